@@ -0,0 +1,151 @@
+// CloudTransportTest - outbox batching and failover timing of CloudTransport
+//
+// Covers queueWrite coalescing, queuePush keys, buildBatch and the wake-up
+// estimate getMillisUntilFlush() reports while WiFi is down. The GPRS flush
+// itself is in SIM800LTest, against the modem emulator.
+
+#include "HostTest.h"
+#include <limits.h>
+#include "../PillDispenser/CloudTransport.h"
+#include "../PillDispenser/TimeManager.h"
+
+TEST(samePathKeepsLatestValue) {
+  CloudTransport transport;
+  CHECK(transport.queueWrite("pilldispenser/device/heartbeat", "{\"seq\":1}"));
+  CHECK(transport.queueWrite("pilldispenser/device/heartbeat", "{\"seq\":2}"));
+  CHECK(transport.queueWrite("pilldispenser/device/heartbeat", "{\"seq\":3}"));
+  CHECK_EQ(transport.getPendingCount(), 1);
+  CHECK_STR(transport.buildBatch().c_str(), "{\"pilldispenser/device/heartbeat\":{\"seq\":3}}");
+}
+
+TEST(urgentSurvivesCoalescing) {
+  // A later routine write to the same path must not demote an urgent one
+  CloudTransport transport;
+  transport.queueWrite("dispensers/1", "{\"status\":\"empty\"}", true);
+  transport.queueWrite("dispensers/1", "{\"status\":\"ok\"}");
+  CHECK_EQ(transport.getPendingCount(), 1);
+  CHECK(transport.hasUrgentWrite());
+  CHECK_STR(transport.buildBatch().c_str(), "{\"dispensers/1\":{\"status\":\"ok\"}}");
+}
+
+TEST(batchKeepsQueueOrder) {
+  CloudTransport transport;
+  CHECK_STR(transport.buildBatch().c_str(), "{}");
+  transport.queueWrite("a/b", "{\"x\":1}");
+  transport.queueWrite("c", "2");
+  transport.queueWrite("d/e/f", "\"text\"");
+  transport.queueWrite("a/b", "{\"x\":4}");
+  CHECK_EQ(transport.getPendingCount(), 3);
+  CHECK(!transport.hasUrgentWrite());
+  CHECK_STR(transport.buildBatch().c_str(), "{\"a/b\":{\"x\":4},\"c\":2,\"d/e/f\":\"text\"}");
+}
+
+TEST(fullOutboxStillCoalesces) {
+  CloudTransport transport;
+  for (int i = 0; i < CLOUD_OUTBOX_SIZE; i++) {
+    CHECK(transport.queueWrite("path/" + String(i), String(i)));
+  }
+  CHECK(!transport.queueWrite("path/extra", "0"));
+  CHECK(transport.queueWrite("path/3", "33"));
+  CHECK_EQ(transport.getPendingCount(), CLOUD_OUTBOX_SIZE);
+  CHECK(transport.buildBatch().indexOf("\"path/3\":33,") > 0);
+  CHECK(transport.buildBatch().indexOf("extra") < 0);
+}
+
+TEST(pushGetsDistinctUrgentKeys) {
+  CloudTransport transport;
+  CHECK(transport.queuePush("pilldispenser/reports", "{\"n\":1}"));
+  CHECK(transport.queuePush("pilldispenser/reports", "{\"n\":2}"));
+  CHECK_EQ(transport.getPendingCount(), 2);
+  CHECK(transport.hasUrgentWrite());
+
+  // {"pilldispenser/reports/gprs_<ms>_<boot>_0":{"n":1},"pilldispenser/reports/gprs_<ms>_<boot>_1":{"n":2}}
+  String batch = transport.buildBatch();
+  int first = batch.indexOf("\"pilldispenser/reports/gprs_");
+  int second = batch.indexOf("\"pilldispenser/reports/gprs_", first + 1);
+  CHECK(first == 1);
+  CHECK(second > first);
+  CHECK(batch.indexOf("_0\":{\"n\":1}") > first);
+  CHECK(batch.indexOf("_1\":{\"n\":2}") > second);
+}
+
+TEST(pushKeysSurviveReboot) {
+  // Same clock reading and sequence after a reboot - the boot number keeps them apart
+  TimeManager clock;
+  clock.applyReferenceTime(1748822400123000LL, "rtc");
+  String keys[2];
+  for (int boot = 0; boot < 2; boot++) {
+    CloudTransport transport;
+    transport.setTimeManager(&clock);
+    CHECK(transport.queuePush("r", "1"));
+    keys[boot] = transport.buildBatch();
+  }
+  CHECK(keys[0].startsWith("{\"r/gprs_1748822400123_"));
+  CHECK(keys[1].startsWith("{\"r/gprs_1748822400123_"));
+  CHECK(keys[0].endsWith("_0\":1}"));
+  CHECK(keys[1].endsWith("_0\":1}"));
+  CHECK(keys[0] != keys[1]);
+}
+
+TEST(clearEmptiesOutbox) {
+  CloudTransport transport;
+  transport.queueWrite("a", "1", true);
+  transport.clearOutbox();
+  CHECK(!transport.hasPending());
+  CHECK(!transport.hasUrgentWrite());
+  CHECK_STR(transport.buildBatch().c_str(), "{}");
+  CHECK_EQ(transport.getMillisUntilFlush(), ULONG_MAX);
+}
+
+TEST(flushEstimateWithoutFallback) {
+  CloudTransport transport;
+  CHECK_EQ(transport.getMillisUntilFlush(), ULONG_MAX);  // Nothing to send
+  transport.queueWrite("a", "1");
+  CHECK_EQ(transport.getMillisUntilFlush(), 0UL);  // On WiFi FirebaseManager flushes next pass
+
+  transport.update(false, "");
+  CHECK_EQ(transport.getActiveLink(), CLOUD_LINK_NONE);
+  CHECK_EQ(transport.getMillisUntilFlush(), ULONG_MAX);  // Only WiFi coming back can send it
+  hostAdvanceMicros(600000000LL);
+  transport.update(false, "");
+  CHECK_EQ(transport.getActiveLink(), CLOUD_LINK_NONE);
+  CHECK_EQ(transport.getPendingCount(), 1);
+}
+
+TEST(flushEstimateCountsDownToFailover) {
+  SIM800L modem(16, 17, 4, Serial2);
+  CloudTransport transport;
+  transport.enableGPRSFallback(&modem, "example-rtdb.firebaseio.com/", "internet");
+  transport.queueWrite("a", "1");
+
+  transport.update(false, "");
+  CHECK_EQ(transport.getMillisUntilFlush(), 60000UL);
+  hostAdvanceMicros(45000000LL);
+  transport.update(false, "");
+  CHECK_EQ(transport.getActiveLink(), CLOUD_LINK_NONE);
+  CHECK_EQ(transport.getMillisUntilFlush(), 15000UL);
+
+  // WiFi back before the failover - stay on WiFi and let FirebaseManager flush
+  transport.update(true, "");
+  CHECK_EQ(transport.getActiveLink(), CLOUD_LINK_WIFI);
+  CHECK_EQ(transport.getMillisUntilFlush(), 0UL);
+
+  // A new outage restarts the countdown
+  hostAdvanceMicros(5000000LL);
+  transport.update(false, "");
+  CHECK_EQ(transport.getMillisUntilFlush(), 60000UL);
+}
+
+int main() {
+  hostAdvanceMicros(10000000LL);  // millis() == 0 means "WiFi not lost" to CloudTransport
+  RUN(samePathKeepsLatestValue);
+  RUN(urgentSurvivesCoalescing);
+  RUN(batchKeepsQueueOrder);
+  RUN(fullOutboxStillCoalesces);
+  RUN(pushGetsDistinctUrgentKeys);
+  RUN(pushKeysSurviveReboot);
+  RUN(clearEmptiesOutbox);
+  RUN(flushEstimateWithoutFallback);
+  RUN(flushEstimateCountsDownToFailover);
+  return testSummary("CloudTransportTest");
+}
@@ -0,0 +1,337 @@
+// HeapSoakTest - 72 hours of hot-path allocations through a first-fit heap
+//
+// Replays each hot path's allocation pattern on its own period, twice: with
+// the String temporaries and String-owning schedules the firmware used to
+// have ("before"), and with what is left now ("after"): FirebaseJson nodes,
+// parse temporaries, WiFi frames and the TLS session.
+//
+//   schedule sync   every 10 s   parse temporaries; before: 60 schedule
+//                                Strings rebuilt each time, kept until the next
+//   status          every 5 s    JSON body; before: path Strings
+//   heartbeat       every minute FirebaseJson; before: ~30 key/value Strings
+//   dose            every 4 h    notification; before: SMS body Strings
+//   TLS session     every 30 min 16 KB + 4 KB + context, held until the next
+//   WiFi frames     every second two RX buffers
+//
+// Each allocation lives for a random part of its path's run time, so paths
+// that overlap free out of order, as concurrent tasks do. The heap is a
+// first-fit list with a header per block and coalescing on free - coarser
+// than the ESP-IDF allocator, so it shows the direction and size of a change,
+// not the device's exact numbers.
+//
+// Sampled every MEMORY_SAMPLE_INTERVAL as MemoryMonitor does, reported per
+// profile: allocations per minute, the smallest largest-free-block, and
+// fragmentation (1 - largest block / free heap), average and worst.
+
+#include "HostTest.h"
+#include <stdint.h>
+#include <vector>
+#include <queue>
+
+#define HEAP_BYTES (120 * 1024)   // Left after WiFi and the Firebase client are up
+#define BLOCK_HEADER 8
+#define MIN_SPLIT 16              // Smaller remainders stay with the block
+#define TICK_MS 50
+#define SOAK_MS (72UL * 3600000UL)
+#define SAMPLE_MS 10000UL         // As MEMORY_SAMPLE_INTERVAL
+#define SAMPLE_PHASE_MS 400UL     // Mid-sync, with WiFi frames in flight
+#define BLOCK_FLOOR 24576         // As MEMORY_DEFAULT_BLOCK_FLOOR
+#define BOOT_OBJECTS 48           // Long-lived allocations made during boot
+
+// ===== FIRST-FIT HEAP =====
+
+struct HeapBlock {
+  uint32_t size;   // Including the header
+  bool used;
+  int prev;        // Neighbours by address, -1 at either end
+  int next;
+};
+
+class FirstFitHeap {
+private:
+  std::vector<HeapBlock> nodes;
+  std::vector<int> spare;   // Recycled node slots
+  int head;
+
+  int newNode(uint32_t size, bool used, int prev, int next) {
+    HeapBlock block = {size, used, prev, next};
+    if (!spare.empty()) {
+      int index = spare.back();
+      spare.pop_back();
+      nodes[index] = block;
+      return index;
+    }
+    nodes.push_back(block);
+    return (int)nodes.size() - 1;
+  }
+
+  // Folds the next block into this one
+  void merge(int index) {
+    int gone = nodes[index].next;
+    nodes[index].size += nodes[gone].size;
+    nodes[index].next = nodes[gone].next;
+    if (nodes[gone].next >= 0) {
+      nodes[nodes[gone].next].prev = index;
+    }
+    spare.push_back(gone);
+  }
+
+public:
+  void reset() {
+    nodes.clear();
+    spare.clear();
+    head = newNode(HEAP_BYTES, false, -1, -1);
+  }
+
+  // Handle of the new block, or -1 if no free block is big enough
+  int allocate(uint32_t bytes) {
+    uint32_t need = ((bytes + 3) & ~3u) + BLOCK_HEADER;
+    for (int i = head; i >= 0; i = nodes[i].next) {
+      if (nodes[i].used || nodes[i].size < need) {
+        continue;
+      }
+      if (nodes[i].size - need >= BLOCK_HEADER + MIN_SPLIT) {
+        int rest = newNode(nodes[i].size - need, false, i, nodes[i].next);
+        if (nodes[i].next >= 0) {
+          nodes[nodes[i].next].prev = rest;
+        }
+        nodes[i].next = rest;
+        nodes[i].size = need;
+      }
+      nodes[i].used = true;
+      return i;
+    }
+    return -1;
+  }
+
+  void release(int index) {
+    nodes[index].used = false;
+    int next = nodes[index].next;
+    if (next >= 0 && !nodes[next].used) {
+      merge(index);
+    }
+    int prev = nodes[index].prev;
+    if (prev >= 0 && !nodes[prev].used) {
+      merge(prev);
+    }
+  }
+
+  void measure(uint32_t& freeBytes, uint32_t& largest) {
+    freeBytes = 0;
+    largest = 0;
+    for (int i = head; i >= 0; i = nodes[i].next) {
+      if (nodes[i].used) {
+        continue;
+      }
+      uint32_t payload = nodes[i].size - BLOCK_HEADER;
+      freeBytes += payload;
+      if (payload > largest) {
+        largest = payload;
+      }
+    }
+  }
+};
+
+// ===== HOT PATHS =====
+
+enum Profile { BEFORE, AFTER };
+
+struct HotPath {
+  const char* name;
+  unsigned long periodMs;
+  unsigned long phaseMs;
+  unsigned long runMs;         // Temporaries are freed within this
+  uint16_t temps[2];           // Per run, before and after
+  uint16_t minSize;
+  uint16_t maxSize;
+  uint16_t kept[2];            // Live until the next run has finished
+  uint16_t keptMin;
+  uint16_t keptMax;
+};
+
+static const HotPath hotPaths[] = {
+  // name          period    phase  run   temps     size        kept     size
+  {"sync",          10000,      0,  800, {66, 60}, 16, 120, {60, 0}, 12, 48},
+  {"status",         5000,   2500,  300, {20, 16}, 24,  96, { 0, 0},  0,  0},
+  {"heartbeat",     60000,  30000, 1500, {50, 20}, 16, 160, { 0, 0},  0,  0},
+  {"dose",       14400000, 600000, 5000, {18,  4}, 32, 200, { 0, 0},  0,  0},
+  {"wifi",           1000,    350,  100, { 2,  2}, 1600, 1700, {0, 0}, 0, 0},
+};
+#define HOT_PATH_COUNT (sizeof(hotPaths) / sizeof(hotPaths[0]))
+
+#define TLS_PERIOD_MS 1800000UL
+static const uint16_t tlsSession[] = {16384, 4096, 1800};
+#define TLS_BLOCKS (sizeof(tlsSession) / sizeof(tlsSession[0]))
+
+struct SoakResult {
+  unsigned long allocations;
+  unsigned long failures;
+  unsigned long tlsFailures;
+  uint32_t minLargest;
+  double fragmentationSum;
+  double maxFragmentation;
+  unsigned long samples;
+  uint32_t freeAfterBoot;
+  uint32_t freeAtEnd;
+};
+
+typedef std::pair<unsigned long, int> PendingFree;   // Due time, block
+static std::priority_queue<PendingFree, std::vector<PendingFree>, std::greater<PendingFree> > pending;
+static FirstFitHeap heap;
+static uint32_t randomState;
+
+static uint32_t nextRandom() {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+static uint32_t randomBetween(uint32_t low, uint32_t high) {
+  return low + nextRandom() % (high - low + 1);
+}
+
+static bool allocateFor(SoakResult& result, uint32_t bytes, unsigned long freeAt) {
+  result.allocations++;
+  int block = heap.allocate(bytes);
+  if (block < 0) {
+    result.failures++;
+    return false;
+  }
+  pending.push(PendingFree(freeAt, block));
+  return true;
+}
+
+static void runPath(const HotPath& path, Profile profile, unsigned long now, SoakResult& result) {
+  int temps = path.temps[profile];
+  int kept = path.kept[profile];
+
+  // Temporaries and kept objects are created interleaved, as a parser does
+  while (temps + kept > 0) {
+    if ((int)randomBetween(1, temps + kept) <= kept) {
+      kept--;
+      allocateFor(result, randomBetween(path.keptMin, path.keptMax), now + path.periodMs + path.runMs);
+    } else {
+      temps--;
+      allocateFor(result, randomBetween(path.minSize, path.maxSize), now + randomBetween(TICK_MS, path.runMs));
+    }
+  }
+}
+
+static void openTLSSession(unsigned long now, SoakResult& result) {
+  // The old session was released just before - the new one must fit whole
+  for (unsigned int i = 0; i < TLS_BLOCKS; i++) {
+    if (!allocateFor(result, tlsSession[i], now + TLS_PERIOD_MS - TICK_MS)) {
+      result.tlsFailures++;
+    }
+  }
+}
+
+static void sampleHeap(SoakResult& result) {
+  uint32_t freeBytes, largest;
+  heap.measure(freeBytes, largest);
+  if (largest < result.minLargest) {
+    result.minLargest = largest;
+  }
+  double fragmentation = freeBytes > 0 ? 1.0 - (double)largest / freeBytes : 0.0;
+  result.fragmentationSum += fragmentation;
+  if (fragmentation > result.maxFragmentation) {
+    result.maxFragmentation = fragmentation;
+  }
+  result.samples++;
+}
+
+static void soak(Profile profile, SoakResult& result) {
+  memset(&result, 0, sizeof(result));
+  result.minLargest = HEAP_BYTES;
+  heap.reset();
+  randomState = 0x2545F491;   // Same sequence for both profiles
+
+  uint32_t largest;
+  std::vector<int> bootObjects;
+  for (int i = 0; i < BOOT_OBJECTS; i++) {
+    bootObjects.push_back(heap.allocate(randomBetween(32, 512)));
+  }
+  heap.measure(result.freeAfterBoot, largest);
+
+  for (unsigned long now = 0; now < SOAK_MS; now += TICK_MS) {
+    while (!pending.empty() && pending.top().first <= now) {
+      heap.release(pending.top().second);
+      pending.pop();
+    }
+    if (now % TLS_PERIOD_MS == 0) {
+      openTLSSession(now, result);
+    }
+    for (unsigned int i = 0; i < HOT_PATH_COUNT; i++) {
+      if (now % hotPaths[i].periodMs == hotPaths[i].phaseMs) {
+        runPath(hotPaths[i], profile, now, result);
+      }
+    }
+    if (now % SAMPLE_MS == SAMPLE_PHASE_MS) {
+      sampleHeap(result);
+    }
+  }
+
+  // Everything still in flight ends - the heap must come back to its boot level
+  while (!pending.empty()) {
+    heap.release(pending.top().second);
+    pending.pop();
+  }
+  heap.measure(result.freeAtEnd, largest);
+  for (size_t i = 0; i < bootObjects.size(); i++) {
+    heap.release(bootObjects[i]);
+  }
+}
+
+static void printResult(const char* name, const SoakResult& result) {
+  printf("  %-7s %lu allocations/min, min largest block %.1f KB, fragmentation %.1f%% avg, %.1f%% worst, "
+         "%lu TLS failures\n",
+         name, result.allocations / (SOAK_MS / 60000UL), result.minLargest / 1024.0,
+         100.0 * result.fragmentationSum / result.samples, 100.0 * result.maxFragmentation,
+         result.tlsFailures);
+}
+
+// ===== CHECKS =====
+
+static SoakResult before, after;
+
+TEST(fewerAllocationsPerMinute) {
+  CHECK(after.allocations * 10 < before.allocations * 7);
+}
+
+TEST(largestBlockDoesNotShrink) {
+  CHECK(after.minLargest >= before.minLargest);
+  CHECK(after.minLargest >= BLOCK_FLOOR);
+}
+
+TEST(tlsSessionAlwaysFits) {
+  CHECK_EQ(before.tlsFailures, 0);
+  CHECK_EQ(after.tlsFailures, 0);
+  CHECK_EQ(before.failures, 0);
+  CHECK_EQ(after.failures, 0);
+}
+
+TEST(fragmentationStaysLow) {
+  CHECK(after.fragmentationSum / after.samples <= before.fragmentationSum / before.samples);
+  CHECK(after.maxFragmentation < 0.25);
+}
+
+TEST(modelDoesNotLeak) {
+  CHECK_EQ(before.freeAtEnd, before.freeAfterBoot);
+  CHECK_EQ(after.freeAtEnd, after.freeAfterBoot);
+}
+
+int main() {
+  soak(BEFORE, before);
+  soak(AFTER, after);
+  printResult("before:", before);
+  printResult("after:", after);
+
+  RUN(fewerAllocationsPerMinute);
+  RUN(largestBlockDoesNotShrink);
+  RUN(tlsSessionAlwaysFits);
+  RUN(fragmentationStaysLow);
+  RUN(modelDoesNotLeak);
+
+  return testSummary("HeapSoakTest");
+}
@@ -0,0 +1,64 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+// Minimal check macros for the host tests - no framework to install.
+//
+//   TEST(name) { CHECK(x == 1); CHECK_STR(a, "b"); }
+//   int main() { RUN(name); return testSummary("suite"); }
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+static int testFailures = 0;
+static int testChecks = 0;
+static const char* testCurrent = "";
+
+#define TEST(name) static void name()
+
+#define RUN(name) \
+  do { \
+    testCurrent = #name; \
+    int failuresBefore = testFailures; \
+    name(); \
+    printf("%s %s\n", testFailures == failuresBefore ? "  ok  " : "  FAIL", #name); \
+  } while (0)
+
+#define CHECK(condition) \
+  do { \
+    testChecks++; \
+    if (!(condition)) { \
+      testFailures++; \
+      printf("    %s:%d: %s: CHECK(%s) failed\n", __FILE__, __LINE__, testCurrent, #condition); \
+    } \
+  } while (0)
+
+#define CHECK_EQ(actual, expected) \
+  do { \
+    testChecks++; \
+    long long a_ = (long long)(actual); \
+    long long e_ = (long long)(expected); \
+    if (a_ != e_) { \
+      testFailures++; \
+      printf("    %s:%d: %s: %s is %lld, expected %lld\n", __FILE__, __LINE__, testCurrent, #actual, a_, e_); \
+    } \
+  } while (0)
+
+#define CHECK_STR(actual, expected) \
+  do { \
+    testChecks++; \
+    std::string a_ = (actual); \
+    std::string e_ = (expected); \
+    if (a_ != e_) { \
+      testFailures++; \
+      printf("    %s:%d: %s: %s\n      got      %s\n      expected %s\n", \
+             __FILE__, __LINE__, testCurrent, #actual, a_.c_str(), e_.c_str()); \
+    } \
+  } while (0)
+
+static inline int testSummary(const char* suite) {
+  printf("%s: %d checks, %d failed\n", suite, testChecks, testFailures);
+  return testFailures == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,625 @@
+#include "ModemEmulator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <termios.h>
+#include <time.h>
+
+#define SIM_CAPACITY 30
+
+ModemProfile modemProfileClean() {
+  ModemProfile p;
+  p.name = "clean";
+  p.latencyMs = 20;
+  p.jitterMs = 10;
+  p.errorRate = 0.0;
+  p.silenceRate = 0.0;
+  p.hangAfter = 0;
+  p.flapPeriodMs = 0;
+  p.flapDownMs = 0;
+  p.smsSubmitMs = 1500;
+  p.inboundSmsMs = 0;
+  p.bearerOpenMs = 2000;
+  p.httpMs = 3000;
+  p.httpStatus = 200;
+  return p;
+}
+
+const char* const MODEM_PROFILE_NAMES[MODEM_PROFILE_COUNT] = {
+  "clean", "slow", "lossy", "flapping", "hung"
+};
+
+bool modemProfileByName(const char* name, ModemProfile* profile) {
+  ModemProfile p = modemProfileClean();
+  std::string wanted(name);
+  if (wanted == "clean") {
+    // Defaults
+  } else if (wanted == "slow") {
+    // Weak signal: every reply lags and the network takes its time
+    p.name = "slow";
+    p.latencyMs = 400;
+    p.jitterMs = 600;
+    p.smsSubmitMs = 6000;
+    p.bearerOpenMs = 8000;
+    p.httpMs = 10000;
+  } else if (wanted == "lossy") {
+    // Noisy UART or a browned-out module: some replies wrong, some missing
+    p.name = "lossy";
+    p.errorRate = 0.05;
+    p.silenceRate = 0.05;
+  } else if (wanted == "flapping") {
+    // Cell edge: registration lost for 30 s every 90 s
+    p.name = "flapping";
+    p.flapPeriodMs = 90000;
+    p.flapDownMs = 30000;
+  } else if (wanted == "hung") {
+    // Firmware lock-up every 60 commands, cleared only by the RST pin
+    p.name = "hung";
+    p.hangAfter = 60;
+  } else {
+    return false;
+  }
+  *profile = p;
+  return true;
+}
+
+static int64_t monotonicMicros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static std::string upper(const std::string& text) {
+  std::string out(text);
+  for (size_t i = 0; i < out.size(); i++) {
+    out[i] = toupper((unsigned char)out[i]);
+  }
+  return out;
+}
+
+static bool startsWith(const std::string& text, const char* prefix) {
+  return text.compare(0, strlen(prefix), prefix) == 0;
+}
+
+// Second quoted field of AT+HTTPPARA="KEY","value" (the value may hold commas)
+static std::string quotedValue(const std::string& command) {
+  size_t comma = command.find("\",\"");
+  if (comma == std::string::npos) {
+    return "";
+  }
+  size_t start = comma + 3;
+  size_t end = command.rfind('"');
+  return end > start ? command.substr(start, end - start) : "";
+}
+
+ModemEmulator::ModemEmulator() {
+  master = -1;
+  slaveKeep = -1;
+  running = false;
+  profile = modemProfileClean();
+  speed = 1;
+  startedUs = monotonicMicros();
+  seed = 12345;
+  messageReference = 0;
+  nextInboundUs = 0;
+  inboundSequence = 0;
+  resetCount = 0;
+  callOutcome = "MO CONNECTED";
+  forcedUnregistered = false;
+  resetState();
+}
+
+ModemEmulator::~ModemEmulator() {
+  stop();
+  if (slaveKeep >= 0) close(slaveKeep);
+  if (master >= 0) close(master);
+}
+
+bool ModemEmulator::open() {
+  master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+    return false;
+  }
+  const char* name = ptsname(master);
+  if (name == nullptr) {
+    return false;
+  }
+  slave = name;
+  fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+  // Hold the slave open so the master never sees EIO between clients
+  slaveKeep = openSlave();
+  return slaveKeep >= 0;
+}
+
+const std::string& ModemEmulator::slavePath() {
+  return slave;
+}
+
+int ModemEmulator::openSlave() {
+  int fd = ::open(slave.c_str(), O_RDWR | O_NOCTTY);
+  if (fd < 0) {
+    return -1;
+  }
+  // A UART passes bytes untouched - no echo, no CR/LF translation
+  struct termios tio;
+  tcgetattr(fd, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(fd, TCSANOW, &tio);
+  return fd;
+}
+
+void ModemEmulator::start(const ModemProfile& modemProfile, unsigned speedFactor) {
+  stop();
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    profile = modemProfile;
+    speed = speedFactor > 0 ? speedFactor : 1;
+    startedUs = monotonicMicros();
+    nextInboundUs = (int64_t)profile.inboundSmsMs * 1000;
+  }
+  running = true;
+  worker = std::thread(&ModemEmulator::run, this);
+}
+
+void ModemEmulator::stop() {
+  running = false;
+  if (worker.joinable()) {
+    worker.join();
+  }
+}
+
+void ModemEmulator::setProfile(const ModemProfile& modemProfile) {
+  std::lock_guard<std::mutex> guard(lock);
+  profile = modemProfile;
+  commandCount = 0;
+  nextInboundUs = nowUs() + (int64_t)profile.inboundSmsMs * 1000;
+}
+
+void ModemEmulator::reset() {
+  std::lock_guard<std::mutex> guard(lock);
+  resetState();
+  resetCount++;
+
+  // Boot chatter of a real module, once it has come back up
+  int64_t booted = nowUs() + 2000000LL;
+  replyAt(booted, "\r\nRDY\r\n\r\n+CFUN: 1\r\n\r\n+CPIN: READY\r\n");
+  replyAt(booted + 1000000LL, "\r\nCall Ready\r\n\r\nSMS Ready\r\n");
+}
+
+void ModemEmulator::resetState() {
+  // Power-on defaults. URCs start off, so a driver that does not
+  // configure them again after a reset never hears about new SMS.
+  echo = true;
+  pduMode = true;
+  cnmiEnabled = false;
+  cfgri = false;
+  moring = false;
+  bearerOpen = false;
+  httpSession = false;
+  hung = false;
+  commandCount = 0;
+  inputMode = INPUT_COMMAND;
+  line.clear();
+  payload.clear();
+  payloadExpected = 0;
+  pendingSmsLength = 0;
+  outputs.clear();
+}
+
+void ModemEmulator::deliverSMS(const std::string& sender, const std::string& body) {
+  std::lock_guard<std::mutex> guard(lock);
+  storeSMS(sender, body);
+}
+
+void ModemEmulator::setRegistered(bool registered) {
+  std::lock_guard<std::mutex> guard(lock);
+  forcedUnregistered = !registered;
+}
+
+void ModemEmulator::setCallOutcome(const std::string& urc) {
+  std::lock_guard<std::mutex> guard(lock);
+  callOutcome = urc;
+}
+
+std::vector<std::string> ModemEmulator::commands() {
+  std::lock_guard<std::mutex> guard(lock);
+  return commandLog;
+}
+
+std::vector<ModemSentSMS> ModemEmulator::sentSMS() {
+  std::lock_guard<std::mutex> guard(lock);
+  return smsLog;
+}
+
+std::vector<ModemHTTPRequest> ModemEmulator::httpRequests() {
+  std::lock_guard<std::mutex> guard(lock);
+  return httpLog;
+}
+
+int ModemEmulator::storedSMSCount() {
+  std::lock_guard<std::mutex> guard(lock);
+  return (int)storage.size();
+}
+
+bool ModemEmulator::urcEnabled() {
+  std::lock_guard<std::mutex> guard(lock);
+  return cnmiEnabled;
+}
+
+bool ModemEmulator::ringOnSMS() {
+  std::lock_guard<std::mutex> guard(lock);
+  return cfgri;
+}
+
+unsigned long ModemEmulator::resets() {
+  std::lock_guard<std::mutex> guard(lock);
+  return resetCount;
+}
+
+void ModemEmulator::clearLog() {
+  std::lock_guard<std::mutex> guard(lock);
+  commandLog.clear();
+  smsLog.clear();
+  httpLog.clear();
+}
+
+int64_t ModemEmulator::nowUs() {
+  return (monotonicMicros() - startedUs) * speed;
+}
+
+double ModemEmulator::random01() {
+  return (double)rand_r(&seed) / ((double)RAND_MAX + 1.0);
+}
+
+unsigned ModemEmulator::replyDelayMs() {
+  unsigned delayMs = profile.latencyMs;
+  if (profile.jitterMs > 0) {
+    delayMs += rand_r(&seed) % (profile.jitterMs + 1);
+  }
+  return delayMs;
+}
+
+bool ModemEmulator::isRegistered(int64_t now) {
+  if (forcedUnregistered) {
+    return false;
+  }
+  if (profile.flapPeriodMs == 0 || profile.flapDownMs == 0) {
+    return true;
+  }
+  int64_t phase = (now / 1000) % profile.flapPeriodMs;
+  return phase < (int64_t)(profile.flapPeriodMs - profile.flapDownMs);
+}
+
+void ModemEmulator::run() {
+  while (running) {
+    int64_t waitUs = 2000;
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      if (!outputs.empty()) {
+        int64_t untilDue = (outputs.front().due - nowUs()) / speed;
+        waitUs = untilDue < 0 ? 0 : (untilDue < waitUs ? untilDue : waitUs);
+      }
+    }
+
+    struct pollfd p = {master, POLLIN, 0};
+    struct timespec timeout = {0, (long)waitUs * 1000};
+    if (ppoll(&p, 1, &timeout, nullptr) > 0 && (p.revents & POLLIN)) {
+      char buffer[256];
+      ssize_t n = read(master, buffer, sizeof(buffer));
+      std::lock_guard<std::mutex> guard(lock);
+      for (ssize_t i = 0; i < n; i++) {
+        receive(buffer[i]);
+      }
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    int64_t now = nowUs();
+    if (profile.inboundSmsMs > 0 && now >= nextInboundUs) {
+      inboundSequence++;
+      storeSMS("+639171234567", "STATUS " + std::to_string(inboundSequence));
+      nextInboundUs = now + (int64_t)profile.inboundSmsMs * 1000;
+    }
+    flushOutputs();
+  }
+}
+
+void ModemEmulator::flushOutputs() {
+  int64_t now = nowUs();
+  while (!outputs.empty() && outputs.front().due <= now) {
+    const std::string& text = outputs.front().text;
+    size_t sent = 0;
+    while (sent < text.size()) {
+      ssize_t n = write(master, text.data() + sent, text.size() - sent);
+      if (n > 0) {
+        sent += n;
+      } else {
+        usleep(100);
+      }
+    }
+    outputs.pop_front();
+  }
+}
+
+void ModemEmulator::replyAt(int64_t due, const std::string& text) {
+  // Replies leave in order, even when a later one has a shorter delay
+  if (!outputs.empty() && outputs.back().due > due) {
+    due = outputs.back().due;
+  }
+  Output output = {due, text};
+  outputs.push_back(output);
+}
+
+void ModemEmulator::reply(const std::string& text, unsigned extraMs) {
+  replyAt(nowUs() + (int64_t)(replyDelayMs() + extraMs) * 1000, text);
+}
+
+void ModemEmulator::storeSMS(const std::string& sender, const std::string& body) {
+  if ((int)storage.size() >= SIM_CAPACITY) {
+    return;
+  }
+  // Lowest free index, like the SIM
+  int index = 1;
+  for (bool taken = true; taken; ) {
+    taken = false;
+    for (size_t i = 0; i < storage.size(); i++) {
+      if (storage[i].index == index) {
+        taken = true;
+        index++;
+        break;
+      }
+    }
+  }
+  StoredSMS sms = {index, sender, body, false};
+  storage.push_back(sms);
+  if (cnmiEnabled && !hung) {
+    replyAt(nowUs(), "\r\n+CMTI: \"SM\"," + std::to_string(index) + "\r\n");
+  }
+}
+
+void ModemEmulator::receive(char c) {
+  if (hung) {
+    return;
+  }
+
+  if (inputMode == INPUT_SMS) {
+    if (c == 26) {
+      handleSMSPayload(true);
+    } else if (c == 27) {
+      handleSMSPayload(false);
+    } else if (c != '\r' && c != '\n') {
+      payload += c;
+    }
+    return;
+  }
+
+  if (inputMode == INPUT_HTTP_DATA) {
+    if (payload.empty() && c == '\n') {
+      return;  // End of the AT+HTTPDATA line, not part of the body
+    }
+    payload += c;
+    if (payload.size() >= payloadExpected) {
+      handleHTTPData();
+    }
+    return;
+  }
+
+  if (echo) {
+    replyAt(nowUs(), std::string(1, c));
+  }
+  if (c == '\r') {
+    std::string command = line;
+    line.clear();
+    handleCommand(command);
+  } else if (c != '\n' && line.size() < 1024) {
+    line += c;
+  }
+}
+
+void ModemEmulator::handleCommand(const std::string& raw) {
+  std::string command = raw;
+  while (!command.empty() && command[0] == ' ') command.erase(0, 1);
+  if (command.empty()) {
+    return;
+  }
+  std::string cmd = upper(command);
+  commandLog.push_back(command);
+
+  commandCount++;
+  if (profile.hangAfter > 0 && commandCount > profile.hangAfter) {
+    hung = true;  // Silent until the RST pin is pulsed
+    outputs.clear();
+    return;
+  }
+
+  double roll = random01();
+  if (roll < profile.silenceRate) {
+    return;
+  }
+  if (roll < profile.silenceRate + profile.errorRate) {
+    reply("\r\nERROR\r\n");
+    return;
+  }
+
+  int64_t now = nowUs();
+  bool registered = isRegistered(now);
+  const std::string ok = "\r\nOK\r\n";
+
+  if (cmd == "AT") {
+    reply(ok);
+  } else if (cmd == "ATE0" || cmd == "ATE1") {
+    echo = cmd == "ATE1";
+    reply(ok);
+  } else if (cmd == "ATI") {
+    reply("\r\nSIM800 R14.18\r\n" + ok);
+  } else if (cmd == "AT+CPIN?") {
+    reply("\r\n+CPIN: READY\r\n" + ok);
+  } else if (cmd == "AT+CREG?") {
+    reply(std::string("\r\n+CREG: 0,") + (registered ? "1" : "2") + "\r\n" + ok);
+  } else if (cmd == "AT+CSQ") {
+    reply(std::string("\r\n+CSQ: ") + (registered ? "18,0" : "99,99") + "\r\n" + ok);
+  } else if (cmd == "AT+COPS?") {
+    reply(std::string(registered ? "\r\n+COPS: 0,0,\"EMULATED\"\r\n" : "\r\n+COPS: 0\r\n") + ok);
+  } else if (cmd == "AT+COPS=0") {
+    reply(ok, 1000);
+  } else if (startsWith(cmd, "AT+CMGF=")) {
+    pduMode = cmd == "AT+CMGF=0";
+    reply(ok);
+  } else if (cmd == "AT+CMGF?") {
+    reply(std::string("\r\n+CMGF: ") + (pduMode ? "0" : "1") + "\r\n" + ok);
+  } else if (startsWith(cmd, "AT+CPMS")) {
+    std::string used = std::to_string(storage.size());
+    reply("\r\n+CPMS: " + used + ",30," + used + ",30," + used + ",30\r\n" + ok);
+  } else if (startsWith(cmd, "AT+CNMI=")) {
+    // <mode>,<mt>: mt 1 stores the message and reports +CMTI
+    size_t comma = cmd.find(',');
+    cnmiEnabled = comma != std::string::npos && atoi(cmd.c_str() + comma + 1) == 1;
+    reply(ok);
+  } else if (startsWith(cmd, "AT+CFGRI=")) {
+    cfgri = atoi(cmd.c_str() + 9) == 1;
+    reply(ok);
+  } else if (startsWith(cmd, "AT+MORING=")) {
+    moring = atoi(cmd.c_str() + 10) == 1;
+    reply(ok);
+  } else if (startsWith(cmd, "AT+CMGL")) {
+    std::string list = "\r\n";
+    for (size_t i = 0; i < storage.size(); i++) {
+      list += "+CMGL: " + std::to_string(storage[i].index) + ",\"" +
+              (storage[i].read ? "REC READ" : "REC UNREAD") + "\",\"" + storage[i].sender +
+              "\",\"\",\"24/10/18,12:00:00+32\"\r\n" + storage[i].body + "\r\n";
+      storage[i].read = true;
+    }
+    reply((storage.empty() ? std::string() : list) + ok);
+  } else if (startsWith(cmd, "AT+CMGR=")) {
+    int index = atoi(cmd.c_str() + 8);
+    std::string found;
+    for (size_t i = 0; i < storage.size(); i++) {
+      if (storage[i].index == index) {
+        found = "\r\n+CMGR: \"" + std::string(storage[i].read ? "REC READ" : "REC UNREAD") + "\",\"" +
+                storage[i].sender + "\",\"\",\"24/10/18,12:00:00+32\"\r\n" + storage[i].body + "\r\n";
+        storage[i].read = true;
+      }
+    }
+    reply(found + ok);
+  } else if (startsWith(cmd, "AT+CMGD=")) {
+    int index = atoi(cmd.c_str() + 8);
+    for (size_t i = 0; i < storage.size(); i++) {
+      if (storage[i].index == index) {
+        storage.erase(storage.begin() + i);
+        break;
+      }
+    }
+    reply(ok);
+  } else if (startsWith(cmd, "AT+CMGS=")) {
+    pendingSmsLength = pduMode ? atoi(cmd.c_str() + 8) : 0;
+    payload.clear();
+    inputMode = INPUT_SMS;
+    reply("\r\n> ");
+  } else if (startsWith(cmd, "ATD")) {
+    if (!registered) {
+      reply("\r\nNO CARRIER\r\n");
+      return;
+    }
+    reply(ok);
+    if (moring) {
+      reply("\r\nMO RING\r\n", 2000);
+    }
+    reply("\r\n" + callOutcome + "\r\n", 6000);
+  } else if (cmd == "ATH" || cmd == "ATA") {
+    reply(ok);
+  } else if (startsWith(cmd, "AT+SAPBR=3,1")) {
+    reply(ok);
+  } else if (cmd == "AT+SAPBR=1,1") {
+    if (registered && !bearerOpen) {
+      bearerOpen = true;
+      reply(ok, profile.bearerOpenMs);
+    } else {
+      reply("\r\nERROR\r\n", profile.bearerOpenMs);
+    }
+  } else if (cmd == "AT+SAPBR=2,1") {
+    bool up = bearerOpen && registered;
+    reply(std::string(up ? "\r\n+SAPBR: 1,1,\"10.64.0.2\"\r\n" : "\r\n+SAPBR: 1,3,\"0.0.0.0\"\r\n") + ok);
+  } else if (cmd == "AT+SAPBR=0,1") {
+    reply(bearerOpen ? ok : "\r\nERROR\r\n");
+    bearerOpen = false;
+  } else if (cmd == "AT+HTTPTERM") {
+    reply(httpSession ? ok : "\r\nERROR\r\n");
+    httpSession = false;
+  } else if (cmd == "AT+HTTPINIT") {
+    reply(httpSession ? "\r\nERROR\r\n" : ok);
+    httpSession = true;
+    pendingHTTP = ModemHTTPRequest();
+  } else if (startsWith(cmd, "AT+HTTPPARA=")) {
+    if (startsWith(cmd, "AT+HTTPPARA=\"URL\"")) {
+      pendingHTTP.url = quotedValue(command);
+    } else if (startsWith(cmd, "AT+HTTPPARA=\"USERDATA\"")) {
+      pendingHTTP.userData = quotedValue(command);
+    }
+    reply(httpSession ? ok : "\r\nERROR\r\n");
+  } else if (startsWith(cmd, "AT+HTTPSSL=")) {
+    reply(ok);
+  } else if (startsWith(cmd, "AT+HTTPDATA=")) {
+    payloadExpected = (size_t)atoi(cmd.c_str() + 12);
+    payload.clear();
+    inputMode = INPUT_HTTP_DATA;
+    reply("\r\nDOWNLOAD\r\n");
+  } else if (startsWith(cmd, "AT+HTTPACTION=")) {
+    if (!httpSession) {
+      reply("\r\nERROR\r\n");
+      return;
+    }
+    pendingHTTP.action = atoi(cmd.c_str() + 14);
+    httpLog.push_back(pendingHTTP);
+    int status = bearerOpen && registered ? profile.httpStatus : 601;  // 601: network error
+    reply(ok);
+    reply("\r\n+HTTPACTION: " + std::to_string(pendingHTTP.action) + "," + std::to_string(status) + ",0\r\n",
+          profile.httpMs);
+  } else if (cmd == "AT+CGATT?") {
+    reply(std::string("\r\n+CGATT: ") + (registered ? "1" : "0") + "\r\n" + ok);
+  } else if (startsWith(cmd, "AT+CGDCONT") || startsWith(cmd, "AT+COLP") || startsWith(cmd, "AT+CLIP")) {
+    reply(ok);
+  } else {
+    reply("\r\nERROR\r\n");
+  }
+}
+
+void ModemEmulator::handleSMSPayload(bool send) {
+  inputMode = INPUT_COMMAND;
+  if (!send) {
+    payload.clear();
+    return;  // ESC - the submit is abandoned without a reply
+  }
+
+  ModemSentSMS sms = {payload, pendingSmsLength, pduMode};
+  if (pduMode) {
+    // Hex PDU: SMSC field (length octet + address) followed by exactly <length> TPDU octets
+    bool hex = payload.size() >= 2 && payload.size() % 2 == 0;
+    for (size_t i = 0; hex && i < payload.size(); i++) {
+      hex = isxdigit((unsigned char)payload[i]) != 0;
+    }
+    int smscOctets = hex ? (int)strtol(payload.substr(0, 2).c_str(), nullptr, 16) : 0;
+    if (!hex || (int)payload.size() / 2 != 1 + smscOctets + pendingSmsLength) {
+      reply("\r\n+CMS ERROR: 304\r\n");
+      return;
+    }
+  }
+  if (!isRegistered(nowUs())) {
+    reply("\r\n+CMS ERROR: 331\r\n", profile.smsSubmitMs);
+    return;
+  }
+
+  smsLog.push_back(sms);
+  messageReference = (messageReference + 1) % 256;
+  reply("\r\n+CMGS: " + std::to_string(messageReference) + "\r\n\r\nOK\r\n", profile.smsSubmitMs);
+}
+
+void ModemEmulator::handleHTTPData() {
+  inputMode = INPUT_COMMAND;
+  pendingHTTP.body = payload;
+  payload.clear();
+  reply("\r\nOK\r\n");
+}
@@ -0,0 +1,167 @@
+#ifndef MODEM_EMULATOR_H
+#define MODEM_EMULATOR_H
+
+// ModemEmulator - a SIM800L stand-in on a Linux pseudo-terminal
+//
+// Speaks the AT subset SIM800L.cpp uses: AT/ATE0/ATI, CPIN, CREG, CSQ, COPS,
+// CMGF, CPMS, CNMI, CFGRI, MORING, CMGL, CMGR, CMGD, CMGS (PDU and text),
+// ATD/ATH/ATA, SAPBR and the HTTP commands. Anything else answers ERROR.
+//
+// A ModemProfile adds the faults a real module shows in the field:
+// reply latency and jitter, ERROR replies, replies that never come, a hung
+// module that only a reset revives, registration flaps, slow SMS submits
+// and inbound SMS arriving as +CMTI URCs.
+//
+// Times in the profile are device milliseconds. With speed > 1 the emulator
+// runs that many times faster than the wall clock, matching the host shim's
+// hostUseRealClock(true, speed), so long scenarios finish quickly.
+//
+// The emulator runs on its own thread; the other side of the pty is an
+// ordinary serial port (see slavePath()).
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+struct ModemProfile {
+  const char* name;
+  unsigned latencyMs;         // Before every reply
+  unsigned jitterMs;          // Random extra, 0..jitterMs
+  double errorRate;           // Chance a command answers ERROR
+  double silenceRate;         // Chance a command gets no reply at all
+  unsigned hangAfter;         // Go silent this many commands after a reset or profile change (0 = never)
+  unsigned flapPeriodMs;      // Registration drops once per period (0 = never)
+  unsigned flapDownMs;        // ...for this long
+  unsigned smsSubmitMs;       // Network time from Ctrl+Z to +CMGS
+  unsigned inboundSmsMs;      // Deliver an SMS (+CMTI) this often (0 = never)
+  unsigned bearerOpenMs;      // AT+SAPBR=1,1
+  unsigned httpMs;            // AT+HTTPACTION to +HTTPACTION URC
+  int httpStatus;
+};
+
+// A profile with no faults and typical SIM800L timings
+ModemProfile modemProfileClean();
+
+// The fault profiles the benchmark runs: clean, slow, lossy, flapping, hung
+#define MODEM_PROFILE_COUNT 5
+extern const char* const MODEM_PROFILE_NAMES[MODEM_PROFILE_COUNT];
+bool modemProfileByName(const char* name, ModemProfile* profile);
+
+struct ModemSentSMS {
+  std::string pdu;            // Hex PDU as received (PDU mode), or the text (text mode)
+  int declaredLength;         // AT+CMGS=<length>
+  bool pduMode;
+};
+
+struct ModemHTTPRequest {
+  std::string url;
+  std::string userData;
+  std::string body;
+  int action;                 // 0 GET, 1 POST
+};
+
+class ModemEmulator {
+public:
+  ModemEmulator();
+  ~ModemEmulator();
+
+  bool open();                      // Create the pty; false if the host has none
+  const std::string& slavePath();
+  int openSlave();                  // Raw-mode fd for the device side
+  void start(const ModemProfile& profile, unsigned speed = 1);
+  void stop();
+  void setProfile(const ModemProfile& profile);
+
+  // Scenario control (thread safe)
+  void reset();                     // RST pin pulsed - echo back on, settings and bearer lost
+  void deliverSMS(const std::string& sender, const std::string& body);
+  void setRegistered(bool registered);
+  void setCallOutcome(const std::string& urc);  // "MO CONNECTED", "BUSY", ... after MO RING
+
+  // What the device did (thread safe copies)
+  std::vector<std::string> commands();
+  std::vector<ModemSentSMS> sentSMS();
+  std::vector<ModemHTTPRequest> httpRequests();
+  int storedSMSCount();
+  bool urcEnabled();                // AT+CNMI asked for +CMTI
+  bool ringOnSMS();                 // AT+CFGRI=1
+  unsigned long resets();
+  void clearLog();
+
+private:
+  struct Output {
+    int64_t due;                    // Device microseconds
+    std::string text;
+  };
+  struct StoredSMS {
+    int index;
+    std::string sender;
+    std::string body;
+    bool read;
+  };
+  enum InputMode { INPUT_COMMAND, INPUT_SMS, INPUT_HTTP_DATA };
+
+  int master;
+  int slaveKeep;
+  std::string slave;
+  std::thread worker;
+  std::atomic<bool> running;
+  std::mutex lock;
+
+  ModemProfile profile;
+  unsigned speed;
+  int64_t startedUs;
+  unsigned seed;
+
+  // Module state, reset by reset()
+  bool echo;
+  bool pduMode;
+  bool cnmiEnabled;
+  bool cfgri;
+  bool moring;
+  bool bearerOpen;
+  bool httpSession;
+  bool hung;
+  unsigned commandCount;
+  bool forcedUnregistered;
+  std::string callOutcome;
+
+  InputMode inputMode;
+  std::string line;
+  std::string payload;
+  size_t payloadExpected;
+  int pendingSmsLength;
+  int messageReference;
+  ModemHTTPRequest pendingHTTP;
+
+  std::deque<Output> outputs;
+  std::vector<StoredSMS> storage;
+  int64_t nextInboundUs;
+  int inboundSequence;
+
+  std::vector<std::string> commandLog;
+  std::vector<ModemSentSMS> smsLog;
+  std::vector<ModemHTTPRequest> httpLog;
+  unsigned long resetCount;
+
+  int64_t nowUs();
+  unsigned replyDelayMs();
+  double random01();
+  bool isRegistered(int64_t now);
+  void resetState();
+  void run();
+  void receive(char c);
+  void handleCommand(const std::string& command);
+  void handleSMSPayload(bool send);
+  void handleHTTPData();
+  void reply(const std::string& text, unsigned extraMs = 0);
+  void replyAt(int64_t due, const std::string& text);
+  void storeSMS(const std::string& sender, const std::string& body);
+  void flushOutputs();
+};
+
+#endif
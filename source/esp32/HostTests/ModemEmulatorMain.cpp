@@ -0,0 +1,60 @@
+// modememu - run the SIM800L emulator on its own
+//
+//   ./modememu [profile] [speed]
+//
+// Prints the pseudo-terminal to open (screen, minicom, a bridge to another
+// host) and serves it until Ctrl-C, then lists the commands it saw. The
+// profiles are those of the benchmark: clean, slow, lossy, flapping, hung.
+
+#include "ModemEmulator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int) {
+  stopRequested = 1;
+}
+
+int main(int argc, char** argv) {
+  const char* name = argc > 1 ? argv[1] : "clean";
+  unsigned speed = argc > 2 ? (unsigned)atoi(argv[2]) : 1;
+
+  ModemProfile profile;
+  if (!modemProfileByName(name, &profile)) {
+    fprintf(stderr, "modememu: unknown profile '%s' (", name);
+    for (int i = 0; i < MODEM_PROFILE_COUNT; i++) {
+      fprintf(stderr, "%s%s", i > 0 ? ", " : "", MODEM_PROFILE_NAMES[i]);
+    }
+    fprintf(stderr, ")\n");
+    return 2;
+  }
+
+  ModemEmulator emulator;
+  if (!emulator.open()) {
+    perror("modememu: pseudo-terminal");
+    return 1;
+  }
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  emulator.start(profile, speed);
+  printf("SIM800L emulator (%s, %ux) on %s\n", profile.name, speed > 0 ? speed : 1,
+         emulator.slavePath().c_str());
+  fflush(stdout);
+
+  while (!stopRequested) {
+    usleep(100000);
+  }
+  emulator.stop();
+
+  std::vector<std::string> commands = emulator.commands();
+  printf("\n%zu command(s), %zu SMS sent, %zu HTTP request(s)\n", commands.size(),
+         emulator.sentSMS().size(), emulator.httpRequests().size());
+  for (size_t i = 0; i < commands.size(); i++) {
+    printf("  %s\n", commands[i].c_str());
+  }
+  return 0;
+}
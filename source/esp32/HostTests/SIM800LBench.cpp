@@ -0,0 +1,127 @@
+// SIM800LBench - SMS throughput and GSM task stalls under modem faults
+//
+// Runs the GSM task's loop body against the pty emulator once per fault
+// profile (see modemProfileByName): every GSM_TASK_PERIOD it runs
+// sim800.update() and SMSCommandHandler::update(), which fetch and delete
+// the inbound messages the emulator delivers, and every SMS_INTERVAL it sends
+// a notification, alternating single-part and two-part texts.
+//
+// Reported per profile:
+//   SMS ok     messages accepted by the network / messages attempted
+//   parts/min  parts accepted per minute spent inside sendSMS()
+//   max, p99   longest and 99th percentile loop pass - how long a queued
+//              request or an RI wake waits for the modem lock
+//   blocked    share of the run the loop spent inside the driver
+//   inbound    SMS commands parsed / messages still on the SIM at the end
+//
+// Times are device milliseconds; the run is BENCH_SPEED times faster than
+// the wall clock.
+
+#include "ModemEmulator.h"
+#include "../PillDispenser/SIM800L.h"
+#include "../PillDispenser/SMSCommandHandler.h"
+#include "../PillDispenser/PINS_CONFIG.h"
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+
+#define BENCH_SPEED 50
+#define BENCH_MS 300000UL         // Five device minutes per profile
+#define GSM_TASK_PERIOD 50        // As in PillDispenser.ino
+#define SMS_INTERVAL 30000UL
+#define INBOUND_INTERVAL 20000
+#define CAREGIVER "+639171234567"
+
+static ModemEmulator emulator;
+static SIM800L sim800(PIN_SIM800_RX, PIN_SIM800_TX, PIN_SIM800_RST, Serial2);
+static SMSCommandHandler smsCommands(&sim800);
+
+static void onPin(uint8_t pin, uint8_t value) {
+  if (pin == PIN_SIM800_RST && value == LOW) {
+    emulator.reset();
+  }
+}
+
+static void runProfile(const char* name) {
+  ModemProfile profile;
+  modemProfileByName(name, &profile);
+  profile.inboundSmsMs = INBOUND_INTERVAL;
+  emulator.setProfile(profile);
+  sim800.begin();
+  emulator.clearLog();
+
+  String shortText = "[PILL DISPENSER] Dose taken at 08:00";
+  String longText = "[PILL DISPENSER] Missed dose:";
+  while (longText.length() < 200) {
+    longText += " Metformin 500mg";
+  }
+
+  std::vector<unsigned long> passes;
+  unsigned long busyMs = 0;
+  unsigned long smsMs = 0;
+  int smsAttempts = 0;
+  int smsSent = 0;
+  int commandsParsed = 0;
+
+  unsigned long started = millis();
+  unsigned long nextSMS = 0;  // Offset into the run
+  while (millis() - started < BENCH_MS) {
+    unsigned long passStart = millis();
+
+    if (millis() - started >= nextSMS) {
+      unsigned long smsStart = millis();
+      if (sim800.sendSMS(CAREGIVER, smsAttempts % 2 == 0 ? shortText : longText)) {
+        smsSent++;
+      }
+      smsAttempts++;
+      smsMs += millis() - smsStart;
+      nextSMS += SMS_INTERVAL;
+    }
+
+    sim800.update();
+    smsCommands.update();
+    while (smsCommands.hasCommand()) {
+      smsCommands.popCommand();
+      commandsParsed++;
+    }
+
+    unsigned long pass = millis() - passStart;
+    passes.push_back(pass);
+    busyMs += pass;
+    delay(GSM_TASK_PERIOD);
+  }
+  unsigned long window = millis() - started;
+
+  size_t parts = emulator.sentSMS().size();
+  std::sort(passes.begin(), passes.end());
+  unsigned long p99 = passes.empty() ? 0 : passes[(passes.size() * 99) / 100];
+  unsigned long worst = passes.empty() ? 0 : passes.back();
+
+  printf("%-9s %3d/%-3d %9.1f %8lu %8lu %7.1f%% %7d/%d\n",
+         name, smsSent, smsAttempts, smsMs > 0 ? parts * 60000.0 / smsMs : 0.0,
+         worst, p99, window > 0 ? busyMs * 100.0 / window : 0.0,
+         commandsParsed, emulator.storedSMSCount());
+  fflush(stdout);
+}
+
+int main() {
+  if (!emulator.open()) {
+    printf("SIM800LBench: no pseudo-terminal on this host\n");
+    return 1;
+  }
+  Serial2.attach(emulator.openSlave());
+  hostOnDigitalWrite(onPin);
+  hostUseRealClock(true, BENCH_SPEED);
+  emulator.start(modemProfileClean(), BENCH_SPEED);
+  smsCommands.addAuthorizedSender(CAREGIVER);
+
+  printf("SIM800L under modem faults - %lu s per profile, SMS every %lu s, inbound every %d s\n\n",
+         BENCH_MS / 1000, SMS_INTERVAL / 1000, INBOUND_INTERVAL / 1000);
+  printf("%-9s %7s %9s %8s %8s %8s %9s\n", "profile", "SMS ok", "parts/min", "max ms", "p99 ms", "blocked", "inbound");
+  for (int i = 0; i < MODEM_PROFILE_COUNT; i++) {
+    runProfile(MODEM_PROFILE_NAMES[i]);
+  }
+
+  emulator.stop();
+  return 0;
+}
@@ -0,0 +1,299 @@
+// SIM800LTest - the SIM800L driver against the pty modem emulator
+//
+// The driver talks to ModemEmulator through Serial2 exactly as it talks to
+// the module on the board: begin() and its post-reset configuration, PDU
+// SMS submits, +CMTI handling, registration loss, ERROR replies, a hung
+// module and the CloudTransport GPRS flush with its auth limits.
+//
+// The clock is real but sped up (TEST_SPEED), so the driver's 1 s command
+// spacing and multi-second waits take milliseconds of wall time.
+
+#include "HostTest.h"
+#include "ModemEmulator.h"
+#include "../PillDispenser/SIM800L.h"
+#include "../PillDispenser/CloudTransport.h"
+#include "../PillDispenser/PINS_CONFIG.h"
+#include <limits.h>
+
+#define TEST_SPEED 40
+#define CAREGIVER "+639171234567"
+
+static ModemEmulator emulator;
+static SIM800L sim800(PIN_SIM800_RX, PIN_SIM800_TX, PIN_SIM800_RST, Serial2);
+
+static void onPin(uint8_t pin, uint8_t value) {
+  if (pin == PIN_SIM800_RST && value == LOW) {
+    emulator.reset();
+  }
+}
+
+static bool sentCommand(const char* command) {
+  std::vector<std::string> log = emulator.commands();
+  for (size_t i = 0; i < log.size(); i++) {
+    if (log[i] == command) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Hex PDU octets after the SMSC field must match the AT+CMGS length
+static bool lengthMatches(const ModemSentSMS& sms) {
+  if (sms.pdu.size() < 2) {
+    return false;
+  }
+  int smscOctets = (int)strtol(sms.pdu.substr(0, 2).c_str(), nullptr, 16);
+  return (int)sms.pdu.size() / 2 == 1 + smscOctets + sms.declaredLength;
+}
+
+TEST(beginConfiguresModule) {
+  CHECK(sim800.begin());
+  CHECK_EQ(emulator.resets(), 1);
+  CHECK(sentCommand("ATE0"));
+  CHECK(emulator.urcEnabled());
+  CHECK(emulator.ringOnSMS());
+  CHECK(sentCommand("AT+MORING=1"));
+  CHECK(sim800.checkNetworkRegistration());
+}
+
+TEST(sendsSingleAndConcatenatedSMS) {
+  emulator.clearLog();
+  CHECK(sim800.sendSMS(CAREGIVER, "Dose taken at 08:00"));
+
+  // 200 GSM-7 characters need two parts, each with a concatenation header
+  String longText;
+  for (int i = 0; i < 20; i++) {
+    longText += "Take pill ";
+  }
+  CHECK(sim800.sendSMS(CAREGIVER, longText));
+
+  std::vector<ModemSentSMS> sent = emulator.sentSMS();
+  CHECK_EQ(sent.size(), 3);
+  for (size_t i = 0; i < sent.size(); i++) {
+    CHECK(sent[i].pduMode);
+    CHECK(lengthMatches(sent[i]));
+  }
+  if (sent.size() == 3) {
+    CHECK(sent[0].pdu.find("050003") == std::string::npos);
+    CHECK(sent[1].pdu.find("050003") != std::string::npos);
+    CHECK(sent[2].pdu.find("050003") != std::string::npos);
+  }
+}
+
+TEST(inboundSMSIsReadAndDeleted) {
+  emulator.deliverSMS(CAREGIVER, "STATUS");
+
+  unsigned long start = millis();
+  while (!sim800.hasPendingSMS() && millis() - start < 5000) {
+    sim800.update();
+    delay(50);
+  }
+  CHECK(sim800.hasPendingSMS());
+  int index = sim800.popPendingSMS();
+  CHECK_EQ(index, 1);
+
+  CHECK(sim800.readSMS(index));
+  CHECK_STR(sim800.getLastSMS().c_str(), "STATUS");
+  CHECK_STR(sim800.getLastSMSSender().c_str(), CAREGIVER);
+  CHECK(sim800.deleteSMS(index));
+  CHECK_EQ(emulator.storedSMSCount(), 0);
+}
+
+TEST(registrationLossAndReconnect) {
+  emulator.setRegistered(false);
+  CHECK(!sim800.checkNetworkRegistration());
+  CHECK(!sim800.sendSMS(CAREGIVER, "Lost"));
+
+  emulator.setRegistered(true);
+  CHECK(sim800.attemptNetworkReconnect());
+  CHECK(sim800.isNetworkConnected());
+}
+
+TEST(errorRepliesFailCleanly) {
+  ModemProfile profile = modemProfileClean();
+  profile.errorRate = 1.0;
+  emulator.setProfile(profile);
+  emulator.clearLog();
+
+  CHECK(!sim800.isReady());
+  CHECK(!sim800.sendSMS(CAREGIVER, "Never sent"));
+  CHECK(!sim800.readSMS(1));
+  CHECK_EQ(emulator.sentSMS().size(), 0);
+
+  // Nothing left half-done - the next message goes through
+  emulator.setProfile(modemProfileClean());
+  CHECK(sim800.sendSMS(CAREGIVER, "Sent"));
+  CHECK_EQ(emulator.sentSMS().size(), 1);
+}
+
+TEST(hungModuleIsResetAndReconfigured) {
+  ModemProfile profile = modemProfileClean();
+  profile.hangAfter = 1;
+  emulator.setProfile(profile);
+  CHECK(sim800.isReady());
+  CHECK(!sim800.isReady());
+
+  // Stays silent until the RST pin is pulsed, even once the fault is gone
+  emulator.setProfile(modemProfileClean());
+  unsigned long resetsBefore = emulator.resets();
+  emulator.clearLog();
+  CHECK(sim800.attemptNetworkReconnect());
+  CHECK_EQ(emulator.resets(), resetsBefore + 1);
+
+  // The reset dropped the URC settings - the driver must send them again
+  CHECK(emulator.urcEnabled());
+  CHECK(emulator.ringOnSMS());
+  CHECK(sentCommand("AT+MORING=1"));
+
+  emulator.deliverSMS(CAREGIVER, "SKIP");
+  unsigned long start = millis();
+  while (!sim800.hasPendingSMS() && millis() - start < 5000) {
+    sim800.update();
+    delay(50);
+  }
+  CHECK(sim800.hasPendingSMS());
+  int index = sim800.popPendingSMS();
+  CHECK(sim800.readSMS(index));
+  CHECK(sim800.deleteSMS(index));
+}
+
+TEST(gprsFlushSendsPatchBatch) {
+  CloudTransport transport;
+  transport.enableGPRSFallback(&sim800, "https://demo.firebaseio.com", "internet");
+  transport.queueWrite("pilldispenser/device/heartbeat", "{\"seq\":7}");
+  transport.queueWrite("dispensers/2", "{\"status\":\"empty\"}");
+  String batch = transport.buildBatch();
+  emulator.clearLog();
+
+  transport.update(true, "");  // Firebase was up - the cached token is fresh
+  transport.update(false, "token");
+  CHECK_EQ(emulator.httpRequests().size(), 0);
+
+  hostAdvanceMicros(61000000LL);  // Past the failover delay
+  transport.update(false, "token");
+  CHECK(transport.getActiveLink() == CLOUD_LINK_GPRS);
+  CHECK(!transport.hasPending());
+
+  std::vector<ModemHTTPRequest> requests = emulator.httpRequests();
+  CHECK_EQ(requests.size(), 1);
+  if (requests.size() == 1) {
+    CHECK_EQ(requests[0].action, 1);
+    CHECK_STR(requests[0].url, "https://demo.firebaseio.com/.json?access_token=token");
+    CHECK_STR(requests[0].userData, "X-HTTP-Method-Override: PATCH");
+    CHECK_STR(requests[0].body, batch.c_str());
+  }
+
+  // WiFi back - the bearer is closed
+  transport.update(true, "token");
+  CHECK(transport.getActiveLink() == CLOUD_LINK_WIFI);
+  CHECK(sentCommand("AT+SAPBR=0,1"));
+}
+
+// A transport that lost WiFi just now, with one report waiting
+static void startOutage(CloudTransport& transport) {
+  transport.enableGPRSFallback(&sim800, "https://demo.firebaseio.com", "internet");
+  transport.update(true, "");
+  transport.queuePush("pilldispenser/reports", "{\"status\":1}");
+  transport.update(false, "token");
+  hostAdvanceMicros(61000000LL);
+  emulator.clearLog();
+}
+
+TEST(gprsStopsWhenTokenExpires) {
+  emulator.setProfile(modemProfileClean());
+  CloudTransport transport;
+  startOutage(transport);
+  transport.update(false, "token");
+  CHECK_EQ(emulator.httpRequests().size(), 1);
+
+  // An hour after Firebase was last reachable the token cannot be valid
+  transport.queuePush("pilldispenser/reports", "{\"status\":2}");
+  hostAdvanceMicros(3600000000LL);
+  transport.update(false, "token");
+  CHECK(transport.isAuthExpired());
+  CHECK_EQ(emulator.httpRequests().size(), 1);
+  CHECK(transport.hasPending());
+  CHECK_EQ(transport.getMillisUntilFlush(), ULONG_MAX);
+  CHECK(sentCommand("AT+SAPBR=0,1"));
+
+  // WiFi back: a fresh token, and the next outage may use GPRS again
+  transport.update(true, "");
+  CHECK(!transport.isAuthExpired());
+}
+
+TEST(gprsStopsOnAuthRejection) {
+  ModemProfile profile = modemProfileClean();
+  profile.httpStatus = 401;
+  emulator.setProfile(profile);
+  CloudTransport transport;
+  startOutage(transport);
+
+  transport.update(false, "token");
+  CHECK_EQ(emulator.httpRequests().size(), 1);
+  CHECK(transport.isAuthExpired());
+
+  // No retry every 5 minutes - the writes wait for WiFi
+  hostAdvanceMicros(600000000LL);
+  transport.update(false, "token");
+  CHECK_EQ(emulator.httpRequests().size(), 1);
+  CHECK(transport.hasPending());
+  emulator.setProfile(modemProfileClean());
+}
+
+TEST(gprsRefusesTooLongURL) {
+  emulator.setProfile(modemProfileClean());
+  CloudTransport transport;
+  startOutage(transport);
+
+  // Service-account tokens can run to a kilobyte
+  String token = "ya29.";
+  while (token.length() < 1000) {
+    token += "c.b0AXv0zTN";
+  }
+  transport.update(false, token);
+  CHECK(transport.isAuthExpired());
+  CHECK_EQ(emulator.httpRequests().size(), 0);
+  CHECK(!sim800.sendHTTPRequest("https://demo.firebaseio.com/.json?access_token=" + token));
+}
+
+TEST(gprsDatabaseSecretDoesNotExpire) {
+  emulator.setProfile(modemProfileClean());
+  CloudTransport transport;
+  transport.setDatabaseSecret("s3cr3t");
+  startOutage(transport);
+
+  hostAdvanceMicros(2 * 3600000000LL);
+  transport.update(false, "token");
+  CHECK(!transport.isAuthExpired());
+  std::vector<ModemHTTPRequest> requests = emulator.httpRequests();
+  CHECK_EQ(requests.size(), 1);
+  if (requests.size() == 1) {
+    CHECK_STR(requests[0].url, "https://demo.firebaseio.com/.json?auth=s3cr3t");
+  }
+}
+
+int main() {
+  if (!emulator.open()) {
+    printf("SIM800LTest: no pseudo-terminal on this host, skipped\n");
+    return 0;
+  }
+  Serial2.attach(emulator.openSlave());
+  hostOnDigitalWrite(onPin);
+  hostUseRealClock(true, TEST_SPEED);
+  emulator.start(modemProfileClean(), TEST_SPEED);
+
+  RUN(beginConfiguresModule);
+  RUN(sendsSingleAndConcatenatedSMS);
+  RUN(inboundSMSIsReadAndDeleted);
+  RUN(registrationLossAndReconnect);
+  RUN(errorRepliesFailCleanly);
+  RUN(hungModuleIsResetAndReconfigured);
+  RUN(gprsFlushSendsPatchBatch);
+  RUN(gprsStopsWhenTokenExpires);
+  RUN(gprsStopsOnAuthRejection);
+  RUN(gprsRefusesTooLongURL);
+  RUN(gprsDatabaseSecretDoesNotExpire);
+
+  emulator.stop();
+  return testSummary("SIM800LTest");
+}
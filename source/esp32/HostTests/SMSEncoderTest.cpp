@@ -0,0 +1,153 @@
+// SMSEncoderTest - SMSEncoder::encode against reference SMS-SUBMIT PDUs
+//
+// The expected PDUs were packed independently of SMSEncoder following
+// GSM 03.38 / 03.40. The "hellohello" user data (E8329BFD4697D9EC37) is
+// the widely published packing example. Every PDU starts with a "00" SMSC
+// octet and has no validity period, as SMSEncoder sends them.
+
+#include "HostTest.h"
+#include "../PillDispenser/SMSEncoder.h"
+
+// Single part, GSM-7
+static const char* GSM7_HELLO =
+  "0001000B916407281553F800000AE8329BFD4697D9EC37";
+
+static const char* GSM7_ESCAPES =
+  "0001000C91365901913883000009C8346853DEF0363E";
+
+// Single part, UCS2 - U+836F has no GSM-7 mapping
+static const char* UCS2_SINGLE =
+  "0001000B819015108933F800081E00470061006D006F00740020006E00690020004C006F006C00610020836F";
+
+// 200 GSM-7 septets: 153 + 47 with a 6-octet UDH (reference 0xCC) and one fill bit
+static const char* CONCAT_PART1 =
+  "0041000C913659019138830000A0050003CC0201C2E231B96C3EA3D3EA35BBED7EC3E3F239BD6EBFE3F3FAB0"
+  "784C2E9BCFE8B47ACD6EBBDFF0B87C4EAFDBEFF8BC3E2C1E93CBE6333AAD5EB3DBEE373C2E9FD3EBF63B3EAF"
+  "0F8BC7E4B2F98C4EABD7ECB6FB0D8FCBE7F4BAFD8ECFEBC3E231B96C3EA3D3EA35BBED7EC3E3F239BD6EBFE3"
+  "F3FAB0784C2E9BCFE8B47ACD6EBBDFF0B87C4EAFDBEF";
+
+static const char* CONCAT_PART2 =
+  "0041000C91365901913883000036050003CC0202F0797D583C2697CD67745ABD66B7DD6F785C3EA7D7ED777C"
+  "5E1F168FC965F3199D56AFD96DF71B1E9703";
+
+// 152 'a' + euro sign: the ESC/0x65 pair would straddle septet 153, so it moves to part 2
+static const char* ESCAPE_SPLIT_PART1 =
+  "0041000C9136590191388300009F050003070201C2E170381C0E87C3E170381C0E87C3E170381C0E87C3E170"
+  "381C0E87C3E170381C0E87C3E170381C0E87C3E170381C0E87C3E170381C0E87C3E170381C0E87C3E170381C"
+  "0E87C3E170381C0E87C3E170381C0E87C3E170381C0E87C3E170381C0E87C3E170381C0E87C3E170381C0E87"
+  "C3E170381C0E87C3E170381C0E87C3E170381C0E8701";
+
+static const char* ESCAPE_SPLIT_PART2 =
+  "0041000C913659019138830000130500030702023665B1582C168BC562B118";
+
+// 75 UCS2 units: 67 + 8 per part, UDH followed directly by the UTF-16 octets
+static const char* UCS2_PART1 =
+  "0041000B819015108933F800088C050003090201836F836F836F836F836F836F836F836F836F836F836F836F"
+  "836F836F836F836F836F836F836F836F836F836F836F836F836F836F836F836F836F836F836F836F836F836F"
+  "836F836F836F836F836F836F836F836F836F836F836F836F836F836F836F836F836F836F836F836F836F836F"
+  "836F836F836F836F836F836F836F836F836F836F836F";
+
+static const char* UCS2_PART2 =
+  "0041000B819015108933F8000816050003090202836F836F836F00780078007800780078";
+
+// What AT+CMGS expects - the PDU minus its SMSC octet
+static int tpduLength(const char* pdu) {
+  return (int)(strlen(pdu) - 2) / 2;
+}
+
+static String repeat(const char* text, int count) {
+  String out;
+  for (int i = 0; i < count; i++) {
+    out += text;
+  }
+  return out;
+}
+
+TEST(gsm7SinglePart) {
+  SMSPduPart parts[SMS_MAX_PARTS];
+  SMSEncoding encoding = SMS_ENCODING_UCS2;
+  int count = SMSEncoder::encode("+46708251358", "hellohello", 0, parts, SMS_MAX_PARTS, &encoding);
+  CHECK_EQ(count, 1);
+  CHECK_EQ(encoding, SMS_ENCODING_GSM7);
+  CHECK_STR(parts[0].pdu.c_str(), GSM7_HELLO);
+  CHECK_EQ(parts[0].tpduLength, tpduLength(GSM7_HELLO));
+}
+
+TEST(gsm7EscapeCharacters) {
+  // Euro sign and square brackets come from the extension table, two septets each
+  SMSPduPart parts[SMS_MAX_PARTS];
+  SMSEncoding encoding = SMS_ENCODING_UCS2;
+  int count = SMSEncoder::encode("+639510198338", "Hi \xE2\x82\xAC[]", 0, parts, SMS_MAX_PARTS, &encoding);
+  CHECK_EQ(count, 1);
+  CHECK_EQ(encoding, SMS_ENCODING_GSM7);
+  CHECK_STR(parts[0].pdu.c_str(), GSM7_ESCAPES);
+  CHECK_EQ(parts[0].tpduLength, tpduLength(GSM7_ESCAPES));
+}
+
+TEST(ucs2SinglePart) {
+  SMSPduPart parts[SMS_MAX_PARTS];
+  SMSEncoding encoding = SMS_ENCODING_GSM7;
+  int count = SMSEncoder::encode("09510198338", "Gamot ni Lola \xE8\x8D\xAF", 0, parts, SMS_MAX_PARTS, &encoding);
+  CHECK_EQ(count, 1);
+  CHECK_EQ(encoding, SMS_ENCODING_UCS2);
+  CHECK_STR(parts[0].pdu.c_str(), UCS2_SINGLE);
+  CHECK_EQ(parts[0].tpduLength, tpduLength(UCS2_SINGLE));
+}
+
+TEST(gsm7ConcatenatedWithFillBit) {
+  String message;
+  for (int i = 0; i < 200; i++) {
+    message += (char)('a' + i % 26);
+  }
+  SMSPduPart parts[SMS_MAX_PARTS];
+  int count = SMSEncoder::encode("+639510198338", message, 0xCC, parts, SMS_MAX_PARTS);
+  CHECK_EQ(count, 2);
+  CHECK_STR(parts[0].pdu.c_str(), CONCAT_PART1);
+  CHECK_STR(parts[1].pdu.c_str(), CONCAT_PART2);
+  CHECK_EQ(parts[0].tpduLength, tpduLength(CONCAT_PART1));
+  CHECK_EQ(parts[0].tpduLength, 153);  // 160 septets incl. UDH = 140 octets + 13 header octets
+  CHECK_EQ(parts[1].tpduLength, tpduLength(CONCAT_PART2));
+}
+
+TEST(gsm7EscapeNotSplitAcrossParts) {
+  String message = repeat("a", 152) + "\xE2\x82\xAC" + repeat("b", 10);
+  SMSPduPart parts[SMS_MAX_PARTS];
+  int count = SMSEncoder::encode("+639510198338", message, 7, parts, SMS_MAX_PARTS);
+  CHECK_EQ(count, 2);
+  CHECK_STR(parts[0].pdu.c_str(), ESCAPE_SPLIT_PART1);
+  CHECK_STR(parts[1].pdu.c_str(), ESCAPE_SPLIT_PART2);
+}
+
+TEST(ucs2Concatenated) {
+  String message = repeat("\xE8\x8D\xAF", 70) + repeat("x", 5);
+  SMSPduPart parts[SMS_MAX_PARTS];
+  SMSEncoding encoding = SMS_ENCODING_GSM7;
+  int count = SMSEncoder::encode("09510198338", message, 9, parts, SMS_MAX_PARTS, &encoding);
+  CHECK_EQ(count, 2);
+  CHECK_EQ(encoding, SMS_ENCODING_UCS2);
+  CHECK_STR(parts[0].pdu.c_str(), UCS2_PART1);
+  CHECK_STR(parts[1].pdu.c_str(), UCS2_PART2);
+  CHECK_EQ(parts[0].tpduLength, tpduLength(UCS2_PART1));
+}
+
+TEST(partLimitTruncates) {
+  // Five parts' worth of text is cut to SMS_MAX_PARTS full parts
+  SMSPduPart parts[SMS_MAX_PARTS];
+  int count = SMSEncoder::encode("+639510198338", repeat("z", 153 * 5), 1, parts, SMS_MAX_PARTS);
+  CHECK_EQ(count, SMS_MAX_PARTS);
+  for (int i = 0; i < count; i++) {
+    CHECK_EQ(parts[i].tpduLength, 153);
+  }
+  CHECK_EQ(SMSEncoder::encode("+639510198338", "x", 1, nullptr, 0), 0);
+}
+
+int main() {
+  RUN(gsm7SinglePart);
+  RUN(gsm7EscapeCharacters);
+  RUN(ucs2SinglePart);
+  RUN(gsm7ConcatenatedWithFillBit);
+  RUN(gsm7EscapeNotSplitAcrossParts);
+  RUN(ucs2Concatenated);
+  RUN(partLimitTruncates);
+  return testSummary("SMSEncoderTest");
+}
@@ -0,0 +1,285 @@
+// ScheduleManagerTest - doses across clock steps and DST transitions
+//
+// ScheduleManager, TimeManager and the TimeAlarms shim run together as on
+// the device: every simulated second the clock is updated, alarms are
+// serviced and the event bus is dispatched. Steps come in through
+// TimeManager.applyReferenceTime() (NTP an hour off, then corrected) or
+// from a DST transition in the zone rules, and reach the scheduler through
+// the clock step callback.
+//
+// Whatever the clock does, a dose is dispensed at most once; a dose passed
+// over by a forward step is given late within its grace period and reported
+// missed beyond it. A clock restored from NVS alone is provisional - no dose
+// is given on it, and NTP's answer is caught up from the saved time.
+
+#include "HostTest.h"
+#include "../PillDispenser/ScheduleManager.h"
+#include "../PillDispenser/TimeManager.h"
+#include "../PillDispenser/EventBus.h"
+#include "esp_timer.h"
+
+#define MONDAY_0000_UTC 1748822400LL   // 2025-06-02 00:00:00 UTC
+#define SPRING_0000_UTC 1743292800LL   // 2025-03-30 00:00:00 UTC, CEST starts 01:00 UTC
+#define AUTUMN_2330_UTC 1761435000LL   // 2025-10-25 23:30:00 UTC, CEST ends 01:00 UTC
+#define CET_ZONE "CET-1CEST,M3.5.0,M10.5.0/3"
+#define HOUR_US 3600000000LL
+
+static ScheduleManager schedules;
+static EventBus bus;
+
+static int dosesDue[MAX_SCHEDULES];
+static int dosesMissed[MAX_SCHEDULES];
+static int reminders[MAX_SCHEDULES];
+
+static void onDoseDue(const BusEvent& event) {
+  dosesDue[event.scheduleIndex]++;
+}
+
+static void onDoseMissed(const BusEvent& event) {
+  dosesMissed[event.scheduleIndex]++;
+}
+
+static void onReminder(const BusEvent& event) {
+  reminders[event.scheduleIndex]++;
+}
+
+// A fresh clock at utcSeconds in the given zone, and no schedules
+static void startAt(TimeManager& clock, const char* zone, int64_t utcSeconds) {
+  schedules.clearAllSchedules();
+  memset(dosesDue, 0, sizeof(dosesDue));
+  memset(dosesMissed, 0, sizeof(dosesMissed));
+  memset(reminders, 0, sizeof(reminders));
+  CHECK(clock.setTimezone(zone));
+  clock.applyReferenceTime(utcSeconds * 1000000LL, "ntp");
+  schedules.setTimeManager(&clock);
+}
+
+// The schedule task's loop, one pass per simulated second
+static void runFor(TimeManager& clock, int seconds) {
+  for (int i = 0; i < seconds; i++) {
+    hostAdvanceMicros(1000000LL);
+    clock.update();
+    Alarm.delay(0);
+    bus.dispatch();
+  }
+}
+
+// NTP suddenly disagrees with the timebase by offsetUs
+static void stepClock(TimeManager& clock, int64_t offsetUs) {
+  clock.applyReferenceTime(clock.getEpochMicros() + offsetUs, "ntp");
+  Alarm.delay(0);
+  bus.dispatch();
+}
+
+TEST(doseFiresOnceOnTime) {
+  TimeManager clock;
+  startAt(clock, "UTC0", MONDAY_0000_UTC + 7 * 3600 + 30 * 60);  // 07:30
+  CHECK(schedules.addSchedule("morning", 0, 8, 0, "Metformin", "Ana"));
+
+  runFor(clock, 2 * 3600);
+  CHECK_EQ(reminders[0], 1);
+  CHECK_EQ(dosesDue[0], 1);
+  CHECK_EQ(dosesMissed[0], 0);
+}
+
+TEST(forwardHourWithinGraceDispensesLate) {
+  // 07:20 -> 08:20: the 08:00 dose is 20 minutes late, inside the default 30
+  TimeManager clock;
+  startAt(clock, "UTC0", MONDAY_0000_UTC + 7 * 3600 + 20 * 60);
+  CHECK(schedules.addSchedule("morning", 0, 8, 0, "Metformin", "Ana"));
+  runFor(clock, 60);
+
+  stepClock(clock, HOUR_US);
+  CHECK_EQ(dosesDue[0], 1);
+  CHECK_EQ(dosesMissed[0], 0);
+  CHECK_EQ(reminders[0], 0);  // Its dose is already past
+
+  // The alarm was re-armed for tomorrow - nothing fires again today
+  runFor(clock, 3 * 3600);
+  CHECK_EQ(dosesDue[0], 1);
+  CHECK_EQ(dosesMissed[0], 0);
+}
+
+TEST(forwardHourBeyondGraceIsMissed) {
+  TimeManager clock;
+  startAt(clock, "UTC0", MONDAY_0000_UTC + 7 * 3600 + 20 * 60);
+  CHECK(schedules.addSchedule("morning", 0, 8, 0, "Metformin", "Ana"));
+  CHECK(schedules.setGracePeriod("morning", 10));
+  CHECK(!schedules.setGracePeriod("morning", 24 * 60 + 1));
+  CHECK(!schedules.setGracePeriod("unknown", 10));
+  runFor(clock, 60);
+
+  stepClock(clock, HOUR_US);
+  CHECK_EQ(dosesDue[0], 0);
+  CHECK_EQ(dosesMissed[0], 1);
+
+  runFor(clock, 3 * 3600);
+  CHECK_EQ(dosesDue[0], 0);
+  CHECK_EQ(dosesMissed[0], 1);
+}
+
+TEST(forwardStepReplaysReminder) {
+  // 07:20 -> 07:50 passes over the 07:45 reminder; the dose is still ahead
+  TimeManager clock;
+  startAt(clock, "UTC0", MONDAY_0000_UTC + 7 * 3600 + 20 * 60);
+  CHECK(schedules.addSchedule("morning", 0, 8, 0, "Metformin", "Ana"));
+  runFor(clock, 60);
+
+  stepClock(clock, HOUR_US / 2);
+  CHECK_EQ(reminders[0], 1);
+  CHECK_EQ(dosesDue[0], 0);
+
+  runFor(clock, 3600);
+  CHECK_EQ(reminders[0], 1);
+  CHECK_EQ(dosesDue[0], 1);
+}
+
+TEST(backwardHourDoesNotRepeatDose) {
+  // Dispensed at 08:00, then NTP puts the clock back to 07:10 - the 07:45
+  // reminder and 08:00 alarm come round again and must be ignored
+  TimeManager clock;
+  startAt(clock, "UTC0", MONDAY_0000_UTC + 7 * 3600 + 40 * 60);
+  CHECK(schedules.addSchedule("morning", 0, 8, 0, "Metformin", "Ana"));
+  runFor(clock, 30 * 60);
+  CHECK_EQ(reminders[0], 1);
+  CHECK_EQ(dosesDue[0], 1);
+
+  stepClock(clock, -HOUR_US);
+  CHECK_EQ(hour(), 7);
+  runFor(clock, 2 * 3600);
+  CHECK_EQ(reminders[0], 1);
+  CHECK_EQ(dosesDue[0], 1);
+  CHECK_EQ(dosesMissed[0], 0);
+
+  // Tomorrow's dose is unaffected
+  runFor(clock, 24 * 3600);
+  CHECK_EQ(dosesDue[0], 2);
+}
+
+TEST(springForwardSkipsLocalHour) {
+  // CET 02:00 becomes CEST 03:00 - 02:15 and 02:45 never happen locally.
+  // 02:45 is 15 minutes late at 03:00 and dispensed; 02:15 with a
+  // 30 minute grace is 45 minutes late and missed.
+  TimeManager clock;
+  startAt(clock, CET_ZONE, SPRING_0000_UTC);  // 01:00 CET
+  CHECK(schedules.addSchedule("late", 1, 2, 45, "Aspirin", "Ana"));
+  CHECK(schedules.addSchedule("early", 2, 2, 15, "Insulin", "Ana"));
+  CHECK(!clock.isDST());
+
+  runFor(clock, 2 * 3600);
+  CHECK(clock.isDST());
+  CHECK_EQ(hour(), 4);
+  CHECK_EQ(dosesDue[0], 1);
+  CHECK_EQ(dosesMissed[0], 0);
+  CHECK_EQ(dosesDue[1], 0);
+  CHECK_EQ(dosesMissed[1], 1);
+  CHECK_EQ(reminders[0], 0);  // 02:30 was skipped too, and its dose is past
+}
+
+TEST(fallBackRepeatsLocalHourOnce) {
+  // CEST 03:00 becomes CET 02:00 - 02:30 comes round twice, one dose only
+  TimeManager clock;
+  startAt(clock, CET_ZONE, AUTUMN_2330_UTC);  // 01:30 CEST
+  CHECK(schedules.addSchedule("night", 0, 2, 30, "Melatonin", "Ana"));
+  CHECK(clock.isDST());
+
+  runFor(clock, 4 * 3600);
+  CHECK(!clock.isDST());
+  CHECK_EQ(hour(), 4);
+  CHECK_EQ(reminders[0], 1);
+  CHECK_EQ(dosesDue[0], 1);
+  CHECK_EQ(dosesMissed[0], 0);
+}
+
+TEST(gracePeriodSurvivesCacheAndResync) {
+  TimeManager clock;
+  startAt(clock, "UTC0", MONDAY_0000_UTC + 7 * 3600 + 20 * 60);
+  CHECK(schedules.addSchedule("morning", 0, 8, 0, "Metformin", "Ana"));
+  CHECK(schedules.addSchedule("evening", 1, 20, 0, "Metformin", "Ana"));
+  CHECK(schedules.setGracePeriod("morning", 10));
+  CHECK(schedules.saveCache());
+
+  // A resync keeps it, like the fired slots
+  schedules.beginSync();
+  CHECK(schedules.addSchedule("morning", 0, 8, 0, "Metformin", "Ana"));
+  CHECK(schedules.addSchedule("evening", 1, 20, 0, "Metformin", "Ana"));
+  schedules.endSync();
+  CHECK_EQ(schedules.getScheduleById("morning")->graceMinutes, 10);
+
+  // As at boot: the cached set, before the network is up
+  schedules.clearAllSchedules();
+  CHECK_EQ(schedules.loadCache(), 2);
+  CHECK_EQ(schedules.getScheduleById("morning")->graceMinutes, 10);
+  CHECK_EQ(schedules.getScheduleById("evening")->graceMinutes, DEFAULT_GRACE_MINUTES);
+
+  // And it still decides what a forward step does
+  runFor(clock, 60);
+  stepClock(clock, HOUR_US);
+  CHECK_EQ(dosesDue[0], 0);
+  CHECK_EQ(dosesMissed[0], 1);
+}
+
+TEST(provisionalRestoreHoldsDosesUntilNTP) {
+  // Power lost at 07:00 and back three hours later - only NVS survived
+  Preferences prefs;
+  CHECK(prefs.begin(TIME_PREFS_NAMESPACE, false));
+  prefs.putLong64("utc", (MONDAY_0000_UTC + 7 * 3600) * 1000000LL - esp_timer_get_time());
+  prefs.putLong64("mark", 0);
+  prefs.end();
+
+  schedules.clearAllSchedules();
+  memset(dosesDue, 0, sizeof(dosesDue));
+  memset(dosesMissed, 0, sizeof(dosesMissed));
+  memset(reminders, 0, sizeof(reminders));
+  TimeManager clock;
+  CHECK(clock.setTimezone("UTC0"));
+  CHECK(clock.restoreTime());
+  CHECK(clock.isTimeProvisional());
+  CHECK(!clock.isTimeValid());
+  CHECK_EQ(hour(), 7);
+  schedules.setTimeManager(&clock);
+  CHECK(schedules.addSchedule("early", 0, 7, 30, "Metformin", "Ana"));
+  CHECK(schedules.addSchedule("late", 1, 9, 50, "Aspirin", "Ana"));
+
+  // The provisional clock passes 07:15 and 07:30 - nothing is given
+  runFor(clock, 3600);
+  CHECK_EQ(reminders[0], 0);
+  CHECK_EQ(dosesDue[0], 0);
+  CHECK_EQ(dosesMissed[0], 0);
+
+  // NTP: it is really 10:05 - 07:30 is long gone, 09:50 is within grace
+  clock.applyReferenceTime((MONDAY_0000_UTC + 10 * 3600 + 5 * 60) * 1000000LL, "ntp");
+  Alarm.delay(0);
+  bus.dispatch();
+  CHECK(!clock.isTimeProvisional());
+  CHECK(clock.isTimeValid());
+  CHECK_EQ(dosesDue[0], 0);
+  CHECK_EQ(dosesMissed[0], 1);
+  CHECK_EQ(dosesDue[1], 1);
+  CHECK_EQ(dosesMissed[1], 0);
+
+  runFor(clock, 3600);
+  CHECK_EQ(dosesDue[0] + dosesDue[1], 1);
+  CHECK_EQ(dosesMissed[0] + dosesMissed[1], 1);
+}
+
+int main() {
+  hostAdvanceMicros(10000000LL);
+  bus.subscribe(BUS_DOSE_DUE, onDoseDue);
+  bus.subscribe(BUS_DOSE_MISSED, onDoseMissed);
+  bus.subscribe(BUS_DOSE_REMINDER, onReminder);
+  schedules.setEventBus(&bus);
+  schedules.begin("host");
+
+  RUN(doseFiresOnceOnTime);
+  RUN(forwardHourWithinGraceDispensesLate);
+  RUN(forwardHourBeyondGraceIsMissed);
+  RUN(forwardStepReplaysReminder);
+  RUN(backwardHourDoesNotRepeatDose);
+  RUN(springForwardSkipsLocalHour);
+  RUN(fallBackRepeatsLocalHourOnce);
+  RUN(gracePeriodSurvivesCacheAndResync);
+  RUN(provisionalRestoreHoldsDosesUntilNTP);
+
+  return testSummary("ScheduleManagerTest");
+}
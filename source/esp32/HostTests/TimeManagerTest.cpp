@@ -0,0 +1,213 @@
+// TimeManagerTest - slew, step and drift estimation of the TimeManager timebase
+//
+// A simulated crystal runs a fixed number of ppm off true time; NTP samples
+// (true time plus jitter) go in through applyReferenceTime() every 6 hours,
+// as the SNTP client delivers them, and update() runs every 10 s. Over 30
+// simulated days the drift estimate must settle on the crystal error, the
+// clock must stay within a few tens of milliseconds and never run backwards.
+
+#include "HostTest.h"
+#include "../PillDispenser/TimeManager.h"
+#include "esp_timer.h"
+
+#define START_UTC 1748736000LL          // 2025-06-01 00:00:00 UTC
+#define DAY_US 86400000000LL
+#define NTP_INTERVAL_US 21600000000LL   // 6 hours, the SNTP poll interval
+#define UPDATE_US 10000000LL            // update() every 10 s
+#define JITTER_US 10000                 // NTP samples within +-10 ms
+
+// Crystal model: true time from the local monotonic timer
+static int64_t monoAtStart;
+static double crystalPpm;               // Positive = local timer runs fast
+
+static int64_t trueMicros() {
+  double elapsed = (double)(esp_timer_get_time() - monoAtStart);
+  return START_UTC * 1000000LL + (int64_t)(elapsed / (1.0 + crystalPpm * 1e-6));
+}
+
+static unsigned jitterSeed = 1;
+
+static int64_t ntpSample() {
+  jitterSeed = jitterSeed * 1103515245u + 12345u;
+  int64_t jitter = (int64_t)((jitterSeed >> 8) % (2 * JITTER_US + 1)) - JITTER_US;
+  return trueMicros() + jitter;
+}
+
+static int stepCallbacks = 0;
+static time_t lastStepOld = 0;
+static time_t lastStepNew = 0;
+
+static void onClockStep(time_t oldLocal, time_t newLocal) {
+  stepCallbacks++;
+  lastStepOld = oldLocal;
+  lastStepNew = newLocal;
+}
+
+struct DriftRun {
+  int64_t maxErrorUs;                   // After the estimate settled
+  int64_t finalErrorUs;
+  bool monotonic;
+};
+
+// Runs the clock for the given days; ntpDays of them with NTP samples
+static DriftRun simulate(TimeManager& clock, int days, int ntpDays, int settleDays) {
+  DriftRun run = {0, 0, true};
+  int64_t started = esp_timer_get_time();
+  int64_t nextSample = started + NTP_INTERVAL_US;
+  int64_t previous = clock.getEpochMicros();
+
+  while (esp_timer_get_time() - started < days * DAY_US) {
+    hostAdvanceMicros(UPDATE_US);
+    int64_t elapsed = esp_timer_get_time() - started;
+    if (elapsed < ntpDays * DAY_US && esp_timer_get_time() >= nextSample) {
+      clock.applyReferenceTime(ntpSample(), "ntp");
+      nextSample += NTP_INTERVAL_US;
+    }
+    clock.update();
+
+    int64_t reading = clock.getEpochMicros();
+    if (reading < previous) {
+      run.monotonic = false;
+    }
+    previous = reading;
+
+    int64_t error = llabs(reading - trueMicros());
+    if (elapsed >= settleDays * DAY_US && error > run.maxErrorUs) {
+      run.maxErrorUs = error;
+    }
+    run.finalErrorUs = reading - trueMicros();
+  }
+  return run;
+}
+
+static void startCrystal(TimeManager& clock, double ppm) {
+  crystalPpm = ppm;
+  monoAtStart = esp_timer_get_time();
+  clock.applyReferenceTime(trueMicros(), "ntp");
+}
+
+TEST(freeRunningCrystalDrifts) {
+  // Without NTP a 40 ppm fast crystal gains about 104 s in 30 days
+  TimeManager clock;
+  startCrystal(clock, 40.0);
+  DriftRun run = simulate(clock, 30, 0, 0);
+  CHECK(run.monotonic);
+  CHECK(run.finalErrorUs > 103000000LL);
+  CHECK(run.finalErrorUs < 105000000LL);
+  CHECK(clock.getDriftPpm() == 0.0);
+}
+
+TEST(fastCrystalIsCompensated) {
+  TimeManager clock;
+  startCrystal(clock, 40.0);
+  DriftRun run = simulate(clock, 30, 30, 3);
+  CHECK(run.monotonic);
+  CHECK(clock.getDriftPpm() < -39.0);
+  CHECK(clock.getDriftPpm() > -41.0);
+  CHECK(run.maxErrorUs < 25000);
+  CHECK_EQ(clock.getSyncCount(), 0);  // Samples fed directly, not via SNTP
+}
+
+TEST(slowCrystalIsCompensated) {
+  TimeManager clock;
+  startCrystal(clock, -25.0);
+  DriftRun run = simulate(clock, 30, 30, 3);
+  CHECK(run.monotonic);
+  CHECK(clock.getDriftPpm() > 24.0);
+  CHECK(clock.getDriftPpm() < 26.0);
+  CHECK(run.maxErrorUs < 25000);
+}
+
+TEST(estimateCarriesThroughOutage) {
+  // Converge for 10 days, then 3 days without NTP on the learned drift
+  TimeManager clock;
+  startCrystal(clock, 40.0);
+  simulate(clock, 10, 10, 10);
+  DriftRun outage = simulate(clock, 3, 0, 0);
+  CHECK(outage.monotonic);
+  CHECK(llabs(outage.finalErrorUs) < 100000);
+
+  // The next sample is slewed, not stepped
+  stepCallbacks = 0;
+  clock.applyReferenceTime(trueMicros(), "ntp");
+  CHECK_EQ(stepCallbacks, 0);
+  CHECK(llabs(clock.getLastCorrectionMs()) < 100);
+}
+
+TEST(smallErrorIsSlewed) {
+  TimeManager clock;
+  clock.setClockStepCallback(onClockStep);
+  startCrystal(clock, 0.0);
+  stepCallbacks = 0;
+
+  // 300 ms behind: slewed at 0.5 ms per second, so about 10 minutes.
+  // Under 10 minutes after the last sample, so none of it counts as drift.
+  hostAdvanceMicros(60000000LL);
+  clock.update();
+  clock.applyReferenceTime(trueMicros() + 300000, "ntp");
+  CHECK_EQ(stepCallbacks, 0);
+  CHECK(clock.getDriftPpm() == 0.0);
+  CHECK_EQ(clock.getLastCorrectionMs(), 300);
+  CHECK(clock.getPendingSlewMs() > 290);
+
+  hostAdvanceMicros(300000000LL);
+  clock.update();
+  CHECK(clock.getPendingSlewMs() > 140);
+  CHECK(clock.getPendingSlewMs() < 160);
+
+  hostAdvanceMicros(300000000LL);
+  clock.update();
+  CHECK_EQ(clock.getPendingSlewMs(), 0);
+  CHECK(llabs(clock.getEpochMicros() - (trueMicros() + 300000)) < 1000);
+}
+
+TEST(largeErrorIsStepped) {
+  TimeManager clock;
+  clock.setClockStepCallback(onClockStep);
+  startCrystal(clock, 0.0);
+  simulate(clock, 1, 0, 0);
+  stepCallbacks = 0;
+
+  // An hour ahead (wrong server, zone confusion): step and report it
+  time_t before = clock.getLocalEpoch();
+  clock.applyReferenceTime(trueMicros() + 3600000000LL, "ntp");
+  CHECK_EQ(stepCallbacks, 1);
+  CHECK_EQ(lastStepOld, before);
+  CHECK_EQ(lastStepNew - lastStepOld, 3600);
+  CHECK_EQ(clock.getPendingSlewMs(), 0);
+  CHECK_EQ(now(), clock.getLocalEpoch());
+
+  // And back again - the clock may step backwards, it never slews backwards
+  clock.applyReferenceTime(trueMicros(), "ntp");
+  CHECK_EQ(stepCallbacks, 2);
+  CHECK_EQ(lastStepNew - lastStepOld, -3600);
+}
+
+TEST(stepRestartsDriftBaseline) {
+  // An outlier step must not be read as oscillator drift
+  TimeManager clock;
+  startCrystal(clock, 40.0);
+  simulate(clock, 5, 5, 5);
+  double settled = clock.getDriftPpm();
+
+  clock.applyReferenceTime(trueMicros() + 5000000LL, "ntp");
+  clock.applyReferenceTime(trueMicros(), "ntp");
+  DriftRun run = simulate(clock, 2, 2, 1);
+  CHECK(clock.getDriftPpm() - settled < 1.0);
+  CHECK(settled - clock.getDriftPpm() < 1.0);
+  CHECK(run.maxErrorUs < 25000);
+}
+
+int main() {
+  hostAdvanceMicros(10000000LL);
+
+  RUN(freeRunningCrystalDrifts);
+  RUN(fastCrystalIsCompensated);
+  RUN(slowCrystalIsCompensated);
+  RUN(estimateCarriesThroughOutage);
+  RUN(smallErrorIsSlewed);
+  RUN(largeErrorIsStepped);
+  RUN(stepRestartsDriftBaseline);
+
+  return testSummary("TimeManagerTest");
+}
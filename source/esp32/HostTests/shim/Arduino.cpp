@@ -0,0 +1,384 @@
+#include "Arduino.h"
+#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+
+HardwareSerial Serial(true);
+HardwareSerial Serial1;
+HardwareSerial Serial2;
+
+// ---- String ----
+
+static std::string formatInteger(unsigned long long magnitude, bool negative, unsigned char base) {
+  if (base < 2 || base > 36) {
+    base = DEC;
+  }
+  char digits[72];
+  int pos = sizeof(digits);
+  digits[--pos] = '\0';
+  do {
+    int d = magnitude % base;
+    digits[--pos] = d < 10 ? '0' + d : 'a' + d - 10;
+    magnitude /= base;
+  } while (magnitude > 0);
+  if (negative) {
+    digits[--pos] = '-';
+  }
+  return std::string(digits + pos);
+}
+
+// Like Arduino, negative values are only signed in base 10
+String::String(int value, unsigned char base)
+  : text(base == DEC ? formatInteger(value < 0 ? -(long long)value : value, value < 0, base)
+                     : formatInteger((unsigned int)value, false, base)) {}
+String::String(unsigned int value, unsigned char base) : text(formatInteger(value, false, base)) {}
+String::String(long value, unsigned char base)
+  : text(base == DEC ? formatInteger(value < 0 ? -(long long)value : value, value < 0, base)
+                     : formatInteger((unsigned long)value, false, base)) {}
+String::String(unsigned long value, unsigned char base) : text(formatInteger(value, false, base)) {}
+String::String(long long value, unsigned char base)
+  : text(base == DEC ? formatInteger(value < 0 ? 0ULL - (unsigned long long)value : value, value < 0, base)
+                     : formatInteger((unsigned long long)value, false, base)) {}
+String::String(unsigned long long value, unsigned char base) : text(formatInteger(value, false, base)) {}
+
+String::String(float value, unsigned int decimals) {
+  char buffer[48];
+  snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, (double)value);
+  text = buffer;
+}
+
+String::String(double value, unsigned int decimals) {
+  char buffer[48];
+  snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, value);
+  text = buffer;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+  size_t pos = text.find(c, from);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String& s, unsigned int from) const {
+  size_t pos = text.find(s.text, from);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char c) const {
+  size_t pos = text.rfind(c);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(const String& s) const {
+  size_t pos = text.rfind(s.text);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int from) const {
+  return from >= text.size() ? String() : String(text.substr(from));
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (from > to) {
+    std::swap(from, to);
+  }
+  if (from >= text.size()) {
+    return String();
+  }
+  if (to > text.size()) {
+    to = text.size();
+  }
+  return String(text.substr(from, to - from));
+}
+
+bool String::startsWith(const String& prefix) const {
+  return text.compare(0, prefix.text.size(), prefix.text) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+  return text.size() >= suffix.text.size() &&
+         text.compare(text.size() - suffix.text.size(), suffix.text.size(), suffix.text) == 0;
+}
+
+bool String::equalsIgnoreCase(const String& other) const {
+  if (text.size() != other.text.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < text.size(); i++) {
+    if (tolower((unsigned char)text[i]) != tolower((unsigned char)other.text[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void String::trim() {
+  size_t first = text.find_first_not_of(" \t\r\n");
+  if (first == std::string::npos) {
+    text.clear();
+    return;
+  }
+  size_t last = text.find_last_not_of(" \t\r\n");
+  text = text.substr(first, last - first + 1);
+}
+
+void String::toLowerCase() {
+  for (size_t i = 0; i < text.size(); i++) {
+    text[i] = tolower((unsigned char)text[i]);
+  }
+}
+
+void String::toUpperCase() {
+  for (size_t i = 0; i < text.size(); i++) {
+    text[i] = toupper((unsigned char)text[i]);
+  }
+}
+
+void String::replace(const String& find, const String& with) {
+  if (find.text.empty()) {
+    return;
+  }
+  size_t pos = 0;
+  while ((pos = text.find(find.text, pos)) != std::string::npos) {
+    text.replace(pos, find.text.size(), with.text);
+    pos += with.text.size();
+  }
+}
+
+void String::toCharArray(char* buffer, unsigned int size) const {
+  if (size == 0) {
+    return;
+  }
+  strncpy(buffer, text.c_str(), size - 1);
+  buffer[size - 1] = '\0';
+}
+
+String operator+(const String& a, const String& b) {
+  String sum(a);
+  sum += b;
+  return sum;
+}
+
+String operator+(const String& a, const char* b) {
+  String sum(a);
+  sum += b;
+  return sum;
+}
+
+String operator+(const char* a, const String& b) {
+  String sum(a);
+  sum += b;
+  return sum;
+}
+
+String operator+(const String& a, char b) {
+  String sum(a);
+  sum += b;
+  return sum;
+}
+
+// ---- Print / Stream ----
+
+size_t Print::write(const uint8_t* data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    write(data[i]);
+  }
+  return size;
+}
+
+size_t Print::printf(const char* format, ...) {
+  char buffer[512];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (length < 0) {
+    return 0;
+  }
+  return write(buffer, min((size_t)length, sizeof(buffer) - 1));
+}
+
+String Stream::readStringUntil(char terminator) {
+  // Simulated time would never reach the Arduino timeout - take what is buffered
+  String line;
+  while (available() > 0) {
+    int c = read();
+    if (c < 0 || c == terminator) {
+      break;
+    }
+    line += (char)c;
+  }
+  return line;
+}
+
+// ---- HardwareSerial ----
+
+static bool consoleEnabled() {
+  static int enabled = -1;
+  if (enabled < 0) {
+    const char* value = getenv("HOST_SERIAL");
+    enabled = value != nullptr && strcmp(value, "1") == 0;
+  }
+  return enabled == 1;
+}
+
+HardwareSerial::HardwareSerial(bool isConsole) {
+  fd = -1;
+  console = isConsole;
+  peeked = -1;
+}
+
+void HardwareSerial::begin(unsigned long, uint32_t, int8_t, int8_t) {
+}
+
+void HardwareSerial::attach(int descriptor) {
+  fd = descriptor;
+  peeked = -1;
+  if (fd >= 0) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  }
+}
+
+int HardwareSerial::available() {
+  if (peeked >= 0) {
+    return 1;
+  }
+  if (fd < 0) {
+    return 0;
+  }
+  struct pollfd p = {fd, POLLIN, 0};
+  if (poll(&p, 1, 0) <= 0 || !(p.revents & POLLIN)) {
+    return 0;
+  }
+  peek();
+  return peeked >= 0 ? 1 : 0;
+}
+
+int HardwareSerial::read() {
+  int c = peek();
+  peeked = -1;
+  return c;
+}
+
+int HardwareSerial::peek() {
+  if (peeked >= 0 || fd < 0) {
+    return peeked;
+  }
+  uint8_t c;
+  if (::read(fd, &c, 1) == 1) {
+    peeked = c;
+  }
+  return peeked;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* data, size_t size) {
+  if (fd >= 0) {
+    size_t sent = 0;
+    while (sent < size) {
+      ssize_t n = ::write(fd, data + sent, size - sent);
+      if (n > 0) {
+        sent += n;
+      } else {
+        struct pollfd p = {fd, POLLOUT, 100};
+        poll(&p, 1, 100);
+      }
+    }
+    return size;
+  }
+  if (console && consoleEnabled()) {
+    fwrite(data, 1, size, stdout);
+  }
+  return size;
+}
+
+// ---- Time ----
+
+static bool realClock = false;
+static unsigned clockSpeed = 1;
+static int64_t simulatedMicros = 0;  // Device time up to realSince
+static int64_t realSince = 0;
+
+static int64_t monotonicMicros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+int64_t hostMicros64() {
+  if (!realClock) {
+    return simulatedMicros;
+  }
+  return simulatedMicros + (monotonicMicros() - realSince) * clockSpeed;
+}
+
+void hostAdvanceMicros(int64_t us) {
+  simulatedMicros += us;
+}
+
+void hostUseRealClock(bool real, unsigned speed) {
+  // Carry the device time over so millis() never jumps
+  simulatedMicros = hostMicros64();
+  realSince = monotonicMicros();
+  realClock = real;
+  clockSpeed = speed > 0 ? speed : 1;
+}
+
+unsigned long millis() {
+  return (unsigned long)(hostMicros64() / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)hostMicros64();
+}
+
+static void sleepDeviceMicros(int64_t us) {
+  if (realClock) {
+    usleep((useconds_t)(us / clockSpeed));
+  } else {
+    hostAdvanceMicros(us);
+  }
+}
+
+void delay(unsigned long ms) {
+  sleepDeviceMicros((int64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  sleepDeviceMicros(us);
+}
+
+void yield() {
+}
+
+// ---- Pins and misc ----
+
+static void (*onDigitalWrite)(uint8_t pin, uint8_t value) = nullptr;
+
+void pinMode(uint8_t, uint8_t) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (onDigitalWrite != nullptr) {
+    onDigitalWrite(pin, value);
+  }
+}
+
+void hostOnDigitalWrite(void (*callback)(uint8_t pin, uint8_t value)) {
+  onDigitalWrite = callback;
+}
+
+int digitalRead(uint8_t) {
+  return HIGH;
+}
+
+long random(long max) {
+  return max > 0 ? rand() % max : 0;
+}
+
+long random(long min, long max) {
+  return max > min ? min + random(max - min) : min;
+}
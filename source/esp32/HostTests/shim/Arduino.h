@@ -0,0 +1,199 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Just enough of the Arduino-ESP32 core to build firmware modules on a PC.
+//
+// Time is simulated by default: millis()/micros()/esp_timer_get_time() only
+// move when a test calls hostAdvanceMicros() or delay(), so timeouts run
+// instantly and results do not depend on machine load. hostUseRealClock()
+// switches to the monotonic clock, optionally sped up, for tests that talk
+// to another thread or process (the pty modem emulator).
+//
+// Serial output is discarded unless HOST_SERIAL=1 is set in the environment.
+// A HardwareSerial can be attached to a file descriptor (e.g. a pty slave).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <string>
+#include <algorithm>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HEX 16
+#define DEC 10
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define SERIAL_8N1 0x800001c
+#define F(text) text
+#define PROGMEM
+
+using std::min;
+using std::max;
+
+class String {
+private:
+  std::string text;
+
+public:
+  String() {}
+  String(const char* value) : text(value != nullptr ? value : "") {}
+  String(const std::string& value) : text(value) {}
+  explicit String(char value) : text(1, value) {}
+  String(int value, unsigned char base = DEC);
+  String(unsigned int value, unsigned char base = DEC);
+  String(long value, unsigned char base = DEC);
+  String(unsigned long value, unsigned char base = DEC);
+  String(long long value, unsigned char base = DEC);
+  String(unsigned long long value, unsigned char base = DEC);
+  String(float value, unsigned int decimals = 2);
+  String(double value, unsigned int decimals = 2);
+
+  unsigned int length() const { return text.size(); }
+  const char* c_str() const { return text.c_str(); }
+  bool isEmpty() const { return text.empty(); }
+  bool reserve(unsigned int size) { text.reserve(size); return true; }
+  char charAt(unsigned int index) const { return index < text.size() ? text[index] : 0; }
+  char operator[](unsigned int index) const { return charAt(index); }
+  char& operator[](unsigned int index) { return text[index]; }
+
+  int indexOf(char c, unsigned int from = 0) const;
+  int indexOf(const String& s, unsigned int from = 0) const;
+  int lastIndexOf(char c) const;
+  int lastIndexOf(const String& s) const;
+  String substring(unsigned int from) const;
+  String substring(unsigned int from, unsigned int to) const;
+  bool startsWith(const String& prefix) const;
+  bool endsWith(const String& suffix) const;
+  bool equals(const String& other) const { return text == other.text; }
+  bool equalsIgnoreCase(const String& other) const;
+
+  long toInt() const { return atol(text.c_str()); }
+  float toFloat() const { return atof(text.c_str()); }
+  void trim();
+  void toLowerCase();
+  void toUpperCase();
+  void replace(const String& find, const String& with);
+  void remove(unsigned int index) { if (index < text.size()) text.erase(index); }
+  void remove(unsigned int index, unsigned int count) { if (index < text.size()) text.erase(index, count); }
+  bool concat(const char* data, unsigned int size) { text.append(data, size); return true; }
+  void toCharArray(char* buffer, unsigned int size) const;
+
+  String& operator+=(const String& other) { text += other.text; return *this; }
+  String& operator+=(const char* other) { text += other; return *this; }
+  String& operator+=(char c) { text += c; return *this; }
+  String& operator+=(int value) { text += String(value).text; return *this; }
+  bool operator==(const String& other) const { return text == other.text; }
+  bool operator==(const char* other) const { return text == other; }
+  bool operator!=(const String& other) const { return text != other.text; }
+  bool operator!=(const char* other) const { return text != other; }
+  bool operator<(const String& other) const { return text < other.text; }
+};
+
+String operator+(const String& a, const String& b);
+String operator+(const String& a, const char* b);
+String operator+(const char* a, const String& b);
+String operator+(const String& a, char b);
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* data, size_t size);
+  size_t write(const char* data, size_t size) { return write((const uint8_t*)data, size); }
+  virtual void flush() {}
+
+  size_t print(const String& value) { return write(value.c_str(), value.length()); }
+  size_t print(const char* value) { return write(value, strlen(value)); }
+  size_t print(char value) { return write((uint8_t)value); }
+  size_t print(int value, int base = DEC) { return print(String(value, base)); }
+  size_t print(unsigned int value, int base = DEC) { return print(String(value, base)); }
+  size_t print(long value, int base = DEC) { return print(String(value, base)); }
+  size_t print(unsigned long value, int base = DEC) { return print(String(value, base)); }
+  size_t print(long long value, int base = DEC) { return print(String(value, base)); }
+  size_t print(unsigned long long value, int base = DEC) { return print(String(value, base)); }
+  size_t print(double value, int decimals = 2) { return print(String(value, decimals)); }
+  template <typename T> size_t println(const T& value) { return print(value) + println(); }
+  template <typename T> size_t println(const T& value, int format) { return print(value, format) + println(); }
+  size_t println() { return print("\r\n"); }
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  String readStringUntil(char terminator);
+};
+
+class HardwareSerial : public Stream {
+private:
+  int fd;            // -1 = console (stdout) or unattached
+  bool console;
+  int peeked;
+
+public:
+  explicit HardwareSerial(bool isConsole = false);
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1);
+  void end() {}
+  void attach(int descriptor);  // Host only: read and write this fd
+  operator bool() const { return true; }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* data, size_t size) override;
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+// Time
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+int64_t hostMicros64();
+void hostAdvanceMicros(int64_t us);   // Jump ahead, in either mode
+void hostUseRealClock(bool real, unsigned speed = 1);  // speed: device ms per wall-clock ms
+
+// Pins read HIGH; a test can watch writes (e.g. a modem RST line)
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void hostOnDigitalWrite(void (*callback)(uint8_t pin, uint8_t value));
+
+long random(long max);
+long random(long min, long max);
+
+// Single-threaded tests: the spinlocks and mutexes only have to compile
+typedef struct { int owner; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) (void)(mux)
+#define portEXIT_CRITICAL(mux) (void)(mux)
+
+typedef void* SemaphoreHandle_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY 0xffffffff
+#define pdMS_TO_TICKS(ms) (ms)
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t) { return pdTRUE; }
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t) { return pdTRUE; }
+
+#endif
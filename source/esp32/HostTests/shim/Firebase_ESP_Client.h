@@ -0,0 +1,7 @@
+#ifndef HOST_FIREBASE_ESP_CLIENT_H
+#define HOST_FIREBASE_ESP_CLIENT_H
+
+// Only what ScheduleManager's interface names - FirebaseManager is not built on the host
+class FirebaseData {};
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef HOST_HARDWARE_SERIAL_H
+#define HOST_HARDWARE_SERIAL_H
+
+// HardwareSerial lives in the Arduino.h shim
+#include "Arduino.h"
+
+#endif
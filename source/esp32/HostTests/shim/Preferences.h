@@ -0,0 +1,125 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+// NVS in memory, shared by every Preferences object for the life of the test
+#include "Arduino.h"
+#include <map>
+
+inline std::map<std::string, std::string>& hostNVS() {
+  static std::map<std::string, std::string> store;
+  return store;
+}
+
+class Preferences {
+private:
+  std::string space;
+  bool opened;
+  bool readOnly;
+
+  std::string keyFor(const char* key) { return space + "/" + key; }
+
+  bool lookup(const char* key, std::string* value) {
+    if (!opened) {
+      return false;
+    }
+    std::map<std::string, std::string>::iterator it = hostNVS().find(keyFor(key));
+    if (it == hostNVS().end()) {
+      return false;
+    }
+    *value = it->second;
+    return true;
+  }
+
+  size_t store(const char* key, const void* data, size_t size) {
+    if (!opened || readOnly) {
+      return 0;
+    }
+    hostNVS()[keyFor(key)] = std::string((const char*)data, size);
+    return size;
+  }
+
+  template <typename T> T getValue(const char* key, T defaultValue) {
+    std::string value;
+    if (!lookup(key, &value) || value.size() != sizeof(T)) {
+      return defaultValue;
+    }
+    T result;
+    memcpy(&result, value.data(), sizeof(T));
+    return result;
+  }
+
+public:
+  Preferences() : opened(false), readOnly(false) {}
+
+  bool begin(const char* name, bool readOnlyMode = false) {
+    space = name;
+    opened = true;
+    readOnly = readOnlyMode;
+    return true;
+  }
+
+  void end() { opened = false; }
+
+  bool clear() {
+    if (!opened || readOnly) {
+      return false;
+    }
+    std::string prefix = space + "/";
+    std::map<std::string, std::string>::iterator it = hostNVS().lower_bound(prefix);
+    while (it != hostNVS().end() && it->first.compare(0, prefix.size(), prefix) == 0) {
+      hostNVS().erase(it++);
+    }
+    return true;
+  }
+
+  bool remove(const char* key) {
+    return opened && !readOnly && hostNVS().erase(keyFor(key)) > 0;
+  }
+
+  bool isKey(const char* key) {
+    std::string value;
+    return lookup(key, &value);
+  }
+
+  size_t putBool(const char* key, bool value) { return store(key, &value, sizeof(value)); }
+  size_t putUChar(const char* key, uint8_t value) { return store(key, &value, sizeof(value)); }
+  size_t putInt(const char* key, int32_t value) { return store(key, &value, sizeof(value)); }
+  size_t putUInt(const char* key, uint32_t value) { return store(key, &value, sizeof(value)); }
+  size_t putLong(const char* key, int32_t value) { return store(key, &value, sizeof(value)); }
+  size_t putULong(const char* key, uint32_t value) { return store(key, &value, sizeof(value)); }
+  size_t putLong64(const char* key, int64_t value) { return store(key, &value, sizeof(value)); }
+  size_t putFloat(const char* key, float value) { return store(key, &value, sizeof(value)); }
+  size_t putString(const char* key, const char* value) { return store(key, value, strlen(value)); }
+  size_t putString(const char* key, const String& value) { return putString(key, value.c_str()); }
+  size_t putBytes(const char* key, const void* value, size_t size) { return store(key, value, size); }
+
+  bool getBool(const char* key, bool defaultValue = false) { return getValue(key, defaultValue); }
+  uint8_t getUChar(const char* key, uint8_t defaultValue = 0) { return getValue(key, defaultValue); }
+  int32_t getInt(const char* key, int32_t defaultValue = 0) { return getValue(key, defaultValue); }
+  uint32_t getUInt(const char* key, uint32_t defaultValue = 0) { return getValue(key, defaultValue); }
+  int32_t getLong(const char* key, int32_t defaultValue = 0) { return getValue(key, defaultValue); }
+  uint32_t getULong(const char* key, uint32_t defaultValue = 0) { return getValue(key, defaultValue); }
+  int64_t getLong64(const char* key, int64_t defaultValue = 0) { return getValue(key, defaultValue); }
+  float getFloat(const char* key, float defaultValue = 0) { return getValue(key, defaultValue); }
+
+  String getString(const char* key, const String& defaultValue = String()) {
+    std::string value;
+    return lookup(key, &value) ? String(value) : defaultValue;
+  }
+
+  size_t getBytesLength(const char* key) {
+    std::string value;
+    return lookup(key, &value) ? value.size() : 0;
+  }
+
+  size_t getBytes(const char* key, void* buffer, size_t maxSize) {
+    std::string value;
+    if (!lookup(key, &value) || value.size() > maxSize) {
+      return 0;
+    }
+    memcpy(buffer, value.data(), value.size());
+    return value.size();
+  }
+};
+
+#endif
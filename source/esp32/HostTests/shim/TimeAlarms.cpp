@@ -0,0 +1,77 @@
+#include "TimeAlarms.h"
+
+TimeAlarmsClass Alarm;
+
+TimeAlarmsClass::TimeAlarmsClass() {
+  memset(slots, 0, sizeof(slots));
+  servicing = false;
+}
+
+AlarmId TimeAlarmsClass::alarmRepeat(int hour, int minute, int second, OnTick_t onTick) {
+  // Like the library, no alarms before the clock has been set
+  if (now() < SECS_PER_YEAR) {
+    return dtINVALID_ALARM_ID;
+  }
+  for (AlarmId id = 0; id < dtNBR_ALARMS; id++) {
+    if (!slots[id].used) {
+      slots[id].used = true;
+      slots[id].value = hour * SECS_PER_HOUR + minute * SECS_PER_MIN + second;
+      slots[id].onTick = onTick;
+      updateNextTrigger(id);
+      return id;
+    }
+  }
+  return dtINVALID_ALARM_ID;
+}
+
+void TimeAlarmsClass::free(AlarmId id) {
+  if (id < dtNBR_ALARMS) {
+    slots[id].used = false;
+  }
+}
+
+uint8_t TimeAlarmsClass::count() {
+  uint8_t used = 0;
+  for (AlarmId id = 0; id < dtNBR_ALARMS; id++) {
+    if (slots[id].used) {
+      used++;
+    }
+  }
+  return used;
+}
+
+time_t TimeAlarmsClass::read(AlarmId id) {
+  return id < dtNBR_ALARMS && slots[id].used ? slots[id].nextTrigger : 0;
+}
+
+void TimeAlarmsClass::delay(unsigned long ms) {
+  // The library spins in serviceAlarms() until ms have passed
+  serviceAlarms();
+  ::delay(ms);
+}
+
+void TimeAlarmsClass::serviceAlarms() {
+  if (servicing) {
+    return;
+  }
+  servicing = true;
+  for (AlarmId id = 0; id < dtNBR_ALARMS; id++) {
+    if (slots[id].used && now() >= slots[id].nextTrigger) {
+      OnTick_t onTick = slots[id].onTick;
+      updateNextTrigger(id);
+      if (onTick != nullptr) {
+        onTick();
+      }
+    }
+  }
+  servicing = false;
+}
+
+void TimeAlarmsClass::updateNextTrigger(AlarmId id) {
+  time_t time = now();
+  if (slots[id].value + previousMidnight(time) <= time) {
+    slots[id].nextTrigger = slots[id].value + nextMidnight(time);
+  } else {
+    slots[id].nextTrigger = slots[id].value + previousMidnight(time);
+  }
+}
@@ -0,0 +1,39 @@
+#ifndef HOST_TIME_ALARMS_H
+#define HOST_TIME_ALARMS_H
+
+// TimeAlarms daily alarms against TimeLib's now(), with the library's
+// absolute trigger times: a clock step does not move an armed alarm, and
+// an alarm whose trigger time has passed fires on the next service call.
+#include "TimeLib.h"
+
+typedef uint8_t AlarmId;
+typedef void (*OnTick_t)();
+
+#define dtNBR_ALARMS 40
+#define dtINVALID_ALARM_ID 255
+
+class TimeAlarmsClass {
+public:
+  TimeAlarmsClass();
+  AlarmId alarmRepeat(int hour, int minute, int second, OnTick_t onTick);
+  void free(AlarmId id);
+  uint8_t count();
+  time_t read(AlarmId id);   // Next trigger, local epoch
+  void delay(unsigned long ms);
+  void serviceAlarms();
+
+private:
+  struct Slot {
+    bool used;
+    time_t value;            // Seconds after midnight
+    time_t nextTrigger;
+    OnTick_t onTick;
+  };
+  Slot slots[dtNBR_ALARMS];
+  bool servicing;
+  void updateNextTrigger(AlarmId id);
+};
+
+extern TimeAlarmsClass Alarm;
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef HOST_TIMELIB_H
+#define HOST_TIMELIB_H
+
+// TimeLib's system time: set with setTime(), then advanced by millis()
+#include "Arduino.h"
+
+#define SECS_PER_MIN ((time_t)60UL)
+#define SECS_PER_HOUR ((time_t)3600UL)
+#define SECS_PER_DAY ((time_t)86400UL)
+#define SECS_PER_YEAR ((time_t)(SECS_PER_DAY * 365UL))
+#define SECS_YR_2000 ((time_t)946684800UL)
+#define previousMidnight(_time_) (((_time_) / SECS_PER_DAY) * SECS_PER_DAY)
+#define nextMidnight(_time_) (previousMidnight(_time_) + SECS_PER_DAY)
+
+struct HostTimeLibClock {
+  time_t base;
+  unsigned long setAtMs;
+};
+
+inline HostTimeLibClock& hostTimeLibClock() {
+  static HostTimeLibClock clock = {0, 0};
+  return clock;
+}
+
+inline void setTime(time_t t) {
+  hostTimeLibClock().base = t;
+  hostTimeLibClock().setAtMs = millis();
+}
+
+inline time_t now() {
+  return hostTimeLibClock().base + (time_t)((millis() - hostTimeLibClock().setAtMs) / 1000);
+}
+
+inline int hostTimeLibField(time_t t, int which) {
+  struct tm fields;
+  gmtime_r(&t, &fields);
+  switch (which) {
+    case 0: return fields.tm_hour;
+    case 1: return fields.tm_min;
+    case 2: return fields.tm_sec;
+    case 3: return fields.tm_mday;
+    case 4: return fields.tm_mon + 1;
+    case 5: return fields.tm_year + 1900;
+    default: return fields.tm_wday + 1;  // TimeLib weekday: Sunday is 1
+  }
+}
+
+inline int hour(time_t t) { return hostTimeLibField(t, 0); }
+inline int minute(time_t t) { return hostTimeLibField(t, 1); }
+inline int second(time_t t) { return hostTimeLibField(t, 2); }
+inline int day(time_t t) { return hostTimeLibField(t, 3); }
+inline int month(time_t t) { return hostTimeLibField(t, 4); }
+inline int year(time_t t) { return hostTimeLibField(t, 5); }
+inline int weekday(time_t t) { return hostTimeLibField(t, 6); }
+inline int hour() { return hour(now()); }
+inline int minute() { return minute(now()); }
+inline int second() { return second(now()); }
+inline int day() { return day(now()); }
+inline int month() { return month(now()); }
+inline int year() { return year(now()); }
+inline int weekday() { return weekday(now()); }
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+// Station status only - hostSetWiFiStatus() picks what status() reports
+#include "Arduino.h"
+
+#define WL_IDLE_STATUS 0
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+
+inline int& hostWiFiStatus() {
+  static int status = WL_DISCONNECTED;
+  return status;
+}
+
+inline void hostSetWiFiStatus(int status) {
+  hostWiFiStatus() = status;
+}
+
+class WiFiClass {
+public:
+  WiFiClass() {}
+  int status() { return hostWiFiStatus(); }
+};
+
+static WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef HOST_ESP_ATTR_H
+#define HOST_ESP_ATTR_H
+
+// No RTC memory on the host - such variables are ordinary statics
+#define RTC_NOINIT_ATTR
+#define RTC_DATA_ATTR
+#define IRAM_ATTR
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef HOST_ESP_SNTP_H
+#define HOST_ESP_SNTP_H
+
+// The SNTP client never runs on the host; tests feed reference time directly
+#include <stdint.h>
+#include <sys/time.h>
+
+#define ESP_SNTP_OPMODE_POLL 0
+#define SNTP_SYNC_MODE_IMMED 0
+#define SNTP_SYNC_MODE_SMOOTH 1
+
+typedef void (*sntp_sync_time_cb_t)(struct timeval* tv);
+
+inline bool esp_sntp_enabled() { return false; }
+inline void esp_sntp_stop() {}
+inline void esp_sntp_init() {}
+inline void esp_sntp_setoperatingmode(int) {}
+inline void esp_sntp_setservername(uint8_t, const char*) {}
+inline void sntp_set_sync_mode(int) {}
+inline void sntp_set_sync_interval(uint32_t) {}
+inline void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t) {}
+inline bool sntp_restart() { return true; }
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+// The monotonic microsecond timer - the shim's clock
+#include "Arduino.h"
+
+inline int64_t esp_timer_get_time() {
+  return hostMicros64();
+}
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef HOST_LWIP_TCPIP_H
+#define HOST_LWIP_TCPIP_H
+
+// No lwIP thread on the host - the core lock is a no-op
+#define LOCK_TCPIP_CORE()
+#define UNLOCK_TCPIP_CORE()
+
+#endif
@@ -0,0 +1,132 @@
+// LogDecoder - turns the PillDispenser binary event log back into text
+//
+// Build:  g++ -std=c++11 -o logdecode LogDecoder.cpp
+// Use:    logdecode capture.bin
+//         cat /dev/ttyUSB0 | logdecode
+//
+// Framed records (see ../PillDispenser/LogEvents.h) are printed with their
+// format strings; every other byte on the UART is passed through unchanged,
+// so ordinary console output stays readable alongside the log.
+
+#include <cstdio>
+#include <cstring>
+#include "../PillDispenser/LogEvents.h"
+
+#define LOG_FORMAT_ENTRY(id, text) text,
+static const char* EVENT_FORMATS[LOG_EVENT_COUNT] = {
+  LOG_EVENT_LIST(LOG_FORMAT_ENTRY)
+};
+#undef LOG_FORMAT_ENTRY
+
+#define LOG_NAME_ENTRY(id, text) #id,
+static const char* EVENT_NAMES[LOG_EVENT_COUNT] = {
+  LOG_EVENT_LIST(LOG_NAME_ENTRY)
+};
+#undef LOG_NAME_ENTRY
+
+#define LOG_MODULE_ENTRY(id, text) text,
+static const char* MODULE_NAMES[LOG_MODULE_COUNT] = {
+  LOG_MODULE_LIST(LOG_MODULE_ENTRY)
+};
+#undef LOG_MODULE_ENTRY
+
+static const char* LEVEL_NAMES[] = {"NONE", "ERROR", "WARN", "INFO", "DEBUG"};
+
+static unsigned long decoded = 0;
+static unsigned long rejected = 0;
+
+// Little endian on both ends - the ESP32 and any x86/ARM host
+static bool decodeFrame(const unsigned char* frame) {
+  const unsigned char* body = frame + 2;
+  unsigned char sum = 0;
+  for (size_t i = 0; i < sizeof(LogRecord); i++) {
+    sum += body[i];
+  }
+  if (sum != frame[LOG_FRAME_SIZE - 1]) {
+    return false;
+  }
+  
+  LogRecord record;
+  memcpy(&record, body, sizeof(LogRecord));
+  if (record.level > LOG_LEVEL_DEBUG || record.module >= LOG_MODULE_COUNT || record.event >= LOG_EVENT_COUNT) {
+    return false;
+  }
+  
+  char message[160];
+  snprintf(message, sizeof(message), EVENT_FORMATS[record.event],
+           (int)record.args[0], (int)record.args[1], (int)record.args[2]);
+  
+  unsigned long ms = record.timestamp;
+  printf("[%5lu.%03lu] %-5s %-8s %s (%s)\n", ms / 1000, ms % 1000,
+         LEVEL_NAMES[record.level], MODULE_NAMES[record.module], message, EVENT_NAMES[record.event]);
+  return true;
+}
+
+// Either passing text through or filling a candidate frame
+static unsigned char frame[LOG_FRAME_SIZE];
+static size_t filled = 0;
+
+static void feed(unsigned char c) {
+  if (filled == 0) {
+    if (c == LOG_FRAME_SYNC1) {
+      frame[filled++] = c;
+    } else {
+      putchar(c);
+    }
+    return;
+  }
+  
+  if (filled == 1 && c != LOG_FRAME_SYNC2) {
+    // Lone SYNC1 was ordinary data
+    putchar(frame[0]);
+    filled = 0;
+    feed(c);
+    return;
+  }
+  
+  frame[filled++] = c;
+  if (filled < LOG_FRAME_SIZE) {
+    return;
+  }
+  
+  filled = 0;
+  if (decodeFrame(frame)) {
+    decoded++;
+    fflush(stdout);
+    return;
+  }
+  
+  // Not a frame after all - emit the first byte and rescan the rest
+  rejected++;
+  unsigned char rest[LOG_FRAME_SIZE];
+  memcpy(rest, frame, LOG_FRAME_SIZE);
+  putchar(rest[0]);
+  for (size_t i = 1; i < LOG_FRAME_SIZE; i++) {
+    feed(rest[i]);
+  }
+}
+
+int main(int argc, char** argv) {
+  FILE* in = stdin;
+  if (argc > 1) {
+    in = fopen(argv[1], "rb");
+    if (!in) {
+      fprintf(stderr, "logdecode: cannot open %s\n", argv[1]);
+      return 1;
+    }
+  }
+  
+  int c;
+  while ((c = fgetc(in)) != EOF) {
+    feed((unsigned char)c);
+  }
+  
+  // Trailing partial frame
+  fwrite(frame, 1, filled, stdout);
+  
+  if (in != stdin) {
+    fclose(in);
+  }
+  fprintf(stderr, "logdecode: %lu record(s) decoded, %lu bad frame(s)\n", decoded, rejected);
+  return 0;
+}
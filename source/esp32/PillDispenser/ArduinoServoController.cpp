@@ -5,6 +5,7 @@ ArduinoServoController::ArduinoServoController(uint8_t rxPin, uint8_t txPin, uns
   this->txPin = txPin;
   this->responseTimeout = timeout;
   this->arduinoReady = false;
+  this->servoMoves = 0;
   this->serial = &Serial1; // Use UART1 on ESP32
 }
 
@@ -114,6 +115,17 @@ bool ArduinoServoController::isSuccessResponse(String response) {
   return response.startsWith("OK:") || response == "PONG";
 }
 
+bool ArduinoServoController::countMoves(bool success, uint8_t moves) {
+  if (success) {
+    servoMoves += moves;
+  }
+  return success;
+}
+
+unsigned long ArduinoServoController::getServoMoveCount() {
+  return servoMoves;
+}
+
 bool ArduinoServoController::ping() {
   String response = sendCommand("PING", 1000);
   return response == "PONG";
@@ -132,7 +144,7 @@ bool ArduinoServoController::setServoAngle(uint8_t channel, uint16_t angle) {
   
   String command = "SA" + String(channel) + "," + String(angle);
   String response = sendCommand(command, responseTimeout);
-  return isSuccessResponse(response);
+  return countMoves(isSuccessResponse(response), 1);
 }
 
 bool ArduinoServoController::dispensePill(uint8_t channel) {
@@ -162,7 +174,7 @@ bool ArduinoServoController::dispensePill(uint8_t channel) {
     }
   }
   
-  return isSuccessResponse(response);
+  return countMoves(isSuccessResponse(response), 5);
 }
 
 bool ArduinoServoController::dispensePillPair(uint8_t channel1, uint8_t channel2) {
@@ -173,7 +185,7 @@ bool ArduinoServoController::dispensePillPair(uint8_t channel1, uint8_t channel2
   
   String command = "DP2" + String(channel1) + "," + String(channel2);
   String response = sendCommand(command, responseTimeout + 3000); // Extra time for dispensing
-  return isSuccessResponse(response);
+  return countMoves(isSuccessResponse(response), 6);
 }
 
 bool ArduinoServoController::testServo(uint8_t channel) {
@@ -184,7 +196,7 @@ bool ArduinoServoController::testServo(uint8_t channel) {
   
   String command = "TS" + String(channel);
   String response = sendCommand(command, 5000); // Test takes ~3.5 seconds
-  return isSuccessResponse(response);
+  return countMoves(isSuccessResponse(response), 3);
 }
 
 bool ArduinoServoController::calibrateServo(uint8_t channel) {
@@ -195,12 +207,12 @@ bool ArduinoServoController::calibrateServo(uint8_t channel) {
   
   String command = "CA" + String(channel);
   String response = sendCommand(command, 8000); // Calibration takes longer
-  return isSuccessResponse(response);
+  return countMoves(isSuccessResponse(response), 5);
 }
 
 bool ArduinoServoController::resetAllServos() {
   String response = sendCommand("RS", 5000);
-  return isSuccessResponse(response);
+  return countMoves(isSuccessResponse(response), 7);
 }
 
 bool ArduinoServoController::stopAllServos() {
@@ -210,12 +222,12 @@ bool ArduinoServoController::stopAllServos() {
 
 bool ArduinoServoController::moveServosToRelease() {
   String response = sendCommand("RL", 3000);
-  return isSuccessResponse(response);
+  return countMoves(isSuccessResponse(response), 2);
 }
 
 bool ArduinoServoController::moveServosToHome() {
   String response = sendCommand("MH", 3000);
-  return isSuccessResponse(response);
+  return countMoves(isSuccessResponse(response), 2);
 }
 
 void ArduinoServoController::update() {
@@ -25,6 +25,7 @@ private:
   uint8_t txPin;
   unsigned long responseTimeout;
   bool arduinoReady;
+  unsigned long servoMoves;  // Physical moves completed, for the battery energy model
   
   // Send command and wait for response
   String sendCommand(String command, unsigned long timeout = 2000);
@@ -32,6 +33,9 @@ private:
   // Check if response indicates success
   bool isSuccessResponse(String response);
   
+  // Add the servo moves a successful command made to servoMoves
+  bool countMoves(bool success, uint8_t moves);
+  
 public:
   /**
    * Constructor
@@ -135,6 +139,13 @@ public:
    * Useful for monitoring heartbeat and async messages
    */
   void update();
+  
+  /**
+   * Total servo moves completed since boot (a dispense counts as 5:
+   * dispense servo, then CH5/CH6 to release and back home)
+   * @return move count
+   */
+  unsigned long getServoMoveCount();
 };
 
 #endif
@@ -0,0 +1,212 @@
+#include "BatteryEstimator.h"
+#include <WiFi.h>
+
+// 18650 NMC Li-ion, per cell, rested
+static const OcvPoint LIION_OCV[] = {
+  {3000, 0}, {3300, 2}, {3500, 5}, {3600, 8}, {3690, 10}, {3710, 15},
+  {3730, 20}, {3750, 25}, {3770, 30}, {3790, 35}, {3800, 40}, {3820, 45},
+  {3840, 50}, {3850, 55}, {3870, 60}, {3910, 65}, {3950, 70}, {3980, 75},
+  {4020, 80}, {4080, 85}, {4110, 90}, {4150, 95}, {4200, 100}
+};
+
+// LiFePO4, per cell, rested - very flat between 20 % and 80 %
+static const OcvPoint LIFEPO4_OCV[] = {
+  {2500, 0}, {2900, 5}, {3000, 8}, {3130, 10}, {3200, 20}, {3220, 30},
+  {3250, 40}, {3260, 50}, {3270, 60}, {3280, 70}, {3300, 80}, {3320, 90},
+  {3350, 95}, {3400, 99}, {3600, 100}
+};
+
+BatteryEstimator::BatteryEstimator(VoltageSensor* voltageSensor, ArduinoServoController* servoController, SIM800L* sim800Module) {
+  sensor = voltageSensor;
+  servos = servoController;
+  modem = sim800Module;
+  power = nullptr;
+  ocvTable = LIION_OCV;
+  ocvPoints = sizeof(LIION_OCV) / sizeof(LIION_OCV[0]);
+  cells = 2;
+  capacityMah = 2600;
+  chemistry = "liion";
+  socPercent = 0;
+  ocvPercent = 0;
+  averageCurrentMa = BOARD_CURRENT_MA + ESP32_CURRENT_MA;
+  usedMah = 0;
+  initialized = false;
+  loadActive = false;
+  lastLoadAt = 0;
+  lastServoMoves = 0;
+  lastRadioMs = 0;
+  lastSleptMs = 0;
+  lastUpdate = 0;
+  restedSamples = 0;
+  rejectedSamples = 0;
+  lowAlertArmed = true;
+  onLowBatteryCallback = nullptr;
+}
+
+void BatteryEstimator::begin(String batteryChemistry, uint8_t cellCount, unsigned int capacity) {
+  batteryChemistry.toLowerCase();
+  if (batteryChemistry == "lifepo4") {
+    ocvTable = LIFEPO4_OCV;
+    ocvPoints = sizeof(LIFEPO4_OCV) / sizeof(LIFEPO4_OCV[0]);
+  } else {
+    batteryChemistry = "liion";
+    ocvTable = LIION_OCV;
+    ocvPoints = sizeof(LIION_OCV) / sizeof(LIION_OCV[0]);
+  }
+  chemistry = batteryChemistry;
+  cells = cellCount > 0 ? cellCount : 1;
+  capacityMah = capacity;
+  
+  lastServoMoves = servos->getServoMoveCount();
+  lastRadioMs = modem->getRadioActiveMs();
+  lastUpdate = millis();
+  
+  // Nothing has run yet at boot, so the first reading is the best OCV we get
+  ocvPercent = percentFromOcv(getVoltage() / cells);
+  socPercent = ocvPercent;
+  initialized = true;
+  lowAlertArmed = socPercent >= LOW_BATTERY_PERCENT;
+  
+  Serial.println("BatteryEstimator: " + String(cells) + "S " + chemistry + ", " +
+                 String(capacity) + " mAh, initial SoC " + String(socPercent, 0) + "%");
+}
+
+float BatteryEstimator::percentFromOcv(float cellVolts) {
+  float milliVolts = cellVolts * 1000.0;
+  
+  if (milliVolts <= ocvTable[0].cellMilliVolts) {
+    return ocvTable[0].percent;
+  }
+  if (milliVolts >= ocvTable[ocvPoints - 1].cellMilliVolts) {
+    return ocvTable[ocvPoints - 1].percent;
+  }
+  
+  // Linear between the two surrounding points
+  for (uint8_t i = 1; i < ocvPoints; i++) {
+    if (milliVolts <= ocvTable[i].cellMilliVolts) {
+      const OcvPoint& low = ocvTable[i - 1];
+      const OcvPoint& high = ocvTable[i];
+      float fraction = (milliVolts - low.cellMilliVolts) / (float)(high.cellMilliVolts - low.cellMilliVolts);
+      return low.percent + fraction * (high.percent - low.percent);
+    }
+  }
+  return ocvTable[ocvPoints - 1].percent;
+}
+
+void BatteryEstimator::update() {
+  if (!initialized) return;
+  
+  unsigned long now = millis();
+  unsigned long elapsed = now - lastUpdate;
+  if (elapsed < UPDATE_INTERVAL) return;
+  lastUpdate = now;
+  
+  // Energy drawn since the last step
+  unsigned long servoMoves = servos->getServoMoveCount();
+  unsigned long radioMs = modem->getRadioActiveMs();
+  unsigned long newMoves = servoMoves - lastServoMoves;
+  unsigned long newRadioMs = radioMs - lastRadioMs;
+  lastServoMoves = servoMoves;
+  lastRadioMs = radioMs;
+  
+  // millis() keeps counting through light sleep - split the step into awake and asleep
+  unsigned long asleepMs = 0;
+  if (power != nullptr) {
+    uint64_t sleptMs = power->getSleptMs();
+    uint64_t newSleptMs = sleptMs - lastSleptMs;
+    asleepMs = newSleptMs > elapsed ? elapsed : (unsigned long)newSleptMs;
+    lastSleptMs = sleptMs;
+  }
+  unsigned long awakeMs = elapsed - asleepMs;
+  
+  float awakeMa = ESP32_CURRENT_MA + (WiFi.status() == WL_CONNECTED ? WIFI_CURRENT_MA : 0);
+  float drawnMah = BOARD_CURRENT_MA * elapsed / 3600000.0 +
+                   awakeMa * awakeMs / 3600000.0 +
+                   ESP32_SLEEP_CURRENT_MA * asleepMs / 3600000.0 +
+                   GSM_ACTIVE_CURRENT_MA * newRadioMs / 3600000.0 +
+                   SERVO_MOVE_MAH * newMoves;
+  usedMah += drawnMah;
+  socPercent -= drawnMah / capacityMah * 100.0;
+  
+  float intervalCurrent = drawnMah * 3600000.0 / elapsed;
+  averageCurrentMa += (intervalCurrent - averageCurrentMa) * AVERAGE_WEIGHT;
+  
+  // Voltage only counts once the battery has recovered from the last load
+  if (loadActive || newMoves > 0 || newRadioMs > 0) {
+    lastLoadAt = now;
+  }
+  if (!loadActive && now - lastLoadAt >= SETTLE_TIME) {
+    ocvPercent = percentFromOcv(getVoltage() / cells);
+    socPercent += (ocvPercent - socPercent) * OCV_WEIGHT;
+    restedSamples++;
+  } else {
+    rejectedSamples++;
+  }
+  socPercent = constrain(socPercent, 0.0f, 100.0f);
+  
+  // Low battery alert, once per discharge
+  if (lowAlertArmed && socPercent < LOW_BATTERY_PERCENT) {
+    lowAlertArmed = false;
+    Serial.println("BatteryEstimator: ⚠️ Low battery - " + String(socPercent, 0) + "%, ~" +
+                   String(getHoursRemaining(), 1) + " h left");
+    if (onLowBatteryCallback != nullptr) {
+      onLowBatteryCallback(socPercent, getHoursRemaining());
+    }
+  } else if (!lowAlertArmed && socPercent > LOW_BATTERY_REARM_PERCENT) {
+    lowAlertArmed = true;
+  }
+}
+
+void BatteryEstimator::setLoadActive(bool active) {
+  if (loadActive && !active) {
+    lastLoadAt = millis();
+  }
+  loadActive = active;
+}
+
+void BatteryEstimator::setPowerManager(PowerManager* powerManager) {
+  power = powerManager;
+  if (power != nullptr) {
+    lastSleptMs = power->getSleptMs();
+  }
+}
+
+void BatteryEstimator::setLowBatteryCallback(void (*callback)(float percent, float hoursLeft)) {
+  onLowBatteryCallback = callback;
+}
+
+float BatteryEstimator::getPercent() {
+  return socPercent;
+}
+
+float BatteryEstimator::getHoursRemaining() {
+  if (averageCurrentMa <= 0) return 0;
+  return socPercent / 100.0 * capacityMah / averageCurrentMa;
+}
+
+float BatteryEstimator::getAverageCurrentMa() {
+  return averageCurrentMa;
+}
+
+float BatteryEstimator::getVoltage() {
+  return sensor->readActualVoltage();
+}
+
+bool BatteryEstimator::isLow() {
+  return socPercent < LOW_BATTERY_PERCENT;
+}
+
+void BatteryEstimator::printStatus() {
+  Serial.println("\n=== BATTERY ESTIMATOR ===");
+  Serial.println("Pack: " + String(cells) + "S " + chemistry + ", " + String(capacityMah, 0) + " mAh");
+  Serial.println("Voltage: " + String(getVoltage(), 2) + " V (" + String(getVoltage() / cells, 3) + " V/cell)");
+  Serial.println("State of charge: " + String(socPercent, 1) + "%");
+  Serial.println("Last rested OCV reading: " + String(ocvPercent, 1) + "%");
+  Serial.println("Average current: " + String(averageCurrentMa, 0) + " mA");
+  Serial.println("Runtime left: " + String(getHoursRemaining(), 1) + " h");
+  Serial.println("Modelled use since boot: " + String(usedMah, 1) + " mAh");
+  Serial.println("Voltage samples used/skipped (load): " + String(restedSamples) + " / " + String(rejectedSamples));
+  Serial.println("Servo moves: " + String(servos->getServoMoveCount()) +
+                 ", radio active: " + String(modem->getRadioActiveMs() / 1000) + " s");
+  Serial.println("=========================\n");
+}
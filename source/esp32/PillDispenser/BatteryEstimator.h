@@ -0,0 +1,103 @@
+#ifndef BATTERY_ESTIMATOR_H
+#define BATTERY_ESTIMATOR_H
+
+#include <Arduino.h>
+#include "VoltageSensor.h"
+#include "ArduinoServoController.h"
+#include "SIM800L.h"
+#include "PowerManager.h"
+
+#define LOW_BATTERY_PERCENT 20.0     // Alert below this
+#define LOW_BATTERY_REARM_PERCENT 30.0  // Alert again only after recovering above this
+
+// Rested (open-circuit) cell voltage vs state of charge
+struct OcvPoint {
+  uint16_t cellMilliVolts;
+  uint8_t percent;
+};
+
+/**
+ * BatteryEstimator
+ *
+ * State of charge from two sources:
+ *  - Voltage: the filtered battery voltage per cell through an open-circuit
+ *    voltage table for the chemistry. Only used when the battery is rested -
+ *    no dispense in progress and no servo or radio activity for SETTLE_TIME -
+ *    since the servos and GSM bursts sag the voltage far below its OCV.
+ *  - Energy: charge drawn since the last update, modelled from a baseline
+ *    current, WiFi, counted servo moves and SIM800L transmit time. Time
+ *    the ESP32 spent in light sleep is charged at its sleep current.
+ *
+ * The energy model runs every update; rested voltage readings pull the
+ * estimate toward the OCV value a little at a time, which removes the
+ * model's drift without letting one bad reading move the percentage much.
+ * Runtime left is the remaining charge over the average modelled current.
+ */
+class BatteryEstimator {
+private:
+  VoltageSensor* sensor;
+  ArduinoServoController* servos;
+  SIM800L* modem;
+  PowerManager* power;
+  
+  const OcvPoint* ocvTable;
+  uint8_t ocvPoints;
+  uint8_t cells;
+  float capacityMah;
+  String chemistry;
+  
+  // Estimate
+  float socPercent;
+  float ocvPercent;              // Last rested voltage reading
+  float averageCurrentMa;
+  float usedMah;                 // Modelled charge drawn since boot
+  bool initialized;
+  
+  // Load tracking
+  bool loadActive;               // Dispense in progress
+  unsigned long lastLoadAt;      // Last time anything sagged the voltage
+  unsigned long lastServoMoves;
+  unsigned long lastRadioMs;
+  uint64_t lastSleptMs;
+  unsigned long lastUpdate;
+  unsigned long restedSamples;
+  unsigned long rejectedSamples;
+  
+  // Low battery alert
+  bool lowAlertArmed;
+  void (*onLowBatteryCallback)(float percent, float hoursLeft);
+  
+  static const unsigned long UPDATE_INTERVAL = 10000;   // Model step every 10 seconds
+  static const unsigned long SETTLE_TIME = 60000;       // Voltage recovers within a minute after load
+  static constexpr float OCV_WEIGHT = 0.1;              // Share of the OCV error corrected per rested sample
+  static constexpr float AVERAGE_WEIGHT = 1.0 / 60;     // Current average over ~10 minutes of updates
+  
+  // Energy model (mA / mAh)
+  static constexpr float BOARD_CURRENT_MA = 60.0;       // Arduino Uno, PCA9685, LCD backlight, GSM idle
+  static constexpr float ESP32_CURRENT_MA = 50.0;       // ESP32 awake, radio off
+  static constexpr float ESP32_SLEEP_CURRENT_MA = 0.8;  // ESP32 in light sleep
+  static constexpr float WIFI_CURRENT_MA = 60.0;        // WiFi associated, modem sleep, while awake
+  static constexpr float GSM_ACTIVE_CURRENT_MA = 350.0; // Average while sending SMS, calling or on GPRS
+  static constexpr float SERVO_MOVE_MAH = 0.15;         // One servo move under load
+  
+  float percentFromOcv(float cellVolts);
+  
+public:
+  BatteryEstimator(VoltageSensor* voltageSensor, ArduinoServoController* servoController, SIM800L* sim800Module);
+  void begin(String batteryChemistry, uint8_t cellCount, unsigned int capacity);
+  void setPowerManager(PowerManager* powerManager);  // Optional - for light sleep time
+  void update();
+  
+  // Dispense in progress - voltage readings are ignored until SETTLE_TIME after it ends
+  void setLoadActive(bool active);
+  void setLowBatteryCallback(void (*callback)(float percent, float hoursLeft));
+  
+  float getPercent();
+  float getHoursRemaining();
+  float getAverageCurrentMa();
+  float getVoltage();
+  bool isLow();
+  void printStatus();
+};
+
+#endif
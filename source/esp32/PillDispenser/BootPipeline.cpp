@@ -0,0 +1,141 @@
+#include "BootPipeline.h"
+
+BootPipeline* BootPipeline::instance = nullptr;
+
+BootPipeline::BootPipeline() {
+  memset(stages, 0, sizeof(stages));
+  stageCount = 0;
+  doneBits = nullptr;
+  startMillis = 0;
+  totalMillis = 0;
+  finished = false;
+  instance = this;
+}
+
+int BootPipeline::add(const char* name, BootStageFunction run, uint32_t after, bool parallel) {
+  if (stageCount >= BOOT_MAX_STAGES) {
+    Serial.println("BootPipeline: ❌ Too many stages - " + String(name) + " not added");
+    return -1;
+  }
+  // Only earlier stages may be waited for, which rules out cycles
+  if (after >> stageCount != 0) {
+    Serial.println("BootPipeline: ❌ " + String(name) + " depends on a later stage - not added");
+    return -1;
+  }
+  
+  BootStage& stage = stages[stageCount];
+  stage.name = name;
+  stage.run = run;
+  stage.after = after;
+  stage.parallel = parallel;
+  stage.state = BOOT_STAGE_WAITING;
+  return stageCount++;
+}
+
+void BootPipeline::run() {
+  startMillis = millis();
+  doneBits = xEventGroupCreate();
+  if (doneBits == nullptr) {
+    Serial.println("BootPipeline: ⚠️ No memory for the event group - booting in sequence");
+  }
+  
+  // Workers first - they wait on their own dependencies
+  for (uint8_t i = 0; i < stageCount && doneBits != nullptr; i++) {
+    if (!stages[i].parallel) continue;
+    if (xTaskCreatePinnedToCore(workerTask, stages[i].name, BOOT_WORKER_STACK, (void*)(intptr_t)i,
+                                BOOT_WORKER_PRIORITY, nullptr, BOOT_WORKER_CORE) != pdPASS) {
+      Serial.println("BootPipeline: ⚠️ No worker for " + String(stages[i].name) + " - running it in line");
+      stages[i].parallel = false;
+    }
+  }
+  
+  for (uint8_t i = 0; i < stageCount; i++) {
+    if (!stages[i].parallel || doneBits == nullptr) {
+      runStage(i);
+    }
+  }
+  
+  if (doneBits != nullptr) {
+    EventBits_t all = (EventBits_t)(BOOT_AFTER(stageCount) - 1);
+    xEventGroupWaitBits(doneBits, all, pdFALSE, pdTRUE, portMAX_DELAY);
+    // Workers touch nothing after setting their bit
+    vEventGroupDelete(doneBits);
+    doneBits = nullptr;
+  }
+  
+  totalMillis = millis() - startMillis;
+  finished = true;
+  Serial.printf("BootPipeline: Boot finished in %lu ms\n", totalMillis);
+}
+
+void BootPipeline::workerTask(void* param) {
+  instance->runStage((uint8_t)(intptr_t)param);
+  vTaskDelete(NULL);
+}
+
+void BootPipeline::runStage(uint8_t index) {
+  BootStage& stage = stages[index];
+  if (stage.after != 0 && doneBits != nullptr) {
+    xEventGroupWaitBits(doneBits, (EventBits_t)stage.after, pdFALSE, pdTRUE, portMAX_DELAY);
+  }
+  
+  stage.startedAt = millis() - startMillis;
+  stage.state = BOOT_STAGE_RUNNING;
+  bool ok = stage.run();
+  stage.finishedAt = millis() - startMillis;
+  stage.state = ok ? BOOT_STAGE_OK : BOOT_STAGE_FAILED;
+  
+  Serial.printf("BootPipeline: %s %s in %lu ms\n", ok ? "✅" : "❌", stage.name,
+                stage.finishedAt - stage.startedAt);
+  if (doneBits != nullptr) {
+    xEventGroupSetBits(doneBits, (EventBits_t)BOOT_AFTER(index));
+  }
+}
+
+bool BootPipeline::isFinished() {
+  return finished;
+}
+
+bool BootPipeline::isOk(int stage) {
+  return stage >= 0 && stage < stageCount && stages[stage].state == BOOT_STAGE_OK;
+}
+
+unsigned long BootPipeline::getFinishedAt(int stage) {
+  if (stage < 0 || stage >= stageCount || stages[stage].state < BOOT_STAGE_OK) {
+    return 0;
+  }
+  return startMillis + stages[stage].finishedAt;
+}
+
+unsigned long BootPipeline::getTotalMillis() {
+  return totalMillis;
+}
+
+void BootPipeline::printReport() {
+  Serial.println("\n=== BOOT TIMING ===");
+  Serial.printf("Pipeline started %lu ms after power-on\n", startMillis);
+  Serial.println("Stage                 Start    Took  Result   After");
+  for (uint8_t i = 0; i < stageCount; i++) {
+    const BootStage& stage = stages[i];
+    const char* result = stage.state == BOOT_STAGE_OK ? "ok" :
+                         stage.state == BOOT_STAGE_FAILED ? "FAILED" :
+                         stage.state == BOOT_STAGE_RUNNING ? "running" : "waiting";
+    unsigned long took = stage.state >= BOOT_STAGE_OK ? stage.finishedAt - stage.startedAt : 0;
+  
+    Serial.printf("%c %-18s %6lu %7lu  %-8s", stage.parallel ? '*' : ' ', stage.name,
+                  stage.startedAt, took, result);
+    for (uint8_t d = 0; d < i; d++) {
+      if (stage.after & BOOT_AFTER(d)) {
+        Serial.printf(" %s", stages[d].name);
+      }
+    }
+    Serial.println();
+  }
+  Serial.println("* = own worker task; times in ms from pipeline start");
+  if (finished) {
+    Serial.printf("Total: %lu ms (%lu ms after power-on)\n", totalMillis, startMillis + totalMillis);
+  } else {
+    Serial.println("Boot still in progress");
+  }
+  Serial.println("===================\n");
+}
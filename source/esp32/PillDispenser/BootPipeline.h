@@ -0,0 +1,77 @@
+#ifndef BOOT_PIPELINE_H
+#define BOOT_PIPELINE_H
+
+#include <Arduino.h>
+
+#define BOOT_MAX_STAGES 12       // One event group bit each (24 available)
+#define BOOT_WORKER_STACK 6144   // SIM800L and Uno handshakes build Strings
+#define BOOT_WORKER_PRIORITY 2
+#define BOOT_WORKER_CORE 0       // setup() runs the in-line stages on core 1
+
+#define BOOT_AFTER(stage) (1UL << (stage))
+
+// Returns false if the subsystem did not come up; later stages still run
+typedef bool (*BootStageFunction)();
+
+enum BootStageState {
+  BOOT_STAGE_WAITING,
+  BOOT_STAGE_RUNNING,
+  BOOT_STAGE_OK,
+  BOOT_STAGE_FAILED
+};
+
+struct BootStage {
+  const char* name;
+  BootStageFunction run;
+  uint32_t after;              // BOOT_AFTER() bits of stages that must finish first
+  bool parallel;               // Own worker task instead of setup()'s
+  volatile BootStageState state;
+  unsigned long startedAt;     // ms since run() was called
+  unsigned long finishedAt;
+};
+
+/**
+ * BootPipeline
+ *
+ * Brings the subsystems up as a dependency graph instead of one long
+ * sequence. Parallel stages get a short-lived worker task each and start
+ * as soon as the stages they depend on have finished, so the Uno handshake,
+ * the SIM800L reset and the LCD no longer wait for each other. The other
+ * stages run in the order added on the caller's task, which keeps blocking
+ * work like the WiFi portal where it always was.
+ *
+ * A stage may only depend on stages added before it, so the graph cannot
+ * deadlock. A dependency orders stages, it does not require success - each
+ * stage function checks what it needs.
+ *
+ * Start and finish times are kept per stage for the boot-timing report.
+ */
+class BootPipeline {
+private:
+  static BootPipeline* instance;
+  BootStage stages[BOOT_MAX_STAGES];
+  uint8_t stageCount;
+  EventGroupHandle_t doneBits;
+  unsigned long startMillis;   // millis() when run() was called
+  unsigned long totalMillis;
+  bool finished;
+  
+  static void workerTask(void* param);
+  void runStage(uint8_t index);
+  
+public:
+  BootPipeline();
+  
+  // Returns the stage index for BOOT_AFTER(), or -1 if it cannot be added
+  int add(const char* name, BootStageFunction run, uint32_t after = 0, bool parallel = false);
+  void run();  // Returns when every stage has finished
+  
+  bool isFinished();
+  bool isOk(int stage);
+  unsigned long getFinishedAt(int stage);  // ms since power-on, 0 if not finished
+  unsigned long getTotalMillis();
+  
+  void printReport();
+};
+
+#endif
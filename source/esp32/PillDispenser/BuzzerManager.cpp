@@ -0,0 +1,198 @@
+#include "BuzzerManager.h"
+#include "esp_arduino_version.h"
+
+portMUX_TYPE BuzzerManager::buzzerMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Melodies - rising for a dispense, double pips for a reminder, a two-tone
+// siren for a missed dose and a falling pair for low battery
+static const ToneStep READY_STEPS[] = {
+  {2000, 150}, {0, 50}, {2600, 150}
+};
+static const ToneStep DISPENSE_STEPS[] = {
+  {2093, 200}, {2637, 200}, {3136, 400}, {0, 600}
+};
+static const ToneStep REMINDER_STEPS[] = {
+  {2637, 150}, {0, 150}, {2637, 150}, {0, 1500}
+};
+static const ToneStep MISSED_DOSE_STEPS[] = {
+  {3136, 300}, {2093, 300}
+};
+static const ToneStep LOW_BATTERY_STEPS[] = {
+  {1568, 400}, {0, 200}, {1175, 600}
+};
+static const ToneStep ERROR_STEPS[] = {
+  {800, 500}, {0, 200}, {800, 500}
+};
+
+#define PATTERN(name, steps, repeat) { name, steps, sizeof(steps) / sizeof(steps[0]), repeat }
+
+static const BuzzerPattern PATTERNS[BUZZER_ALERT_COUNT] = {
+  PATTERN("ready", READY_STEPS, 1),
+  PATTERN("dispense", DISPENSE_STEPS, 5),        // ~7 s, as the old continuous beep
+  PATTERN("reminder", REMINDER_STEPS, 4),
+  PATTERN("missed dose", MISSED_DOSE_STEPS, 10),
+  PATTERN("low battery", LOW_BATTERY_STEPS, 2),
+  PATTERN("error", ERROR_STEPS, 1)
+};
+
+BuzzerManager::BuzzerManager(uint8_t buzzerPin) {
+  pin = buzzerPin;
+  stepTimer = nullptr;
+  ready = false;
+  queueHead = 0;
+  queueCount = 0;
+  playing = false;
+  current = nullptr;
+  stepIndex = 0;
+  repeatsLeft = 0;
+  patternsPlayed = 0;
+  patternsDropped = 0;
+}
+
+bool BuzzerManager::begin() {
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  if (!ledcAttach(pin, 2000, BUZZER_LEDC_RESOLUTION)) {
+    Serial.println("BuzzerManager: ❌ LEDC attach failed");
+    return false;
+  }
+#else
+  ledcSetup(BUZZER_LEDC_CHANNEL, 2000, BUZZER_LEDC_RESOLUTION);
+  ledcAttachPin(pin, BUZZER_LEDC_CHANNEL);
+#endif
+  output(0);
+  
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = onStepTimer;
+  timerArgs.arg = this;
+  timerArgs.name = "buzzer";
+  if (esp_timer_create(&timerArgs, &stepTimer) != ESP_OK) {
+    Serial.println("BuzzerManager: ❌ Failed to create step timer");
+    return false;
+  }
+  
+  ready = true;
+  Serial.println("BuzzerManager: LEDC buzzer on GPIO " + String(pin));
+  return true;
+}
+
+void BuzzerManager::output(uint16_t frequency) {
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  ledcWriteTone(pin, frequency);
+#else
+  ledcWriteTone(BUZZER_LEDC_CHANNEL, frequency);
+#endif
+}
+
+bool BuzzerManager::play(BuzzerAlert alert) {
+  if (!ready || alert >= BUZZER_ALERT_COUNT) {
+    return false;
+  }
+  
+  const ToneStep* first = nullptr;
+  bool queued = true;
+  
+  portENTER_CRITICAL(&buzzerMux);
+  if (!playing) {
+    // Idle - start right away from this task
+    playing = true;
+    current = &PATTERNS[alert];
+    stepIndex = 0;
+    repeatsLeft = current->repeat;
+    first = &current->steps[0];
+  } else if (queueCount < BUZZER_QUEUE_SIZE) {
+    queue[(queueHead + queueCount) % BUZZER_QUEUE_SIZE] = alert;
+    queueCount++;
+  } else {
+    patternsDropped++;
+    queued = false;
+  }
+  portEXIT_CRITICAL(&buzzerMux);
+  
+  if (first != nullptr) {
+    output(first->frequency);
+    esp_timer_start_once(stepTimer, (uint64_t)first->durationMs * 1000);
+  } else if (!queued) {
+    Serial.println("BuzzerManager: ⚠️ Queue full, dropped " + String(getAlertName(alert)));
+  }
+  return queued;
+}
+
+void BuzzerManager::onStepTimer(void* arg) {
+  ((BuzzerManager*)arg)->advance();
+}
+
+// Runs in the esp_timer task at the end of each note
+void BuzzerManager::advance() {
+  const ToneStep* next = nullptr;
+  
+  portENTER_CRITICAL(&buzzerMux);
+  if (playing && current != nullptr) {
+    stepIndex++;
+    if (stepIndex >= current->stepCount) {
+      stepIndex = 0;
+      if (repeatsLeft > 0) {
+        repeatsLeft--;
+      }
+      if (repeatsLeft == 0) {
+        // Pattern done - move on to the next queued one
+        patternsPlayed++;
+        if (queueCount > 0) {
+          current = &PATTERNS[queue[queueHead]];
+          queueHead = (queueHead + 1) % BUZZER_QUEUE_SIZE;
+          queueCount--;
+          repeatsLeft = current->repeat;
+        } else {
+          current = nullptr;
+          playing = false;
+        }
+      }
+    }
+    if (current != nullptr) {
+      next = &current->steps[stepIndex];
+    }
+  }
+  portEXIT_CRITICAL(&buzzerMux);
+  
+  if (next != nullptr) {
+    output(next->frequency);
+    esp_timer_start_once(stepTimer, (uint64_t)next->durationMs * 1000);
+  } else {
+    output(0);
+  }
+}
+
+void BuzzerManager::stop() {
+  if (!ready) return;
+  
+  esp_timer_stop(stepTimer);
+  portENTER_CRITICAL(&buzzerMux);
+  playing = false;
+  current = nullptr;
+  queueCount = 0;
+  portEXIT_CRITICAL(&buzzerMux);
+  output(0);
+}
+
+bool BuzzerManager::isPlaying() {
+  return playing;
+}
+
+const char* BuzzerManager::getAlertName(BuzzerAlert alert) {
+  if (alert >= BUZZER_ALERT_COUNT) return "unknown";
+  return PATTERNS[alert].name;
+}
+
+void BuzzerManager::printStatus() {
+  portENTER_CRITICAL(&buzzerMux);
+  const char* playingName = playing && current != nullptr ? current->name : "-";
+  uint8_t queued = queueCount;
+  portEXIT_CRITICAL(&buzzerMux);
+  
+  Serial.println("\n=== BUZZER ===");
+  Serial.println("Ready: " + String(ready ? "Yes" : "No"));
+  Serial.println("Playing: " + String(playingName));
+  Serial.println("Queued: " + String(queued));
+  Serial.println("Patterns played: " + String(patternsPlayed));
+  Serial.println("Patterns dropped: " + String(patternsDropped));
+  Serial.println("==============\n");
+}
@@ -0,0 +1,76 @@
+#ifndef BUZZER_MANAGER_H
+#define BUZZER_MANAGER_H
+
+#include <Arduino.h>
+#include "esp_timer.h"
+
+#define BUZZER_QUEUE_SIZE 4
+#define BUZZER_LEDC_CHANNEL 0       // Arduino core 2.x only, 3.x allocates by pin
+#define BUZZER_LEDC_RESOLUTION 10
+
+// One note; frequency 0 is a rest
+struct ToneStep {
+  uint16_t frequency;
+  uint16_t durationMs;
+};
+
+struct BuzzerPattern {
+  const char* name;
+  const ToneStep* steps;
+  uint8_t stepCount;
+  uint8_t repeat;
+};
+
+// Each alert class has its own melody
+enum BuzzerAlert {
+  BUZZER_READY,
+  BUZZER_DISPENSE,
+  BUZZER_REMINDER,
+  BUZZER_MISSED_DOSE,
+  BUZZER_LOW_BATTERY,
+  BUZZER_ERROR,
+  BUZZER_ALERT_COUNT
+};
+
+/**
+ * BuzzerManager
+ *
+ * Plays tone patterns on the buzzer through LEDC PWM. A one-shot esp_timer
+ * fires at the end of each note and starts the next one, so play() only
+ * queues the pattern and returns immediately - nothing in loop() waits for
+ * the buzzer. Patterns requested while one is playing are queued and
+ * played in order.
+ */
+class BuzzerManager {
+private:
+  uint8_t pin;
+  esp_timer_handle_t stepTimer;
+  bool ready;
+  
+  // Playback state, shared with the timer callback (guarded by buzzerMux)
+  static portMUX_TYPE buzzerMux;
+  BuzzerAlert queue[BUZZER_QUEUE_SIZE];
+  uint8_t queueHead;
+  uint8_t queueCount;
+  bool playing;
+  const BuzzerPattern* current;
+  uint8_t stepIndex;
+  uint8_t repeatsLeft;
+  unsigned long patternsPlayed;
+  unsigned long patternsDropped;
+  
+  static void onStepTimer(void* arg);
+  void advance();
+  void output(uint16_t frequency);
+  
+public:
+  BuzzerManager(uint8_t buzzerPin);
+  bool begin();
+  bool play(BuzzerAlert alert);  // Returns false if the queue is full
+  void stop();                   // Silence now and drop anything queued
+  bool isPlaying();
+  static const char* getAlertName(BuzzerAlert alert);
+  void printStatus();
+};
+
+#endif
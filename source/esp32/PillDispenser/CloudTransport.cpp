@@ -0,0 +1,300 @@
+#include "CloudTransport.h"
+#include "TimeManager.h"
+#include <Arduino.h>
+#include <Preferences.h>
+#include <limits.h>
+
+CloudTransport::CloudTransport() {
+  sim800 = nullptr;
+  modemLock = nullptr;
+  fallbackEnabled = false;
+  outboxCount = 0;
+  timeManager = nullptr;
+  bootNumber = 0;
+  pushSequence = 0;
+  activeLink = CLOUD_LINK_WIFI;
+  wifiLostAt = 0;
+  lastGPRSFlush = 0;
+  lastBearerAttempt = 0;
+  tokenValidAt = 0;
+  authExpired = false;
+}
+
+void CloudTransport::enableGPRSFallback(SIM800L* sim800Module, String url, String apnName,
+                                        String username, String password) {
+  sim800 = sim800Module;
+  apn = apnName;
+  apnUser = username;
+  apnPassword = password;
+
+  // The REST endpoint needs a scheme and no trailing slash
+  databaseURL = url;
+  if (!databaseURL.startsWith("http")) {
+    databaseURL = "https://" + databaseURL;
+  }
+  while (databaseURL.endsWith("/")) {
+    databaseURL.remove(databaseURL.length() - 1);
+  }
+
+  fallbackEnabled = sim800 != nullptr && apn.length() > 0;
+  Serial.println("CloudTransport: GPRS fallback " + String(fallbackEnabled ? "enabled (APN: " + apn + ")" : "disabled"));
+}
+
+void CloudTransport::setModemLock(SemaphoreHandle_t lock) {
+  modemLock = lock;
+}
+
+void CloudTransport::setTimeManager(TimeManager* manager) {
+  timeManager = manager;
+}
+
+void CloudTransport::setDatabaseSecret(const String& secret) {
+  databaseSecret = secret;
+}
+
+// Counts boots that queued a report, so keys from different boots never collide
+static uint32_t takeBootNumber() {
+  Preferences prefs;
+  if (!prefs.begin(CLOUD_PREFS_NAMESPACE, false)) {
+    return (uint32_t)random(1, 0x7FFFFFFF);  // Hardware RNG on the ESP32
+  }
+  uint32_t boot = prefs.getUInt("boot", 0) + 1;
+  prefs.putUInt("boot", boot);
+  prefs.end();
+  return boot;
+}
+
+bool CloudTransport::queueWrite(const String& path, const String& json, bool urgent) {
+  for (int i = 0; i < outboxCount; i++) {
+    if (outbox[i].path == path) {
+      outbox[i].json = json;
+      outbox[i].urgent = outbox[i].urgent || urgent;
+      return true;
+    }
+  }
+
+  if (outboxCount >= CLOUD_OUTBOX_SIZE) {
+    Serial.println("⚠️ CloudTransport: Outbox full, dropping write to " + path);
+    return false;
+  }
+
+  outbox[outboxCount].path = path;
+  outbox[outboxCount].json = json;
+  outbox[outboxCount].urgent = urgent;
+  outboxCount++;
+
+  Serial.println("CloudTransport: Queued " + path + " (" + String(outboxCount) + " pending)");
+  return true;
+}
+
+bool CloudTransport::queuePush(const String& parentPath, const String& json) {
+  // Multi-location updates cannot push, so build a key that still sorts by time.
+  // The system clock is not set on an offline boot - take UTC from the timebase
+  // (restored or NTP), and the boot number so a reboot cannot reuse a key
+  if (bootNumber == 0) {
+    bootNumber = takeBootNumber();
+  }
+  int64_t utcMs = timeManager != nullptr ? timeManager->getEpochMicros() / 1000 : (int64_t)millis();
+  String key = "gprs_" + String((long long)utcMs) + "_" + String(bootNumber) + "_" + String(pushSequence++);
+  return queueWrite(parentPath + "/" + key, json, true);
+}
+
+bool CloudTransport::hasPending() {
+  return outboxCount > 0;
+}
+
+int CloudTransport::getPendingCount() {
+  return outboxCount;
+}
+
+unsigned long CloudTransport::getMillisUntilFlush() {
+  if (outboxCount == 0) {
+    return ULONG_MAX;
+  }
+  // On WiFi FirebaseManager flushes on its next check; loss not seen yet - let update() run
+  if (activeLink == CLOUD_LINK_WIFI || wifiLostAt == 0) {
+    return 0;
+  }
+  if (!fallbackEnabled || authExpired) {
+    return ULONG_MAX;  // Only WiFi coming back can send it
+  }
+  
+  unsigned long currentTime = millis();
+  if (activeLink != CLOUD_LINK_GPRS) {
+    unsigned long down = currentTime - wifiLostAt;
+    return down >= FAILOVER_DELAY ? 0 : FAILOVER_DELAY - down;
+  }
+  
+  unsigned long due = 0;
+  if (!hasUrgentWrite() && lastGPRSFlush != 0) {
+    unsigned long sinceFlush = currentTime - lastGPRSFlush;
+    due = sinceFlush >= GPRS_FLUSH_INTERVAL ? 0 : GPRS_FLUSH_INTERVAL - sinceFlush;
+  }
+  // A failed bearer attempt holds every flush back until the retry interval
+  if (lastBearerAttempt != 0 && sim800 != nullptr && !sim800->isGPRSConnected()) {
+    unsigned long sinceAttempt = currentTime - lastBearerAttempt;
+    if (sinceAttempt < BEARER_RETRY_INTERVAL) {
+      due = max(due, BEARER_RETRY_INTERVAL - sinceAttempt);
+    }
+  }
+  return due;
+}
+
+bool CloudTransport::hasUrgentWrite() {
+  for (int i = 0; i < outboxCount; i++) {
+    if (outbox[i].urgent) {
+      return true;
+    }
+  }
+  return false;
+}
+
+String CloudTransport::buildBatch() {
+  String batch = "{";
+  for (int i = 0; i < outboxCount; i++) {
+    if (i > 0) {
+      batch += ",";
+    }
+    batch += "\"" + outbox[i].path + "\":" + outbox[i].json;
+  }
+  batch += "}";
+  return batch;
+}
+
+void CloudTransport::clearOutbox() {
+  for (int i = 0; i < outboxCount; i++) {
+    outbox[i].path = "";
+    outbox[i].json = "";
+  }
+  outboxCount = 0;
+}
+
+void CloudTransport::update(bool firebaseReady, const String& authToken) {
+  if (firebaseReady) {
+    wifiLostAt = 0;
+    tokenValidAt = millis();
+    authExpired = false;
+    if (activeLink != CLOUD_LINK_WIFI) {
+      Serial.println("✅ CloudTransport: WiFi restored - failing back from GPRS");
+      if (activeLink == CLOUD_LINK_GPRS && sim800 != nullptr) {
+        if (modemLock != nullptr) xSemaphoreTake(modemLock, portMAX_DELAY);
+        sim800->disableGPRS();
+        if (modemLock != nullptr) xSemaphoreGive(modemLock);
+      }
+      activeLink = CLOUD_LINK_WIFI;
+    }
+    return;
+  }
+
+  unsigned long currentTime = millis();
+
+  if (wifiLostAt == 0) {
+    wifiLostAt = currentTime;
+    activeLink = CLOUD_LINK_NONE;
+    Serial.println("⚠️ CloudTransport: Firebase unreachable - buffering writes");
+  }
+
+  if (!fallbackEnabled) {
+    return;
+  }
+
+  if (activeLink != CLOUD_LINK_GPRS && currentTime - wifiLostAt >= FAILOVER_DELAY) {
+    Serial.println("📶 CloudTransport: Failing over to GPRS");
+    activeLink = CLOUD_LINK_GPRS;
+    lastGPRSFlush = 0;
+  }
+
+  if (activeLink != CLOUD_LINK_GPRS || outboxCount == 0 || authExpired) {
+    return;
+  }
+
+  bool intervalElapsed = lastGPRSFlush == 0 || currentTime - lastGPRSFlush >= GPRS_FLUSH_INTERVAL;
+  if (intervalElapsed || hasUrgentWrite()) {
+    // Modem busy with an SMS or call - try again on the next pass
+    if (modemLock != nullptr && xSemaphoreTake(modemLock, 0) != pdTRUE) {
+      return;
+    }
+    flushViaGPRS(authToken);
+    if (modemLock != nullptr) xSemaphoreGive(modemLock);
+  }
+}
+
+bool CloudTransport::flushViaGPRS(const String& authToken) {
+  // PATCH on the root applies every path in one request; SIM800L only does
+  // GET/POST so the method is overridden with a header the RTDB honours
+  String url = databaseURL + "/.json";
+  if (databaseSecret.length() > 0) {
+    url += "?auth=" + databaseSecret;
+  } else if (authToken.length() > 0) {
+    // Nothing refreshes the token while WiFi is down
+    if (tokenValidAt == 0 || millis() - tokenValidAt >= TOKEN_LIFETIME) {
+      stopForAuth("cached access token has expired");
+      return false;
+    }
+    url += "?access_token=" + authToken;
+  }
+  if (url.length() > SIM800_HTTP_URL_MAX) {
+    stopForAuth("signed URL too long for the modem");
+    return false;
+  }
+
+  if (!sim800->isGPRSConnected()) {
+    if (lastBearerAttempt != 0 && millis() - lastBearerAttempt < BEARER_RETRY_INTERVAL) {
+      return false;
+    }
+    lastBearerAttempt = millis();
+    if (!sim800->enableGPRS(apn, apnUser, apnPassword)) {
+      return false;
+    }
+  }
+
+  int writes = outboxCount;
+  Serial.println("CloudTransport: Flushing " + String(writes) + " write(s) over GPRS...");
+  lastGPRSFlush = millis();
+
+  if (sim800->sendHTTPRequest(url, buildBatch(), "X-HTTP-Method-Override: PATCH")) {
+    clearOutbox();
+    Serial.println("✅ CloudTransport: " + String(writes) + " write(s) delivered over GPRS");
+    return true;
+  }
+
+  Serial.println("❌ CloudTransport: GPRS flush failed (HTTP " + String(sim800->getLastHTTPStatus()) + ")");
+  if (sim800->getLastHTTPStatus() == 401 || sim800->getLastHTTPStatus() == 403) {
+    stopForAuth("credential rejected by the server");
+    return false;
+  }
+  if (sim800->getLastHTTPStatus() == 0) {
+    // Transport-level failure - reopen the bearer next time
+    sim800->disableGPRS();
+  }
+  // Retry on the batch interval rather than on every loop pass
+  for (int i = 0; i < outboxCount; i++) {
+    outbox[i].urgent = false;
+  }
+  return false;
+}
+
+void CloudTransport::stopForAuth(const char* reason) {
+  authExpired = true;
+  if (sim800->isGPRSConnected()) {
+    sim800->disableGPRS();
+  }
+  Serial.println("🔒 CloudTransport: GPRS flushes stopped - " + String(reason) +
+                 ", " + String(outboxCount) + " write(s) kept for WiFi");
+}
+
+bool CloudTransport::isAuthExpired() {
+  return authExpired;
+}
+
+CloudLink CloudTransport::getActiveLink() {
+  return activeLink;
+}
+
+String CloudTransport::getActiveLinkName() {
+  switch (activeLink) {
+    case CLOUD_LINK_WIFI: return "WiFi";
+    case CLOUD_LINK_GPRS: return "GPRS";
+    default: return "offline";
+  }
+}
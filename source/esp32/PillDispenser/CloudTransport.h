@@ -0,0 +1,106 @@
+#ifndef CLOUD_TRANSPORT_H
+#define CLOUD_TRANSPORT_H
+
+#include <Arduino.h>
+#include "SIM800L.h"
+
+/**
+ * CloudTransport
+ *
+ * Keeps cloud reporting alive when WiFi drops by falling back to the
+ * SIM800L's GPRS bearer.
+ *
+ * While Firebase is unreachable, writes are parked in a small outbox
+ * keyed by RTDB path. Repeated writes to the same path (heartbeats)
+ * replace each other so only the latest value is sent. After WiFi has been
+ * down for FAILOVER_DELAY the outbox is flushed over GPRS as a single
+ * multi-location PATCH to the RTDB REST API, batched to keep modem airtime
+ * and data cost low. When WiFi and Firebase come back the bearer is closed
+ * and FirebaseManager flushes anything left over the normal client.
+ *
+ * Authentication over GPRS cannot refresh anything, so it either uses a
+ * Realtime Database secret (setDatabaseSecret), which does not expire, or
+ * the service-account access token cached while WiFi was up. That token
+ * expires at most an hour after Firebase was last reachable, and is often
+ * too long for the SIM800's URL parameter anyway. Once the token is
+ * expired or too long, or the server answers 401/403, GPRS flushes stop.
+ * Writes stay buffered until WiFi returns - see isAuthExpired().
+ */
+
+#define CLOUD_OUTBOX_SIZE 8
+#define CLOUD_PREFS_NAMESPACE "cloud"  // Boot number for report keys
+
+class TimeManager;
+
+enum CloudLink {
+  CLOUD_LINK_WIFI,
+  CLOUD_LINK_GPRS,
+  CLOUD_LINK_NONE
+};
+
+struct CloudWrite {
+  String path;   // RTDB path without leading slash
+  String json;   // Compact JSON value written at path
+  bool urgent;   // Flush without waiting for the batch interval
+};
+
+class CloudTransport {
+private:
+  SIM800L* sim800;
+  SemaphoreHandle_t modemLock;  // Shared with the GSM task, optional
+  String databaseURL;
+  String apn;
+  String apnUser;
+  String apnPassword;
+  String databaseSecret;     // Legacy RTDB secret for GPRS, optional
+  bool fallbackEnabled;
+
+  CloudWrite outbox[CLOUD_OUTBOX_SIZE];
+  int outboxCount;
+  TimeManager* timeManager;  // Clock for report keys, optional
+  uint32_t bootNumber;       // Taken from NVS on the first push of this boot
+  uint16_t pushSequence;
+
+  CloudLink activeLink;
+  unsigned long wifiLostAt;
+  unsigned long lastGPRSFlush;
+  unsigned long lastBearerAttempt;
+  unsigned long tokenValidAt;  // Firebase last ready, so the cached token was still good
+  bool authExpired;            // No usable credential for GPRS until WiFi is back
+
+  static const unsigned long FAILOVER_DELAY = 60000;         // WiFi must be down 1 minute before using GPRS
+  static const unsigned long GPRS_FLUSH_INTERVAL = 300000;   // Batch routine writes every 5 minutes
+  static const unsigned long BEARER_RETRY_INTERVAL = 60000;  // Wait between failed bearer attempts
+  static const unsigned long TOKEN_LIFETIME = 3600000;       // OAuth2 access tokens last an hour
+
+  bool flushViaGPRS(const String& authToken);
+  void stopForAuth(const char* reason);
+
+public:
+  CloudTransport();
+
+  void enableGPRSFallback(SIM800L* sim800Module, String databaseURL, String apn,
+                          String username = "", String password = "");
+  void setModemLock(SemaphoreHandle_t lock);
+  void setTimeManager(TimeManager* manager);
+  void setDatabaseSecret(const String& secret);  // Used instead of the access token over GPRS
+
+  // Outbox - same path replaces the pending value, returns false if full
+  bool queueWrite(const String& path, const String& json, bool urgent = false);
+  bool queuePush(const String& parentPath, const String& json); // Generates a chronological key, unique across reboots
+  bool hasPending();
+  bool hasUrgentWrite();
+  int getPendingCount();
+  unsigned long getMillisUntilFlush();  // Until update() sends the outbox; ULONG_MAX if it will not
+  String buildBatch();  // {"path/a":{...},"path/b":{...}} for a multi-location update
+  void clearOutbox();
+
+  // Call in loop() with the current Firebase state and auth token
+  void update(bool firebaseReady, const String& authToken);
+
+  CloudLink getActiveLink();
+  String getActiveLinkName();
+  bool isAuthExpired();  // GPRS flushes stopped for lack of a valid credential
+};
+
+#endif
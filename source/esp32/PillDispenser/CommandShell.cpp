@@ -0,0 +1,323 @@
+#include "CommandShell.h"
+
+CommandShell::CommandShell() {
+  memset(commands, 0, sizeof(commands));
+  memset(slots, 0, sizeof(slots));
+  memset(slotHashes, 0, sizeof(slotHashes));
+  commandCount = 0;
+  line[0] = '\0';
+  lineLength = 0;
+  lineOverflow = false;
+  script[0] = '\0';
+  scriptPos = 0;
+  batchMode = false;
+  current = nullptr;
+  jobCommand = nullptr;
+  jobStep = nullptr;
+  jobIndex = 0;
+  jobSteps = 0;
+  jobArg = 0;
+  jobWakeAt = 0;
+  jobWaitMs = 0;
+}
+
+// FNV-1a
+uint32_t CommandShell::hash(const char* text, size_t length) {
+  uint32_t h = 2166136261UL;
+  for (size_t i = 0; i < length; i++) {
+    h ^= (uint8_t)text[i];
+    h *= 16777619UL;
+  }
+  return h;
+}
+
+bool CommandShell::add(const ShellCommand* table, uint8_t count) {
+  for (uint8_t i = 0; i < count; i++) {
+    const ShellCommand* command = &table[i];
+    if (commandCount >= SHELL_MAX_COMMANDS) {
+      Serial.println("CommandShell: ❌ Command table full - " + String(command->name) + " not registered");
+      return false;
+    }
+  
+    uint32_t h = hash(command->name, strlen(command->name));
+    uint16_t slot = h & (SHELL_HASH_SIZE - 1);
+    bool duplicate = false;
+    while (slots[slot] != nullptr) {
+      if (slotHashes[slot] == h && strcmp(slots[slot]->name, command->name) == 0) {
+        duplicate = true;
+        break;
+      }
+      slot = (slot + 1) & (SHELL_HASH_SIZE - 1);
+    }
+    if (duplicate) {
+      Serial.println("CommandShell: ⚠️ Duplicate command ignored - " + String(command->name));
+      continue;
+    }
+  
+    slots[slot] = command;
+    slotHashes[slot] = h;
+    commands[commandCount++] = command;
+  }
+  return true;
+}
+
+const ShellCommand* CommandShell::find(const char* text, size_t length) {
+  uint32_t h = hash(text, length);
+  uint16_t slot = h & (SHELL_HASH_SIZE - 1);
+  while (slots[slot] != nullptr) {
+    const ShellCommand* command = slots[slot];
+    if (slotHashes[slot] == h && strncmp(command->name, text, length) == 0 && command->name[length] == '\0') {
+      return command;
+    }
+    slot = (slot + 1) & (SHELL_HASH_SIZE - 1);
+  }
+  return nullptr;
+}
+
+void CommandShell::update() {
+  if (jobStep != nullptr) {
+    stepJob();
+  }
+  if (jobStep == nullptr) {
+    runNextCommand();
+  }
+  // Leave further input in the UART buffer until queued commands have run
+  if (script[scriptPos] == '\0') {
+    readInput();
+  }
+}
+
+void CommandShell::readInput() {
+  while (Serial.available()) {
+    char c = Serial.read();
+    if (c != '\n' && c != '\r') {
+      if (lineLength < SHELL_LINE_MAX - 1) {
+        line[lineLength++] = tolower(c);
+      } else {
+        lineOverflow = true;
+      }
+      continue;
+    }
+  
+    if (lineOverflow) {
+      Serial.println("❌ Line too long (max " + String(SHELL_LINE_MAX - 1) + " characters)");
+      lineOverflow = false;
+      lineLength = 0;
+      continue;
+    }
+    if (lineLength == 0) {
+      continue;
+    }
+    line[lineLength] = '\0';
+    lineLength = 0;
+  
+    // abort is the one command that does not wait for the running job
+    String text = line;
+    text.trim();
+    if (text == "abort" && jobStep != nullptr) {
+      abortJob();
+      continue;
+    }
+  
+    strncpy(script, text.c_str(), sizeof(script) - 1);
+    script[sizeof(script) - 1] = '\0';
+    scriptPos = 0;
+    return;
+  }
+}
+
+void CommandShell::runNextCommand() {
+  if (script[scriptPos] == '\0') {
+    return;
+  }
+  
+  char* start = &script[scriptPos];
+  char* end = strchr(start, ';');
+  if (end != nullptr) {
+    *end = '\0';
+    scriptPos = end - script + 1;
+  } else {
+    scriptPos += strlen(start);
+  }
+  
+  // Trim the segment in place
+  while (*start == ' ') start++;
+  size_t length = strlen(start);
+  while (length > 0 && start[length - 1] == ' ') {
+    start[--length] = '\0';
+  }
+  if (length > 0) {
+    execute(start);
+  }
+}
+
+void CommandShell::execute(char* text) {
+  // Longest matching name wins: "servo test 2" tries "servo test 2", then "servo test"
+  size_t boundaries[SHELL_MAX_WORDS];
+  uint8_t words = 0;
+  for (size_t i = 0; words < SHELL_MAX_WORDS; i++) {
+    if (text[i] == ' ' || text[i] == '\0') {
+      boundaries[words++] = i;
+      if (text[i] == '\0') break;
+    }
+  }
+  
+  const ShellCommand* command = nullptr;
+  size_t nameLength = 0;
+  for (int w = words - 1; w >= 0 && command == nullptr; w--) {
+    nameLength = boundaries[w];
+    command = find(text, nameLength);
+  }
+  
+  if (command == nullptr) {
+    Serial.println("❌ Unknown command: " + String(text) + " (try help)");
+    if (batchMode) {
+      Serial.println("#ERR " + String(text) + ": unknown command");
+    }
+    return;
+  }
+  
+  const char* rest = text + nameLength;
+  while (*rest == ' ') rest++;
+  
+  ShellArgs args;
+  if (!parseArgs(command, rest, args)) {
+    Serial.println("❌ Usage: " + String(command->name) + " " + String(command->usage));
+    finish(command, false, "bad argument");
+    return;
+  }
+  
+  current = command;
+  bool success = command->handler(args);
+  current = nullptr;
+  
+  if (jobStep != nullptr && jobCommand == command) {
+    if (success) {
+      return;  // finish() runs when the job ends
+    }
+    jobStep = nullptr;
+    jobCommand = nullptr;
+  }
+  finish(command, success, "failed");
+}
+
+bool CommandShell::parseArgs(const ShellCommand* command, const char* rest, ShellArgs& args) {
+  args.present = rest[0] != '\0';
+  args.value = 0;
+  args.text = rest;
+  
+  switch (command->argType) {
+    case SHELL_ARG_NONE:
+      return !args.present;
+  
+    case SHELL_ARG_INT:
+    case SHELL_ARG_OPTIONAL_INT: {
+      if (!args.present) {
+        return command->argType == SHELL_ARG_OPTIONAL_INT;
+      }
+      char* end;
+      long value = strtol(rest, &end, 10);
+      if (end == rest || *end != '\0' || value < command->argMin || value > command->argMax) {
+        return false;
+      }
+      args.value = value;
+      return true;
+    }
+  
+    case SHELL_ARG_TEXT:
+      return true;
+  }
+  return false;
+}
+
+bool CommandShell::startJob(ShellJobStep step, uint16_t steps, int arg) {
+  if (jobStep != nullptr || current == nullptr) {
+    return false;
+  }
+  jobCommand = current;
+  jobStep = step;
+  jobIndex = 0;
+  jobSteps = steps;
+  jobArg = arg;
+  jobWakeAt = millis();
+  jobWaitMs = 0;
+  return true;
+}
+
+void CommandShell::stepJob() {
+  if (millis() - jobWakeAt < jobWaitMs) {
+    return;
+  }
+  
+  const ShellCommand* command = jobCommand;
+  if (jobIndex >= jobSteps) {
+    jobStep = nullptr;
+    jobCommand = nullptr;
+    Serial.println("✅ " + String(command->name) + " done");
+    finish(command, true, nullptr);
+    return;
+  }
+  
+  long waitMs = jobStep(jobIndex, jobArg);
+  jobIndex++;
+  if (waitMs < 0) {
+    jobStep = nullptr;
+    jobCommand = nullptr;
+    Serial.printf("❌ %s stopped at step %u/%u\n", command->name, (unsigned)jobIndex, (unsigned)jobSteps);
+    finish(command, false, "stopped");
+    return;
+  }
+  
+  if (jobSteps > 1) {
+    Serial.printf("⏳ %s %u/%u\n", command->name, (unsigned)jobIndex, (unsigned)jobSteps);
+  }
+  jobWakeAt = millis();
+  jobWaitMs = waitMs;
+}
+
+bool CommandShell::isJobRunning() {
+  return jobStep != nullptr;
+}
+
+void CommandShell::abortJob() {
+  if (jobStep == nullptr) {
+    Serial.println("No job running");
+    return;
+  }
+  
+  const ShellCommand* command = jobCommand;
+  jobStep = nullptr;
+  jobCommand = nullptr;
+  
+  // Drop the rest of the line as well - it was written expecting this job to finish
+  script[0] = '\0';
+  scriptPos = 0;
+  
+  Serial.printf("⏹️ %s aborted at step %u/%u\n", command->name, (unsigned)jobIndex, (unsigned)jobSteps);
+  finish(command, false, "aborted");
+}
+
+void CommandShell::finish(const ShellCommand* command, bool success, const char* reason) {
+  if (!batchMode) {
+    return;
+  }
+  if (success) {
+    Serial.println("#OK " + String(command->name));
+  } else {
+    Serial.println("#ERR " + String(command->name) + ": " + String(reason ? reason : "failed"));
+  }
+}
+
+void CommandShell::setBatchMode(bool enabled) {
+  batchMode = enabled;
+}
+
+void CommandShell::printHelp() {
+  Serial.println("\n========== AVAILABLE COMMANDS ==========");
+  for (uint8_t i = 0; i < commandCount; i++) {
+    const ShellCommand* command = commands[i];
+    Serial.printf("%s%s%s - %s\n", command->name, command->usage[0] ? " " : "", command->usage, command->help);
+  }
+  Serial.println("Separate commands with ';' to run them in sequence");
+  Serial.println("=========================================");
+}
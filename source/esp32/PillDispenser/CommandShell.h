@@ -0,0 +1,108 @@
+#ifndef COMMAND_SHELL_H
+#define COMMAND_SHELL_H
+
+#include <Arduino.h>
+
+#define SHELL_MAX_COMMANDS 64
+#define SHELL_HASH_SIZE 128      // Power of two, at least twice SHELL_MAX_COMMANDS
+#define SHELL_MAX_WORDS 3        // Longest command name, in words ("gsm stats reset")
+#define SHELL_LINE_MAX 128
+
+// Argument schema - checked by the shell before the handler runs
+enum ShellArgType {
+  SHELL_ARG_NONE,
+  SHELL_ARG_INT,           // Required integer in [argMin, argMax]
+  SHELL_ARG_OPTIONAL_INT,  // Same, may be omitted
+  SHELL_ARG_TEXT           // Rest of the line, parsed by the handler
+};
+
+struct ShellArgs {
+  bool present;
+  int value;
+  String text;
+};
+
+// Return false if the command failed (reported as #ERR in batch mode)
+typedef bool (*ShellHandler)(const ShellArgs& args);
+
+struct ShellCommand {
+  const char* name;        // Lower case, words separated by one space
+  ShellArgType argType;
+  int16_t argMin;
+  int16_t argMax;
+  const char* usage;       // Argument part of the help line, e.g. "<1-5>"
+  const char* help;
+  ShellHandler handler;
+};
+
+// One step of a long-running command. Returns the milliseconds to wait
+// before the next step, or a negative value to stop early.
+typedef long (*ShellJobStep)(uint16_t step, int arg);
+
+/**
+ * CommandShell
+ *
+ * Serial console with table-driven dispatch. Each subsystem hands over a
+ * const table of commands; names are hashed (FNV-1a) into an open-addressed
+ * table when registered, so a lookup is a hash and usually one compare
+ * instead of a walk down an if/else chain. Multi-word names are matched
+ * longest first, the remainder of the line is the argument.
+ *
+ * Input is read without blocking. Commands that take seconds (servo sweep,
+ * waits) run as jobs: the shell calls one step per update() and sleeps
+ * between steps, printing progress, so the UI task keeps its period.
+ *
+ * Several commands can be given on one line separated by ';' - each runs
+ * after the previous job has finished. "batch on" adds a machine-readable
+ * #OK / #ERR line after every command for hardware-in-the-loop scripts.
+ */
+class CommandShell {
+private:
+  const ShellCommand* commands[SHELL_MAX_COMMANDS];  // Registration order, for help
+  uint8_t commandCount;
+  const ShellCommand* slots[SHELL_HASH_SIZE];
+  uint32_t slotHashes[SHELL_HASH_SIZE];
+  
+  char line[SHELL_LINE_MAX];
+  uint8_t lineLength;
+  bool lineOverflow;
+  char script[SHELL_LINE_MAX];  // Commands waiting to run (';' separated)
+  uint8_t scriptPos;
+  bool batchMode;
+  
+  const ShellCommand* current;   // Command whose handler is running
+  
+  // Running job
+  const ShellCommand* jobCommand;
+  ShellJobStep jobStep;
+  uint16_t jobIndex;
+  uint16_t jobSteps;
+  int jobArg;
+  unsigned long jobWakeAt;
+  unsigned long jobWaitMs;
+  
+  static uint32_t hash(const char* text, size_t length);
+  const ShellCommand* find(const char* text, size_t length);
+  void readInput();
+  void runNextCommand();
+  void execute(char* text);
+  bool parseArgs(const ShellCommand* command, const char* rest, ShellArgs& args);
+  void stepJob();
+  void finish(const ShellCommand* command, bool success, const char* reason);
+  
+public:
+  CommandShell();
+  
+  bool add(const ShellCommand* table, uint8_t count);
+  void update();  // Call regularly from one task
+  
+  // For handlers: run the rest of the command as a job of 'steps' steps
+  bool startJob(ShellJobStep step, uint16_t steps, int arg = 0);
+  bool isJobRunning();
+  void abortJob();
+  
+  void setBatchMode(bool enabled);
+  void printHelp();
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "EventBus.h"
+
+portMUX_TYPE EventBus::busMux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char* EVENT_TYPE_NAMES[BUS_EVENT_TYPES] = {
+  "dose due", "dose reminder", "dose missed"
+};
+
+EventBus::EventBus() {
+  memset(pool, 0, sizeof(pool));
+  memset(subscribers, 0, sizeof(subscribers));
+  memset(subscriberCount, 0, sizeof(subscriberCount));
+  memset(dispatchedCount, 0, sizeof(dispatchedCount));
+  head = 0;
+  count = 0;
+  published = 0;
+  dropped = 0;
+  highWater = 0;
+}
+
+bool EventBus::subscribe(BusEventType type, BusHandler handler) {
+  if (type >= BUS_EVENT_TYPES || handler == nullptr) {
+    return false;
+  }
+  if (subscriberCount[type] >= EVENT_BUS_MAX_SUBSCRIBERS) {
+    Serial.println("EventBus: ❌ Too many subscribers for " + String(EVENT_TYPE_NAMES[type]));
+    return false;
+  }
+  subscribers[type][subscriberCount[type]++] = handler;
+  return true;
+}
+
+bool EventBus::publish(const BusEvent& event) {
+  if (event.type >= BUS_EVENT_TYPES) {
+    return false;
+  }
+  
+  bool accepted = false;
+  portENTER_CRITICAL(&busMux);
+  if (count < EVENT_BUS_DEPTH) {
+    BusEvent& slot = pool[(head + count) % EVENT_BUS_DEPTH];
+    slot = event;
+    slot.publishedAt = millis();
+    count++;
+    if (count > highWater) {
+      highWater = count;
+    }
+    published++;
+    accepted = true;
+  } else {
+    // Never overwrite - a queued dose must not be lost silently
+    dropped++;
+  }
+  portEXIT_CRITICAL(&busMux);
+  
+  if (!accepted) {
+    Serial.println("EventBus: ❌ Pool full - " + String(EVENT_TYPE_NAMES[event.type]) + " dropped");
+  }
+  return accepted;
+}
+
+uint8_t EventBus::dispatch() {
+  uint8_t delivered = 0;
+  
+  // Only what was queued on entry - subscribers may publish follow-ups
+  portENTER_CRITICAL(&busMux);
+  uint8_t pending = count;
+  portEXIT_CRITICAL(&busMux);
+  
+  while (delivered < pending) {
+    BusEvent event;
+    portENTER_CRITICAL(&busMux);
+    event = pool[head];
+    head = (head + 1) % EVENT_BUS_DEPTH;
+    count--;
+    portEXIT_CRITICAL(&busMux);
+  
+    for (uint8_t i = 0; i < subscriberCount[event.type]; i++) {
+      subscribers[event.type][i](event);
+    }
+    dispatchedCount[event.type]++;
+    delivered++;
+  }
+  return delivered;
+}
+
+const char* EventBus::getTypeName(BusEventType type) {
+  return type < BUS_EVENT_TYPES ? EVENT_TYPE_NAMES[type] : "unknown";
+}
+
+void EventBus::printStatus() {
+  portENTER_CRITICAL(&busMux);
+  uint8_t pending = count;
+  uint8_t peak = highWater;
+  uint32_t total = published;
+  uint32_t lost = dropped;
+  portEXIT_CRITICAL(&busMux);
+  
+  Serial.println("\n=== EVENT BUS ===");
+  Serial.println("Pending: " + String(pending) + " / " + String(EVENT_BUS_DEPTH) + " (peak " + String(peak) + ")");
+  Serial.println("Published: " + String(total) + ", dropped: " + String(lost));
+  for (int i = 0; i < BUS_EVENT_TYPES; i++) {
+    Serial.printf("%-14s %u subscriber(s), %lu dispatched\n", EVENT_TYPE_NAMES[i],
+                  (unsigned)subscriberCount[i], (unsigned long)dispatchedCount[i]);
+  }
+  Serial.println("Names interned: " + String(nameTable.getUsedCount() - 1) + " / " + String(NAME_TABLE_SIZE - 1));
+  Serial.println("=================\n");
+}
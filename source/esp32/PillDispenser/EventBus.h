@@ -0,0 +1,68 @@
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <Arduino.h>
+#include "NameTable.h"
+
+#define EVENT_BUS_DEPTH 32           // Room for a reminder and a dose per schedule after a clock step
+#define EVENT_BUS_MAX_SUBSCRIBERS 4  // Per event type
+
+enum BusEventType : uint8_t {
+  BUS_DOSE_DUE,        // Scheduled dose passed all checks - dispense it
+  BUS_DOSE_REMINDER,   // 15 minutes before a dose
+  BUS_DOSE_MISSED,     // Dose passed over by a clock step beyond its grace window
+  BUS_EVENT_TYPES
+};
+
+// Plain data, copied into the pool by value
+struct BusEvent {
+  BusEventType type;
+  int8_t scheduleIndex;
+  uint8_t dispenserId;   // 0-4
+  uint8_t hour;          // Scheduled dose time
+  uint8_t minute;
+  NameId medication;
+  NameId patient;
+  NameId pillSize;
+  uint32_t publishedAt;  // millis()
+};
+
+typedef void (*BusHandler)(const BusEvent& event);
+
+/**
+ * EventBus
+ *
+ * Publish/subscribe between modules without String copies or heap use.
+ * publish() copies a small POD event into a preallocated ring and returns,
+ * so an alarm callback does no more than that. dispatch() later hands each
+ * event to every subscriber of its type, in subscription order, on the
+ * dispatching task's own stack.
+ *
+ * publish() is safe from any task. dispatch() is called by the schedule
+ * task only, under the schedule lock, so subscribers may read schedules.
+ */
+class EventBus {
+private:
+  static portMUX_TYPE busMux;
+  BusEvent pool[EVENT_BUS_DEPTH];
+  uint8_t head;
+  uint8_t count;
+  BusHandler subscribers[BUS_EVENT_TYPES][EVENT_BUS_MAX_SUBSCRIBERS];
+  uint8_t subscriberCount[BUS_EVENT_TYPES];
+  uint32_t published;
+  uint32_t dropped;
+  uint32_t dispatchedCount[BUS_EVENT_TYPES];
+  uint8_t highWater;
+  
+public:
+  EventBus();
+  
+  bool subscribe(BusEventType type, BusHandler handler);  // Call during setup
+  bool publish(const BusEvent& event);                    // False if the pool is full
+  uint8_t dispatch();                                     // Returns events delivered
+  
+  static const char* getTypeName(BusEventType type);
+  void printStatus();
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "EventLog.h"
+
+EventLog eventLog;
+
+portMUX_TYPE EventLog::logMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Names only - the format strings live in the host decoder
+#define LOG_NAME_ENTRY(id, text) #id,
+static const char* EVENT_NAMES[LOG_EVENT_COUNT] = {
+  LOG_EVENT_LIST(LOG_NAME_ENTRY)
+};
+#undef LOG_NAME_ENTRY
+
+#define LOG_MODULE_ENTRY(id, text) text,
+static const char* MODULE_NAMES[LOG_MODULE_COUNT] = {
+  LOG_MODULE_LIST(LOG_MODULE_ENTRY)
+};
+#undef LOG_MODULE_ENTRY
+
+static const char LEVEL_LETTERS[] = "-EWID";
+
+EventLog::EventLog() {
+  memset(ring, 0, sizeof(ring));
+  head = 0;
+  count = 0;
+  written = 0;
+  dropped = 0;
+  droppedReported = 0;
+  binaryOutput = true;
+}
+
+void EventLog::write(uint8_t level, uint8_t module, uint16_t event, int32_t a, int32_t b, int32_t c) {
+  uint32_t timestamp = millis();
+  
+  portENTER_CRITICAL(&logMux);
+  LogRecord& record = ring[head];
+  record.timestamp = timestamp;
+  record.level = level;
+  record.module = module;
+  record.event = event;
+  record.args[0] = a;
+  record.args[1] = b;
+  record.args[2] = c;
+  head = (head + 1) % LOG_RING_SIZE;
+  if (count < LOG_RING_SIZE) {
+    count++;
+  } else {
+    // Full - the oldest record was just overwritten
+    dropped++;
+  }
+  written++;
+  portEXIT_CRITICAL(&logMux);
+}
+
+uint16_t EventLog::drain(uint16_t maxRecords) {
+  uint16_t sent = 0;
+  
+  // Tell the reader records went missing before the ones that survived
+  uint32_t lost = dropped - droppedReported;
+  if (lost > 0) {
+    droppedReported += lost;
+    LogRecord notice = {};
+    notice.timestamp = millis();
+    notice.level = LOG_LEVEL_WARN;
+    notice.module = LOG_MOD_LOG;
+    notice.event = EV_LOG_DROPPED;
+    notice.args[0] = lost;
+    output(notice);
+  }
+  
+  while (sent < maxRecords) {
+    LogRecord record;
+    bool available = false;
+  
+    portENTER_CRITICAL(&logMux);
+    if (count > 0) {
+      uint16_t tail = (head + LOG_RING_SIZE - count) % LOG_RING_SIZE;
+      record = ring[tail];
+      count--;
+      available = true;
+    }
+    portEXIT_CRITICAL(&logMux);
+  
+    if (!available) {
+      break;
+    }
+    output(record);
+    sent++;
+  }
+  return sent;
+}
+
+void EventLog::output(const LogRecord& record) {
+  if (binaryOutput) {
+    // One write per frame so other tasks' Serial output cannot split it
+    uint8_t frame[LOG_FRAME_SIZE];
+    frame[0] = LOG_FRAME_SYNC1;
+    frame[1] = LOG_FRAME_SYNC2;
+    memcpy(frame + 2, &record, sizeof(LogRecord));
+    uint8_t sum = 0;
+    for (size_t i = 0; i < sizeof(LogRecord); i++) {
+      sum += frame[2 + i];
+    }
+    frame[LOG_FRAME_SIZE - 1] = sum;
+    Serial.write(frame, LOG_FRAME_SIZE);
+    return;
+  }
+  
+  Serial.printf("[%lu] %c %s %s %ld %ld %ld\n", (unsigned long)record.timestamp,
+                record.level <= LOG_LEVEL_DEBUG ? LEVEL_LETTERS[record.level] : '?',
+                getModuleName(record.module), getEventName(record.event),
+                (long)record.args[0], (long)record.args[1], (long)record.args[2]);
+}
+
+void EventLog::setBinaryOutput(bool binary) {
+  binaryOutput = binary;
+}
+
+const char* EventLog::getModuleName(uint8_t module) {
+  return module < LOG_MODULE_COUNT ? MODULE_NAMES[module] : "?";
+}
+
+const char* EventLog::getEventName(uint16_t event) {
+  return event < LOG_EVENT_COUNT ? EVENT_NAMES[event] : "?";
+}
+
+void EventLog::printStatus() {
+  portENTER_CRITICAL(&logMux);
+  uint16_t pending = count;
+  uint32_t total = written;
+  uint32_t lost = dropped;
+  portEXIT_CRITICAL(&logMux);
+  
+  Serial.println("\n=== EVENT LOG ===");
+  Serial.println("Compiled level: " + String(LOG_LEVEL) + " (" + String(LEVEL_LETTERS[LOG_LEVEL]) + " and above)");
+  Serial.println("Output: " + String(binaryOutput ? "binary frames (use LogDecoder)" : "text"));
+  Serial.println("Pending: " + String(pending) + " / " + String(LOG_RING_SIZE));
+  Serial.println("Records written: " + String(total));
+  Serial.println("Records lost to overflow: " + String(lost));
+  Serial.println("=================\n");
+}
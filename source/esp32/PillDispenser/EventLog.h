@@ -0,0 +1,80 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <Arduino.h>
+#include "LogEvents.h"
+
+// Calls above this level are removed at compile time, arguments and all.
+// LOG_LEVEL_DEBUG adds the once-per-second clock trace.
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_RING_SIZE 256   // Records (20 bytes each)
+#define LOG_DRAIN_BATCH 16  // Records per drain() call
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(module, event, ...) eventLog.write(LOG_LEVEL_ERROR, module, event, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(module, event, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(module, event, ...) eventLog.write(LOG_LEVEL_WARN, module, event, ##__VA_ARGS__)
+#else
+#define LOG_WARN(module, event, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(module, event, ...) eventLog.write(LOG_LEVEL_INFO, module, event, ##__VA_ARGS__)
+#else
+#define LOG_INFO(module, event, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(module, event, ...) eventLog.write(LOG_LEVEL_DEBUG, module, event, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(module, event, ...) ((void)0)
+#endif
+
+/**
+ * EventLog
+ *
+ * Structured logging for the hot paths. A log call stores a 20-byte binary
+ * record (timestamp, level, module, event id, three integer arguments) in
+ * a RAM ring and returns - no formatting, no String, no UART wait. When the
+ * ring is full the oldest record is overwritten and the loss is reported.
+ *
+ * A low-priority task calls drain() to move records to the UART, either as
+ * framed binary for the host decoder (source/esp32/LogDecoder) or as plain
+ * text with event names when no decoder is at hand. Framed records mix
+ * safely with ordinary Serial output; the decoder passes that through.
+ */
+class EventLog {
+private:
+  static portMUX_TYPE logMux;
+  LogRecord ring[LOG_RING_SIZE];
+  uint16_t head;                 // Next slot to write
+  uint16_t count;
+  uint32_t written;
+  uint32_t dropped;
+  uint32_t droppedReported;
+  bool binaryOutput;
+  
+  void output(const LogRecord& record);
+  
+public:
+  EventLog();
+  
+  void write(uint8_t level, uint8_t module, uint16_t event, int32_t a = 0, int32_t b = 0, int32_t c = 0);
+  uint16_t drain(uint16_t maxRecords = LOG_DRAIN_BATCH);  // Returns records sent
+  
+  void setBinaryOutput(bool binary);
+  static const char* getModuleName(uint8_t module);
+  static const char* getEventName(uint16_t event);
+  void printStatus();
+};
+
+extern EventLog eventLog;
+
+#endif
@@ -1,6 +1,7 @@
 #include "FirebaseManager.h"
 #include "FirebaseConfig.h"
 #include "ScheduleManager.h"
+#include "TimeManager.h"
 #include "addons/TokenHelper.h"
 #include "addons/RTDBHelper.h"
 #include <WiFiManager.h>
@@ -17,11 +18,17 @@ FirebaseManager::FirebaseManager() {
   lastScheduleSync = 0;
   lastFirebaseReady = 0;
   lastStreamCheck = 0;
+  lastTransportCheck = 0;
   dispenseCommandReceived = false;
   lastDispenseCommand = 0;
   scheduleManager = nullptr;
+  scheduleLock = nullptr;
+  profiler = nullptr;
+  memoryMonitor = nullptr;
+  timeManager = nullptr;
+  timezonePending = false;
   deviceId = "PILL_DISPENSER_" + String(ESP.getEfuseMac(), HEX);
-  deviceParentPath = "pilldispenser/device/" + deviceId;
+  buildPaths();
   userId = "";
   
   // Set static instance for callbacks
@@ -66,6 +73,9 @@ bool FirebaseManager::begin(String apiKey, String databaseURL) {
   Serial.println("\nFirebaseManager: Initializing Firebase...");
   Serial.printf("Firebase Client v%s\n\n", FIREBASE_CLIENT_VERSION);
   
+  // Kept even if WiFi is down so the GPRS fallback knows where to write
+  databaseURLValue = databaseURL;
+  
   // Check WiFi connection status
   if (WiFi.status() == WL_CONNECTED) {
     isConnected = true;
@@ -266,11 +276,30 @@ void FirebaseManager::deviceStreamCallback(MultiPathStream stream) {
         Serial.println("FirebaseManager: Triggering schedule sync due to update...");
         instance->syncSchedulesFromFirebase();
         
-      } else if (stream.dataPath == "/system_config") {
+      } else if (stream.dataPath.startsWith("/system_config")) {
         String config = stream.value;
         Serial.print("FirebaseManager: System config updated: ");
         Serial.println(config);
-        // Handle system configuration changes here
+        
+        // Time zone as a POSIX TZ string, e.g. "PHT-8"
+        String timezone = "";
+        if (stream.dataPath == "/system_config/timezone") {
+          timezone = config;
+        } else if (stream.dataPath == "/system_config" && stream.type == "json") {
+          FirebaseJson json;
+          FirebaseJsonData data;
+          json.setJsonData(config);
+          if (json.get(data, "timezone")) {
+            timezone = data.to<String>();
+          }
+        }
+        timezone.replace("\"", "");
+        timezone.trim();
+        if (timezone.length() > 0 && timezone != "null") {
+          // Stream callbacks run outside loop() - hand over to updateNonBlocking()
+          instance->pendingTimezone = timezone;
+          instance->timezonePending = true;
+        }
       }
     }
   }
@@ -293,19 +322,19 @@ bool FirebaseManager::beginScheduleStream() {
     return false;
   }
   
-  String schedulePath = deviceParentPath + "/schedules";
-  Serial.println("FirebaseManager: 🚀 Starting schedule stream on path: " + schedulePath);
+  Serial.printf("FirebaseManager: 🚀 Starting schedule stream on path: %s\n", schedulesPath);
   Serial.println("FirebaseManager: Firebase ready status: " + String(isAuthenticated ? "YES" : "NO"));
   
   // Try to begin stream
-  if (!Firebase.RTDB.beginStream(&scheduleStream, schedulePath)) {
+  if (!Firebase.RTDB.beginStream(&scheduleStream, schedulesPath)) {
     Serial.printf("FirebaseManager: ❌ Schedule stream initialization failed: %s\n", 
                   scheduleStream.errorReason().c_str());
     Serial.println("FirebaseManager: Trying alternative stream configuration...");
     
     // Try with a test path to see if streaming works at all
-    String testPath = schedulePath + "/test";
-    if (!Firebase.RTDB.beginStream(&scheduleStream, testPath)) {
+    char fallbackPath[FIREBASE_PATH_MAX + 8];
+    snprintf(fallbackPath, sizeof(fallbackPath), "%s/test", schedulesPath);
+    if (!Firebase.RTDB.beginStream(&scheduleStream, fallbackPath)) {
       Serial.printf("FirebaseManager: ❌ Even test stream failed: %s\n", 
                     scheduleStream.errorReason().c_str());
       return false;
@@ -327,7 +356,7 @@ bool FirebaseManager::beginScheduleStream() {
   
   // Test the stream by manually triggering a read (for debugging)
   Serial.println("FirebaseManager: Testing stream with manual read...");
-  if (Firebase.RTDB.getJSON(&fbdo, schedulePath)) {
+  if (Firebase.RTDB.getJSON(&fbdo, schedulesPath)) {
     Serial.println("FirebaseManager: Manual read successful - stream path is accessible");
   } else {
     Serial.printf("FirebaseManager: Manual read failed: %s\n", fbdo.errorReason().c_str());
@@ -416,6 +445,69 @@ void FirebaseManager::updateNonBlocking() {
     
     lastStreamCheck = currentMillis;
   }
+  
+  // Apply a time zone received from /system_config
+  if (timezonePending && timeManager != nullptr) {
+    timezonePending = false;
+    // A zone change can step the clock, which reschedules doses
+    if (scheduleLock != nullptr) xSemaphoreTake(scheduleLock, portMAX_DELAY);
+    timeManager->setTimezone(pendingTimezone.c_str());
+    if (scheduleLock != nullptr) xSemaphoreGive(scheduleLock);
+  }
+  
+  // Track link state for the outbox / GPRS fallback
+  if (currentMillis - lastTransportCheck >= TRANSPORT_CHECK_INTERVAL) {
+    lastTransportCheck = currentMillis;
+    bool ready = WiFi.status() == WL_CONNECTED && isFirebaseReady();
+    transport.update(ready, ready ? String("") : String(Firebase.getToken()));
+    
+    if (ready && transport.hasPending()) {
+      flushOutbox();
+    }
+  }
+}
+
+void FirebaseManager::enableGPRSFallback(SIM800L* sim800, String apn, String username, String password,
+                                         String databaseSecret) {
+  transport.enableGPRSFallback(sim800, databaseURLValue, apn, username, password);
+  transport.setDatabaseSecret(databaseSecret);
+}
+
+void FirebaseManager::setModemLock(SemaphoreHandle_t lock) {
+  transport.setModemLock(lock);
+}
+
+String FirebaseManager::getCloudLinkName() {
+  return transport.getActiveLinkName();
+}
+
+int FirebaseManager::getPendingCloudWrites() {
+  return transport.getPendingCount();
+}
+
+unsigned long FirebaseManager::getMillisUntilCloudFlush() {
+  return transport.getMillisUntilFlush();
+}
+
+unsigned long FirebaseManager::getMillisUntilHeartbeat() {
+  unsigned long sinceLast = millis() - lastHeartbeat;
+  return sinceLast >= HEARTBEAT_INTERVAL ? 0 : HEARTBEAT_INTERVAL - sinceLast;
+}
+
+bool FirebaseManager::flushOutbox() {
+  // One multi-location update for everything buffered while offline
+  FirebaseJson batch;
+  batch.setJsonData(transport.buildBatch());
+  int writes = transport.getPendingCount();
+  
+  if (Firebase.RTDB.updateNode(&fbdo, "/", &batch)) {
+    transport.clearOutbox();
+    Serial.println("FirebaseManager: ✅ Flushed " + String(writes) + " buffered write(s)");
+    return true;
+  }
+  
+  Serial.println("FirebaseManager: ❌ Outbox flush failed - " + fbdo.errorReason());
+  return false;
 }
 
 bool FirebaseManager::shouldSendData() {
@@ -428,7 +520,19 @@ String FirebaseManager::getDeviceId() {
 
 void FirebaseManager::setDeviceId(String id) {
   deviceId = id;
-  deviceParentPath = "pilldispenser/device/" + deviceId;
+  buildPaths();
+}
+
+void FirebaseManager::buildPaths() {
+  // Fixed for the life of the device - the hot paths use these instead of
+  // concatenating a new String on every write
+  snprintf(deviceParentPath, sizeof(deviceParentPath), "pilldispenser/device/%s", deviceId.c_str());
+  snprintf(heartbeatPath, sizeof(heartbeatPath), "%s/heartbeat", deviceParentPath);
+  snprintf(statusPath, sizeof(statusPath), "%s/status", deviceParentPath);
+  snprintf(schedulesPath, sizeof(schedulesPath), "%s/schedules", deviceParentPath);
+  snprintf(dispensersPath, sizeof(dispensersPath), "%s/dispensers", deviceParentPath);
+  snprintf(commandsPath, sizeof(commandsPath), "%s/commands", deviceParentPath);
+  snprintf(testPath, sizeof(testPath), "%s/test", deviceParentPath);
 }
 
 bool FirebaseManager::sendPillDispenseLog(int pillCount, String timestamp) {
@@ -437,14 +541,18 @@ bool FirebaseManager::sendPillDispenseLog(int pillCount, String timestamp) {
     return false;
   }
   
-  String path = deviceParentPath + "/pill_logs/" + String(millis());
+  unsigned long now = millis();
+  char path[FIREBASE_PATH_MAX + 16];
+  snprintf(path, sizeof(path), "%s/pill_logs/%lu", deviceParentPath, now);
+  char uptime[12];
+  snprintf(uptime, sizeof(uptime), "%lu", now);
   
   FirebaseJson json;
   json.set("timestamp", timestamp);
   json.set("pill_count", pillCount);
   json.set("device_id", deviceId);
   json.set("status", "dispensed");
-  json.set("uptime", String(millis()));
+  json.set("uptime", uptime);
   
   if (Firebase.RTDB.setJSON(&fbdo, path, &json)) {
     Serial.println("FirebaseManager: Pill dispense log sent successfully");
@@ -463,16 +571,18 @@ bool FirebaseManager::updateDeviceStatus(String status) {
     return false;
   }
   
-  String path = deviceParentPath + "/status";
+  char lastUpdate[12];
+  snprintf(lastUpdate, sizeof(lastUpdate), "%lu", millis());
   
   FirebaseJson json;
   json.set("status", status);
-  json.set("last_update", String(millis()));
+  json.set("last_update", lastUpdate);
   json.set("ip_address", WiFi.localIP().toString());
   json.set("wifi_strength", WiFi.RSSI());
   json.set("free_heap", ESP.getFreeHeap());
+  json.set("largest_free_block", ESP.getMaxAllocHeap());
   
-  if (Firebase.RTDB.setJSON(&fbdo, path, &json)) {
+  if (Firebase.RTDB.setJSON(&fbdo, statusPath, &json)) {
     Serial.print("FirebaseManager: Device status updated to: ");
     Serial.println(status);
     return true;
@@ -483,7 +593,7 @@ bool FirebaseManager::updateDeviceStatus(String status) {
   }
 }
 
-bool FirebaseManager::sendHeartbeat(VoltageSensor* voltageSensor) {
+bool FirebaseManager::sendHeartbeat(BatteryEstimator* battery) {
   unsigned long currentTime = millis();
   if (currentTime - lastHeartbeat < HEARTBEAT_INTERVAL) {
     return true; // Not time for heartbeat yet
@@ -492,36 +602,83 @@ bool FirebaseManager::sendHeartbeat(VoltageSensor* voltageSensor) {
   Serial.println("FirebaseManager: Attempting to send heartbeat...");
   lastHeartbeat = currentTime;
   
-  if (!isFirebaseReady()) {
-    Serial.println("FirebaseManager: Cannot send heartbeat - Firebase not ready");
-    return false;
-  }
-  
-  String path = deviceParentPath + "/heartbeat";
-  Serial.print("FirebaseManager: Sending heartbeat to path: ");
-  Serial.println(path);
+  // Values stay strings, as the dashboard expects, but are formatted on the stack
+  char number[16];
+  snprintf(number, sizeof(number), "%lu", currentTime);
   
   FirebaseJson json;
-  json.set("timestamp", String(currentTime));
-  json.set("uptime", String(currentTime));
+  json.set("timestamp", number);
+  json.set("uptime", number);
   json.set("wifi_strength", WiFi.RSSI());
   json.set("free_heap", ESP.getFreeHeap());
+  json.set("largest_free_block", ESP.getMaxAllocHeap());
+  json.set("min_free_heap", ESP.getMinFreeHeap());
   json.set("device_status", "online");
   
-  // Add battery data if voltage sensor is available
-  if (voltageSensor != nullptr) {
-    json.set("battery_voltage", String(voltageSensor->readActualVoltage()));
-    json.set("battery_percentage", String(voltageSensor->readBatteryPercentage()));
+  // Restored from NVS after a power loss and not confirmed by NTP - doses are held
+  if (timeManager != nullptr) {
+    json.set("clock_provisional", timeManager->isTimeProvisional());
+  }
+  
+  // Fragmentation shows in the largest block long before free heap runs out
+  if (memoryMonitor != nullptr) {
+    uint32_t minFree, maxFree, minLargest, maxLargest;
+    memoryMonitor->get24HourRange(minFree, maxFree, minLargest, maxLargest);
+    json.set("memory/free_heap_24h_min", (int)minFree);
+    json.set("memory/largest_block_24h_min", (int)minLargest);
+    json.set("memory/largest_block_trend", (int)memoryMonitor->getLargestBlockTrend());
+    json.set("memory/low_memory_restarts", (int)memoryMonitor->getLowMemoryRestarts());
+  }
+  
+  // Add battery data if the estimator is available
+  if (battery != nullptr) {
+    snprintf(number, sizeof(number), "%.2f", battery->getVoltage());
+    json.set("battery_voltage", number);
+    snprintf(number, sizeof(number), "%.2f", battery->getPercent());
+    json.set("battery_percentage", number);
+    snprintf(number, sizeof(number), "%.1f", battery->getHoursRemaining());
+    json.set("battery_runtime_hours", number);
     Serial.print("FirebaseManager: Battery voltage: ");
-    Serial.print(voltageSensor->readActualVoltage());
+    Serial.print(battery->getVoltage());
     Serial.print("V, Percentage: ");
-    Serial.print(voltageSensor->readBatteryPercentage());
-    Serial.println("%");
+    Serial.print(battery->getPercent());
+    Serial.print("%, Runtime: ");
+    Serial.print(battery->getHoursRemaining(), 1);
+    Serial.println(" h");
   } else {
     Serial.println("FirebaseManager: No voltage sensor available");
   }
   
-  if (Firebase.RTDB.setJSON(&fbdo, path, &json)) {
+  // Latency per hot path since boot (or the last "stats reset")
+  if (profiler != nullptr) {
+    char key[48];
+    for (int i = 0; i < PROFILE_COUNT; i++) {
+      ProfileId id = (ProfileId)i;
+      const char* name = LatencyProfiler::getName(id);
+      snprintf(key, sizeof(key), "latency/%s/p50_us", name);
+      json.set(key, (int)profiler->getPercentile(id, 50));
+      snprintf(key, sizeof(key), "latency/%s/p99_us", name);
+      json.set(key, (int)profiler->getPercentile(id, 99));
+      snprintf(key, sizeof(key), "latency/%s/max_us", name);
+      json.set(key, (int)profiler->getMax(id));
+      snprintf(key, sizeof(key), "latency/%s/overruns", name);
+      json.set(key, (int)profiler->getOverruns(id));
+    }
+  }
+  
+  if (!isFirebaseReady()) {
+    // Buffered heartbeats replace each other - only the latest is delivered
+    String body;
+    json.set("link", transport.getActiveLinkName());
+    json.toString(body, false);
+    Serial.println("FirebaseManager: Firebase not ready - heartbeat buffered");
+    return transport.queueWrite(heartbeatPath, body);
+  }
+  
+  Serial.print("FirebaseManager: Sending heartbeat to path: ");
+  Serial.println(heartbeatPath);
+  
+  if (Firebase.RTDB.setJSON(&fbdo, heartbeatPath, &json)) {
     Serial.println("FirebaseManager: ✅ Heartbeat sent successfully!");
     return true;
   } else {
@@ -536,20 +693,19 @@ bool FirebaseManager::uploadSensorData(String sensorName, String value) {
     return false;
   }
   
-  String path = deviceParentPath + "/sensors/" + sensorName;
+  char path[FIREBASE_PATH_MAX + 32];
+  snprintf(path, sizeof(path), "%s/sensors/%s", deviceParentPath, sensorName.c_str());
+  char timestamp[12];
+  snprintf(timestamp, sizeof(timestamp), "%lu", millis());
   
   FirebaseJson json;
   json.set("value", value);
-  json.set("timestamp", String(millis()));
+  json.set("timestamp", timestamp);
   
   return Firebase.RTDB.setJSON(&fbdo, path, &json);
 }
 
 bool FirebaseManager::sendPillReport(int pillCount, String datetime, String description, int status) {
-  if (!isFirebaseReady()) {
-    return false;
-  }
-  
   FirebaseJson json;
   json.set("pill_count", pillCount);
   json.set("datetime", datetime);
@@ -557,6 +713,14 @@ bool FirebaseManager::sendPillReport(int pillCount, String datetime, String desc
   json.set("status", status);
   json.set("device_id", deviceId);
   
+  if (!isFirebaseReady()) {
+    // Reports are urgent - sent on the next GPRS pass or WiFi reconnect
+    String body;
+    json.toString(body, false);
+    Serial.println("FirebaseManager: Firebase not ready - report buffered");
+    return transport.queuePush("pilldispenser/reports", body);
+  }
+  
   // Push data with unique Firebase key
   if (Firebase.RTDB.pushJSON(&fbdo, "/pilldispenser/reports", &json)) {
     Serial.println("FirebaseManager: Pill report sent successfully!");
@@ -573,7 +737,8 @@ bool FirebaseManager::downloadSchedule() {
     return false;
   }
   
-  String path = deviceParentPath + "/schedule";
+  char path[FIREBASE_PATH_MAX];
+  snprintf(path, sizeof(path), "%s/schedule", deviceParentPath);
   
   if (Firebase.RTDB.getJSON(&fbdo, path)) {
     Serial.println("FirebaseManager: Schedule data retrieved");
@@ -592,9 +757,7 @@ bool FirebaseManager::checkForCommands() {
     return false;
   }
   
-  String path = deviceParentPath + "/commands";
-  
-  if (Firebase.RTDB.getString(&fbdo, path)) {
+  if (Firebase.RTDB.getString(&fbdo, commandsPath)) {
     String command = fbdo.to<String>();
     if (command.length() > 0) {
       Serial.print("FirebaseManager: Command received: ");
@@ -604,7 +767,7 @@ bool FirebaseManager::checkForCommands() {
       processCommand(command);
       
       // Clear the command after reading (only for polling mode)
-      Firebase.RTDB.deleteNode(&fbdo, path);
+      Firebase.RTDB.deleteNode(&fbdo, commandsPath);
       return true;
     }
   }
@@ -684,7 +847,6 @@ bool FirebaseManager::testConnection() {
     return false;
   }
   
-  String testPath = deviceParentPath + "/test";
   String testData = "Connection test at " + String(millis());
   
   if (Firebase.RTDB.setString(&fbdo, testPath, testData)) {
@@ -742,8 +904,6 @@ bool FirebaseManager::testDataUpload() {
 bool FirebaseManager::testDataDownload() {
   Serial.println("FirebaseManager: Testing data download...");
   
-  String testPath = deviceParentPath + "/test";
-  
   if (Firebase.RTDB.getString(&fbdo, testPath)) {
     Serial.print("FirebaseManager: Downloaded data: ");
     Serial.println(fbdo.to<String>());
@@ -761,6 +921,23 @@ void FirebaseManager::setScheduleManager(ScheduleManager* manager) {
   Serial.println("FirebaseManager: Schedule manager linked");
 }
 
+void FirebaseManager::setTimeManager(TimeManager* manager) {
+  timeManager = manager;
+  transport.setTimeManager(manager);
+}
+
+void FirebaseManager::setScheduleLock(SemaphoreHandle_t lock) {
+  scheduleLock = lock;
+}
+
+void FirebaseManager::setProfiler(LatencyProfiler* latencyProfiler) {
+  profiler = latencyProfiler;
+}
+
+void FirebaseManager::setMemoryMonitor(MemoryMonitor* monitor) {
+  memoryMonitor = monitor;
+}
+
 void FirebaseManager::setUserId(String uid) {
   userId = uid;
   Serial.println("FirebaseManager: User ID set to " + userId);
@@ -804,15 +981,19 @@ bool FirebaseManager::syncSchedulesFromFirebase() {
   // The main loop prioritizes TimeAlarms processing before this is called.
   Serial.println("FirebaseManager: Syncing schedules from Firebase...");
   
-  String schedulePath = deviceParentPath + "/schedules";
-  Serial.println("FirebaseManager: Schedule path: " + schedulePath);
+  Serial.printf("FirebaseManager: Schedule path: %s\n", schedulesPath);
   
-  if (Firebase.RTDB.getJSON(&fbdo, schedulePath)) {
+  if (Firebase.RTDB.getJSON(&fbdo, schedulesPath)) {
     Serial.println("FirebaseManager: Successfully retrieved data from Firebase");
     FirebaseJson* json = fbdo.to<FirebaseJson*>();
     
-    // Clear existing schedules
-    scheduleManager->clearAllSchedules();
+    // The schedule task services alarms concurrently - hold it off while
+    // the alarm table is rebuilt (the fetch above ran without the lock)
+    if (scheduleLock != nullptr) xSemaphoreTake(scheduleLock, portMAX_DELAY);
+    
+    // Match schedules by id - a resync must not reset fired slots or SKIP,
+    // or a later backward clock step could dispense the same slot twice
+    scheduleManager->beginSync();
     
     // Parse and add schedules
     size_t len = json->iteratorBegin();
@@ -840,6 +1021,7 @@ bool FirebaseManager::syncSchedulesFromFirebase() {
       String patientName = "";
       String pillSize = "medium";
       String timeStr = "";
+      int graceMinutes = DEFAULT_GRACE_MINUTES;
       
       // Try both field name formats (original schedule page vs schedule-v2)
       if (scheduleJson.get(data, "dispenserId") || scheduleJson.get(data, "dispenser_id")) {
@@ -874,6 +1056,9 @@ bool FirebaseManager::syncSchedulesFromFirebase() {
       if (scheduleJson.get(data, "pillSize") || scheduleJson.get(data, "pill_size")) {
         pillSize = data.to<String>();
       }
+      if (scheduleJson.get(data, "graceMinutes") || scheduleJson.get(data, "grace_minutes")) {
+        graceMinutes = data.to<int>();
+      }
       
       // ===== VALIDATION =====
       bool isValid = true;
@@ -908,10 +1093,16 @@ bool FirebaseManager::syncSchedulesFromFirebase() {
       
       // Add schedule if valid
       if (isValid) {
-        if (scheduleManager->addSchedule(key, dispenserId, hour, minute, 
-                                         medicationName, patientName, pillSize, enabled)) {
+        if (scheduleManager->addSchedule(key.c_str(), dispenserId, hour, minute, 
+                                         medicationName.c_str(), patientName.c_str(),
+                                         pillSize.c_str(), enabled)) {
           addedCount++;
           dispenserCounts[dispenserId]++;
+          // How late a dose passed over by a clock step may still be given
+          if (!scheduleManager->setGracePeriod(key.c_str(), graceMinutes)) {
+            Serial.printf("⚠️  Schedule %s: grace %d min out of range - keeping %d\n",
+                         key.c_str(), graceMinutes, scheduleManager->getScheduleById(key.c_str())->graceMinutes);
+          }
           Serial.printf("✅ Added schedule: %s - %02d:%02d for dispenser %d\n", 
                        key.c_str(), hour, minute, dispenserId);
         }
@@ -922,6 +1113,11 @@ bool FirebaseManager::syncSchedulesFromFirebase() {
     }
     
     json->iteratorEnd();
+    scheduleManager->endSync();
+  
+    // Next boot arms these before the network is up
+    scheduleManager->saveCache();
+    if (scheduleLock != nullptr) xSemaphoreGive(scheduleLock);
     
     lastScheduleSync = millis();
     Serial.println("\n" + String('=', 60));
@@ -952,8 +1148,6 @@ bool FirebaseManager::updateDispenserAfterDispense(int dispenserId, TimeManager*
     return false;
   }
 
-  String dispensersPath = deviceParentPath + "/dispensers";
-
   // Get current dispensers as JSON string
   if (Firebase.RTDB.getJSON(&fbdo, dispensersPath)) {
     // Parse the JSON response
@@ -4,10 +4,16 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <Firebase_ESP_Client.h>
-#include "VoltageSensor.h"
+#include "BatteryEstimator.h"
+#include "CloudTransport.h"
+#include "LatencyProfiler.h"
+#include "MemoryMonitor.h"
+
+#define FIREBASE_PATH_MAX 96  // "pilldispenser/device/PILL_DISPENSER_<mac>/<node>" with room to spare
 
 // Forward declaration
 class ScheduleManager;
+class TimeManager;
 
 class FirebaseManager {
 private:
@@ -27,22 +33,49 @@ private:
   unsigned long lastScheduleSync;
   unsigned long lastFirebaseReady;
   unsigned long lastStreamCheck;
+  unsigned long lastTransportCheck;
+  
+  // Offline outbox and GPRS fallback
+  CloudTransport transport;
+  String databaseURLValue;
   
   // Command processing
-  bool dispenseCommandReceived;
+  volatile bool dispenseCommandReceived;
   int lastDispenseCommand;
   
   // Schedule manager reference
   ScheduleManager* scheduleManager;
+  SemaphoreHandle_t scheduleLock;  // Held while the schedules or the clock change
+  
+  // Hot-path latency summary for the heartbeat
+  LatencyProfiler* profiler;
+  
+  // Heap and stack history for the heartbeat
+  MemoryMonitor* memoryMonitor;
+  
+  // Time zone from /system_config, applied from updateNonBlocking()
+  TimeManager* timeManager;
+  String pendingTimezone;
+  volatile bool timezonePending;
   
   static const unsigned long HEARTBEAT_INTERVAL = 60000; // 1 minute
   static const unsigned long SEND_DATA_INTERVAL = 5000;  // 5 seconds
   static const unsigned long SCHEDULE_SYNC_INTERVAL = 10000; // 10 seconds (reduced for testing)
   static const unsigned long FIREBASE_READY_INTERVAL = 100; // Call Firebase.ready() every 100ms
   static const unsigned long STREAM_CHECK_INTERVAL = 50; // Check streams every 50ms
+  static const unsigned long TRANSPORT_CHECK_INTERVAL = 1000; // Check link state every second
+  
+  // Device paths, built once by buildPaths() when the device ID is set
+  char deviceParentPath[FIREBASE_PATH_MAX];
+  char heartbeatPath[FIREBASE_PATH_MAX];
+  char statusPath[FIREBASE_PATH_MAX];
+  char schedulesPath[FIREBASE_PATH_MAX];
+  char dispensersPath[FIREBASE_PATH_MAX];
+  char commandsPath[FIREBASE_PATH_MAX];
+  char testPath[FIREBASE_PATH_MAX];
+  void buildPaths();
   
   // Device paths for streaming
-  String deviceParentPath;
   String devicePaths[4] = { "/device_status", "/pill_schedule", "/commands", "/system_config" };
   
   // Callback functions
@@ -57,6 +90,9 @@ private:
   // Command processing
   void processCommand(String command);
   
+  // Deliver writes buffered while offline
+  bool flushOutbox();
+  
 public:
   FirebaseManager();
   bool begin(String apiKey, String databaseURL);
@@ -67,7 +103,7 @@ public:
   // Data operations
   bool sendPillDispenseLog(int pillCount, String timestamp);
   bool updateDeviceStatus(String status);
-  bool sendHeartbeat(VoltageSensor* voltageSensor = nullptr);
+  bool sendHeartbeat(BatteryEstimator* battery = nullptr);
   bool uploadSensorData(String sensorName, String value);
   bool sendPillReport(int pillCount, String datetime, String description, int status);
   bool updateDispenserAfterDispense(int dispenserId, class TimeManager* timeManager);
@@ -78,6 +114,16 @@ public:
   void handleStreamUpdates();
   void updateNonBlocking(); // Non-blocking update method
   
+  // GPRS fallback for reports and heartbeats while WiFi is down; without a
+  // database secret it only works for the first hour of an outage
+  void enableGPRSFallback(SIM800L* sim800, String apn, String username = "", String password = "",
+                          String databaseSecret = "");
+  void setModemLock(SemaphoreHandle_t lock);
+  String getCloudLinkName();
+  int getPendingCloudWrites();
+  unsigned long getMillisUntilHeartbeat();  // 0 when one is due
+  unsigned long getMillisUntilCloudFlush(); // Outbox over WiFi or GPRS; ULONG_MAX if nothing will go
+  
   // Configuration
   bool downloadSchedule();
   bool checkForCommands();
@@ -86,6 +132,10 @@ public:
   
   // Schedule management
   void setScheduleManager(ScheduleManager* manager);
+  void setTimeManager(TimeManager* manager);
+  void setScheduleLock(SemaphoreHandle_t lock);
+  void setProfiler(LatencyProfiler* latencyProfiler);
+  void setMemoryMonitor(MemoryMonitor* monitor);
   void setUserId(String uid);
   bool syncSchedulesFromFirebase();
   bool shouldSyncSchedules();
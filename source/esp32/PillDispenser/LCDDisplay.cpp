@@ -3,12 +3,30 @@
 
 LCDDisplay::LCDDisplay(uint8_t address) : lcd(address, COLS, ROWS) {
   i2cAddress = address;
+  memset(frame, ' ', sizeof(frame));
+  memset(visible, ' ', sizeof(visible));
+  cursorCol = 0;
+  cursorRow = 0;
+  hwCol = 0;
+  hwRow = 0;
+  batchDepth = 0;
+  autoFlush = true;
+  resetStats();
 }
 
 bool LCDDisplay::begin() {
   lcd.init();
   lcd.backlight();
   
+  // init() leaves the display blank with the address counter at 0,0
+  memset(frame, ' ', sizeof(frame));
+  memset(visible, ' ', sizeof(visible));
+  cursorCol = 0;
+  cursorRow = 0;
+  hwCol = 0;
+  hwRow = 0;
+  resetStats();
+  
   // Test if device is connected
   Wire.beginTransmission(i2cAddress);
   uint8_t error = Wire.endTransmission();
@@ -23,47 +41,151 @@ bool LCDDisplay::begin() {
   }
 }
 
+// Framebuffer primitives - these never touch the bus
+
+void LCDDisplay::drawText(const char* text, uint8_t col, uint8_t row) {
+  if (row >= ROWS) return;
+  
+  // Clipped to the row; the LCD would wrap into an unrelated row otherwise
+  while (col < COLS && *text != '\0') {
+    frame[row][col++] = *text++;
+  }
+  cursorCol = col;
+  cursorRow = row;
+}
+
+void LCDDisplay::fillRow(uint8_t row) {
+  if (row >= ROWS) return;
+  memset(frame[row], ' ', COLS);
+}
+
+void LCDDisplay::flushIfAuto() {
+  if (autoFlush && batchDepth == 0) {
+    flush();
+  }
+}
+
+void LCDDisplay::flush() {
+  bool changed = false;
+  
+  for (uint8_t row = 0; row < ROWS; row++) {
+    uint8_t col = 0;
+    while (col < COLS) {
+      if (frame[row][col] == visible[row][col]) {
+        col++;
+        continue;
+      }
+  
+      // Extend the run; one unchanged character between two changes is
+      // as cheap to resend as a cursor move, so it is bridged
+      uint8_t end = col + 1;
+      while (end < COLS) {
+        if (frame[row][end] != visible[row][end]) {
+          end++;
+        } else if (end + 1 < COLS && frame[row][end + 1] != visible[row][end + 1]) {
+          end += 2;
+        } else {
+          break;
+        }
+      }
+  
+      if (hwRow != row || hwCol != col) {
+        lcd.setCursor(col, row);
+        sentBytes++;
+      }
+      for (uint8_t i = col; i < end; i++) {
+        lcd.write((uint8_t)frame[row][i]);
+        visible[row][i] = frame[row][i];
+      }
+      sentBytes += end - col;
+      changed = true;
+  
+      // Past the last column the controller's address jumps to another row
+      hwRow = end < COLS ? row : 255;
+      hwCol = end;
+      col = end;
+    }
+  }
+  
+  if (changed) {
+    flushCount++;
+  }
+}
+
+void LCDDisplay::beginBatch() {
+  batchDepth++;
+}
+
+void LCDDisplay::endBatch() {
+  if (batchDepth > 0) {
+    batchDepth--;
+  }
+  flushIfAuto();
+}
+
+void LCDDisplay::setAutoFlush(bool enabled) {
+  autoFlush = enabled;
+  flushIfAuto();
+}
+
+void LCDDisplay::invalidate() {
+  // 0 is never drawn into the framebuffer, so every cell differs
+  memset(visible, 0, sizeof(visible));
+  hwRow = 255;
+}
+
+// Drawing calls. immediateBytes counts what the old write-through
+// implementation sent for the same call (1 byte per command or character).
+
 void LCDDisplay::clear() {
-  lcd.clear();
+  memset(frame, ' ', sizeof(frame));
+  cursorCol = 0;
+  cursorRow = 0;
+  immediateBytes += 1;
+  flushIfAuto();
 }
 
 void LCDDisplay::setCursor(uint8_t col, uint8_t row) {
   if (col < COLS && row < ROWS) {
-    lcd.setCursor(col, row);
+    cursorCol = col;
+    cursorRow = row;
+    immediateBytes += 1;
   }
 }
 
 void LCDDisplay::print(String text) {
-  lcd.print(text);
+  drawText(text.c_str(), cursorCol, cursorRow);
+  immediateBytes += text.length();
+  flushIfAuto();
 }
 
 void LCDDisplay::print(String text, uint8_t col, uint8_t row) {
   setCursor(col, row);
-  lcd.print(text);
+  print(text);
 }
 
 void LCDDisplay::printLine(String text, uint8_t row) {
+  printLine(text.c_str(), row);
+}
+
+void LCDDisplay::printLine(const char* text, uint8_t row) {
   if (row >= ROWS) return;
   
-  // Clear the entire row
-  setCursor(0, row);
-  for (int i = 0; i < COLS; i++) {
-    lcd.print(" ");
-  }
-  
-  // Print the text at the beginning of the row
-  setCursor(0, row);
-  lcd.print(text.substring(0, COLS)); // Truncate if too long
+  fillRow(row);
+  drawText(text, 0, row);
+  immediateBytes += 2 + COLS + min((size_t)COLS, strlen(text));
+  flushIfAuto();
 }
 
 void LCDDisplay::centerText(String text, uint8_t row) {
   if (row >= ROWS) return;
   
-  uint8_t startCol = (COLS - text.length()) / 2;
-  if (startCol < 0) startCol = 0;
+  uint8_t startCol = text.length() < COLS ? (COLS - text.length()) / 2 : 0;
   
-  printLine("", row); // Clear the row
-  print(text, startCol, row);
+  fillRow(row);
+  drawText(text.c_str(), startCol, row);
+  immediateBytes += 2 + COLS + 1 + text.length();
+  flushIfAuto();
 }
 
 bool LCDDisplay::isConnected() {
@@ -80,30 +202,35 @@ void LCDDisplay::backlight(bool on) {
 }
 
 void LCDDisplay::displayWelcome() {
+  beginBatch();
   clear();
   centerText("PILL DISPENSER V3", 0);
   centerText("Initializing...", 1);
   print("System Starting", 0, 3);
+  endBatch();
   Serial.println("LCDDisplay: Welcome screen displayed");
 }
 
 void LCDDisplay::displayMainScreen() {
+  beginBatch();
   clear();
   centerText("PILL DISPENSER V3", 0);
   print("Status: Ready", 0, 1);
   print("Next: --:--", 0, 2);
   print("Count: 0", 0, 3);
+  endBatch();
 }
 
 void LCDDisplay::displayTime(String timeStr) {
-  // Clear row 2 first to prevent text overlap
-  setCursor(0, 2);
-  for (int i = 0; i < COLS; i++) {
-    lcd.print(" ");
-  }
-  // Display the time
-  setCursor(0, 2);
-  lcd.print(timeStr.substring(0, COLS)); // Truncate if too long
+  displayTime(timeStr.c_str());
+}
+
+void LCDDisplay::displayTime(const char* timeStr) {
+  // Rewrite row 2 in the framebuffer; usually only the seconds digit reaches the LCD
+  fillRow(2);
+  drawText(timeStr, 0, 2);
+  immediateBytes += 2 + COLS + min((size_t)COLS, strlen(timeStr));
+  flushIfAuto();
 }
 
 void LCDDisplay::displayPillCount(int count) {
@@ -117,20 +244,24 @@ void LCDDisplay::displayStatus(String status) {
 }
 
 void LCDDisplay::displayError(String error) {
+  beginBatch();
   clear();
   centerText("ERROR", 0);
   centerText(error, 1);
   print("Check connections", 0, 3);
+  endBatch();
   Serial.print("LCDDisplay: Error displayed - ");
   Serial.println(error);
 }
 
 void LCDDisplay::displayTestMenu() {
+  beginBatch();
   clear();
   print("=== TEST MODE ===", 0, 0);
   print("Send commands via", 0, 1);
   print("Serial Monitor", 0, 2);
   print("Type 'help' for list", 0, 3);
+  endBatch();
 }
 
 void LCDDisplay::testDisplay() {
@@ -181,12 +312,15 @@ void LCDDisplay::testDisplay() {
 }
 
 void LCDDisplay::displayMessage(String title, String message) {
+  beginBatch();
   clear();
   centerText(title, 0);
   centerText(message, 1);
+  endBatch();
 }
 
 void LCDDisplay::displayDispenseInfo(int containerNum, String medication) {
+  beginBatch();
   clear();
   centerText("DISPENSING", 0);
   centerText("Container " + String(containerNum), 1);
@@ -196,4 +330,29 @@ void LCDDisplay::displayDispenseInfo(int containerNum, String medication) {
     medication = medication.substring(0, COLS - 3) + "...";
   }
   centerText(medication, 2);
+  endBatch();
+}
+
+void LCDDisplay::resetStats() {
+  immediateBytes = 0;
+  sentBytes = 0;
+  flushCount = 0;
+  statsSince = millis();
+}
+
+void LCDDisplay::printStats() {
+  unsigned long seconds = (millis() - statsSince) / 1000;
+  if (seconds == 0) seconds = 1;
+  
+  Serial.println("\n=== LCD I2C TRAFFIC ===");
+  Serial.println("Window: " + String(seconds) + " s");
+  Serial.printf("Write-through (before): %lu LCD bytes, ~%lu I2C bytes/s\n",
+                immediateBytes, immediateBytes * LCD_I2C_BYTES_PER_LCD_BYTE / seconds);
+  Serial.printf("Framebuffer diff (now): %lu LCD bytes, ~%lu I2C bytes/s\n",
+                sentBytes, sentBytes * LCD_I2C_BYTES_PER_LCD_BYTE / seconds);
+  if (immediateBytes > 0) {
+    Serial.println("Saved: " + String(100 - (int)(sentBytes * 100 / immediateBytes)) + "%");
+  }
+  Serial.println("Flushes with changes: " + String(flushCount));
+  Serial.println("======================\n");
 }
@@ -8,6 +8,22 @@
 #include <LiquidCrystal_I2C.h>
 #pragma GCC diagnostic pop
 
+// Each LCD byte goes out as 2 nibbles x 3 PCF8574 writes (data, EN high, EN low),
+// each write being an address byte plus a data byte on the bus
+#define LCD_I2C_BYTES_PER_LCD_BYTE 12
+
+/**
+ * LCDDisplay
+ *
+ * Drawing calls only update a shadow framebuffer. flush() compares it with
+ * the image known to be on the glass and sends cursor moves and characters
+ * for the changed runs only, so a redraw that changes one digit costs a
+ * couple of LCD bytes instead of a full row. Nothing is cleared on the
+ * hardware after init, which also removes the flicker.
+ *
+ * By default every drawing call flushes straight away; wrap multi-call
+ * updates in beginBatch()/endBatch() to send them as a single diff.
+ */
 class LCDDisplay {
 private:
   LiquidCrystal_I2C lcd;
@@ -15,6 +31,26 @@ private:
   static const uint8_t COLS = 20;
   static const uint8_t ROWS = 4;
   
+  // Framebuffer
+  char frame[ROWS][COLS];     // What the screen should show
+  char visible[ROWS][COLS];   // What was last sent to the LCD
+  uint8_t cursorCol;          // Drawing cursor in the framebuffer
+  uint8_t cursorRow;
+  uint8_t hwCol;              // LCD address counter, 255 = unknown
+  uint8_t hwRow;
+  uint8_t batchDepth;
+  bool autoFlush;
+  
+  // Traffic statistics (LCD bytes: characters + commands)
+  unsigned long immediateBytes;  // What the old write-through driver would have sent
+  unsigned long sentBytes;       // What the diffing flush actually sent
+  unsigned long flushCount;
+  unsigned long statsSince;
+  
+  void drawText(const char* text, uint8_t col, uint8_t row);
+  void fillRow(uint8_t row);
+  void flushIfAuto();
+  
 public:
   LCDDisplay(uint8_t address = 0x27);
   bool begin();
@@ -23,9 +59,11 @@ public:
   void print(String text);
   void print(String text, uint8_t col, uint8_t row);
   void printLine(String text, uint8_t row);
+  void printLine(const char* text, uint8_t row);
   void centerText(String text, uint8_t row);
   void displayWelcome();
   void displayTime(String timeStr);
+  void displayTime(const char* timeStr);
   void displayPillCount(int count);
   void displayStatus(String status);
   void displayError(String error);
@@ -36,6 +74,17 @@ public:
   void displayTestMenu();
   void displayMessage(String title, String message);
   void displayDispenseInfo(int containerNum, String medication);
+  
+  // Framebuffer control
+  void flush();                 // Send changed characters to the LCD
+  void beginBatch();            // Defer flushing until the matching endBatch()
+  void endBatch();
+  void setAutoFlush(bool enabled);
+  void invalidate();            // Assume the LCD content is unknown, resend everything
+  
+  // Traffic statistics
+  void printStats();
+  void resetStats();
 };
 
 #endif
\ No newline at end of file
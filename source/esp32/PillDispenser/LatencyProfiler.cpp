@@ -0,0 +1,158 @@
+#include "LatencyProfiler.h"
+
+portMUX_TYPE LatencyProfiler::profileMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Upper edge of each bucket in microseconds; the last one catches everything
+static const uint32_t BUCKET_LIMITS[LATENCY_BUCKETS] = {
+  10, 20, 50, 100, 200, 500,
+  1000, 2000, 5000, 10000, 20000, 50000,
+  100000, 200000, 500000, 1000000, 2000000, 5000000,
+  10000000, UINT32_MAX
+};
+
+static const char* PROFILE_NAMES[PROFILE_COUNT] = {
+  "schedule", "dispense", "time", "firebase", "gsm", "servo", "lcd"
+};
+
+// Default budgets (us) - the schedule pass is what delays a dose
+static const uint32_t DEFAULT_BUDGETS[PROFILE_COUNT] = {
+  5000,     // schedule pass
+  1000,     // dispense state machine (only queues work now)
+  1000,     // time discipline
+  50000,    // firebase
+  200000,   // sim800 (AT round trips)
+  10000,    // servo link
+  50000     // lcd frame
+};
+
+LatencyProfiler::LatencyProfiler() {
+  memset(histograms, 0, sizeof(histograms));
+  for (int i = 0; i < PROFILE_COUNT; i++) {
+    histograms[i].budgetMicros = DEFAULT_BUDGETS[i];
+  }
+}
+
+uint8_t LatencyProfiler::bucketFor(uint32_t micros) {
+  uint8_t bucket = 0;
+  while (bucket < LATENCY_BUCKETS - 1 && micros > BUCKET_LIMITS[bucket]) {
+    bucket++;
+  }
+  return bucket;
+}
+
+void LatencyProfiler::record(ProfileId id, uint32_t micros) {
+  if (id >= PROFILE_COUNT) return;
+  uint8_t bucket = bucketFor(micros);
+  
+  portENTER_CRITICAL(&profileMux);
+  LatencyHistogram& histogram = histograms[id];
+  histogram.buckets[bucket]++;
+  histogram.count++;
+  if (micros > histogram.maxMicros) {
+    histogram.maxMicros = micros;
+  }
+  if (micros > histogram.budgetMicros) {
+    histogram.overruns++;
+  }
+  portEXIT_CRITICAL(&profileMux);
+}
+
+void LatencyProfiler::setBudget(ProfileId id, uint32_t micros) {
+  if (id >= PROFILE_COUNT) return;
+  portENTER_CRITICAL(&profileMux);
+  histograms[id].budgetMicros = micros;
+  histograms[id].overruns = 0;
+  portEXIT_CRITICAL(&profileMux);
+}
+
+void LatencyProfiler::reset() {
+  portENTER_CRITICAL(&profileMux);
+  for (int i = 0; i < PROFILE_COUNT; i++) {
+    memset(histograms[i].buckets, 0, sizeof(histograms[i].buckets));
+    histograms[i].count = 0;
+    histograms[i].maxMicros = 0;
+    histograms[i].overruns = 0;
+  }
+  portEXIT_CRITICAL(&profileMux);
+}
+
+uint32_t LatencyProfiler::getPercentile(ProfileId id, uint8_t percent) {
+  if (id >= PROFILE_COUNT) return 0;
+  
+  portENTER_CRITICAL(&profileMux);
+  LatencyHistogram histogram = histograms[id];
+  portEXIT_CRITICAL(&profileMux);
+  
+  if (histogram.count == 0) {
+    return 0;
+  }
+  
+  // Smallest bucket holding at least percent of the samples
+  uint32_t rank = ((uint64_t)histogram.count * percent + 99) / 100;
+  uint32_t seen = 0;
+  for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+    seen += histogram.buckets[i];
+    if (seen >= rank) {
+      return min(BUCKET_LIMITS[i], histogram.maxMicros);
+    }
+  }
+  return histogram.maxMicros;
+}
+
+uint32_t LatencyProfiler::getMax(ProfileId id) {
+  return id < PROFILE_COUNT ? histograms[id].maxMicros : 0;
+}
+
+uint32_t LatencyProfiler::getOverruns(ProfileId id) {
+  return id < PROFILE_COUNT ? histograms[id].overruns : 0;
+}
+
+uint32_t LatencyProfiler::getCount(ProfileId id) {
+  return id < PROFILE_COUNT ? histograms[id].count : 0;
+}
+
+uint32_t LatencyProfiler::getBudget(ProfileId id) {
+  return id < PROFILE_COUNT ? histograms[id].budgetMicros : 0;
+}
+
+const char* LatencyProfiler::getName(ProfileId id) {
+  return id < PROFILE_COUNT ? PROFILE_NAMES[id] : "unknown";
+}
+
+int LatencyProfiler::findByName(const String& name) {
+  for (int i = 0; i < PROFILE_COUNT; i++) {
+    if (name == PROFILE_NAMES[i]) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void LatencyProfiler::formatMicros(char* out, size_t size, uint32_t micros) {
+  if (micros < 1000) {
+    snprintf(out, size, "%u us", (unsigned)micros);
+  } else if (micros < 1000000) {
+    snprintf(out, size, "%.1f ms", micros / 1000.0);
+  } else {
+    snprintf(out, size, "%.2f s", micros / 1000000.0);
+  }
+}
+
+void LatencyProfiler::printStats() {
+  Serial.println("\n=== LATENCY ===");
+  Serial.println("Scope          Count       p50       p99       Max    Budget  Overruns");
+  
+  for (int i = 0; i < PROFILE_COUNT; i++) {
+    ProfileId id = (ProfileId)i;
+    char p50[12], p99[12], worst[12], budget[12];
+    formatMicros(p50, sizeof(p50), getPercentile(id, 50));
+    formatMicros(p99, sizeof(p99), getPercentile(id, 99));
+    formatMicros(worst, sizeof(worst), getMax(id));
+    formatMicros(budget, sizeof(budget), getBudget(id));
+  
+    Serial.printf("%-10s %9lu %9s %9s %9s %9s %9lu\n", PROFILE_NAMES[i], (unsigned long)getCount(id),
+                  p50, p99, worst, budget, (unsigned long)getOverruns(id));
+  }
+  Serial.println("p50/p99 are bucket upper edges (1-2-5 series)");
+  Serial.println("===============\n");
+}
@@ -0,0 +1,81 @@
+#ifndef LATENCY_PROFILER_H
+#define LATENCY_PROFILER_H
+
+#include <Arduino.h>
+#include "esp_timer.h"
+
+#define LATENCY_BUCKETS 20
+
+// Hot-path scopes that are timed
+enum ProfileId {
+  PROFILE_SCHEDULE_PASS,  // One full pass of the schedule task
+  PROFILE_DISPENSE,       // updateDispenseStateMachine()
+  PROFILE_TIME,           // timeManager.update()
+  PROFILE_FIREBASE,       // firebase.updateNonBlocking()
+  PROFILE_GSM,            // sim800.update()
+  PROFILE_SERVO,          // servoController.update()
+  PROFILE_LCD,            // One screen frame written to the LCD
+  PROFILE_COUNT
+};
+
+struct LatencyHistogram {
+  uint32_t buckets[LATENCY_BUCKETS];
+  uint32_t count;
+  uint32_t maxMicros;
+  uint32_t overruns;       // Samples over budgetMicros
+  uint32_t budgetMicros;
+};
+
+/**
+ * LatencyProfiler
+ *
+ * Fixed-bucket latency histograms for the hot paths. Buckets follow a
+ * 1-2-5 series from 10 us to 10 s, so recording a sample is a short scan
+ * and a few increments - cheap enough to leave on in production. p50 and
+ * p99 are read back as the upper edge of the bucket they fall in.
+ *
+ * Every scope has a time budget; samples over it are counted as overruns
+ * so a slow subsystem shows up even when its percentiles look fine.
+ */
+class LatencyProfiler {
+private:
+  static portMUX_TYPE profileMux;
+  LatencyHistogram histograms[PROFILE_COUNT];
+  
+  static uint8_t bucketFor(uint32_t micros);
+  static void formatMicros(char* out, size_t size, uint32_t micros);
+  
+public:
+  LatencyProfiler();
+  
+  void record(ProfileId id, uint32_t micros);
+  void setBudget(ProfileId id, uint32_t micros);
+  void reset();
+  
+  uint32_t getPercentile(ProfileId id, uint8_t percent);  // Upper bucket edge, capped at max
+  uint32_t getMax(ProfileId id);
+  uint32_t getOverruns(ProfileId id);
+  uint32_t getCount(ProfileId id);
+  uint32_t getBudget(ProfileId id);
+  
+  static const char* getName(ProfileId id);
+  static int findByName(const String& name);  // -1 if unknown
+  void printStats();
+};
+
+// Times the enclosing scope, e.g. { ProfileTimer timer(profiler, PROFILE_GSM); sim800.update(); }
+class ProfileTimer {
+private:
+  LatencyProfiler& profiler;
+  ProfileId id;
+  int64_t started;
+  
+public:
+  ProfileTimer(LatencyProfiler& latencyProfiler, ProfileId profileId)
+    : profiler(latencyProfiler), id(profileId), started(esp_timer_get_time()) {}
+  ~ProfileTimer() {
+    profiler.record(id, (uint32_t)(esp_timer_get_time() - started));
+  }
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef LOG_EVENTS_H
+#define LOG_EVENTS_H
+
+// Shared by the firmware (EventLog) and the host decoder (source/esp32/LogDecoder).
+// Plain C++ only - no Arduino headers here.
+//
+// Add new entries at the END of each list so ids already in the field keep
+// their meaning. Formats take up to three %d arguments and never reach the
+// firmware image; the device only stores ids and integer arguments.
+
+#include <stdint.h>
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#define LOG_MODULE_LIST(X) \
+  X(LOG_MOD_SYSTEM,   "system")   \
+  X(LOG_MOD_SCHEDULE, "schedule") \
+  X(LOG_MOD_DISPENSE, "dispense") \
+  X(LOG_MOD_LOG,      "log")
+
+// X(id, format)
+#define LOG_EVENT_LIST(X) \
+  X(EV_LOG_DROPPED,          "ring overflow, %d record(s) lost") \
+  X(EV_CLOCK_TICK,           "TimeLib %06d, %d alarm(s) registered") \
+  X(EV_SCHEDULE_SUMMARY,     "%d of %d schedule(s) active, %d alarm(s) registered") \
+  X(EV_SERVO_QUEUE_FULL,     "servo queue full, action %d dropped") \
+  X(EV_GSM_QUEUE_FULL,       "GSM queue full, action %d dropped") \
+  X(EV_CLOUD_QUEUE_FULL,     "cloud queue full, report for container %d dropped") \
+  X(EV_ALARM_FIRED,          "alarm fired for schedule %d at TimeLib %04d") \
+  X(EV_SCHEDULE_BAD_INDEX,   "alarm for invalid schedule index %d") \
+  X(EV_DOSE_DISABLED,        "schedule %d disabled, not dispensing") \
+  X(EV_DOSE_NOT_TODAY,       "schedule %d not due today") \
+  X(EV_DOSE_ALREADY_HANDLED, "schedule %d already handled (clock stepped back)") \
+  X(EV_DOSE_SKIPPED,         "schedule %d skipped by caregiver request") \
+  X(EV_DOSE_DUE,             "schedule %d due: container %d, %04d") \
+  X(EV_NO_DISPENSE_CALLBACK, "schedule %d fired but no event bus is set") \
+  X(EV_ALARM_CREATED,        "schedule %d armed for %04d, %d min from now") \
+  X(EV_ALARM_ALLOC_FAILED,   "schedule %d: TimeAlarms has no free slot") \
+  X(EV_SCHEDULE_UPDATED,     "schedule %d updated: %04d, container %d") \
+  X(EV_SCHEDULE_DISABLED,    "schedule %d added disabled, no alarm") \
+  X(EV_SCHEDULE_COUNT,       "%d schedule(s) loaded") \
+  X(EV_DISPENSE_SCHEDULED,   "scheduled dispense, container %d") \
+  X(EV_DISPENSE_BUSY,        "dispense already in progress, container %d not started") \
+  X(EV_DISPENSE_START,       "dispense started, container %d (scheduled %d)") \
+  X(EV_SERVO_COMMAND_SENT,   "DP%d sent to the Uno") \
+  X(EV_DISPENSE_DONE,        "container %d dispensed, %d pill(s) since boot") \
+  X(EV_DISPENSE_FAILED,      "container %d failed - Uno did not confirm") \
+  X(EV_REMINDER,             "15-minute reminder, container %d") \
+  X(EV_MISSED_DOSE,          "missed dose, container %d, due %04d") \
+  X(EV_MEMORY_LOW,           "largest free block trend %d B below floor %d B, min free heap %d B") \
+  X(EV_MEMORY_RESTART,       "restarting for fragmentation, block trend %d B, floor %d B") \
+  X(EV_MEMORY_RESTARTED,     "back from low-memory restart %d, block trend was %d B") \
+  X(EV_STACK_LOW,            "task %d stack high-water mark down to %d B") \
+  X(EV_BOOT_DONE,            "boot finished after %d ms, doses armed at %d ms")
+
+#define LOG_ENUM_ENTRY(id, text) id,
+
+enum LogModule : uint8_t {
+  LOG_MODULE_LIST(LOG_ENUM_ENTRY)
+  LOG_MODULE_COUNT
+};
+
+enum LogEvent : uint16_t {
+  LOG_EVENT_LIST(LOG_ENUM_ENTRY)
+  LOG_EVENT_COUNT
+};
+
+#define LOG_RECORD_ARGS 3
+#define LOG_FRAME_SYNC1 0xA5
+#define LOG_FRAME_SYNC2 0x5A
+
+// Wire and ring format, little endian: 20 bytes
+struct LogRecord {
+  uint32_t timestamp;              // millis()
+  uint8_t level;
+  uint8_t module;
+  uint16_t event;
+  int32_t args[LOG_RECORD_ARGS];
+};
+
+// On the UART a record is framed as SYNC1 SYNC2 <record> <sum of record bytes>
+#define LOG_FRAME_SIZE (2 + sizeof(LogRecord) + 1)
+
+#endif
@@ -0,0 +1,275 @@
+#include "MemoryMonitor.h"
+#include "EventLog.h"
+#include "esp_attr.h"
+
+#define RESTART_MAGIC 0x4D454D52  // "MEMR"
+
+// Survives the controlled restart, lost on power-off
+struct RestartRecord {
+  uint32_t magic;
+  uint32_t restarts;
+  uint32_t trendBytes;    // Largest-block trend that caused the last one
+  uint32_t check;
+};
+RTC_NOINIT_ATTR static RestartRecord restartRecord;
+
+static bool restartRecordValid() {
+  return restartRecord.magic == RESTART_MAGIC &&
+         restartRecord.check == (restartRecord.restarts ^ restartRecord.trendBytes ^ RESTART_MAGIC);
+}
+
+portMUX_TYPE MemoryMonitor::memoryMux = portMUX_INITIALIZER_UNLOCKED;
+
+MemoryMonitor::MemoryMonitor() {
+  taskMonitor = nullptr;
+  memset(&last, 0, sizeof(last));
+  memset(hours, 0, sizeof(hours));
+  memset(trend, 0, sizeof(trend));
+  memset(stackWarned, 0, sizeof(stackWarned));
+  currentHour = 0;
+  hourStart = 0;
+  lastSample = 0;
+  sampleCount = 0;
+  trendCount = 0;
+  trendPos = 0;
+  blockFloor = MEMORY_DEFAULT_BLOCK_FLOOR;
+  alarmRaised = false;
+  restartPending = false;
+  onLowMemory = nullptr;
+  isQuiet = nullptr;
+}
+
+void MemoryMonitor::begin(TaskMonitor* tasks) {
+  taskMonitor = tasks;
+  
+  if (restartRecordValid()) {
+    LOG_WARN(LOG_MOD_SYSTEM, EV_MEMORY_RESTARTED, restartRecord.restarts, restartRecord.trendBytes);
+    Serial.printf("MemoryMonitor: ⚠️ Restarted for low memory (%lu time(s) since power-on)\n",
+                  (unsigned long)restartRecord.restarts);
+  } else {
+    restartRecord.magic = RESTART_MAGIC;
+    restartRecord.restarts = 0;
+    restartRecord.trendBytes = 0;
+    restartRecord.check = RESTART_MAGIC;
+  }
+  
+  startHour(0);
+  hourStart = millis();
+  sample();
+  Serial.printf("MemoryMonitor: Free heap %lu, largest block %lu, floor %lu bytes\n",
+                (unsigned long)last.freeHeap, (unsigned long)last.largestBlock, (unsigned long)blockFloor);
+}
+
+void MemoryMonitor::update() {
+  unsigned long now = millis();
+  
+  if (now - lastSample >= MEMORY_SAMPLE_INTERVAL) {
+    sample();
+  }
+  
+  if (restartPending && (isQuiet == nullptr || isQuiet())) {
+    restartNow();
+  }
+}
+
+void MemoryMonitor::startHour(uint8_t index) {
+  MemoryHour& hour = hours[index];
+  hour.valid = false;
+  hour.minFree = UINT32_MAX;
+  hour.maxFree = 0;
+  hour.minLargest = UINT32_MAX;
+  hour.maxLargest = 0;
+  for (int i = 0; i < TASK_MONITOR_MAX; i++) {
+    hour.minStack[i] = UINT16_MAX;
+  }
+}
+
+void MemoryMonitor::sample() {
+  MemorySample now;
+  now.freeHeap = ESP.getFreeHeap();
+  now.largestBlock = ESP.getMaxAllocHeap();
+  now.minFreeHeap = ESP.getMinFreeHeap();
+  now.takenAt = millis();
+  lastSample = now.takenAt;
+  
+  // Stack watermarks are read outside the lock - they query the scheduler
+  uint16_t stackFree[TASK_MONITOR_MAX];
+  uint8_t taskCount = taskMonitor != nullptr ? taskMonitor->getTaskCount() : 0;
+  for (uint8_t i = 0; i < taskCount; i++) {
+    stackFree[i] = (uint16_t)min(taskMonitor->getStackFree(i), (uint32_t)UINT16_MAX);
+  }
+  
+  portENTER_CRITICAL(&memoryMux);
+  last = now;
+  sampleCount++;
+  
+  if (now.takenAt - hourStart >= 3600000UL) {
+    hourStart += 3600000UL;
+    currentHour = (currentHour + 1) % MEMORY_HISTORY_HOURS;
+    startHour(currentHour);
+  }
+  MemoryHour& hour = hours[currentHour];
+  hour.valid = true;
+  hour.minFree = min(hour.minFree, now.freeHeap);
+  hour.maxFree = max(hour.maxFree, now.freeHeap);
+  hour.minLargest = min(hour.minLargest, now.largestBlock);
+  hour.maxLargest = max(hour.maxLargest, now.largestBlock);
+  for (uint8_t i = 0; i < taskCount; i++) {
+    hour.minStack[i] = min(hour.minStack[i], stackFree[i]);
+  }
+  
+  trend[trendPos] = now.largestBlock;
+  trendPos = (trendPos + 1) % MEMORY_TREND_SAMPLES;
+  if (trendCount < MEMORY_TREND_SAMPLES) {
+    trendCount++;
+  }
+  portEXIT_CRITICAL(&memoryMux);
+  
+  for (uint8_t i = 0; i < taskCount; i++) {
+    if (stackFree[i] > 0 && stackFree[i] < TASK_STACK_WARNING && !stackWarned[i]) {
+      stackWarned[i] = true;
+      LOG_WARN(LOG_MOD_SYSTEM, EV_STACK_LOW, i, stackFree[i]);
+    }
+  }
+  
+  // Judge the trend only once the window is full, so boot does not count
+  uint32_t average = getLargestBlockTrend();
+  if (!alarmRaised && trendCount == MEMORY_TREND_SAMPLES && average < blockFloor) {
+    alarmRaised = true;
+    restartPending = true;
+    LOG_ERROR(LOG_MOD_SYSTEM, EV_MEMORY_LOW, average, blockFloor, now.minFreeHeap);
+    if (onLowMemory != nullptr) {
+      onLowMemory(average, blockFloor);
+    }
+  }
+}
+
+void MemoryMonitor::restartNow() {
+  uint32_t average = getLargestBlockTrend();
+  restartRecord.magic = RESTART_MAGIC;
+  restartRecord.restarts++;
+  restartRecord.trendBytes = average;
+  restartRecord.check = restartRecord.restarts ^ restartRecord.trendBytes ^ RESTART_MAGIC;
+  
+  LOG_ERROR(LOG_MOD_SYSTEM, EV_MEMORY_RESTART, average, blockFloor);
+  while (eventLog.drain() > 0) {
+  }
+  Serial.println("MemoryMonitor: 🔄 Heap fragmented - restarting while the dispenser is idle");
+  Serial.flush();
+  delay(100);
+  ESP.restart();
+}
+
+void MemoryMonitor::setBlockFloor(uint32_t bytes) {
+  blockFloor = bytes;
+  // A new floor gets a fresh judgement; a restart already pending stays pending
+  alarmRaised = restartPending;
+}
+
+uint32_t MemoryMonitor::getBlockFloor() {
+  return blockFloor;
+}
+
+void MemoryMonitor::setLowMemoryCallback(void (*callback)(uint32_t trendBytes, uint32_t floorBytes)) {
+  onLowMemory = callback;
+}
+
+void MemoryMonitor::setQuietCheck(bool (*check)()) {
+  isQuiet = check;
+}
+
+MemorySample MemoryMonitor::getLastSample() {
+  portENTER_CRITICAL(&memoryMux);
+  MemorySample copy = last;
+  portEXIT_CRITICAL(&memoryMux);
+  return copy;
+}
+
+uint32_t MemoryMonitor::getLargestBlockTrend() {
+  portENTER_CRITICAL(&memoryMux);
+  uint64_t sum = 0;
+  for (uint8_t i = 0; i < trendCount; i++) {
+    sum += trend[i];
+  }
+  uint8_t count = trendCount;
+  portEXIT_CRITICAL(&memoryMux);
+  return count > 0 ? (uint32_t)(sum / count) : 0;
+}
+
+void MemoryMonitor::get24HourRange(uint32_t& minFree, uint32_t& maxFree, uint32_t& minLargest, uint32_t& maxLargest) {
+  minFree = UINT32_MAX;
+  maxFree = 0;
+  minLargest = UINT32_MAX;
+  maxLargest = 0;
+  
+  portENTER_CRITICAL(&memoryMux);
+  for (int i = 0; i < MEMORY_HISTORY_HOURS; i++) {
+    const MemoryHour& hour = hours[i];
+    if (!hour.valid) continue;
+    minFree = min(minFree, hour.minFree);
+    maxFree = max(maxFree, hour.maxFree);
+    minLargest = min(minLargest, hour.minLargest);
+    maxLargest = max(maxLargest, hour.maxLargest);
+  }
+  portEXIT_CRITICAL(&memoryMux);
+  
+  if (minFree == UINT32_MAX) minFree = 0;
+  if (minLargest == UINT32_MAX) minLargest = 0;
+}
+
+bool MemoryMonitor::isRestartPending() {
+  return restartPending;
+}
+
+uint32_t MemoryMonitor::getLowMemoryRestarts() {
+  return restartRecordValid() ? restartRecord.restarts : 0;
+}
+
+void MemoryMonitor::printStatus() {
+  MemorySample now = getLastSample();
+  uint32_t minFree, maxFree, minLargest, maxLargest;
+  get24HourRange(minFree, maxFree, minLargest, maxLargest);
+  uint32_t average = getLargestBlockTrend();
+  
+  portENTER_CRITICAL(&memoryMux);
+  MemoryHour window = hours[currentHour];
+  for (int i = 0; i < MEMORY_HISTORY_HOURS; i++) {
+    if (!hours[i].valid) continue;
+    for (int t = 0; t < TASK_MONITOR_MAX; t++) {
+      window.minStack[t] = min(window.minStack[t], hours[i].minStack[t]);
+    }
+  }
+  unsigned long samples = sampleCount;
+  portEXIT_CRITICAL(&memoryMux);
+  
+  Serial.println("\n=== MEMORY ===");
+  Serial.printf("Free heap:      %7lu bytes (24 h: %lu - %lu)\n",
+                (unsigned long)now.freeHeap, (unsigned long)minFree, (unsigned long)maxFree);
+  Serial.printf("Largest block:  %7lu bytes (24 h: %lu - %lu)\n",
+                (unsigned long)now.largestBlock, (unsigned long)minLargest, (unsigned long)maxLargest);
+  Serial.printf("Min free ever:  %7lu bytes\n", (unsigned long)now.minFreeHeap);
+  if (now.freeHeap > 0) {
+    Serial.printf("Fragmentation:  %6.1f%% (1 - largest / free)\n",
+                  100.0 * (1.0 - (double)now.largestBlock / now.freeHeap));
+  }
+  Serial.printf("Block trend:    %7lu bytes over %u sample(s), floor %lu\n",
+                (unsigned long)average, (unsigned)min((unsigned long)MEMORY_TREND_SAMPLES, samples),
+                (unsigned long)blockFloor);
+  
+  uint8_t taskCount = taskMonitor != nullptr ? taskMonitor->getTaskCount() : 0;
+  if (taskCount > 0) {
+    Serial.println("Stack free, lowest in 24 h:");
+    for (uint8_t i = 0; i < taskCount; i++) {
+      uint16_t lowest = window.minStack[i];
+      Serial.printf("  %-10s %5u bytes%s\n", taskMonitor->getTaskName(i),
+                    lowest == UINT16_MAX ? 0 : (unsigned)lowest,
+                    lowest < TASK_STACK_WARNING ? "  ⚠️ low" : "");
+    }
+  }
+  
+  Serial.printf("Low-memory restarts since power-on: %lu\n", (unsigned long)getLowMemoryRestarts());
+  if (restartPending) {
+    Serial.println("⚠️ Restart pending - waiting for a quiet moment");
+  }
+  Serial.println("==============\n");
+}
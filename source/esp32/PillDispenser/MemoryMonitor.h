@@ -0,0 +1,93 @@
+#ifndef MEMORY_MONITOR_H
+#define MEMORY_MONITOR_H
+
+#include <Arduino.h>
+#include "TaskMonitor.h"
+
+#define MEMORY_SAMPLE_INTERVAL 10000UL   // ms between samples
+#define MEMORY_HISTORY_HOURS 24          // Rolling window, one min/max bucket per hour
+#define MEMORY_TREND_SAMPLES 30          // Largest-block samples averaged for the trend (5 minutes)
+#define MEMORY_DEFAULT_BLOCK_FLOOR 24576 // A TLS session needs ~16 KB + 4 KB contiguous, plus margin
+
+struct MemorySample {
+  uint32_t freeHeap;
+  uint32_t largestBlock;    // Biggest single allocation that would succeed
+  uint32_t minFreeHeap;     // Lowest free heap since boot (from the allocator)
+  unsigned long takenAt;
+};
+
+struct MemoryHour {
+  bool valid;
+  uint32_t minFree;
+  uint32_t maxFree;
+  uint32_t minLargest;
+  uint32_t maxLargest;
+  uint16_t minStack[TASK_MONITOR_MAX];  // Bytes, per TaskMonitor id
+};
+
+/**
+ * MemoryMonitor
+ *
+ * Samples free heap, the largest free block, the allocator's minimum-ever
+ * free heap and every monitored task's stack high-water mark at a fixed
+ * rate, and keeps min/max per hour for the last 24 hours in RAM.
+ *
+ * Free heap alone hides fragmentation: a unit can have 60 KB free and still
+ * fail a TLS handshake because no 16 KB piece is left. The largest block is
+ * averaged over MEMORY_TREND_SAMPLES so one busy moment does not count;
+ * when that trend falls below the floor the low-memory callback runs once
+ * (the sketch sends a system error SMS) and a restart is scheduled. The
+ * restart waits until the quiet check passes - nothing dispensing, no alert
+ * in progress, no dose due soon - so it never lands on a dose.
+ *
+ * update() is called from one low-priority task; the getters may be called
+ * from any task.
+ */
+class MemoryMonitor {
+private:
+  static portMUX_TYPE memoryMux;
+  TaskMonitor* taskMonitor;
+  
+  MemorySample last;
+  MemoryHour hours[MEMORY_HISTORY_HOURS];
+  uint8_t currentHour;
+  unsigned long hourStart;
+  unsigned long lastSample;
+  unsigned long sampleCount;
+  
+  uint32_t trend[MEMORY_TREND_SAMPLES];
+  uint8_t trendCount;
+  uint8_t trendPos;
+  
+  uint32_t blockFloor;
+  bool alarmRaised;
+  bool restartPending;
+  bool stackWarned[TASK_MONITOR_MAX];
+  
+  void (*onLowMemory)(uint32_t trendBytes, uint32_t floorBytes);
+  bool (*isQuiet)();
+  
+  void sample();
+  void startHour(uint8_t index);
+  void restartNow();
+  
+public:
+  MemoryMonitor();
+  void begin(TaskMonitor* tasks);
+  void update();  // Call regularly from one task
+  
+  void setBlockFloor(uint32_t bytes);
+  uint32_t getBlockFloor();
+  void setLowMemoryCallback(void (*callback)(uint32_t trendBytes, uint32_t floorBytes));
+  void setQuietCheck(bool (*check)());
+  
+  MemorySample getLastSample();
+  uint32_t getLargestBlockTrend();
+  void get24HourRange(uint32_t& minFree, uint32_t& maxFree, uint32_t& minLargest, uint32_t& maxLargest);
+  bool isRestartPending();
+  uint32_t getLowMemoryRestarts();  // Since power-on
+  
+  void printStatus();
+};
+
+#endif
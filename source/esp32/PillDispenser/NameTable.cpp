@@ -0,0 +1,67 @@
+#include "NameTable.h"
+
+NameTable nameTable;
+
+NameTable::NameTable() {
+  memset(names, 0, sizeof(names));
+  memset(used, 0, sizeof(used));
+  used[NAME_NONE] = true;
+  usedCount = 1;
+}
+
+NameId NameTable::find(const char* text) {
+  if (text == nullptr || text[0] == '\0') {
+    return NAME_NONE;
+  }
+  for (uint8_t id = 1; id < NAME_TABLE_SIZE; id++) {
+    if (used[id] && strncmp(names[id], text, NAME_MAX_LENGTH - 1) == 0) {
+      return id;
+    }
+  }
+  return NAME_NONE;
+}
+
+NameId NameTable::intern(const char* text) {
+  NameId existing = find(text);
+  if (existing != NAME_NONE || text == nullptr || text[0] == '\0') {
+    return existing;
+  }
+  
+  for (uint8_t id = 1; id < NAME_TABLE_SIZE; id++) {
+    if (!used[id]) {
+      strncpy(names[id], text, NAME_MAX_LENGTH - 1);
+      names[id][NAME_MAX_LENGTH - 1] = '\0';
+      used[id] = true;
+      usedCount++;
+      return id;
+    }
+  }
+  
+  Serial.println("NameTable: ❌ Table full - name not stored: " + String(text));
+  return NAME_NONE;
+}
+
+const char* NameTable::get(NameId id) {
+  if (id >= NAME_TABLE_SIZE || !used[id]) {
+    return "";
+  }
+  return names[id];
+}
+
+void NameTable::retainOnly(const bool* keep) {
+  for (uint8_t id = 1; id < NAME_TABLE_SIZE; id++) {
+    if (used[id] && !keep[id]) {
+      used[id] = false;
+      names[id][0] = '\0';
+      usedCount--;
+    }
+  }
+}
+
+uint8_t NameTable::getUsedCount() {
+  return usedCount;
+}
+
+bool NameTable::isFull() {
+  return usedCount >= NAME_TABLE_SIZE;
+}
@@ -0,0 +1,43 @@
+#ifndef NAME_TABLE_H
+#define NAME_TABLE_H
+
+#include <Arduino.h>
+
+#define NAME_TABLE_SIZE 48
+#define NAME_MAX_LENGTH 32   // Including the terminator; longer names are truncated
+#define NAME_NONE 0          // Id 0 is always the empty string
+
+typedef uint8_t NameId;
+
+/**
+ * NameTable
+ *
+ * Interned medication and patient names. Each distinct name is stored once
+ * in a fixed slot and referred to by a one-byte id, so events and queued
+ * work can carry names without copying Strings. Ids stay valid until the
+ * slot is reclaimed by retainOnly(), which ScheduleManager calls only when
+ * the table is full.
+ *
+ * intern() and retainOnly() run under the schedule lock; get() may be called
+ * from any task.
+ */
+class NameTable {
+private:
+  char names[NAME_TABLE_SIZE][NAME_MAX_LENGTH];
+  bool used[NAME_TABLE_SIZE];
+  uint8_t usedCount;
+  
+public:
+  NameTable();
+  
+  NameId intern(const char* text);   // NAME_NONE if empty or the table is full
+  NameId find(const char* text);     // NAME_NONE if not interned
+  const char* get(NameId id);        // "" for NAME_NONE or a free slot
+  void retainOnly(const bool* keep); // Frees every slot whose keep[id] is false
+  uint8_t getUsedCount();
+  bool isFull();
+};
+
+extern NameTable nameTable;
+
+#endif
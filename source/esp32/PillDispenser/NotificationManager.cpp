@@ -13,6 +13,17 @@ NotificationManager::NotificationManager(SIM800L* sim800Module, TimeManager* tim
   sendOnLowBattery = true;
   lastNotificationTime = 0;
   
+  emergencyNumber = "";
+  message[0] = '\0';
+  escalationReason[0] = '\0';
+  escalationState = ESCALATION_IDLE;
+  escalationSteps = 0;
+  escalationStep = 0;
+  escalationStateStart = 0;
+  callConnectedAt = 0;
+  ackTimeout = DEFAULT_ACK_TIMEOUT;
+  ringTimeout = DEFAULT_RING_TIMEOUT;
+  
   // Initialize phone numbers
   for (int i = 0; i < MAX_PHONE_NUMBERS; i++) {
     phoneNumbers[i].number = "";
@@ -27,6 +38,10 @@ void NotificationManager::begin() {
 }
 
 bool NotificationManager::addPhoneNumber(String number, String name) {
+  if (number.length() == 0) {
+    return false;
+  }
+  
   if (phoneCount >= MAX_PHONE_NUMBERS) {
     Serial.println("NotificationManager: Max phone numbers reached");
     return false;
@@ -106,117 +121,131 @@ bool NotificationManager::canSendNow() {
   return (millis() - lastNotificationTime >= NOTIFICATION_COOLDOWN);
 }
 
-String NotificationManager::formatBeforeDispenseMessage(String patientName, String medicationName, String time) {
-  String message = "PILL REMINDER\n";
-  message += "Patient: " + patientName + "\n";
-  message += "Medication: " + medicationName + "\n";
-  message += "Scheduled: " + time + "\n";
-  message += "Time remaining: 30 minutes\n";
-  message += "Please be ready to take your medication.";
+const char* NotificationManager::formatBeforeDispenseMessage(const char* patientName, const char* medicationName, const char* time) {
+  snprintf(message, sizeof(message),
+           "PILL REMINDER\n"
+           "Patient: %s\n"
+           "Medication: %s\n"
+           "Scheduled: %s\n"
+           "Time remaining: 30 minutes\n"
+           "Please be ready to take your medication.",
+           patientName, medicationName, time);
   return message;
 }
 
-String NotificationManager::formatDispenseMessage(String patientName, String medicationName, String time) {
-  String message = "MEDICATION DISPENSED\n";
-  message += "Patient: " + patientName + "\n";
-  message += "Medication: " + medicationName + "\n";
-  message += "Time: " + time + "\n";
-  message += "Please take your medication now.";
+const char* NotificationManager::formatDispenseMessage(const char* patientName, const char* medicationName, const char* time) {
+  snprintf(message, sizeof(message),
+           "MEDICATION DISPENSED\n"
+           "Patient: %s\n"
+           "Medication: %s\n"
+           "Time: %s\n"
+           "Please take your medication now.",
+           patientName, medicationName, time);
   return message;
 }
 
-String NotificationManager::formatPillTakenMessage(String patientName, String medicationName, String time) {
-  String message = "MEDICATION CONFIRMED\n";
-  message += "Patient: " + patientName + "\n";
-  message += "Medication: " + medicationName + "\n";
-  message += "Taken at: " + time + "\n";
-  message += "Thank you for taking your medication on time.";
+const char* NotificationManager::formatPillTakenMessage(const char* patientName, const char* medicationName, const char* time) {
+  snprintf(message, sizeof(message),
+           "MEDICATION CONFIRMED\n"
+           "Patient: %s\n"
+           "Medication: %s\n"
+           "Taken at: %s\n"
+           "Thank you for taking your medication on time.",
+           patientName, medicationName, time);
   return message;
 }
 
-String NotificationManager::formatMissedDoseMessage(String patientName, String medicationName, String scheduledTime) {
-  String message = "MISSED DOSE ALERT\n";
-  message += "Patient: " + patientName + "\n";
-  message += "Medication: " + medicationName + "\n";
-  message += "Scheduled: " + scheduledTime + "\n";
-  message += "Status: NOT TAKEN\n";
-  message += "Please contact patient immediately.";
+const char* NotificationManager::formatMissedDoseMessage(const char* patientName, const char* medicationName, const char* scheduledTime) {
+  snprintf(message, sizeof(message),
+           "MISSED DOSE ALERT\n"
+           "Patient: %s\n"
+           "Medication: %s\n"
+           "Scheduled: %s\n"
+           "Status: NOT TAKEN\n"
+           "Please contact patient immediately.\n"
+           "Reply ACK to stop escalation calls.",
+           patientName, medicationName, scheduledTime);
   return message;
 }
 
-String NotificationManager::formatLowBatteryMessage(float batteryPercent) {
-  String message = "LOW BATTERY WARNING\n";
-  message += "Battery Level: " + String(batteryPercent, 1) + "%\n";
-  message += "System Time: " + timeManager->getDateTimeString() + "\n";
-  message += "Please charge the dispenser soon to avoid interruption.";
+const char* NotificationManager::formatLowBatteryMessage(float batteryPercent, float hoursRemaining) {
+  int length = snprintf(message, sizeof(message), "LOW BATTERY WARNING\nBattery Level: %.1f%%\n", batteryPercent);
+  if (hoursRemaining >= 0 && length < (int)sizeof(message)) {
+    length += snprintf(message + length, sizeof(message) - length, "Estimated Runtime: %.1f hours\n", hoursRemaining);
+  }
+  if (length < (int)sizeof(message)) {
+    snprintf(message + length, sizeof(message) - length,
+             "System Time: %s\n"
+             "Please charge the dispenser soon to avoid interruption.",
+             timeManager->getSnapshot().dateTime);
+  }
   return message;
 }
 
-String NotificationManager::formatSystemErrorMessage(String errorDescription) {
-  String message = "SYSTEM ERROR\n";
-  message += "Error: " + errorDescription + "\n";
-  message += "Time: " + timeManager->getDateTimeString() + "\n";
-  message += "Please check the dispenser system.";
+const char* NotificationManager::formatSystemErrorMessage(const char* errorDescription) {
+  snprintf(message, sizeof(message),
+           "SYSTEM ERROR\n"
+           "Error: %s\n"
+           "Time: %s\n"
+           "Please check the dispenser system.",
+           errorDescription, timeManager->getSnapshot().dateTime);
   return message;
 }
 
-bool NotificationManager::notifyBeforeDispense(String patientName, String medicationName, String scheduleTime) {
+bool NotificationManager::notifyBeforeDispense(const char* patientName, const char* medicationName, const char* scheduleTime) {
   if (!notificationsEnabled || !sendBeforeDispense) {
     return false;
   }
   
-  String message = formatBeforeDispenseMessage(patientName, medicationName, scheduleTime);
-  return sendSMSToAll(message);
+  return sendSMSToAll(formatBeforeDispenseMessage(patientName, medicationName, scheduleTime));
 }
 
-bool NotificationManager::notifyOnDispense(String patientName, String medicationName) {
+bool NotificationManager::notifyOnDispense(const char* patientName, const char* medicationName) {
   if (!notificationsEnabled || !sendOnDispense) {
     return false;
   }
   
-  String currentTime = timeManager->getDateTimeString();
-  String message = formatDispenseMessage(patientName, medicationName, currentTime);
-  return sendSMSToAll(message);
+  return sendSMSToAll(formatDispenseMessage(patientName, medicationName, timeManager->getSnapshot().dateTime));
 }
 
-bool NotificationManager::notifyPillTaken(String patientName, String medicationName) {
+bool NotificationManager::notifyPillTaken(const char* patientName, const char* medicationName) {
   if (!notificationsEnabled || !sendOnPillTaken) {
     return false;
   }
   
-  String currentTime = timeManager->getDateTimeString();
-  String message = formatPillTakenMessage(patientName, medicationName, currentTime);
-  return sendSMSToAll(message);
+  return sendSMSToAll(formatPillTakenMessage(patientName, medicationName, timeManager->getSnapshot().dateTime));
 }
 
-bool NotificationManager::notifyMissedDose(String patientName, String medicationName, String scheduledTime) {
+bool NotificationManager::notifyMissedDose(const char* patientName, const char* medicationName, const char* scheduledTime) {
   if (!notificationsEnabled || !sendOnMissedDose) {
     return false;
   }
   
-  String message = formatMissedDoseMessage(patientName, medicationName, scheduledTime);
-  return sendSMSToAll(message);
+  return startEscalation(formatMissedDoseMessage(patientName, medicationName, scheduledTime));
 }
 
-bool NotificationManager::notifyLowBattery(float batteryPercent) {
+bool NotificationManager::notifyLowBattery(float batteryPercent, float hoursRemaining) {
   if (!notificationsEnabled || !sendOnLowBattery) {
     return false;
   }
   
-  String message = formatLowBatteryMessage(batteryPercent);
-  return sendSMSToAll(message);
+  return sendSMSToAll(formatLowBatteryMessage(batteryPercent, hoursRemaining));
 }
 
-bool NotificationManager::notifySystemError(String errorDescription) {
+bool NotificationManager::notifySystemError(const char* errorDescription) {
   if (!notificationsEnabled) {
     return false;
   }
   
-  String message = formatSystemErrorMessage(errorDescription);
-  return sendSMSToAll(message);
+  // System errors bypass the SMS cooldown - one may precede a restart
+  if (!isReady()) {
+    Serial.println("NotificationManager: Cannot send SMS - not ready");
+    return false;
+  }
+  return deliverSMSToAll(formatSystemErrorMessage(errorDescription));
 }
 
-bool NotificationManager::sendSMSToAll(String message) {
+bool NotificationManager::sendSMSToAll(const char* text) {
   if (!isReady()) {
     Serial.println("NotificationManager: Cannot send SMS - not ready");
     return false;
@@ -227,6 +256,10 @@ bool NotificationManager::sendSMSToAll(String message) {
     return false;
   }
   
+  return deliverSMSToAll(text);
+}
+
+bool NotificationManager::deliverSMSToAll(const char* text) {
   bool allSuccess = true;
   int sentCount = 0;
   
@@ -234,14 +267,14 @@ bool NotificationManager::sendSMSToAll(String message) {
   Serial.println("📱 SENDING SMS NOTIFICATIONS");
   Serial.println(String('=', 50));
   Serial.println("Message:");
-  Serial.println(message);
+  Serial.println(text);
   Serial.println(String('-', 50));
   
   for (int i = 0; i < phoneCount; i++) {
     if (phoneNumbers[i].enabled) {
       Serial.print("Sending to " + phoneNumbers[i].name + " (" + phoneNumbers[i].number + ")... ");
       
-      if (sim800->sendSMS(phoneNumbers[i].number, message)) {
+      if (sim800->sendSMS(phoneNumbers[i].number, text)) {
         Serial.println("✅ Sent");
         sentCount++;
       } else {
@@ -261,6 +294,176 @@ bool NotificationManager::sendSMSToAll(String message) {
   return allSuccess;
 }
 
+void NotificationManager::setEmergencyNumber(String number) {
+  emergencyNumber = number;
+}
+
+void NotificationManager::setEscalationTiming(unsigned long ackMinutes, unsigned long ringSeconds) {
+  ackTimeout = ackMinutes * 60000UL;
+  ringTimeout = ringSeconds * 1000UL;
+  Serial.println("NotificationManager: Escalation ACK timeout " + String(ackMinutes) + 
+                 " min, ring timeout " + String(ringSeconds) + " s");
+}
+
+void NotificationManager::buildEscalationLadder() {
+  escalationSteps = 0;
+  for (int i = 0; i < phoneCount && escalationSteps < MAX_ESCALATION_STEPS; i++) {
+    if (phoneNumbers[i].enabled) {
+      escalationLadder[escalationSteps++] = phoneNumbers[i].number;
+    }
+  }
+  // Emergency contact is the last rung, even if it is also a caregiver
+  if (emergencyNumber.length() > 0 && escalationSteps < MAX_ESCALATION_STEPS) {
+    escalationLadder[escalationSteps++] = emergencyNumber;
+  }
+}
+
+bool NotificationManager::startEscalation(const char* text) {
+  if (!notificationsEnabled) {
+    return false;
+  }
+  
+  if (escalationState != ESCALATION_IDLE) {
+    // One ladder at a time - the active one already has caregivers' attention
+    Serial.println("NotificationManager: Escalation already active, not restarting");
+    return false;
+  }
+  
+  if (!isReady()) {
+    Serial.println("NotificationManager: Cannot escalate - not ready");
+    return false;
+  }
+  
+  buildEscalationLadder();
+  strncpy(escalationReason, text, sizeof(escalationReason) - 1);
+  escalationReason[sizeof(escalationReason) - 1] = '\0';
+  escalationStep = 0;
+  
+  Serial.println("🚨 NotificationManager: Starting escalation (" + String(escalationSteps) + " call step(s))");
+  
+  // Missed doses bypass the SMS cooldown
+  deliverSMSToAll(escalationReason);
+  lastNotificationTime = millis();
+  
+  escalationState = ESCALATION_WAIT_ACK;
+  escalationStateStart = millis();
+  return true;
+}
+
+bool NotificationManager::acknowledge(String source) {
+  if (escalationState == ESCALATION_IDLE) {
+    return false;
+  }
+  
+  if (escalationState == ESCALATION_CALLING) {
+    sim800->hangupCall();
+  }
+  
+  finishEscalation("acknowledged by " + source);
+  return true;
+}
+
+bool NotificationManager::isEscalating() {
+  return escalationState != ESCALATION_IDLE;
+}
+
+String NotificationManager::getEscalationStatus() {
+  switch (escalationState) {
+    case ESCALATION_WAIT_ACK: {
+      unsigned long waited = millis() - escalationStateStart;
+      unsigned long remaining = waited < ackTimeout ? (ackTimeout - waited) / 1000 : 0;
+      return "Waiting for ACK (" + String(remaining) + "s until calls)";
+    }
+    case ESCALATION_CALLING:
+      return "Calling " + escalationLadder[escalationStep] + 
+             " (step " + String(escalationStep + 1) + "/" + String(escalationSteps) + ")";
+    case ESCALATION_BETWEEN_CALLS:
+      return "Next call: step " + String(escalationStep + 2) + "/" + String(escalationSteps);
+    default:
+      return "Idle";
+  }
+}
+
+void NotificationManager::callNextContact() {
+  if (escalationStep >= escalationSteps) {
+    finishEscalation("no one answered - ladder exhausted");
+    return;
+  }
+  
+  String number = escalationLadder[escalationStep];
+  Serial.println("📞 NotificationManager: Escalation call " + String(escalationStep + 1) + 
+                 "/" + String(escalationSteps) + " to " + number);
+  
+  escalationState = ESCALATION_CALLING;
+  escalationStateStart = millis();
+  callConnectedAt = 0;
+  
+  if (!sim800->makeCall(number)) {
+    // Failed dials fall through to the next contact via the CALL_ENDED path
+    Serial.println("❌ NotificationManager: Dial failed");
+  }
+}
+
+void NotificationManager::finishEscalation(String outcome) {
+  Serial.println("✅ NotificationManager: Escalation finished - " + outcome);
+  escalationState = ESCALATION_IDLE;
+  escalationReason[0] = '\0';
+  escalationStep = 0;
+}
+
+void NotificationManager::update() {
+  unsigned long now = millis();
+  
+  switch (escalationState) {
+    case ESCALATION_IDLE:
+      break;
+      
+    case ESCALATION_WAIT_ACK:
+      if (now - escalationStateStart >= ackTimeout) {
+        Serial.println("⏰ NotificationManager: No acknowledgement - escalating to voice calls");
+        escalationStep = 0;
+        callNextContact();
+      }
+      break;
+      
+    case ESCALATION_CALLING: {
+      CallState state = sim800->getCallState();
+      
+      if (state == CALL_CONNECTED) {
+        // Keep the call open briefly so the caregiver hears it connect, then hang up
+        if (callConnectedAt == 0) {
+          callConnectedAt = now;
+        } else if (now - callConnectedAt >= CALL_HOLD_TIME) {
+          sim800->hangupCall();
+          finishEscalation("call answered by " + escalationLadder[escalationStep]);
+        }
+      } else if (state == CALL_ENDED || state == CALL_IDLE) {
+        if (sim800->getCallResult() == CALL_RESULT_ANSWERED) {
+          finishEscalation("call answered by " + escalationLadder[escalationStep]);
+        } else {
+          Serial.println("NotificationManager: Call to " + escalationLadder[escalationStep] + 
+                         " - " + SIM800L::getCallResultName(sim800->getCallResult()));
+          escalationState = ESCALATION_BETWEEN_CALLS;
+          escalationStateStart = now;
+        }
+      } else if (now - escalationStateStart >= ringTimeout) {
+        Serial.println("NotificationManager: Ring timeout, hanging up");
+        sim800->hangupCall();
+        escalationState = ESCALATION_BETWEEN_CALLS;
+        escalationStateStart = now;
+      }
+      break;
+    }
+      
+    case ESCALATION_BETWEEN_CALLS:
+      if (now - escalationStateStart >= CALL_GAP) {
+        escalationStep++;
+        callNextContact();
+      }
+      break;
+  }
+}
+
 void NotificationManager::printConfig() {
   Serial.println("\n" + String('=', 50));
   Serial.println("📱 NOTIFICATION CONFIGURATION");
@@ -280,5 +483,9 @@ void NotificationManager::printConfig() {
   Serial.println("  Pill Taken: " + String(sendOnPillTaken ? "ON" : "OFF"));
   Serial.println("  Missed Dose: " + String(sendOnMissedDose ? "ON" : "OFF"));
   Serial.println("  Low Battery: " + String(sendOnLowBattery ? "ON" : "OFF"));
+  Serial.println("\nEscalation:");
+  Serial.println("  Emergency contact: " + (emergencyNumber.length() > 0 ? emergencyNumber : String("(none)")));
+  Serial.println("  ACK timeout: " + String(ackTimeout / 60000) + " min, ring timeout: " + String(ringTimeout / 1000) + " s");
+  Serial.println("  Status: " + getEscalationStatus());
   Serial.println(String('=', 50) + "\n");
 }
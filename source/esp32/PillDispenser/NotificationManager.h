@@ -6,6 +6,8 @@
 #include "TimeManager.h"
 
 #define MAX_PHONE_NUMBERS 3
+#define MAX_ESCALATION_STEPS (MAX_PHONE_NUMBERS + 1)  // Caregivers, then the emergency contact
+#define NOTIFY_MESSAGE_MAX 320  // Two concatenated SMS parts
 
 enum NotificationType {
   NOTIFY_BEFORE_DISPENSE,   // 30 minutes before
@@ -16,6 +18,15 @@ enum NotificationType {
   NOTIFY_SYSTEM_ERROR        // System errors
 };
 
+// Missed-dose escalation ladder:
+// SMS to all caregivers -> wait for ACK -> call caregiver 1 -> caregiver 2 -> emergency contact
+enum EscalationState {
+  ESCALATION_IDLE,
+  ESCALATION_WAIT_ACK,      // SMS sent, waiting for a reply or dispense
+  ESCALATION_CALLING,       // Voice call in progress
+  ESCALATION_BETWEEN_CALLS  // Short pause before dialing the next contact
+};
+
 struct PhoneNumber {
   String number;
   String name;
@@ -39,13 +50,35 @@ private:
   unsigned long lastNotificationTime;
   static const unsigned long NOTIFICATION_COOLDOWN = 30000;  // 30 seconds between SMS
   
-  // Formatting helpers
-  String formatDispenseMessage(String patientName, String medicationName, String time);
-  String formatBeforeDispenseMessage(String patientName, String medicationName, String time);
-  String formatPillTakenMessage(String patientName, String medicationName, String time);
-  String formatMissedDoseMessage(String patientName, String medicationName, String scheduledTime);
-  String formatLowBatteryMessage(float batteryPercent);
-  String formatSystemErrorMessage(String errorDescription);
+  // Escalation state machine
+  String emergencyNumber;
+  EscalationState escalationState;
+  char escalationReason[NOTIFY_MESSAGE_MAX];
+  String escalationLadder[MAX_ESCALATION_STEPS];
+  int escalationSteps;
+  int escalationStep;
+  unsigned long escalationStateStart;
+  unsigned long callConnectedAt;
+  unsigned long ackTimeout;
+  unsigned long ringTimeout;
+  static const unsigned long DEFAULT_ACK_TIMEOUT = 10UL * 60000;  // 10 minutes to reply before calls start
+  static const unsigned long DEFAULT_RING_TIMEOUT = 45000;        // Give up on a call after 45 seconds
+  static const unsigned long CALL_HOLD_TIME = 15000;              // Keep an answered call open 15 seconds
+  static const unsigned long CALL_GAP = 10000;                    // Pause between calls
+  
+  void buildEscalationLadder();
+  void callNextContact();
+  void finishEscalation(String outcome);
+  bool deliverSMSToAll(const char* message);
+  
+  // Formatting helpers - write into message, which is reused for every SMS
+  char message[NOTIFY_MESSAGE_MAX];
+  const char* formatDispenseMessage(const char* patientName, const char* medicationName, const char* time);
+  const char* formatBeforeDispenseMessage(const char* patientName, const char* medicationName, const char* time);
+  const char* formatPillTakenMessage(const char* patientName, const char* medicationName, const char* time);
+  const char* formatMissedDoseMessage(const char* patientName, const char* medicationName, const char* scheduledTime);
+  const char* formatLowBatteryMessage(float batteryPercent, float hoursRemaining);
+  const char* formatSystemErrorMessage(const char* errorDescription);
   
 public:
   NotificationManager(SIM800L* sim800Module, TimeManager* timeMgr);
@@ -66,16 +99,25 @@ public:
   void setOnLowBatteryEnabled(bool enabled);
   
   // Send notifications
-  bool notifyBeforeDispense(String patientName, String medicationName, String scheduleTime);
-  bool notifyOnDispense(String patientName, String medicationName);
-  bool notifyPillTaken(String patientName, String medicationName);
-  bool notifyMissedDose(String patientName, String medicationName, String scheduledTime);
-  bool notifyLowBattery(float batteryPercent);
-  bool notifySystemError(String errorDescription);
+  bool notifyBeforeDispense(const char* patientName, const char* medicationName, const char* scheduleTime);
+  bool notifyOnDispense(const char* patientName, const char* medicationName);
+  bool notifyPillTaken(const char* patientName, const char* medicationName);
+  bool notifyMissedDose(const char* patientName, const char* medicationName, const char* scheduledTime);
+  bool notifyLowBattery(float batteryPercent, float hoursRemaining = -1);
+  bool notifySystemError(const char* errorDescription);
+  
+  // Missed-dose escalation - call update() from loop()
+  void setEmergencyNumber(String number);
+  void setEscalationTiming(unsigned long ackMinutes, unsigned long ringSeconds);
+  bool startEscalation(const char* text);
+  bool acknowledge(String source);
+  bool isEscalating();
+  String getEscalationStatus();
+  void update();
   
   // Generic send function
-  bool sendNotification(NotificationType type, String message);
-  bool sendSMSToAll(String message);
+  bool sendNotification(NotificationType type, const char* text);
+  bool sendSMSToAll(const char* text);
   
   // Utilities
   bool isReady();
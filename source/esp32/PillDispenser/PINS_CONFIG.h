@@ -12,6 +12,7 @@
 #define PIN_SIM800_RX 16
 #define PIN_SIM800_TX 17
 #define PIN_SIM800_RST 4
+#define PIN_SIM800_RI 32   // Ring indicator, low on call or SMS - wakes from light sleep
 
 // ===== VOLTAGE SENSOR PIN =====
 #define PIN_VOLTAGE_SENSOR 34  // ADC1_CH5 - Supports analog reading
@@ -10,11 +10,24 @@
 #include "FirebaseConfig.h"
 #include "ArduinoServoController.h"  // Servo control via Arduino Uno serial communication
 #include "LCDDisplay.h"  // Reactivated LCDDisplay
+#include "ScreenManager.h"
 #include "TimeManager.h"
 #include "FirebaseManager.h"
 #include "ScheduleManager.h"
 #include "SIM800L.h"
+#include "SMSCommandHandler.h"
+#include "NotificationManager.h"
 #include "VoltageSensor.h"
+#include "BatteryEstimator.h"
+#include "BuzzerManager.h"
+#include "TaskMonitor.h"
+#include "MemoryMonitor.h"
+#include "LatencyProfiler.h"
+#include "EventLog.h"
+#include "CommandShell.h"
+#include "BootPipeline.h"
+#include "PowerManager.h"
+#include "EventBus.h"
 #include "Wifi_Config.h"
 #include "UserConfig.h"
 
@@ -25,11 +38,23 @@
 // ===== COMPONENT INSTANCES =====
 ArduinoServoController servoController(PIN_UNO_RX, PIN_UNO_TX);  // Serial communication with Arduino Uno
 LCDDisplay lcd;  // Reactivate LCDDisplay instance
+ScreenManager screens;  // Owns the LCD once started
 TimeManager timeManager;
 FirebaseManager firebase;
 ScheduleManager scheduleManager;
 SIM800L sim800(PIN_SIM800_RX, PIN_SIM800_TX, PIN_SIM800_RST, Serial2);
+SMSCommandHandler smsCommands(&sim800);
+NotificationManager notifications(&sim800, &timeManager);
 VoltageSensor voltageSensor(PIN_VOLTAGE_SENSOR);
+BatteryEstimator battery(&voltageSensor, &servoController, &sim800);
+BuzzerManager buzzer(PIN_BUZZER);
+TaskMonitor taskMonitor;
+MemoryMonitor memoryMonitor;  // Heap, largest block and stack history ("memory")
+LatencyProfiler profiler;  // Hot-path latency histograms ("stats")
+CommandShell shell;        // Serial console
+EventBus eventBus;         // Dose events from ScheduleManager to the subscribers below
+BootPipeline boot;         // Staged start-up and its timing report ("boot")
+PowerManager powerManager; // Light sleep between doses ("power")
 
 // ===== SYSTEM VARIABLES =====
 bool systemInitialized = false;
@@ -38,20 +63,128 @@ unsigned long lastHeartbeat = 0;
 unsigned long lastLcdUpdate = 0;  // Reactivate LCD time update
 unsigned long lastTimeDebug = 0;   // For debug time output
 int pillCount = 0;
+bool dosesCaughtUp = false;     // Boot catch-up already ran (from the cache or after the cloud sync)
+unsigned long dosesArmedAt = 0; // millis() when the schedule task took over armed alarms, 0 if not at boot
 
 // ===== DISPENSE STATE MACHINE =====
 enum DispenseState {
   IDLE,
   DISPENSING,
+  SERVO_WAIT,
   COMPLETE
 };
 
+// Owned by the schedule task; other tasks use requestDispense() / isDispenseBusy()
 DispenseState currentDispenseState = IDLE;
 int currentDispenserId = -1;
 bool isScheduledDispense = false;
-String scheduleMedication = "";
-String schedulePatient = "";
-String schedulePillSize = "";
+BusEvent currentDose;  // The dose being dispensed, when isScheduledDispense
+
+// ===== TASKS =====
+// Each subsystem is driven by exactly one task. Other tasks reach it through
+// that task's queue, and completion is signalled on the system event group.
+//   schedule - TimeAlarms, TimeManager, ScheduleManager, dispense state machine
+//   servo    - Arduino Uno serial link
+//   network  - Firebase streams, web commands, heartbeat and reports
+//   gsm      - SIM800L, SMS commands, caregiver notifications and calls
+//   ui       - screen fields, battery estimate, serial console
+//   log      - drains the event log ring to the UART, samples memory
+// The screen render task (ScreenManager) sits beside them on core 0.
+#define SCHEDULE_TASK_PRIORITY 5
+#define SERVO_TASK_PRIORITY 4
+#define NETWORK_TASK_PRIORITY 3
+#define GSM_TASK_PRIORITY 2
+#define UI_TASK_PRIORITY 1
+#define LOG_TASK_PRIORITY 1
+
+#define SCHEDULE_TASK_CORE 1    // Dose timing and the servo link away from the WiFi stack
+#define SERVO_TASK_CORE 1
+#define NETWORK_TASK_CORE 0
+#define GSM_TASK_CORE 0
+#define UI_TASK_CORE 1
+#define LOG_TASK_CORE 0
+
+#define SCHEDULE_TASK_STACK 6144
+#define SERVO_TASK_STACK 4096
+#define NETWORK_TASK_STACK 8192  // Firebase client and JSON parsing
+#define GSM_TASK_STACK 6144
+#define UI_TASK_STACK 6144
+#define LOG_TASK_STACK 3072
+
+#define SCHEDULE_TASK_PERIOD 20  // ms between alarm checks
+#define SERVO_TASK_PERIOD 50     // ms between Uno message checks when idle
+#define NETWORK_TASK_PERIOD 20
+#define GSM_TASK_PERIOD 50
+#define UI_TASK_PERIOD 20
+#define LOG_TASK_PERIOD 50     // ms between ring drains
+
+#define DISPENSE_QUEUE_LENGTH 2
+#define SERVO_QUEUE_LENGTH 4
+#define GSM_QUEUE_LENGTH 6
+#define CLOUD_QUEUE_LENGTH 6
+
+// System event group bits
+#define EVT_SYSTEM_READY (1 << 0)   // setup() finished, tasks may run
+#define EVT_DISPENSE_BUSY (1 << 1)  // Dispense sequence in progress
+#define EVT_SERVO_DONE (1 << 2)     // Uno finished the dispense sequence
+#define EVT_SERVO_FAILED (1 << 3)   // Uno did not confirm the dispense
+#define EVT_DOSES_READY (1 << 4)    // Alarms armed and the Uno link up - schedule and servo tasks may run
+
+// Work for the servo task
+enum ServoAction {
+  SERVO_DISPENSE,
+  SERVO_STATUS,
+  SERVO_TEST,
+  SERVO_ANGLE,      // Single servo to an angle (console sweep job)
+  SERVO_RESET,
+  SERVO_RELEASE,
+  SERVO_HOME,
+  SERVO_STOP,
+  SERVO_CALIBRATE
+};
+
+struct ServoRequest {
+  ServoAction action;
+  uint8_t channel;
+  uint8_t angle;     // SERVO_ANGLE only
+};
+
+// Work for the GSM task
+enum GsmAction {
+  GSM_NOTIFY_CAREGIVERS,  // SMS text to both caregivers
+  GSM_MISSED_DOSE,        // Start missed-dose escalation
+  GSM_LOW_BATTERY,
+  GSM_SYSTEM_ERROR,       // SMS a system error, text = description
+  GSM_ACKNOWLEDGE,        // Stop escalation, text = who acknowledged
+  GSM_SCAN_SMS            // Woken by the modem - read SMS that arrived during light sleep
+};
+
+struct GsmRequest {
+  GsmAction action;
+  float percent;
+  float hoursLeft;
+  char text[200];
+  char patient[32];
+  char medication[32];
+  char time[12];
+};
+
+// Work for the network task - one pill report, optionally updating the dispenser
+struct CloudReport {
+  int container;          // 1-based
+  bool updateDispenser;
+  int status;
+  char dateTime[20];      // When it happened, not when it was sent
+  char description[96];
+};
+
+QueueHandle_t dispenseQueue;   // int, 0-based dispenser id
+QueueHandle_t servoQueue;
+QueueHandle_t gsmQueue;
+QueueHandle_t cloudQueue;
+EventGroupHandle_t systemEvents;
+SemaphoreHandle_t scheduleLock;  // Alarm table, schedules and the TimeLib clock
+SemaphoreHandle_t modemLock;     // SIM800L, shared with the GPRS cloud fallback
 
 // WiFi credentials (for development - move to secure storage in production)
 const String WIFI_SSID = "jayron";
@@ -65,17 +198,68 @@ const String WIFI_PASSWORD = "12345678";
 void initializeDevelopmentMode();
 void setupWiFi(const char* ssid, const char* password, TimeManager* timeManager);
 void testFirebaseConnection();
-void handleScheduledDispense(int dispenserId, String pillSize, String medication, String patient);
+void subscribeDoseEvents();
+void onDoseDue(const BusEvent& event);
 void dispenseFromContainer(int dispenserId);
 void checkDispenseCommands();
+void checkSMSCommands();
 void updateDispenseStateMachine();
-void startDispense(int dispenserId, bool scheduled = false, String medication = "", String patient = "", String pillSize = "");
+void startDispense(int dispenserId, const BusEvent* dose = nullptr);
+bool requestDispense(int dispenserId);
+bool isDispenseBusy();
+String getNextDoseTime();
+
+// Boot stages, run by the BootPipeline in initializeDevelopmentMode()
+bool bootDisplay();
+bool bootServos();
+bool bootModem();
+bool bootPower();
+bool bootClock();
+bool bootCachedSchedules();
+bool bootDoseTasks();
+bool bootWiFi();
+bool bootFirebase();
+bool bootCloudSchedules();
+
+// Tasks and their queues
+void createTaskResources();
+void startTasks();
+void releaseTasks();
+void scheduleTask(void* param);
+void servoTask(void* param);
+void networkTask(void* param);
+void gsmTask(void* param);
+void uiTask(void* param);
+void logTask(void* param);
+bool queueServoRequest(ServoAction action, uint8_t channel = 0, uint8_t angle = 0);
+void runServoRequest(const ServoRequest& request);
+void queueGsmRequest(const GsmRequest& request);
+void runGsmRequest(const GsmRequest& request);
+void queueCloudReport(int container, bool updateDispenser, const char* description, int status);
+void sendCloudReport(const CloudReport& report);
+void registerShellCommands();
+void printDebugStatus();
+void printBootReport();
 
 // Notification helpers
 void playDispenseBuzzer();
 void playReminderBuzzer();
-void sendSMSNotification(String message);
-void handleReminderNotification(int dispenserId, String pillSize, String medication, String patient);
+void sendSMSNotification(const char* message);
+void queueSMSNotification(const char* format, ...) __attribute__((format(printf, 1, 2)));
+void queueMissedDoseNotification(const char* patient, const char* medication, const char* scheduledTime);
+void queueAcknowledge(const char* source);
+void onReminderAlert(const BusEvent& event);
+void onReminderNotify(const BusEvent& event);
+void onMissedDoseAlert(const BusEvent& event);
+void onMissedDoseNotify(const BusEvent& event);
+void onMissedDoseReport(const BusEvent& event);
+void handleLowBattery(float percent, float hoursLeft);
+void handleLowMemory(uint32_t trendBytes, uint32_t floorBytes);
+bool isQuietForRestart();
+bool isQuietForSleep();
+unsigned long msUntilRequiredWake();
+void onPowerWake(PowerWakeSource source);
+void onAlarmTiming(long lateMs);
 
 void setup() {
   // Initialize buzzer first to prevent noise (BEFORE Serial.begin)
@@ -83,12 +267,18 @@ void setup() {
   digitalWrite(PIN_BUZZER, LOW);
   
   Serial.begin(115200);
-  delay(2000);
+  
+  // Hand the buzzer pin to LEDC - all beeps are asynchronous from here
+  buzzer.begin();
   
   Serial.println("\n" + String('=', 50));
   Serial.println("    PILL DISPENSER V3 - STARTING UP");
   Serial.println(String('=', 50));
   
+  // Queues and locks first - boot-time callbacks already post to them
+  createTaskResources();
+  registerShellCommands();
+  
   // Initialize status LED
   pinMode(PIN_STATUS_LED, OUTPUT);
   digitalWrite(PIN_STATUS_LED, LOW);
@@ -97,9 +287,6 @@ void setup() {
   Wire.begin(PIN_SDA, PIN_SCL);
   Serial.println("I2C initialized");
 
-  // Small delay to ensure ESP32 is fully ready after I2C init
-  delay(100);
-
   if (DEVELOPMENT_MODE) {
     Serial.println("\n🔧 DEVELOPMENT MODE ENABLED 🔧");
     initializeDevelopmentMode();
@@ -113,37 +300,150 @@ void setup() {
   digitalWrite(PIN_STATUS_LED, HIGH);
   
   // Sound buzzer to indicate system ready
-  digitalWrite(PIN_BUZZER, HIGH);
-  delay(500);
-  digitalWrite(PIN_BUZZER, LOW);
+  buzzer.play(BUZZER_READY);
+  
+  if (systemInitialized) {
+    releaseTasks();
+  }
 }
 
 void loop() {
-  // CRITICAL: Process TimeAlarms first with minimal delay
-  // This ensures alarm callbacks are triggered at the right time
-  // DO NOT add any blocking operations before this!
-  Alarm.delay(1);
+  // Everything runs in the tasks started by startTasks() - the Arduino
+  // loop task is not needed and its stack is returned to the heap
+  vTaskDelete(NULL);
+}
+
+void createTaskResources() {
+  dispenseQueue = xQueueCreate(DISPENSE_QUEUE_LENGTH, sizeof(int));
+  servoQueue = xQueueCreate(SERVO_QUEUE_LENGTH, sizeof(ServoRequest));
+  gsmQueue = xQueueCreate(GSM_QUEUE_LENGTH, sizeof(GsmRequest));
+  cloudQueue = xQueueCreate(CLOUD_QUEUE_LENGTH, sizeof(CloudReport));
+  systemEvents = xEventGroupCreate();
+  scheduleLock = xSemaphoreCreateMutex();
+  modemLock = xSemaphoreCreateMutex();
   
-  if (DEVELOPMENT_MODE) {
-    // CRITICAL: Update dispense state machine first (non-blocking)
-    updateDispenseStateMachine();
+  if (!dispenseQueue || !servoQueue || !gsmQueue || !cloudQueue || !systemEvents || !scheduleLock || !modemLock) {
+    Serial.println("❌ Out of memory creating task queues - restarting");
+    delay(1000);
+    ESP.restart();
+  }
+}
+
+// Created before the boot stages run; each waits for its event group bit
+void startTasks() {
+  Serial.println("\n🧵 Starting tasks...");
+  taskMonitor.start("schedule", scheduleTask, SCHEDULE_TASK_STACK, SCHEDULE_TASK_PRIORITY, SCHEDULE_TASK_CORE);
+  taskMonitor.start("servo", servoTask, SERVO_TASK_STACK, SERVO_TASK_PRIORITY, SERVO_TASK_CORE);
+  taskMonitor.start("network", networkTask, NETWORK_TASK_STACK, NETWORK_TASK_PRIORITY, NETWORK_TASK_CORE);
+  taskMonitor.start("gsm", gsmTask, GSM_TASK_STACK, GSM_TASK_PRIORITY, GSM_TASK_CORE);
+  taskMonitor.start("ui", uiTask, UI_TASK_STACK, UI_TASK_PRIORITY, UI_TASK_CORE);
+  taskMonitor.start("log", logTask, LOG_TASK_STACK, LOG_TASK_PRIORITY, LOG_TASK_CORE);
+}
+
+// After the last boot stage - schedule and servo were released earlier by bootDoseTasks()
+void releaseTasks() {
+  if (screens.isRunning()) {
+    taskMonitor.add("screen", screens.getTaskHandle(), SCREEN_TASK_STACK, SCREEN_TASK_PRIORITY, SCREEN_TASK_CORE);
+  }
+  
+  // Sampled from the log task, so set up before the tasks are released
+  memoryMonitor.setBlockFloor(MEMORY_BLOCK_FLOOR_BYTES);
+  memoryMonitor.setLowMemoryCallback(handleLowMemory);
+  memoryMonitor.setQuietCheck(isQuietForRestart);
+  memoryMonitor.begin(&taskMonitor);
+  
+  // Light sleep, entered from the log task once everything else is idle
+  powerManager.setQuietCheck(isQuietForSleep);
+  powerManager.setNextWakeCallback(msUntilRequiredWake);
+  powerManager.setWakeCallback(onPowerWake);
+  powerManager.begin(PIN_UNO_RX, PIN_SIM800_RI, POWER_LIGHT_SLEEP);
+  battery.setPowerManager(&powerManager);
+  
+  // Release the rest together
+  xEventGroupSetBits(systemEvents, EVT_SYSTEM_READY);
+}
+
+// ===== TASK BODIES =====
+
+// Dose timing - the only task that services TimeAlarms or runs the dispense state machine
+void scheduleTask(void* param) {
+  int id = TaskMonitor::idFromParam(param);
+  xEventGroupWaitBits(systemEvents, EVT_DOSES_READY, pdFALSE, pdTRUE, portMAX_DELAY);
+  TickType_t lastWake = xTaskGetTickCount();
+  
+  for (;;) {
+    taskMonitor.beginCycle(id);
     
-    // Use non-blocking Firebase update instead of direct Firebase.ready()
-    // This prevents Firebase streams from blocking TimeAlarms
-    firebase.updateNonBlocking();
+    // Alarm callbacks, clock discipline and clock-step catch-up all touch
+    // the alarm table, which Firebase schedule syncs rebuild from their task.
+    // The dispense state machine is under the same lock because the console
+    // "test" command fires alarm callbacks from the UI task.
+    // Alarm.delay(0) services the alarms once (it spins to the next millisecond).
+    {
+      ProfileTimer pass(profiler, PROFILE_SCHEDULE_PASS);
+      xSemaphoreTake(scheduleLock, portMAX_DELAY);
+      Alarm.delay(0);
+      {
+        ProfileTimer timer(profiler, PROFILE_TIME);
+        timeManager.update();
+      }
+      scheduleManager.update();
+      eventBus.dispatch();  // Subscribers run here, off the alarm callback's stack
+      updateDispenseStateMachine();
+      xSemaphoreGive(scheduleLock);
+    }
     
-    // Update time manager (auto-sync every 6 hours)
-    timeManager.update();
+    taskMonitor.endCycle(id);
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SCHEDULE_TASK_PERIOD));
+  }
+}
+
+// Arduino Uno link - dispense sequences and servo console commands
+void servoTask(void* param) {
+  int id = TaskMonitor::idFromParam(param);
+  xEventGroupWaitBits(systemEvents, EVT_DOSES_READY, pdFALSE, pdTRUE, portMAX_DELAY);
+  ServoRequest request;
+  
+  for (;;) {
+    bool received = xQueueReceive(servoQueue, &request, pdMS_TO_TICKS(SERVO_TASK_PERIOD)) == pdTRUE;
+    taskMonitor.beginCycle(id);
     
-    // Update schedule manager (checks alarms - but TimeAlarms already processed above)
-    scheduleManager.update();
+    if (received) {
+      runServoRequest(request);
+    }
     
-    // Update SIM800L for background network reconnection
-    sim800.update();
+    // Update servo controller to process async messages
+    {
+      ProfileTimer timer(profiler, PROFILE_SERVO);
+      servoController.update();
+    }
     
-    // Check for realtime dispense commands from web app (only if idle)
-    if (currentDispenseState == IDLE) {
-      checkDispenseCommands();
+    taskMonitor.endCycle(id);
+  }
+}
+
+// Firebase - may block on TLS and HTTP without delaying anything else
+void networkTask(void* param) {
+  int id = TaskMonitor::idFromParam(param);
+  xEventGroupWaitBits(systemEvents, EVT_SYSTEM_READY, pdFALSE, pdTRUE, portMAX_DELAY);
+  CloudReport report;
+  
+  for (;;) {
+    bool received = xQueueReceive(cloudQueue, &report, pdMS_TO_TICKS(NETWORK_TASK_PERIOD)) == pdTRUE;
+    taskMonitor.beginCycle(id);
+    
+    // Use non-blocking Firebase update instead of direct Firebase.ready()
+    {
+      ProfileTimer timer(profiler, PROFILE_FIREBASE);
+      firebase.updateNonBlocking();
+    }
+    
+    // Realtime dispense commands from the web app
+    checkDispenseCommands();
+    
+    // Dispense and missed-dose reports from the schedule task
+    if (received) {
+      sendCloudReport(report);
     }
     
     // Sync schedules from Firebase periodically (non-blocking check)
@@ -153,234 +453,651 @@ void loop() {
     // }
     
     // Send Firebase heartbeat every 1 minute to indicate device is online
-    firebase.sendHeartbeat(&voltageSensor);
+    firebase.sendHeartbeat(&battery);
     
-    // Update LCD time display continuously (update every second)
-    static unsigned long lastLcdUpdate = 0;
+    taskMonitor.endCycle(id);
+  }
+}
+
+// SIM800L - SMS, calls and escalation; holds the modem for the whole pass
+void gsmTask(void* param) {
+  int id = TaskMonitor::idFromParam(param);
+  xEventGroupWaitBits(systemEvents, EVT_SYSTEM_READY, pdFALSE, pdTRUE, portMAX_DELAY);
+  GsmRequest request;
+  
+  for (;;) {
+    bool received = xQueueReceive(gsmQueue, &request, pdMS_TO_TICKS(GSM_TASK_PERIOD)) == pdTRUE;
+    taskMonitor.beginCycle(id);
+    xSemaphoreTake(modemLock, portMAX_DELAY);
+    
+    if (received) {
+      runGsmRequest(request);
+    }
+    
+    // Update SIM800L for background network reconnection
+    {
+      ProfileTimer timer(profiler, PROFILE_GSM);
+      sim800.update();
+    }
+    
+    // Fetch and authenticate inbound SMS, then run queued caregiver commands
+    smsCommands.update();
+    checkSMSCommands();
+    
+    // Advance missed-dose escalation (ACK wait, voice calls)
+    notifications.update();
+    
+    xSemaphoreGive(modemLock);
+    taskMonitor.endCycle(id);
+  }
+}
+
+// Screen fields, battery estimate and the serial console
+void uiTask(void* param) {
+  int id = TaskMonitor::idFromParam(param);
+  xEventGroupWaitBits(systemEvents, EVT_SYSTEM_READY, pdFALSE, pdTRUE, portMAX_DELAY);
+  unsigned long lastLcdUpdate = 0;
+  
+  for (;;) {
+    taskMonitor.beginCycle(id);
+    
+    // Battery state of charge and runtime forecast
+    battery.update();
+    
+    // Refresh the screen fields every second (the render task does the drawing)
     if (millis() - lastLcdUpdate >= 1000) { // Update every 1 second
-      String currentTimeString = timeManager.getTimeString();
-      lcd.displayTime(currentTimeString);
+      screens.setField(FIELD_TIME, timeManager.getSnapshot().display); // Per-second snapshot, no allocation
+      screens.setField(FIELD_NEXT_DOSE, getNextDoseTime());
+      screens.setField(FIELD_WIFI, WiFi.status() == WL_CONNECTED ? "Connected" : "Down");
       lastLcdUpdate = millis();
     }
     
-    // Update servo controller to process async messages
-    servoController.update();
+    // Serial console - reads without blocking, long commands run as jobs
+    shell.update();
     
-    // Serial command handler for testing
-    if (Serial.available()) {
-      String command = Serial.readStringUntil('\n');
-      command.trim();
-      command.toLowerCase();
-      
-      if (command.startsWith("test ")) {
-        int scheduleIndex = command.substring(5).toInt();
-        Serial.println("Testing schedule trigger for index: " + String(scheduleIndex));
-        scheduleManager.testTriggerSchedule(scheduleIndex);
-      } else if (command == "schedules") {
-        scheduleManager.printSchedules();
-      } else if (command == "time") {
-        Serial.println("Current NTP time: " + timeManager.getTimeString());
-        Serial.printf("TimeAlarms time: %02d:%02d:%02d\n", hour(), minute(), second());
-      } else if (command == "servo status") {
-        Serial.println("\n========== SERVO CONTROLLER STATUS ==========");
-        if (servoController.isConnected()) {
-          Serial.println("✅ Arduino Uno connected and responding");
-        } else {
-          Serial.println("❌ Arduino Uno not responding");
-        }
-        Serial.println("=============================================");
-      } else if (command.startsWith("servo test ")) {
-        int servoNum = command.substring(11).toInt();
-        if (servoNum >= 0 && servoNum <= 15) {
-          Serial.println("Testing servo " + String(servoNum) + "...");
-          servoController.testServo(servoNum);
-          Serial.println("✅ Servo test complete");
-        } else {
-          Serial.println("❌ Invalid servo number (0-4)");
-        }
-      } else if (command == "servo sweep") {
-        Serial.println("Testing all servos with sweep...");
-        for (int i = 0; i <= 4; i++) {
-          Serial.println("Sweeping servo " + String(i) + "...");
-          servoController.setServoAngle(i, 0);
-          delay(500);
-          servoController.setServoAngle(i, 180);
-          delay(500);
-          servoController.setServoAngle(i, 90);
-          delay(500);
-        }
-        Serial.println("✅ Servo sweep complete");
-      } else if (command == "servo reset") {
-        Serial.println("Resetting all servos to 90 degrees...");
-        servoController.resetAllServos();
-        Serial.println("✅ All servos reset");
-      } else if (command == "servo release") {
-        Serial.println("Moving CH5/CH6 servos to release position...");
-        servoController.moveServosToRelease();
-        Serial.println("✅ CH5/CH6 moved to release position");
-      } else if (command == "servo home") {
-        Serial.println("Moving CH5/CH6 servos to home position...");
-        servoController.moveServosToHome();
-        Serial.println("✅ CH5/CH6 moved to home position");
-      } else if (command == "servo stop") {
-        Serial.println("Stopping all servos...");
-        servoController.stopAllServos();
-        Serial.println("✅ All servos stopped");
-      } else if (command.startsWith("dispense ")) {
-        int containerNum = command.substring(9).toInt();
-        if (containerNum >= 1 && containerNum <= 5) {
-          if (currentDispenseState != IDLE) {
-            Serial.println("⚠️ Dispense already in progress");
-          } else {
-            Serial.println("\n" + String('=', 60));
-            Serial.println("👊 MANUAL DISPENSE TRIGGERED (Serial Command)");
-            Serial.println(String('=', 60));
-            Serial.println("Container: " + String(containerNum));
-            Serial.println("Time: " + timeManager.getTimeString());
-            Serial.println(String('=', 60) + "\n");
-            
-            // Start non-blocking dispense (convert to 0-based index)
-            startDispense(containerNum - 1, false, "", "", "");
-          }
-        } else {
-          Serial.println("❌ Invalid container number (1-5)");
-        }
-      } else if (command.startsWith("calibrate ")) {
-        int servoNum = command.substring(10).toInt();
-        if (servoNum >= 0 && servoNum <= 15) {
-          Serial.println("Calibrating servo " + String(servoNum) + "...");
-          servoController.calibrateServo(servoNum);
-          Serial.println("✅ Calibration complete");
-        } else {
-          Serial.println("❌ Invalid servo number (0-4)");
-        }
-      } else if (command == "help") {
-        Serial.println("\n========== AVAILABLE COMMANDS ==========");
-        Serial.println("schedules - List all schedules");
-        Serial.println("time - Show current time");
-        Serial.println("test <index> - Test schedule trigger");
-        Serial.println("servo status - Check servo driver status");
-        Serial.println("servo test <0-4> - Test specific servo");
-        Serial.println("servo sweep - Sweep all servos");
-        Serial.println("servo reset - Reset all servos to 90°");
-        Serial.println("servo release - Move CH5/CH6 to release position");
-        Serial.println("servo home - Move CH5/CH6 to home position");
-        Serial.println("servo stop - Stop all servos");
-        Serial.println("dispense <1-5> - Manual dispense from container");
-        Serial.println("calibrate <0-4> - Calibrate specific servo");
-        Serial.println("help - Show this help message");
-        Serial.println("=========================================");
-      }
+    printDebugStatus();
+    
+    taskMonitor.endCycle(id);
+    vTaskDelay(pdMS_TO_TICKS(UI_TASK_PERIOD));
+  }
+}
+
+// Event log - formatting and UART time happen here, not in the hot paths
+void logTask(void* param) {
+  int id = TaskMonitor::idFromParam(param);
+  xEventGroupWaitBits(systemEvents, EVT_SYSTEM_READY, pdFALSE, pdTRUE, portMAX_DELAY);
+  
+  for (;;) {
+    taskMonitor.beginCycle(id);
+    
+    // Keep draining while a burst is backed up, then sleep
+    while (eventLog.drain() == LOG_DRAIN_BATCH) {
+      taskYIELD();
     }
+    
+    // Samples every MEMORY_SAMPLE_INTERVAL; may restart here once it is quiet
+    memoryMonitor.update();
+  
+    taskMonitor.endCycle(id);
+  
+    // Outside the cycle, so CPU time and cycle maxima do not include the sleep
+    powerManager.update();
+    vTaskDelay(pdMS_TO_TICKS(LOG_TASK_PERIOD));
+  }
+}
+
+// ===== SERIAL CONSOLE =====
+// Command tables are registered with the shell in setup(); "help" is generated from them.
+
+bool cmdHelp(const ShellArgs& args) {
+  shell.printHelp();
+  return true;
+}
+
+bool cmdBatchOn(const ShellArgs& args) {
+  shell.setBatchMode(true);  // The shell acknowledges with #OK
+  return true;
+}
+
+bool cmdBatchOff(const ShellArgs& args) {
+  shell.setBatchMode(false);
+  Serial.println("✅ Batch mode off");
+  return true;
+}
+
+long waitStep(uint16_t step, int milliseconds) {
+  return milliseconds;
+}
+
+bool cmdWait(const ShellArgs& args) {
+  return shell.startJob(waitStep, 1, args.value);
+}
+
+bool cmdAbort(const ShellArgs& args) {
+  // Reaches here only when no job is running - the shell aborts a running one itself
+  shell.abortJob();
+  return true;
+}
+
+bool cmdTasks(const ShellArgs& args) {
+  taskMonitor.printStatus();
+  return true;
+}
+
+bool cmdTasksReset(const ShellArgs& args) {
+  taskMonitor.resetStats();
+  Serial.println("✅ Task statistics reset");
+  return true;
+}
+
+bool cmdStats(const ShellArgs& args) {
+  profiler.printStats();
+  return true;
+}
+
+bool cmdStatsReset(const ShellArgs& args) {
+  profiler.reset();
+  Serial.println("✅ Latency statistics reset");
+  return true;
+}
+
+bool cmdStatsBudget(const ShellArgs& args) {
+  // stats budget <scope> <ms>
+  int space = args.text.indexOf(' ');
+  int scope = LatencyProfiler::findByName(args.text.substring(0, space));
+  float budgetMs = space > 0 ? args.text.substring(space + 1).toFloat() : 0;
+  if (scope < 0 || budgetMs <= 0) {
+    Serial.println("❌ Usage: stats budget <schedule|dispense|time|firebase|gsm|servo|lcd> <ms>");
+    return false;
+  }
+  profiler.setBudget((ProfileId)scope, (uint32_t)(budgetMs * 1000));
+  Serial.println("✅ Budget for " + String(LatencyProfiler::getName((ProfileId)scope)) + " set to " + String(budgetMs, 1) + " ms");
+  return true;
+}
+
+bool cmdMemory(const ShellArgs& args) {
+  memoryMonitor.printStatus();
+  return true;
+}
+
+bool cmdMemoryFloor(const ShellArgs& args) {
+  memoryMonitor.setBlockFloor((uint32_t)args.value * 1024);
+  Serial.printf("✅ Largest-block floor set to %d KB\n", args.value);
+  return true;
+}
+
+void printBootReport() {
+  boot.printReport();
+  if (dosesArmedAt > 0) {
+    Serial.printf("Doses armed %lu ms after power-on\n", dosesArmedAt);
+  } else {
+    Serial.println("No doses armed during boot (no schedules, or no clock until NTP)");
+  }
+  if (timeManager.isTimeProvisional()) {
+    Serial.println("Clock provisional: restored from NVS after a power loss, not confirmed by NTP yet");
+  }
+}
+
+bool cmdBoot(const ShellArgs& args) {
+  printBootReport();
+  return true;
+}
+
+bool cmdBus(const ShellArgs& args) {
+  eventBus.printStatus();
+  return true;
+}
+
+bool cmdLog(const ShellArgs& args) {
+  eventLog.printStatus();
+  return true;
+}
+
+bool cmdLogText(const ShellArgs& args) {
+  eventLog.setBinaryOutput(false);
+  Serial.println("✅ Event log output: text");
+  return true;
+}
+
+bool cmdLogBinary(const ShellArgs& args) {
+  eventLog.setBinaryOutput(true);
+  Serial.println("✅ Event log output: binary frames");
+  return true;
+}
+
+static const ShellCommand systemCommands[] = {
+  {"help", SHELL_ARG_NONE, 0, 0, "", "Show this help message", cmdHelp},
+  {"batch on", SHELL_ARG_NONE, 0, 0, "", "Print #OK/#ERR after every command (for test scripts)", cmdBatchOn},
+  {"batch off", SHELL_ARG_NONE, 0, 0, "", "Back to interactive output", cmdBatchOff},
+  {"wait", SHELL_ARG_INT, 1, 30000, "<ms>", "Pause a ';' sequence", cmdWait},
+  {"abort", SHELL_ARG_NONE, 0, 0, "", "Stop the running job and the rest of its line", cmdAbort},
+  {"tasks", SHELL_ARG_NONE, 0, 0, "", "Task stack high-water marks and CPU time", cmdTasks},
+  {"tasks reset", SHELL_ARG_NONE, 0, 0, "", "Restart the CPU time window", cmdTasksReset},
+  {"memory", SHELL_ARG_NONE, 0, 0, "", "Heap, largest block and stack watermarks, 24 h min/max", cmdMemory},
+  {"memory floor", SHELL_ARG_INT, 4, 96, "<KB>", "Largest-block floor that triggers a restart", cmdMemoryFloor},
+  {"boot", SHELL_ARG_NONE, 0, 0, "", "Boot stage timings and when doses were armed", cmdBoot},
+  {"stats", SHELL_ARG_NONE, 0, 0, "", "Hot-path latency p50/p99/max and budget overruns", cmdStats},
+  {"stats reset", SHELL_ARG_NONE, 0, 0, "", "Clear latency histograms", cmdStatsReset},
+  {"stats budget", SHELL_ARG_TEXT, 0, 0, "<scope> <ms>", "Set a latency budget", cmdStatsBudget},
+  {"bus", SHELL_ARG_NONE, 0, 0, "", "Dose event bus pool, subscribers and interned names", cmdBus},
+  {"log", SHELL_ARG_NONE, 0, 0, "", "Event log ring status and overflow count", cmdLog},
+  {"log text", SHELL_ARG_NONE, 0, 0, "", "Event log as text", cmdLogText},
+  {"log binary", SHELL_ARG_NONE, 0, 0, "", "Event log as binary frames (needs LogDecoder)", cmdLogBinary}
+};
+
+bool cmdSchedules(const ShellArgs& args) {
+  xSemaphoreTake(scheduleLock, portMAX_DELAY);
+  scheduleManager.printSchedules();
+  xSemaphoreGive(scheduleLock);
+  return true;
+}
+
+bool cmdTestSchedule(const ShellArgs& args) {
+  Serial.println("Testing schedule trigger for index: " + String(args.value));
+  xSemaphoreTake(scheduleLock, portMAX_DELAY);
+  scheduleManager.testTriggerSchedule(args.value);
+  xSemaphoreGive(scheduleLock);
+  return true;
+}
+
+bool cmdTime(const ShellArgs& args) {
+  Serial.println("Current NTP time: " + timeManager.getTimeString() + " " + timeManager.getZoneName() +
+                 (timeManager.isDST() ? " (DST)" : ""));
+  Serial.println("Time zone: " + timeManager.getTimezone());
+  Serial.printf("TimeAlarms time: %02d:%02d:%02d\n", hour(), minute(), second());
+  return true;
+}
+
+bool cmdTimeBench(const ShellArgs& args) {
+  timeManager.benchmarkFormatting();
+  return true;
+}
+
+static const ShellCommand scheduleCommands[] = {
+  {"schedules", SHELL_ARG_NONE, 0, 0, "", "List all schedules", cmdSchedules},
+  {"test", SHELL_ARG_INT, 0, MAX_SCHEDULES - 1, "<index>", "Test schedule trigger", cmdTestSchedule},
+  {"time", SHELL_ARG_NONE, 0, 0, "", "Show current time", cmdTime},
+  {"time bench", SHELL_ARG_NONE, 0, 0, "", "Compare snapshot vs strftime time formatting", cmdTimeBench}
+};
+
+bool cmdServoStatus(const ShellArgs& args) {
+  return queueServoRequest(SERVO_STATUS);
+}
+
+bool cmdServoTest(const ShellArgs& args) {
+  return queueServoRequest(SERVO_TEST, args.value);
+}
+
+// 0° / 180° / 90° on each dispenser servo, half a second apart
+long servoSweepStep(uint16_t step, int unused) {
+  static const uint8_t SWEEP_ANGLES[] = {0, 180, 90};
+  if (!queueServoRequest(SERVO_ANGLE, step / 3, SWEEP_ANGLES[step % 3])) {
+    return -1;
+  }
+  return 500;
+}
+
+bool cmdServoSweep(const ShellArgs& args) {
+  Serial.println("Testing all servos with sweep (abort to stop)...");
+  return shell.startJob(servoSweepStep, 5 * 3);
+}
+
+bool cmdServoReset(const ShellArgs& args) {
+  return queueServoRequest(SERVO_RESET);
+}
+
+bool cmdServoRelease(const ShellArgs& args) {
+  return queueServoRequest(SERVO_RELEASE);
+}
+
+bool cmdServoHome(const ShellArgs& args) {
+  return queueServoRequest(SERVO_HOME);
+}
+
+bool cmdServoStop(const ShellArgs& args) {
+  return queueServoRequest(SERVO_STOP);
+}
+
+bool cmdCalibrate(const ShellArgs& args) {
+  return queueServoRequest(SERVO_CALIBRATE, args.value);
+}
+
+bool cmdDispense(const ShellArgs& args) {
+  if (isDispenseBusy()) {
+    Serial.println("⚠️ Dispense already in progress");
+    return false;
   }
   
-  // Debug: Print current time EVERY SECOND to monitor alarm triggering
+  Serial.println("\n" + String('=', 60));
+  Serial.println("👊 MANUAL DISPENSE TRIGGERED (Serial Command)");
+  Serial.println(String('=', 60));
+  Serial.println("Container: " + String(args.value));
+  Serial.println("Time: " + timeManager.getTimeString());
+  Serial.println(String('=', 60) + "\n");
+  
+  // Hand over to the schedule task (convert to 0-based index)
+  return requestDispense(args.value - 1);
+}
+
+static const ShellCommand servoCommands[] = {
+  {"servo status", SHELL_ARG_NONE, 0, 0, "", "Check servo driver status", cmdServoStatus},
+  {"servo test", SHELL_ARG_INT, 0, 15, "<0-15>", "Test specific servo", cmdServoTest},
+  {"servo sweep", SHELL_ARG_NONE, 0, 0, "", "Sweep all servos", cmdServoSweep},
+  {"servo reset", SHELL_ARG_NONE, 0, 0, "", "Reset all servos to 90°", cmdServoReset},
+  {"servo release", SHELL_ARG_NONE, 0, 0, "", "Move CH5/CH6 to release position", cmdServoRelease},
+  {"servo home", SHELL_ARG_NONE, 0, 0, "", "Move CH5/CH6 to home position", cmdServoHome},
+  {"servo stop", SHELL_ARG_NONE, 0, 0, "", "Stop all servos", cmdServoStop},
+  {"calibrate", SHELL_ARG_INT, 0, 15, "<0-15>", "Calibrate specific servo", cmdCalibrate},
+  {"dispense", SHELL_ARG_INT, 1, 5, "<1-5>", "Manual dispense from container", cmdDispense}
+};
+
+bool cmdNotify(const ShellArgs& args) {
+  notifications.printConfig();
+  return true;
+}
+
+bool cmdNotifyAck(const ShellArgs& args) {
+  if (!notifications.isEscalating()) {
+    Serial.println("No active escalation");
+    return false;
+  }
+  queueAcknowledge("serial console");
+  return true;
+}
+
+bool cmdGsmStats(const ShellArgs& args) {
+  sim800.printStats();
+  return true;
+}
+
+bool cmdGsmStatsReset(const ShellArgs& args) {
+  sim800.resetStats();
+  Serial.println("✅ SIM800L statistics reset");
+  return true;
+}
+
+static const ShellCommand notifyCommands[] = {
+  {"notify", SHELL_ARG_NONE, 0, 0, "", "Show notification/escalation status", cmdNotify},
+  {"notify ack", SHELL_ARG_NONE, 0, 0, "", "Acknowledge active missed-dose escalation", cmdNotifyAck},
+  {"gsm stats", SHELL_ARG_NONE, 0, 0, "", "SIM800L command/SMS timing statistics", cmdGsmStats},
+  {"gsm stats reset", SHELL_ARG_NONE, 0, 0, "", "Clear SIM800L statistics", cmdGsmStatsReset}
+};
+
+bool cmdLcdStats(const ShellArgs& args) {
+  lcd.printStats();
+  return true;
+}
+
+bool cmdLcdStatsReset(const ShellArgs& args) {
+  lcd.resetStats();
+  Serial.println("✅ LCD statistics reset");
+  return true;
+}
+
+bool cmdScreen(const ShellArgs& args) {
+  screens.printStatus();
+  return true;
+}
+
+bool cmdVoltage(const ShellArgs& args) {
+  voltageSensor.printDebug();
+  return true;
+}
+
+bool cmdBattery(const ShellArgs& args) {
+  battery.printStatus();
+  return true;
+}
+
+bool cmdPower(const ShellArgs& args) {
+  powerManager.printStatus();
+  Serial.println("Modelled average current: " + String(battery.getAverageCurrentMa(), 0) + " mA");
+  return true;
+}
+
+bool cmdPowerOn(const ShellArgs& args) {
+  powerManager.setEnabled(true);
+  Serial.println("✅ Light sleep enabled");
+  return true;
+}
+
+bool cmdPowerOff(const ShellArgs& args) {
+  powerManager.setEnabled(false);
+  Serial.println("✅ Light sleep disabled");
+  return true;
+}
+
+bool cmdPowerReset(const ShellArgs& args) {
+  powerManager.resetStats();
+  Serial.println("✅ Power statistics reset");
+  return true;
+}
+
+bool cmdBuzzer(const ShellArgs& args) {
+  if (!args.present) {
+    buzzer.printStatus();
+    return true;
+  }
+  Serial.println("Playing " + String(BuzzerManager::getAlertName((BuzzerAlert)(args.value - 1))));
+  buzzer.play((BuzzerAlert)(args.value - 1));
+  return true;
+}
+
+bool cmdBuzzerStop(const ShellArgs& args) {
+  buzzer.stop();
+  return true;
+}
+
+static const ShellCommand deviceCommands[] = {
+  {"lcd stats", SHELL_ARG_NONE, 0, 0, "", "LCD I2C traffic, write-through vs framebuffer diff", cmdLcdStats},
+  {"lcd stats reset", SHELL_ARG_NONE, 0, 0, "", "Clear LCD statistics", cmdLcdStatsReset},
+  {"screen", SHELL_ARG_NONE, 0, 0, "", "Show active screen and render task status", cmdScreen},
+  {"voltage", SHELL_ARG_NONE, 0, 0, "", "Battery voltage and ADC filter noise", cmdVoltage},
+  {"battery", SHELL_ARG_NONE, 0, 0, "", "State of charge and runtime forecast", cmdBattery},
+  {"power", SHELL_ARG_NONE, 0, 0, "", "Light sleep time, wake sources and alarm lateness", cmdPower},
+  {"power on", SHELL_ARG_NONE, 0, 0, "", "Allow light sleep while idle", cmdPowerOn},
+  {"power off", SHELL_ARG_NONE, 0, 0, "", "Stay awake (for comparing alarm timing)", cmdPowerOff},
+  {"power reset", SHELL_ARG_NONE, 0, 0, "", "Clear sleep and alarm timing statistics", cmdPowerReset},
+  {"buzzer", SHELL_ARG_OPTIONAL_INT, 1, BUZZER_ALERT_COUNT, "[1-6]", "Buzzer status, or play an alert melody", cmdBuzzer},
+  {"buzzer stop", SHELL_ARG_NONE, 0, 0, "", "Silence the buzzer", cmdBuzzerStop}
+};
+
+void registerShellCommands() {
+  shell.add(systemCommands, sizeof(systemCommands) / sizeof(systemCommands[0]));
+  shell.add(scheduleCommands, sizeof(scheduleCommands) / sizeof(scheduleCommands[0]));
+  shell.add(servoCommands, sizeof(servoCommands) / sizeof(servoCommands[0]));
+  shell.add(notifyCommands, sizeof(notifyCommands) / sizeof(notifyCommands[0]));
+  shell.add(deviceCommands, sizeof(deviceCommands) / sizeof(deviceCommands[0]));
+}
+
+void printDebugStatus() {
+  // Clock trace every second to monitor alarm triggering (LOG_LEVEL_DEBUG builds)
   static unsigned long lastSecondDebug = 0;
   if (millis() - lastSecondDebug > 1000) { // Every 1 second
     lastSecondDebug = millis();
-    Serial.printf("⏰ TimeLib: %02d:%02d:%02d | TimeManager: %s | Alarms: %d | Next: %s\n", 
-                  hour(), minute(), second(),
-                  timeManager.getTimeString().c_str(),
-                  Alarm.count(),
-                  scheduleManager.getNextScheduleTime().c_str());
+    LOG_DEBUG(LOG_MOD_SYSTEM, EV_CLOCK_TICK, hour() * 10000 + minute() * 100 + second(), Alarm.count());
   }
   
-  // Detailed debug every minute
+  // Schedule summary every minute ("schedules" prints the full table)
   static unsigned long lastTimeDebug = 0;
   if (millis() - lastTimeDebug > 60000) { // Every 60 seconds
     lastTimeDebug = millis();
-    Serial.println("\n" + String('=', 70));
-    Serial.println("⏰ DETAILED TIME & ALARM STATUS");
-    Serial.println(String('=', 70));
-    Serial.printf("TimeLib (TimeAlarms): %02d:%02d:%02d\n", hour(), minute(), second());
-    Serial.println("TimeManager: " + timeManager.getTimeString());
-    Serial.println("Active schedules: " + String(scheduleManager.getActiveScheduleCount()) + 
-                   " / " + String(scheduleManager.getScheduleCount()));
-    Serial.println("Total alarms registered: " + String(Alarm.count()));
-    Serial.println("Next schedule: " + scheduleManager.getNextScheduleTime());
-    scheduleManager.printSchedules();
-    Serial.println(String('=', 70) + "\n");
+    LOG_INFO(LOG_MOD_SYSTEM, EV_SCHEDULE_SUMMARY, scheduleManager.getActiveScheduleCount(),
+             scheduleManager.getScheduleCount(), Alarm.count());
   }
 }
 
 void initializeDevelopmentMode() {
   Serial.println("\n📋 Initializing components for development...");
   
-  // Initialize LCD first for status display
-  Serial.print("LCD Display: ");
-  if (lcd.begin()) {
-    Serial.println("✅ OK");
-    lcd.displayMainScreen();
-  } else {
-    Serial.println("❌ FAILED");
-  }
+  // Independent hardware comes up side by side on worker tasks (last argument).
+  // Doses are armed from the local schedule cache as soon as the clock is
+  // restored, so the slow network stages no longer delay them.
+  int display = boot.add("lcd", bootDisplay, 0, true);
+  int servos = boot.add("uno link", bootServos, 0, true);
+  int modem = boot.add("sim800l", bootModem, 0, true);
+  boot.add("power", bootPower, BOOT_AFTER(servos) | BOOT_AFTER(modem), true);
+  int timebase = boot.add("clock", bootClock);
+  int cached = boot.add("cached schedules", bootCachedSchedules, BOOT_AFTER(timebase));
+  boot.add("dose tasks", bootDoseTasks, BOOT_AFTER(servos) | BOOT_AFTER(cached), true);
+  int wifi = boot.add("wifi", bootWiFi, BOOT_AFTER(display));
+  int cloud = boot.add("firebase", bootFirebase, BOOT_AFTER(wifi));
+  boot.add("cloud schedules", bootCloudSchedules, BOOT_AFTER(cloud));
   
-  // Setup WiFi using WiFiManager (handles AP mode automatically)
-  Serial.print("WiFi Connection: ");
-  if (setupWiFiWithManager(&timeManager, "PillDispenser")) {
-    Serial.println("✅ OK");
-    lcd.clear();
-    lcd.print("WiFi Connected!", 0, 0);
-    lcd.print(WiFi.localIP().toString(), 0, 1);
-    delay(2000);
-  } else {
-    Serial.println("❌ FAILED");
-    lcd.clear();
-    lcd.print("WiFi Failed!", 0, 0);
-    lcd.print("Check Config", 0, 1);
-    delay(3000);
-    // Restart to try again
-    ESP.restart();
+  // Created now but held until their stage (or the end of boot) releases them
+  startTasks();
+  boot.run();
+  printBootReport();
+  
+  LOG_INFO(LOG_MOD_SYSTEM, EV_BOOT_DONE, millis(), dosesArmedAt);
+  Serial.println("\n🎯 Development mode ready!");
+  screens.setField(FIELD_STATUS, "Ready");
+  
+  systemInitialized = true;
+}
+
+// ===== BOOT STAGES =====
+// Worker stages run concurrently and must not share hardware; the others
+// run in order on the setup() task.
+
+bool bootDisplay() {
+  if (!lcd.begin()) {
+    Serial.println("LCD Display: ❌ FAILED");
+    return false;
   }
+  Serial.println("LCD Display: ✅ OK");
+  screens.setField(FIELD_STATUS, "Starting");
+  screens.setField(FIELD_PILL_COUNT, pillCount);
+  screens.setScreen(SCREEN_HOME);
+  screens.setProfiler(&profiler);
+  screens.begin(&lcd);
+  return true;
+}
   
-  // Initialize Arduino Servo Controller
-  Serial.print("Arduino Servo Controller: ");
-  if (servoController.begin()) {
-    Serial.println("✅ OK");
+bool bootServos() {
+  if (!servoController.begin()) {
+    Serial.println("Arduino Servo Controller: ❌ FAILED");
+    return false;
+  }
+  Serial.println("Arduino Servo Controller: ✅ OK");
     
-    // Set all servos from ch0 to ch4 to angle 0 as starting point
-    Serial.println("Setting servos ch0-ch4 to angle 0...");
-    for (int ch = 0; ch <= 4; ch++) {
-      servoController.setServoAngle(ch, 0);
-      delay(100); // Small delay between servo movements
-    }
-    Serial.println("All servos initialized to 0 degrees");
-  } else {
-    Serial.println("❌ FAILED");
+  // Set all servos from ch0 to ch4 to angle 0 as starting point
+  for (int ch = 0; ch <= 4; ch++) {
+    servoController.setServoAngle(ch, 0);
+    delay(100); // Small delay between servo movements
   }
+  Serial.println("All servos initialized to 0 degrees");
+  return true;
+}
   
-  // Initialize SIM800L
-  Serial.print("SIM800L Module: ");
-  if (sim800.begin()) {
-    Serial.println("✅ OK");
-  } else {
-    Serial.println("❌ FAILED");
-  }
+bool bootModem() {
+  bool ready = sim800.begin();
+  Serial.println(ready ? "SIM800L Module: ✅ OK" : "SIM800L Module: ❌ FAILED");
   
-  // Initialize Voltage Sensor
-  Serial.print("Voltage Sensor: ");
+  // Only caregivers may send SMS commands
+  smsCommands.addAuthorizedSender(CAREGIVER_1_PHONE);
+  smsCommands.addAuthorizedSender(CAREGIVER_2_PHONE);
+  
+  // Missed-dose escalation: SMS, then calls to caregiver 1, caregiver 2, emergency contact
+  notifications.begin();
+  notifications.addPhoneNumber(CAREGIVER_1_PHONE, CAREGIVER_1_NAME);
+  notifications.addPhoneNumber(CAREGIVER_2_PHONE, CAREGIVER_2_NAME);
+  notifications.setEmergencyNumber(EMERGENCY_PHONE);
+  notifications.setEscalationTiming(ESCALATION_ACK_MINUTES, ESCALATION_RING_SECONDS);
+  return ready;
+}
+  
+// After the modem reset and servo homing, so the first reading is close to open-circuit
+bool bootPower() {
   voltageSensor.begin();
-  Serial.println("✅ OK");
+  Serial.println("Voltage Sensor: ✅ OK");
   
-  // Initialize Firebase Manager
-  Serial.print("Firebase Manager: ");
-  if (firebase.begin(PillDispenserConfig::getApiKey(), PillDispenserConfig::getDatabaseURL())) {
-    Serial.println("✅ OK");
+  // Battery estimator (needs the voltage sensor, servo and GSM counters)
+  battery.begin(BATTERY_CHEMISTRY, BATTERY_CELLS, BATTERY_CAPACITY_MAH);
+  battery.setLowBatteryCallback(handleLowBattery);
+  return true;
+}
+  
+bool bootClock() {
+  // Time zone first - the restored clock is converted with it
+  timeManager.loadTimezone(DEVICE_TIMEZONE.c_str());
+  
+  // Restore the last known time so alarms are right before NTP answers
+  bool restored = timeManager.restoreTime();
+  if (timeManager.isTimeProvisional()) {
+    Serial.println("Persisted Clock: ⚠️ PROVISIONAL (NVS only - doses wait for NTP)");
   } else {
-    Serial.println("❌ FAILED");
+    Serial.println(restored ? "Persisted Clock: ✅ RESTORED" : "Persisted Clock: ⚠️ NONE");
   }
-  
-  // Initialize Schedule Manager
-  Serial.print("Schedule Manager: ");
+  return restored;
+}
+
+// The schedule task is not running yet, so no lock is needed here
+bool bootCachedSchedules() {
   scheduleManager.begin(firebase.getDeviceId());
-  scheduleManager.setDispenseCallback(handleScheduledDispense);
-  scheduleManager.setReminderCallback(handleReminderNotification);
+  subscribeDoseEvents();
+  scheduleManager.setEventBus(&eventBus);
   scheduleManager.setTimeManager(&timeManager);
-  Serial.println("✅ OK");
+  scheduleManager.setAlarmTimingCallback(onAlarmTiming);
+  Serial.println("Schedule Manager: ✅ OK");
+  
+  // Without a trusted clock these are re-armed, and caught up, by the first NTP step
+  int cached = scheduleManager.loadCache();
+  if (cached > 0 && timeManager.isTimeValid()) {
+    // Doses that came due while the device was rebooting
+    scheduleManager.catchUpMissedDoses();
+    dosesCaughtUp = true;
+  }
+  return cached >= 0;
+}
+
+bool bootDoseTasks() {
+  if (scheduleManager.getActiveScheduleCount() > 0 && timeManager.isTimeValid()) {
+    dosesArmedAt = millis();
+  }
+  xEventGroupSetBits(systemEvents, EVT_DOSES_READY);
+  return true;
+}
+
+bool bootWiFi() {
+  // Setup WiFi using WiFiManager (handles AP mode automatically)
+  if (!setupWiFiWithManager(nullptr, "PillDispenser")) {
+    Serial.println("WiFi Connection: ❌ FAILED");
+    screens.setField(FIELD_ERROR, "WiFi Failed!");
+    screens.showOverlay(SCREEN_ERROR);
+    delay(3000);
+    // Doses may already be running from the cache - let one finish first
+    while (isDispenseBusy()) {
+      delay(100);
+    }
+    // Restart to try again
+    ESP.restart();
+  }
+  Serial.println("WiFi Connection: ✅ OK");
+  screens.setField(FIELD_WIFI, "Connected");
+  screens.setField(FIELD_IP, WiFi.localIP().toString());
+  screens.showOverlay(SCREEN_NETWORK, 5000);
+  
+  // The schedule task may already be servicing the clock
+  xSemaphoreTake(scheduleLock, portMAX_DELAY);
+  timeManager.begin("pool.ntp.org");  // Time zone comes from loadTimezone()/system_config
+  xSemaphoreGive(scheduleLock);
+  return true;
+}
+
+bool bootFirebase() {
+  bool started = firebase.begin(PillDispenserConfig::getApiKey(), PillDispenserConfig::getDatabaseURL());
+  Serial.println(started ? "Firebase Manager: ✅ OK" : "Firebase Manager: ❌ FAILED");
   
   // Link Firebase and Schedule Manager
   firebase.setScheduleManager(&scheduleManager);
+  firebase.setTimeManager(&timeManager);
   firebase.setUserId(USER_ID);
+  firebase.enableGPRSFallback(&sim800, GPRS_APN, GPRS_USER, GPRS_PASSWORD, GPRS_DATABASE_SECRET);
+  firebase.setScheduleLock(scheduleLock);
+  firebase.setModemLock(modemLock);
+  firebase.setProfiler(&profiler);
+  firebase.setMemoryMonitor(&memoryMonitor);
   
   // Wait for Firebase to be ready before syncing schedules
   Serial.println("\n⏳ Waiting for Firebase to be ready...");
@@ -393,156 +1110,215 @@ void initializeDevelopmentMode() {
     waitCount++;
   }
   Serial.println();
+  return firebase.isFirebaseReady();
+}
   
-  if (firebase.isFirebaseReady()) {
-    // Initial schedule sync from Firebase
-    Serial.println("📅 Loading schedules from Firebase...");
-    if (firebase.syncSchedulesFromFirebase()) {
-      Serial.println("✅ Schedules loaded successfully");
-    } else {
-      Serial.println("⚠️ No schedules found or sync failed");
-    }
-  } else {
+bool bootCloudSchedules() {
+  if (!firebase.isFirebaseReady()) {
     Serial.println("❌ Firebase not ready - skipping schedule sync");
+    return false;
   }
   
-  Serial.println("\n🎯 Development mode ready!");
+  // Replaces the cached set and refreshes the cache if it changed
+  Serial.println("📅 Loading schedules from Firebase...");
+  if (!firebase.syncSchedulesFromFirebase()) {
+    Serial.println("⚠️ No schedules found or sync failed - keeping the cached schedules");
+    return false;
+  }
+  Serial.println("✅ Schedules loaded successfully");
   
-  systemInitialized = true;
+  xSemaphoreTake(scheduleLock, portMAX_DELAY);
+  if (!dosesCaughtUp) {
+    // Doses that came due while the device was rebooting
+    scheduleManager.catchUpMissedDoses();
+    dosesCaughtUp = true;
+  }
+  if (dosesArmedAt == 0 && scheduleManager.getActiveScheduleCount() > 0 && timeManager.isTimeValid()) {
+    dosesArmedAt = millis();
+  }
+  xSemaphoreGive(scheduleLock);
+  return true;
 }
 
 
-// Callback function for scheduled dispensing
-void handleScheduledDispense(int dispenserId, String pillSize, String medication, String patient) {
+// ===== DOSE EVENT SUBSCRIBERS =====
+// Dispatched by the schedule task after the alarm pass, with the schedule lock held.
+// Each subscriber does one job; names come from the interned table, not String copies.
+
+void subscribeDoseEvents() {
+  eventBus.subscribe(BUS_DOSE_DUE, onDoseDue);
+  eventBus.subscribe(BUS_DOSE_REMINDER, onReminderAlert);
+  eventBus.subscribe(BUS_DOSE_REMINDER, onReminderNotify);
+  eventBus.subscribe(BUS_DOSE_MISSED, onMissedDoseAlert);
+  eventBus.subscribe(BUS_DOSE_MISSED, onMissedDoseNotify);
+  eventBus.subscribe(BUS_DOSE_MISSED, onMissedDoseReport);
+}
+
+// Scheduled dispensing
+void onDoseDue(const BusEvent& event) {
   // Only start dispense if we're idle
   if (currentDispenseState != IDLE) {
-    Serial.println("⚠️ Dispense already in progress, skipping scheduled dispense");
+    LOG_WARN(LOG_MOD_DISPENSE, EV_DISPENSE_BUSY, event.dispenserId + 1);
+    onMissedDoseNotify(event);  // Names the scheduled slot, not the current time
     return;
   }
   
-  Serial.println("\n" + String('=', 60));
-  Serial.println("⏰ SCHEDULED DISPENSE TRIGGERED");
-  Serial.println(String('=', 60));
-  Serial.printf("Container: %d\n", dispenserId + 1);
-  Serial.println("Medication: " + medication);
-  Serial.println("Patient: " + patient);
-  Serial.println("Pill Size: " + pillSize);
-  Serial.println("Time: " + timeManager.getTimeString());
-  Serial.println(String('=', 60));
+  LOG_INFO(LOG_MOD_DISPENSE, EV_DISPENSE_SCHEDULED, event.dispenserId + 1);
   
   // Start the non-blocking dispense sequence
-  startDispense(dispenserId, true, medication, patient, pillSize);
+  startDispense(event.dispenserId, &event);
 }
 
-// Function to dispense from a specific container (DEPRECATED - use startDispense instead)
+// Function to dispense from a specific container (DEPRECATED - use requestDispense instead)
 void dispenseFromContainer(int dispenserId) {
   // This is now handled by the state machine
-  startDispense(dispenserId, false, "", "", "");
+  requestDispense(dispenserId);
 }
 
-// Start a new dispense sequence
-void startDispense(int dispenserId, bool scheduled, String medication, String patient, String pillSize) {
+// Manual dispense from any task - the schedule task picks it up when idle
+bool requestDispense(int dispenserId) {
+  if (isDispenseBusy()) {
+    return false;
+  }
+  return xQueueSend(dispenseQueue, &dispenserId, 0) == pdTRUE;
+}
+
+bool isDispenseBusy() {
+  return (xEventGroupGetBits(systemEvents) & EVT_DISPENSE_BUSY) || uxQueueMessagesWaiting(dispenseQueue) > 0;
+}
+
+// Start a new dispense sequence (schedule task only)
+void startDispense(int dispenserId, const BusEvent* dose) {
   if (dispenserId < 0 || dispenserId > 4) {
     Serial.println("❌ Invalid dispenser ID: " + String(dispenserId));
     return;
   }
   
   if (currentDispenseState != IDLE) {
-    Serial.println("⚠️ Dispense already in progress, cannot start new dispense");
+    LOG_WARN(LOG_MOD_DISPENSE, EV_DISPENSE_BUSY, dispenserId + 1);
     return;
   }
   
   // Store dispense information
   currentDispenserId = dispenserId;
-  isScheduledDispense = scheduled;
-  scheduleMedication = medication;
-  schedulePatient = patient;
-  schedulePillSize = pillSize;
+  isScheduledDispense = dose != nullptr;
+  if (dose != nullptr) {
+    currentDose = *dose;
+  }
+  
+  // Voltage sags from here until the servos are done
+  battery.setLoadActive(true);
   
   // Play buzzer for dispense event
   playDispenseBuzzer();
   
-  // Display on LCD if scheduled
-  if (scheduled) {
-    lcd.displayDispenseInfo(dispenserId + 1, medication);
-  }
+  // Dispensing screen until the sequence finishes
+  screens.setField(FIELD_CONTAINER, dispenserId + 1);
+  screens.setField(FIELD_MEDICATION, dose != nullptr ? nameTable.get(dose->medication) : "Manual dispense");
+  screens.setField(FIELD_STATUS, "Dispensing");
+  screens.showOverlay(SCREEN_DISPENSING);
   
-  Serial.println("\n" + String('=', 60));
-  Serial.println("🔄 STARTING DISPENSE SEQUENCE - CONTAINER " + String(dispenserId + 1));
-  Serial.println(String('=', 60));
+  LOG_INFO(LOG_MOD_DISPENSE, EV_DISPENSE_START, dispenserId + 1, isScheduledDispense);
   
   // Move to DISPENSING state
+  xEventGroupSetBits(systemEvents, EVT_DISPENSE_BUSY);
   currentDispenseState = DISPENSING;
 }
 
 // Non-blocking dispense state machine
 void updateDispenseStateMachine() {
+  ProfileTimer timer(profiler, PROFILE_DISPENSE);
+  
   switch (currentDispenseState) {
-    case IDLE:
-      // Nothing to do
+    case IDLE: {
+      // Manual dispenses queued by the other tasks
+      int dispenserId;
+      if (xQueueReceive(dispenseQueue, &dispenserId, 0) == pdTRUE) {
+        startDispense(dispenserId);
+      }
       break;
+    }
       
     case DISPENSING:
       // Send dispense command to Arduino (Arduino handles entire sequence)
-      Serial.println("🔄 DISPENSING FROM CONTAINER " + String(currentDispenserId + 1));
-      Serial.printf("Sending DP%d command to Arduino...\n", currentDispenserId);
-      Serial.println("Arduino will handle: Dispense → Wait 15s → Release → Wait 10s → Home");
+      // Arduino handles: Dispense → Wait 15s → Release → Wait 10s → Home
+      LOG_INFO(LOG_MOD_DISPENSE, EV_SERVO_COMMAND_SENT, currentDispenserId);
       
-      if (servoController.dispensePill(currentDispenserId)) {
+      // The servo task owns the Uno link; alarms keep running while it works
+      xEventGroupClearBits(systemEvents, EVT_SERVO_DONE | EVT_SERVO_FAILED);
+      if (!queueServoRequest(SERVO_DISPENSE, currentDispenserId)) {
+        xEventGroupSetBits(systemEvents, EVT_SERVO_FAILED);
+      }
+      currentDispenseState = SERVO_WAIT;
+      break;
+      
+    case SERVO_WAIT: {
+      EventBits_t bits = xEventGroupGetBits(systemEvents);
+      if (bits & EVT_SERVO_DONE) {
         pillCount++;
-        Serial.println("✅ DISPENSE SEQUENCE COMPLETED BY ARDUINO");
-        Serial.println("   Total pills dispensed: " + String(pillCount));
+        LOG_INFO(LOG_MOD_DISPENSE, EV_DISPENSE_DONE, currentDispenserId + 1, pillCount);
+        screens.setField(FIELD_PILL_COUNT, pillCount);
         
         // Arduino has completed everything, move directly to complete
         currentDispenseState = COMPLETE;
-      } else {
-        Serial.println("❌ DISPENSE FAILED - Arduino communication error");
+      } else if (bits & EVT_SERVO_FAILED) {
+        LOG_ERROR(LOG_MOD_DISPENSE, EV_DISPENSE_FAILED, currentDispenserId + 1);
+        if (isScheduledDispense) {
+          onMissedDoseNotify(currentDose);
+        }
+        screens.setField(FIELD_ERROR, "Dispense failed");
+        screens.setField(FIELD_STATUS, "Ready");
+        screens.showOverlay(SCREEN_ERROR, 10000);
+        buzzer.play(BUZZER_ERROR);
+        battery.setLoadActive(false);
+        xEventGroupClearBits(systemEvents, EVT_DISPENSE_BUSY);
         currentDispenseState = IDLE;
       }
       break;
+    }
       
     case COMPLETE:
       // Update Firebase and send notifications if this was a scheduled dispense
       if (isScheduledDispense) {
-        firebase.updateDispenserAfterDispense(currentDispenserId, &timeManager);
-        
-        String smsMessage = "[PILL DISPENSER] Medication dispensed from Container " + 
-                           String(currentDispenserId + 1) + " - " + scheduleMedication + 
-                           " for " + schedulePatient + " at " + timeManager.getTimeString();
-        sendSMSNotification(smsMessage);
+        const char* medication = nameTable.get(currentDose.medication);
+        char description[96];
+        snprintf(description, sizeof(description), "Scheduled dispense: %s", medication);
+        queueCloudReport(currentDispenserId + 1, true, description, 1);
         
-        firebase.sendPillReport(currentDispenserId + 1, timeManager.getDateTimeString(), 
-                               "Scheduled dispense: " + scheduleMedication, 1);
+        queueSMSNotification("[PILL DISPENSER] Medication dispensed from Container %d - %s for %s at %s",
+                             currentDispenserId + 1, medication, nameTable.get(currentDose.patient),
+                             timeManager.getSnapshot().display);
       } else {
         // Manual dispense
-        firebase.updateDispenserAfterDispense(currentDispenserId, &timeManager);
+        queueCloudReport(currentDispenserId + 1, true, "Manual dispense", 1);
         
-        String smsMessage = "[PILL DISPENSER] Manual dispense from Container " + 
-                           String(currentDispenserId + 1) + " at " + timeManager.getTimeString();
-        sendSMSNotification(smsMessage);
-        
-        firebase.sendPillReport(currentDispenserId + 1, timeManager.getDateTimeString(), 
-                               "Manual dispense", 1);
+        queueSMSNotification("[PILL DISPENSER] Manual dispense from Container %d at %s",
+                             currentDispenserId + 1, timeManager.getSnapshot().display);
       }
       
-      Serial.println("✅ DISPENSE SEQUENCE COMPLETED");
-      Serial.println(String('=', 60) + "\n");
+      // A successful dispense resolves any pending missed-dose alert
+      if (notifications.isEscalating()) {
+        char source[32];
+        snprintf(source, sizeof(source), "dispense from Container %d", currentDispenserId + 1);
+        queueAcknowledge(source);
+      }
       
       // Reset to idle
+      screens.clearOverlay();
+      screens.setField(FIELD_STATUS, "Ready");
+      battery.setLoadActive(false);
       currentDispenseState = IDLE;
       currentDispenserId = -1;
       isScheduledDispense = false;
-      scheduleMedication = "";
-      schedulePatient = "";
-      schedulePillSize = "";
+      xEventGroupClearBits(systemEvents, EVT_DISPENSE_BUSY);
       break;
   }
 }
 
-// Check for realtime dispense commands from web app
+// Check for realtime dispense commands from web app (network task)
 void checkDispenseCommands() {
   // Only check if we're idle
-  if (currentDispenseState != IDLE) {
+  if (isDispenseBusy()) {
     return;
   }
   
@@ -554,72 +1330,410 @@ void checkDispenseCommands() {
       Serial.println("Container: " + String(dispenserId));
       
       // Start dispense (convert to 0-based index)
-      startDispense(dispenserId - 1, false, "", "", "");
+      requestDispense(dispenserId - 1);
+    }
+  }
+}
+
+// Run caregiver commands received by SMS and reply to the sender (GSM task)
+void checkSMSCommands() {
+  if (!smsCommands.hasCommand()) {
+    return;
+  }
+  
+  SMSCommand command = smsCommands.popCommand();
+  String reply;
+  
+  switch (command.type) {
+    case SMS_CMD_STATUS:
+      reply = "[PILL DISPENSER] Status\n";
+      reply += "Time: " + timeManager.getTimeString() + "\n";
+      reply += "State: " + String(isDispenseBusy() ? "Dispensing" : "Idle") + "\n";
+      reply += "Pills dispensed: " + String(pillCount) + "\n";
+      reply += "Next dose: " + getNextDoseTime() + "\n";
+      reply += "WiFi: " + String(WiFi.status() == WL_CONNECTED ? "Connected" : "Down") + "\n";
+      reply += "Battery: " + String(battery.getPercent(), 0) + "% (~" + String(battery.getHoursRemaining(), 0) + " h)";
+      if (notifications.isEscalating()) {
+        reply += "\nAlert: " + notifications.getEscalationStatus();
+      }
+      break;
+      
+    case SMS_CMD_DISPENSE:
+      if (command.argument < 1 || command.argument > 5) {
+        reply = "[PILL DISPENSER] Invalid container. Use DISPENSE 1-5.";
+      } else {
+        Serial.println("\n📩 SMS dispense command received!");
+        Serial.println("Container: " + String(command.argument));
+        
+        // Same path as realtime dispense commands from the web app
+        if (requestDispense(command.argument - 1)) {
+          reply = "[PILL DISPENSER] Dispensing from Container " + String(command.argument) + ".";
+        } else {
+          reply = "[PILL DISPENSER] Dispense already in progress, try again shortly.";
+        }
+      }
+      break;
+      
+    case SMS_CMD_SKIP: {
+      xSemaphoreTake(scheduleLock, portMAX_DELAY);
+      int skipped = scheduleManager.skipNextSchedule();
+      if (skipped >= 0) {
+        scheduleManager.saveCache();  // The SKIP survives a reboot before the dose
+        MedicationSchedule* schedule = scheduleManager.getSchedule(skipped);
+        char text[96];
+        snprintf(text, sizeof(text), "[PILL DISPENSER] Skipping %s at %02d:%02d (Container %d).",
+                 nameTable.get(schedule->medicationId), schedule->hour, schedule->minute,
+                 schedule->dispenserId + 1);
+        reply = text;
+      } else {
+        reply = "[PILL DISPENSER] No upcoming dose to skip.";
+      }
+      xSemaphoreGive(scheduleLock);
+      break;
     }
+      
+    case SMS_CMD_ACK:
+      if (notifications.acknowledge(command.sender)) {
+        reply = "[PILL DISPENSER] Acknowledged - escalation calls stopped.";
+      } else {
+        reply = "[PILL DISPENSER] No active alert to acknowledge.";
+      }
+      break;
+      
+    default:
+      reply = SMSCommandHandler::getHelpText();
+      break;
   }
+  
+  smsCommands.sendReply(command.sender, reply);
 }
 
-// Play professional buzzer sound for dispense event
+// Play professional buzzer sound for dispense event (returns immediately)
 void playDispenseBuzzer() {
-  // Continuous beep for 7 seconds
-  digitalWrite(PIN_BUZZER, HIGH);
-  delay(7000);
-  digitalWrite(PIN_BUZZER, LOW);
+  buzzer.play(BUZZER_DISPENSE);
   Serial.println("🔊 Dispense buzzer activated");
 }
 
-// Play reminder buzzer sound (15 minutes before)
+// Play reminder buzzer sound (15 minutes before, returns immediately)
 void playReminderBuzzer() {
-  // Continuous beep for 7 seconds
-  digitalWrite(PIN_BUZZER, HIGH);
-  delay(7000);
-  digitalWrite(PIN_BUZZER, LOW);
+  buzzer.play(BUZZER_REMINDER);
   Serial.println("🔔 Reminder buzzer activated");
 }
 
-// Send SMS to all caregivers
-void sendSMSNotification(String message) {
+// Send SMS to all caregivers (GSM task - use queueSMSNotification elsewhere)
+void sendSMSNotification(const char* message) {
   if (sim800.isNetworkConnected()) {
     Serial.println("📤 Sending SMS notifications...");
     
     // Send to Caregiver 1
     if (sim800.sendSMS(CAREGIVER_1_PHONE, message)) {
-      Serial.println("✅ SMS sent to " + CAREGIVER_1_NAME + ": " + CAREGIVER_1_PHONE);
+      Serial.printf("✅ SMS sent to %s: %s\n", CAREGIVER_1_NAME.c_str(), CAREGIVER_1_PHONE.c_str());
     } else {
-      Serial.println("❌ Failed to send SMS to " + CAREGIVER_1_NAME);
+      Serial.printf("❌ Failed to send SMS to %s\n", CAREGIVER_1_NAME.c_str());
     }
     
     delay(2000); // Delay between SMS sends
     
     // Send to Caregiver 2
     if (sim800.sendSMS(CAREGIVER_2_PHONE, message)) {
-      Serial.println("✅ SMS sent to " + CAREGIVER_2_NAME + ": " + CAREGIVER_2_PHONE);
+      Serial.printf("✅ SMS sent to %s: %s\n", CAREGIVER_2_NAME.c_str(), CAREGIVER_2_PHONE.c_str());
     } else {
-      Serial.println("❌ Failed to send SMS to " + CAREGIVER_2_NAME);
+      Serial.printf("❌ Failed to send SMS to %s\n", CAREGIVER_2_NAME.c_str());
     }
   } else {
     Serial.println("⚠️ GSM not connected - SMS not sent");
   }
 }
 
-// Handle 15-minute reminder notification
-void handleReminderNotification(int dispenserId, String pillSize, String medication, String patient) {
-  Serial.println("\n" + String('=', 60));
-  Serial.println("🔔 15-MINUTE REMINDER");
-  Serial.println(String('=', 60));
-  Serial.printf("Container: %d\n", dispenserId + 1);
-  Serial.println("Medication: " + medication);
-  Serial.println("Patient: " + patient);
-  Serial.println("Time: " + timeManager.getTimeString());
-  Serial.println(String('=', 60));
+// 15-minute reminder - screen and buzzer
+void onReminderAlert(const BusEvent& event) {
+  LOG_INFO(LOG_MOD_SCHEDULE, EV_REMINDER, event.dispenserId + 1);
+  
+  // Show the upcoming dose for a minute
+  screens.showOverlay(SCREEN_NEXT_DOSE, 60000);
   
   // Play reminder buzzer
   playReminderBuzzer();
+}
+
+// 15-minute reminder - SMS to caregivers
+void onReminderNotify(const BusEvent& event) {
+  queueSMSNotification("[PILL DISPENSER REMINDER] Upcoming medication in 15 minutes - Container %d: %s for %s",
+                       event.dispenserId + 1, nameTable.get(event.medication), nameTable.get(event.patient));
+}
+
+// Dose passed over by a clock step beyond its grace window - screen and buzzer
+void onMissedDoseAlert(const BusEvent& event) {
+  LOG_WARN(LOG_MOD_SCHEDULE, EV_MISSED_DOSE, event.dispenserId + 1, event.hour * 100 + event.minute);
   
-  // Send SMS reminder to caregivers
-  String smsMessage = "[PILL DISPENSER REMINDER] Upcoming medication in 15 minutes - Container " + 
-                     String(dispenserId + 1) + ": " + medication + " for " + patient;
-  sendSMSNotification(smsMessage);
+  char line[SCREEN_FIELD_MAX];
+  snprintf(line, sizeof(line), "%02d:%02d %s", event.hour, event.minute, nameTable.get(event.medication));
+  buzzer.play(BUZZER_MISSED_DOSE);
+  screens.showMessage("MISSED DOSE", line, 60000);
+}
+
+// Missed dose - caregiver escalation
+void onMissedDoseNotify(const BusEvent& event) {
+  char scheduledTime[6];
+  snprintf(scheduledTime, sizeof(scheduledTime), "%02d:%02d", event.hour, event.minute);
+  queueMissedDoseNotification(nameTable.get(event.patient), nameTable.get(event.medication), scheduledTime);
+}
+
+// Missed dose - cloud history
+void onMissedDoseReport(const BusEvent& event) {
+  char description[96];
+  snprintf(description, sizeof(description), "Missed dose (clock step): %s at %02d:%02d",
+           nameTable.get(event.medication), event.hour, event.minute);
+  queueCloudReport(event.dispenserId + 1, false, description, 0);
+}
+
+// State of charge fell below LOW_BATTERY_PERCENT
+void handleLowBattery(float percent, float hoursLeft) {
+  buzzer.play(BUZZER_LOW_BATTERY);
   
-  Serial.println("✅ Reminder notification completed\n");
+  GsmRequest request = {};
+  request.action = GSM_LOW_BATTERY;
+  request.percent = percent;
+  request.hoursLeft = hoursLeft;
+  queueGsmRequest(request);
+  screens.showMessage("LOW BATTERY", (String(percent, 0) + "% ~" + String(hoursLeft, 1) + " h left").c_str(), 60000);
+}
+
+// Largest free block trend fell below the floor (log task)
+void handleLowMemory(uint32_t trendBytes, uint32_t floorBytes) {
+  GsmRequest request = {};
+  request.action = GSM_SYSTEM_ERROR;
+  snprintf(request.text, sizeof(request.text),
+           "Memory fragmented (largest block %lu B, floor %lu B). Restarting when no dose is near.",
+           (unsigned long)trendBytes, (unsigned long)floorBytes);
+  queueGsmRequest(request);
+}
+
+// A low-memory restart waits for this - nothing dispensing, alerting or due soon
+bool isQuietForRestart() {
+  if (isDispenseBusy() || notifications.isEscalating()) {
+    return false;
+  }
+  // Let the system error SMS and any reports go out first
+  if (uxQueueMessagesWaiting(gsmQueue) > 0 || uxQueueMessagesWaiting(cloudQueue) > 0) {
+    return false;
+  }
+  
+  xSemaphoreTake(scheduleLock, portMAX_DELAY);
+  int minutes = scheduleManager.getMinutesUntilNextDose();
+  xSemaphoreGive(scheduleLock);
+  return minutes < 0 || minutes > MEMORY_RESTART_QUIET_MINUTES;
+}
+
+// Log task, before light sleep - every other task must be blocked with nothing queued
+bool isQuietForSleep() {
+  if (taskMonitor.findBusyTask() >= 0) {
+    return false;
+  }
+  if (isDispenseBusy() || notifications.isEscalating() || buzzer.isPlaying() || shell.isJobRunning()) {
+    return false;
+  }
+  if (uxQueueMessagesWaiting(servoQueue) > 0 || uxQueueMessagesWaiting(gsmQueue) > 0 ||
+      uxQueueMessagesWaiting(cloudQueue) > 0) {
+    return false;
+  }
+  return !sim800.hasPendingSMS();
+}
+
+// How long the system may sleep before an alarm, heartbeat or outbox flush is due
+unsigned long msUntilRequiredWake() {
+  unsigned long wakeMs = POWER_MAX_SLEEP_MS;
+  
+  xSemaphoreTake(scheduleLock, portMAX_DELAY);
+  long seconds = scheduleManager.getSecondsUntilNextAlarm();
+  xSemaphoreGive(scheduleLock);
+  if (seconds >= 0) {
+    // Wake early enough for the schedule task to be running when the alarm comes due
+    unsigned long alarmMs = (unsigned long)seconds * 1000UL;
+    alarmMs = alarmMs > POWER_WAKE_LEAD_MS ? alarmMs - POWER_WAKE_LEAD_MS : 0;
+    wakeMs = min(wakeMs, alarmMs);
+  }
+  
+  if (WiFi.status() == WL_CONNECTED) {
+    wakeMs = min(wakeMs, firebase.getMillisUntilHeartbeat());
+  }
+  // Offline too - a missed-dose report is urgent and goes out over GPRS
+  wakeMs = min(wakeMs, firebase.getMillisUntilCloudFlush());
+  return wakeMs;
+}
+
+void onPowerWake(PowerWakeSource source) {
+  // RI pulses for an SMS; +CMTI was sent while the UART was asleep and is lost
+  if (source == POWER_WAKE_MODEM) {
+    GsmRequest request = {};
+    request.action = GSM_SCAN_SMS;
+    queueGsmRequest(request);
+  }
+}
+
+// Schedule task - lateness of each dose and reminder alarm, for comparing sleep on and off
+void onAlarmTiming(long lateMs) {
+  powerManager.recordAlarmLateness(lateMs);
+}
+
+// ===== TASK QUEUES =====
+
+String getNextDoseTime() {
+  xSemaphoreTake(scheduleLock, portMAX_DELAY);
+  String next = scheduleManager.getNextScheduleTime();
+  xSemaphoreGive(scheduleLock);
+  return next;
+}
+
+bool queueServoRequest(ServoAction action, uint8_t channel, uint8_t angle) {
+  ServoRequest request = {action, channel, angle};
+  if (xQueueSend(servoQueue, &request, 0) != pdTRUE) {
+    LOG_WARN(LOG_MOD_DISPENSE, EV_SERVO_QUEUE_FULL, action);
+    return false;
+  }
+  return true;
+}
+
+// Servo task - the only code that talks to the Arduino Uno
+void runServoRequest(const ServoRequest& request) {
+  switch (request.action) {
+    case SERVO_DISPENSE: {
+      bool success = servoController.dispensePill(request.channel);
+      xEventGroupSetBits(systemEvents, success ? EVT_SERVO_DONE : EVT_SERVO_FAILED);
+      break;
+    }
+      
+    case SERVO_STATUS:
+      Serial.println("\n========== SERVO CONTROLLER STATUS ==========");
+      if (servoController.isConnected()) {
+        Serial.println("✅ Arduino Uno connected and responding");
+      } else {
+        Serial.println("❌ Arduino Uno not responding");
+      }
+      Serial.println("=============================================");
+      break;
+      
+    case SERVO_TEST:
+      Serial.println("Testing servo " + String(request.channel) + "...");
+      servoController.testServo(request.channel);
+      Serial.println("✅ Servo test complete");
+      break;
+      
+    case SERVO_ANGLE:
+      Serial.println("Servo " + String(request.channel) + " -> " + String(request.angle) + "°");
+      servoController.setServoAngle(request.channel, request.angle);
+      break;
+      
+    case SERVO_RESET:
+      Serial.println("Resetting all servos to 90 degrees...");
+      servoController.resetAllServos();
+      Serial.println("✅ All servos reset");
+      break;
+      
+    case SERVO_RELEASE:
+      Serial.println("Moving CH5/CH6 servos to release position...");
+      servoController.moveServosToRelease();
+      Serial.println("✅ CH5/CH6 moved to release position");
+      break;
+      
+    case SERVO_HOME:
+      Serial.println("Moving CH5/CH6 servos to home position...");
+      servoController.moveServosToHome();
+      Serial.println("✅ CH5/CH6 moved to home position");
+      break;
+      
+    case SERVO_STOP:
+      Serial.println("Stopping all servos...");
+      servoController.stopAllServos();
+      Serial.println("✅ All servos stopped");
+      break;
+      
+    case SERVO_CALIBRATE:
+      Serial.println("Calibrating servo " + String(request.channel) + "...");
+      servoController.calibrateServo(request.channel);
+      Serial.println("✅ Calibration complete");
+      break;
+  }
+}
+
+void queueGsmRequest(const GsmRequest& request) {
+  if (xQueueSend(gsmQueue, &request, 0) != pdTRUE) {
+    LOG_WARN(LOG_MOD_SYSTEM, EV_GSM_QUEUE_FULL, request.action);
+  }
+}
+
+// Formats straight into the queued request - no String is built for the body
+void queueSMSNotification(const char* format, ...) {
+  GsmRequest request = {};
+  request.action = GSM_NOTIFY_CAREGIVERS;
+  va_list args;
+  va_start(args, format);
+  vsnprintf(request.text, sizeof(request.text), format, args);
+  va_end(args);
+  queueGsmRequest(request);
+}
+
+void queueMissedDoseNotification(const char* patient, const char* medication, const char* scheduledTime) {
+  GsmRequest request = {};
+  request.action = GSM_MISSED_DOSE;
+  strncpy(request.patient, patient, sizeof(request.patient) - 1);
+  strncpy(request.medication, medication, sizeof(request.medication) - 1);
+  strncpy(request.time, scheduledTime, sizeof(request.time) - 1);
+  queueGsmRequest(request);
+}
+
+void queueAcknowledge(const char* source) {
+  GsmRequest request = {};
+  request.action = GSM_ACKNOWLEDGE;
+  strncpy(request.text, source, sizeof(request.text) - 1);
+  queueGsmRequest(request);
+}
+
+// GSM task, with the modem lock held
+void runGsmRequest(const GsmRequest& request) {
+  switch (request.action) {
+    case GSM_NOTIFY_CAREGIVERS:
+      sendSMSNotification(request.text);
+      break;
+      
+    case GSM_MISSED_DOSE:
+      notifications.notifyMissedDose(request.patient, request.medication, request.time);
+      break;
+      
+    case GSM_LOW_BATTERY:
+      notifications.notifyLowBattery(request.percent, request.hoursLeft);
+      break;
+      
+    case GSM_SYSTEM_ERROR:
+      notifications.notifySystemError(request.text);
+      break;
+  
+    case GSM_ACKNOWLEDGE:
+      notifications.acknowledge(request.text);
+      break;
+  
+    case GSM_SCAN_SMS:
+      sim800.queueStoredSMS();
+      break;
+  }
+}
+
+void queueCloudReport(int container, bool updateDispenser, const char* description, int status) {
+  CloudReport report = {};
+  report.container = container;
+  report.updateDispenser = updateDispenser;
+  report.status = status;
+  strncpy(report.dateTime, timeManager.getSnapshot().dateTime, sizeof(report.dateTime) - 1);
+  strncpy(report.description, description, sizeof(report.description) - 1);
+  if (xQueueSend(cloudQueue, &report, 0) != pdTRUE) {
+    LOG_WARN(LOG_MOD_SYSTEM, EV_CLOUD_QUEUE_FULL, container);
+  }
+}
+
+// Network task - the only code that talks to Firebase
+void sendCloudReport(const CloudReport& report) {
+  if (report.updateDispenser) {
+    firebase.updateDispenserAfterDispense(report.container - 1, &timeManager);
+  }
+  firebase.sendPillReport(report.container, report.dateTime, report.description, report.status);
 }
@@ -0,0 +1,251 @@
+#include "PowerManager.h"
+#include <WiFi.h>
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "driver/uart.h"
+
+portMUX_TYPE PowerManager::powerMux = portMUX_INITIALIZER_UNLOCKED;
+
+PowerManager::PowerManager() {
+  enabled = false;
+  unoRxPin = -1;
+  ringPin = -1;
+  awakeUntil = 0;
+  sleptMs = 0;
+  msUntilWake = nullptr;
+  isQuiet = nullptr;
+  onWake = nullptr;
+  resetStats();
+}
+
+void PowerManager::begin(int8_t unoRx, int8_t ringIndicator, bool enable) {
+  unoRxPin = unoRx;
+  ringPin = ringIndicator;
+  
+  // Console: the first characters typed wake the chip and are lost
+  uart_set_wakeup_threshold(UART_NUM_0, POWER_UART_WAKE_EDGES);
+  esp_sleep_enable_uart_wakeup(UART_NUM_0);
+  
+  // The Uno link runs through the GPIO matrix, so it wakes on its start bit instead.
+  // A line held low (Uno unpowered) would wake us at once - leave it out then.
+  if (unoRxPin >= 0 && digitalRead(unoRxPin) == HIGH) {
+    gpio_wakeup_enable((gpio_num_t)unoRxPin, GPIO_INTR_LOW_LEVEL);
+  } else if (unoRxPin >= 0) {
+    Serial.println("PowerManager: ⚠️ Uno RX is low - Uno messages will not wake the ESP32");
+    unoRxPin = -1;
+  }
+  
+  // SIM800L RI is open drain, low while a call rings or briefly for an SMS
+  if (ringPin >= 0) {
+    pinMode(ringPin, INPUT_PULLUP);
+    gpio_wakeup_enable((gpio_num_t)ringPin, GPIO_INTR_LOW_LEVEL);
+  }
+  esp_sleep_enable_gpio_wakeup();
+  
+  // Radio off between DTIM beacons whenever it is idle
+  WiFi.setSleep(WIFI_PS_MAX_MODEM);
+  
+  enabled = enable;
+  awakeUntil = millis() + POWER_ACTIVITY_AWAKE_MS;
+  Serial.printf("PowerManager: Light sleep %s (wake on timer, console%s%s)\n",
+                enabled ? "enabled" : "disabled", unoRxPin >= 0 ? ", Uno" : "", ringPin >= 0 ? ", modem RI" : "");
+}
+
+void PowerManager::update() {
+  if (!enabled) {
+    return;
+  }
+  unsigned long now = millis();
+  if ((long)(awakeUntil - now) > 0) {
+    return;
+  }
+  if (isQuiet != nullptr && !isQuiet()) {
+    return;
+  }
+  
+  // A wake line already low would end the sleep at once
+  if ((ringPin >= 0 && digitalRead(ringPin) == LOW) || (unoRxPin >= 0 && digitalRead(unoRxPin) == LOW)) {
+    awakeUntil = now + POWER_ACTIVITY_AWAKE_MS;
+    return;
+  }
+  
+  unsigned long sleepMs = msUntilWake != nullptr ? msUntilWake() : POWER_MAX_SLEEP_MS;
+  unsigned long limit = WiFi.status() == WL_CONNECTED ? POWER_MAX_SLEEP_WIFI_MS : POWER_MAX_SLEEP_MS;
+  if (sleepMs > limit) {
+    sleepMs = limit;
+  }
+  if (sleepMs < POWER_MIN_SLEEP_MS) {
+    return;
+  }
+  
+  sleep(sleepMs);
+}
+
+void PowerManager::sleep(unsigned long ms) {
+  // UART FIFOs stop with the APB clock - let the console finish first
+  Serial.flush();
+  esp_sleep_enable_timer_wakeup((uint64_t)ms * 1000ULL);
+  
+  int64_t start = esp_timer_get_time();
+  esp_err_t result = esp_light_sleep_start();
+  unsigned long slept = (unsigned long)((esp_timer_get_time() - start) / 1000);
+  
+  if (result != ESP_OK) {
+    portENTER_CRITICAL(&powerMux);
+    sleepFailures++;
+    portEXIT_CRITICAL(&powerMux);
+    awakeUntil = millis() + POWER_ACTIVITY_AWAKE_MS;
+    return;
+  }
+  
+  PowerWakeSource source = wakeSource();
+  portENTER_CRITICAL(&powerMux);
+  sleepCount++;
+  sleptMs += slept;
+  statsSleptMs += slept;
+  if (slept > longestSleepMs) {
+    longestSleepMs = slept;
+  }
+  wakes[source]++;
+  lastWake = source;
+  portEXIT_CRITICAL(&powerMux);
+  
+  awakeUntil = millis() + (source == POWER_WAKE_TIMER ? POWER_MIN_AWAKE_MS : POWER_ACTIVITY_AWAKE_MS);
+  if (onWake != nullptr) {
+    onWake(source);
+  }
+}
+
+PowerWakeSource PowerManager::wakeSource() {
+  switch (esp_sleep_get_wakeup_cause()) {
+    case ESP_SLEEP_WAKEUP_TIMER:
+      return POWER_WAKE_TIMER;
+    case ESP_SLEEP_WAKEUP_UART:
+      return POWER_WAKE_CONSOLE;
+    case ESP_SLEEP_WAKEUP_GPIO:
+      // RI stays low for at least 120 ms, far longer than the wake-up
+      return ringPin >= 0 && digitalRead(ringPin) == LOW ? POWER_WAKE_MODEM : POWER_WAKE_UNO;
+    default:
+      return POWER_WAKE_OTHER;
+  }
+}
+
+void PowerManager::setEnabled(bool enable) {
+  enabled = enable;
+  awakeUntil = millis() + POWER_ACTIVITY_AWAKE_MS;
+}
+
+bool PowerManager::isEnabled() {
+  return enabled;
+}
+
+void PowerManager::setNextWakeCallback(unsigned long (*callback)()) {
+  msUntilWake = callback;
+}
+
+void PowerManager::setQuietCheck(bool (*check)()) {
+  isQuiet = check;
+}
+
+void PowerManager::setWakeCallback(void (*callback)(PowerWakeSource source)) {
+  onWake = callback;
+}
+
+void PowerManager::recordAlarmLateness(long lateMs) {
+  // Catch-ups after a reboot or a clock step say nothing about sleep
+  if (lateMs < -1000 || lateMs > POWER_LATE_WINDOW_MS) {
+    return;
+  }
+  portENTER_CRITICAL(&powerMux);
+  AlarmTiming& bucket = timing[enabled ? 1 : 0];
+  bucket.count++;
+  bucket.totalMs += lateMs;
+  if (bucket.count == 1 || lateMs > bucket.maxMs) {
+    bucket.maxMs = lateMs;
+  }
+  portEXIT_CRITICAL(&powerMux);
+}
+
+uint64_t PowerManager::getSleptMs() {
+  portENTER_CRITICAL(&powerMux);
+  uint64_t total = sleptMs;
+  portEXIT_CRITICAL(&powerMux);
+  return total;
+}
+
+float PowerManager::getSleepPercent() {
+  unsigned long window = millis() - statsStart;
+  if (window == 0) return 0;
+  portENTER_CRITICAL(&powerMux);
+  uint64_t slept = statsSleptMs;
+  portEXIT_CRITICAL(&powerMux);
+  return 100.0 * slept / window;
+}
+
+const char* PowerManager::getWakeName(PowerWakeSource source) {
+  switch (source) {
+    case POWER_WAKE_TIMER: return "timer";
+    case POWER_WAKE_CONSOLE: return "console";
+    case POWER_WAKE_UNO: return "uno";
+    case POWER_WAKE_MODEM: return "modem";
+    default: return "other";
+  }
+}
+
+void PowerManager::resetStats() {
+  portENTER_CRITICAL(&powerMux);
+  sleepCount = 0;
+  statsSleptMs = 0;
+  statsStart = millis();
+  longestSleepMs = 0;
+  memset(wakes, 0, sizeof(wakes));
+  sleepFailures = 0;
+  lastWake = POWER_WAKE_OTHER;
+  memset(timing, 0, sizeof(timing));
+  portEXIT_CRITICAL(&powerMux);
+}
+
+void PowerManager::printStatus() {
+  portENTER_CRITICAL(&powerMux);
+  unsigned long count = sleepCount;
+  uint64_t slept = statsSleptMs;
+  unsigned long longest = longestSleepMs;
+  unsigned long wakeCounts[POWER_WAKE_SOURCES];
+  memcpy(wakeCounts, wakes, sizeof(wakeCounts));
+  unsigned long failures = sleepFailures;
+  AlarmTiming timingCopy[2];
+  memcpy(timingCopy, timing, sizeof(timingCopy));
+  portEXIT_CRITICAL(&powerMux);
+  unsigned long window = millis() - statsStart;
+  
+  Serial.println("\n=== POWER ===");
+  Serial.printf("Light sleep:    %s, WiFi %s (max window %lu ms)\n", enabled ? "enabled" : "disabled",
+                WiFi.status() == WL_CONNECTED ? "connected" : "offline",
+                WiFi.status() == WL_CONNECTED ? (unsigned long)POWER_MAX_SLEEP_WIFI_MS : POWER_MAX_SLEEP_MS);
+  Serial.printf("Asleep:         %.1f%% of %lu s (%lu sleeps, longest %lu ms)\n",
+                window > 0 ? 100.0 * slept / window : 0.0, window / 1000, count, longest);
+  Serial.print("Wakes:         ");
+  for (int i = 0; i < POWER_WAKE_SOURCES; i++) {
+    Serial.printf(" %s %lu", getWakeName((PowerWakeSource)i), wakeCounts[i]);
+  }
+  Serial.println();
+  if (failures > 0) {
+    Serial.printf("Sleep refused:  %lu time(s)\n", failures);
+  }
+  if (msUntilWake != nullptr) {
+    Serial.printf("Next wake due:  %lu ms\n", msUntilWake());
+  }
+  
+  Serial.println("Alarm lateness (dose and reminder alarms, ms):");
+  const char* labels[2] = {"sleep off", "sleep on "};
+  for (int i = 0; i < 2; i++) {
+    if (timingCopy[i].count == 0) {
+      Serial.printf("  %s  no alarms yet\n", labels[i]);
+    } else {
+      Serial.printf("  %s  n=%lu avg %ld max %ld\n", labels[i], timingCopy[i].count,
+                    (long)(timingCopy[i].totalMs / (int64_t)timingCopy[i].count), timingCopy[i].maxMs);
+    }
+  }
+  Serial.println("=============\n");
+}
@@ -0,0 +1,96 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+
+#define POWER_MIN_SLEEP_MS 2000          // Shorter gaps are not worth a wake-up
+#define POWER_WAKE_LEAD_MS 2000          // Awake this long before a dose or reminder alarm
+#define POWER_MIN_AWAKE_MS 300           // After a timer wake, every task gets a pass
+#define POWER_ACTIVITY_AWAKE_MS 30000    // After console, Uno or modem activity
+#define POWER_MAX_SLEEP_WIFI_MS 5000     // Under the WiFi driver's 6 s beacon timeout
+#define POWER_MAX_SLEEP_MS 600000UL      // Offline: look around every 10 minutes anyway
+#define POWER_UART_WAKE_EDGES 3          // RX edges on the console that wake the chip
+#define POWER_LATE_WINDOW_MS 60000       // Later than this is a catch-up, not alarm timing
+
+enum PowerWakeSource {
+  POWER_WAKE_TIMER,
+  POWER_WAKE_CONSOLE,   // Serial console (UART0)
+  POWER_WAKE_UNO,       // Arduino Uno link RX
+  POWER_WAKE_MODEM,     // SIM800L ring indicator (call or SMS)
+  POWER_WAKE_OTHER,
+  POWER_WAKE_SOURCES
+};
+
+struct AlarmTiming {
+  unsigned long count;
+  int64_t totalMs;
+  long maxMs;
+};
+
+/**
+ * PowerManager
+ *
+ * Puts the ESP32 into light sleep while nothing needs it. The sketch tells
+ * it how long until the next required wake (dose or reminder alarm, cloud
+ * heartbeat, outbox flush) and whether the system is quiet; update() then
+ * sleeps until that time, waking early on console input, a byte from the
+ * Uno or the SIM800L ring indicator.
+ *
+ * Light sleep stops the WiFi radio. WiFi stays in modem sleep and windows
+ * are kept under the driver's beacon timeout while it is associated, so the
+ * link survives; only when offline are long windows taken.
+ *
+ * Sleep time feeds the battery model. Dose and reminder alarm lateness is
+ * kept separately for sleep on and off, so the cost in timing accuracy
+ * can be compared on the same unit.
+ *
+ * update() must be called from one task, outside its measured work cycle;
+ * the other methods may be called from any task.
+ */
+class PowerManager {
+private:
+  static portMUX_TYPE powerMux;
+  bool enabled;
+  int8_t unoRxPin;
+  int8_t ringPin;
+  unsigned long awakeUntil;
+  
+  // Statistics since begin() or resetStats()
+  unsigned long sleepCount;
+  uint64_t sleptMs;            // Never reset - the battery model takes differences
+  uint64_t statsSleptMs;
+  unsigned long statsStart;
+  unsigned long longestSleepMs;
+  unsigned long wakes[POWER_WAKE_SOURCES];
+  unsigned long sleepFailures;
+  PowerWakeSource lastWake;
+  AlarmTiming timing[2];       // [0] sleep off, [1] sleep on
+  
+  unsigned long (*msUntilWake)();
+  bool (*isQuiet)();
+  void (*onWake)(PowerWakeSource source);
+  
+  void sleep(unsigned long ms);
+  PowerWakeSource wakeSource();
+  
+public:
+  PowerManager();
+  void begin(int8_t unoRx, int8_t ringIndicator, bool enable);
+  void update();  // Call regularly from one task
+  
+  void setEnabled(bool enable);
+  bool isEnabled();
+  void setNextWakeCallback(unsigned long (*callback)());  // ms until something must run
+  void setQuietCheck(bool (*check)());
+  void setWakeCallback(void (*callback)(PowerWakeSource source));
+  
+  void recordAlarmLateness(long lateMs);  // From the schedule task
+  uint64_t getSleptMs();                  // Since boot
+  float getSleepPercent();                // Since the last reset
+  static const char* getWakeName(PowerWakeSource source);
+  
+  void resetStats();
+  void printStatus();
+};
+
+#endif
@@ -8,6 +8,15 @@ SIM800L::SIM800L(uint8_t rxPin, uint8_t txPin, uint8_t rstPin, HardwareSerial& s
   lastCommand = 0;
   lastNetworkCheck = 0;
   lastReconnectAttempt = 0;
+  smsReference = 0;
+  pendingSMSCount = 0;
+  callState = CALL_IDLE;
+  callResult = CALL_RESULT_NONE;
+  gprsConnected = false;
+  lastHTTPStatus = 0;
+  radioActiveMs = 0;
+  callStartedAt = 0;
+  resetStats();
 }
 
 bool SIM800L::begin(long baudRate) {
@@ -34,6 +43,7 @@ bool SIM800L::begin(long baudRate) {
     if (sendATCommand("AT+CPIN?", "READY", 5000)) {
       Serial.println("SIM800L: SIM card is ready");
       isModuleReady = true;
+      configureModule();
       return true;
     } else {
       Serial.println("SIM800L: SIM card not ready or missing");
@@ -44,6 +54,19 @@ bool SIM800L::begin(long baudRate) {
     return false;
   }
 }
+      
+void SIM800L::configureModule() {
+  // Store incoming SMS on the SIM and report them with +CMTI: "SM",<index>
+  sendATCommand("AT+CMGF=1", "OK", 3000);
+  sendATCommand("AT+CPMS=\"SM\",\"SM\",\"SM\"", "OK", 5000);
+  sendATCommand("AT+CNMI=2,1,0,0,0", "OK", 3000);
+  // Pulse RI on SMS too, not only on calls - it wakes the ESP32 from light sleep
+  sendATCommand("AT+CFGRI=1", "OK", 3000);
+  queueStoredSMS();
+      
+  // Report outgoing call progress as MO RING / MO CONNECTED
+  sendATCommand("AT+MORING=1", "OK", 3000);
+}
 
 void SIM800L::reset() {
   Serial.println("SIM800L: Resetting module...");
@@ -58,6 +81,8 @@ bool SIM800L::isReady() {
 }
 
 bool SIM800L::sendATCommand(String command, String expectedResponse, unsigned long timeout) {
+  unsigned long startTime = millis();
+  
   // Ensure minimum delay between commands
   while (millis() - lastCommand < COMMAND_DELAY) {
     delay(10);
@@ -82,6 +107,7 @@ bool SIM800L::sendATCommand(String command, String expectedResponse, unsigned lo
     Serial.println(response);
   }
   
+  recordCommand(command, startTime, success);
   return success;
 }
 
@@ -101,6 +127,33 @@ void SIM800L::waitForResponse(unsigned long timeout) {
     }
     delay(10);
   }
+  
+  scanForURCs(response);
+}
+
+void SIM800L::waitForFinalResponse(unsigned long timeout) {
+  // Like waitForResponse, but only a complete "OK"/"ERROR" line ends the read,
+  // so message bodies containing those words are not cut short
+  response = "";
+  unsigned long startTime = millis();
+  
+  while (millis() - startTime < timeout) {
+    if (sim800->available()) {
+      char c = sim800->read();
+      response += c;
+      
+      // The final OK follows a blank line; a bare OK at the start means no payload
+      if (c == '\n' && (response.endsWith("\r\n\r\nOK\r\n") || response == "\r\nOK\r\n" ||
+                        response == "OK\r\n" || response.endsWith("ERROR\r\n") ||
+                        response.indexOf("+CMS ERROR") >= 0)) {
+        break;
+      }
+    } else {
+      delay(10);
+    }
+  }
+  
+  scanForURCs(response);
 }
 
 String SIM800L::getResponse() {
@@ -108,10 +161,108 @@ String SIM800L::getResponse() {
 }
 
 void SIM800L::clearBuffer() {
+  // Anything waiting here arrived unsolicited - keep URCs, drop the rest
+  processURCs();
+  response = "";
+}
+
+void SIM800L::processURCs() {
   while (sim800->available()) {
-    sim800->read();
+    char c = sim800->read();
+    if (c == '\n') {
+      urcLine.trim();
+      if (urcLine.length() > 0) {
+        handleURC(urcLine);
+      }
+      urcLine = "";
+    } else if (urcLine.length() < 128) {
+      urcLine += c;
+    }
   }
-  response = "";
+}
+
+void SIM800L::scanForURCs(const String& text) {
+  int start = 0;
+  while (start < (int)text.length()) {
+    int end = text.indexOf('\n', start);
+    if (end < 0) end = text.length();
+    String line = text.substring(start, end);
+    line.trim();
+    if (isURC(line)) {
+      handleURC(line);
+    }
+    start = end + 1;
+  }
+}
+
+bool SIM800L::isURC(const String& line) {
+  return line.startsWith("+CMTI:") || line == "MO RING" || line == "MO CONNECTED" ||
+         line == "BUSY" || line == "NO ANSWER" || line == "NO CARRIER" || line == "NO DIALTONE";
+}
+
+void SIM800L::handleURC(const String& line) {
+  // New SMS - handled in any call state, an ACK during an escalation call matters most
+  if (line.startsWith("+CMTI:")) {
+    // +CMTI: "SM",3
+    int comma = line.lastIndexOf(',');
+    if (comma > 0) {
+      int index = line.substring(comma + 1).toInt();
+      Serial.println("📩 SIM800L: New SMS stored at index " + String(index));
+      queuePendingSMS(index);
+    }
+    return;
+  }
+  
+  // Call progress - only meaningful while one of our calls is in progress
+  if (callState == CALL_IDLE || callState == CALL_ENDED) {
+    return;
+  }
+  if (line == "MO RING") {
+    callState = CALL_RINGING;
+    Serial.println("📞 SIM800L: Ringing");
+  } else if (line == "MO CONNECTED") {
+    callState = CALL_CONNECTED;
+    callResult = CALL_RESULT_ANSWERED;
+    Serial.println("📞 SIM800L: Call answered");
+  } else if (line == "BUSY") {
+    endCall(CALL_RESULT_BUSY);
+  } else if (line == "NO ANSWER") {
+    endCall(CALL_RESULT_NO_ANSWER);
+  } else if (line == "NO CARRIER") {
+    // After MO CONNECTED this is just the far end hanging up
+    endCall(callState == CALL_CONNECTED ? CALL_RESULT_ANSWERED : CALL_RESULT_NO_CARRIER);
+  } else if (line == "NO DIALTONE") {
+    endCall(CALL_RESULT_FAILED);
+  }
+}
+
+void SIM800L::queuePendingSMS(int index) {
+  if (index <= 0) return;
+  
+  for (uint8_t i = 0; i < pendingSMSCount; i++) {
+    if (pendingSMS[i] == index) return; // Already queued
+  }
+  
+  if (pendingSMSCount >= MAX_PENDING_SMS) {
+    Serial.println("⚠️ SIM800L: Pending SMS queue full, index " + String(index) + " left on SIM");
+    return;
+  }
+  pendingSMS[pendingSMSCount++] = index;
+}
+
+bool SIM800L::hasPendingSMS() {
+  return pendingSMSCount > 0;
+}
+
+int SIM800L::popPendingSMS() {
+  if (pendingSMSCount == 0) return -1;
+  
+  int index = pendingSMS[0];
+  for (uint8_t i = 1; i < pendingSMSCount; i++) {
+    pendingSMS[i - 1] = pendingSMS[i];
+  }
+  pendingSMSCount--;
+  return index;
 }
 
 void SIM800L::printResponse() {
@@ -132,6 +283,7 @@ bool SIM800L::checkNetworkRegistration() {
     if (isNetworkRegistered) {
       Serial.println("⚠️ SIM800L: Network connection lost");
       isNetworkRegistered = false;
+      statRegistrationLosses++;
     }
     return false;
   }
@@ -161,53 +313,256 @@ bool SIM800L::sendSMS(String phoneNumber, String message) {
     return false;
   }
   
+  unsigned long startTime = millis();
+  
+  // Encode as GSM-7 or UCS2, split into concatenated parts if needed
+  SMSPduPart parts[SMS_MAX_PARTS];
+  SMSEncoding encoding;
+  int partCount = SMSEncoder::encode(phoneNumber, message, smsReference++, parts, SMS_MAX_PARTS, &encoding);
+  if (partCount == 0) {
+    Serial.println("SIM800L: SMS encoding failed");
+    return recordSMS(false, 0, startTime);
+  }
+  
   Serial.print("SIM800L: Sending SMS to ");
-  Serial.println(phoneNumber);
+  Serial.print(phoneNumber);
+  Serial.printf(" (%s, %d part%s)\n",
+                encoding == SMS_ENCODING_UCS2 ? "UCS2" : "GSM-7",
+                partCount, partCount > 1 ? "s" : "");
+  
+  // Set SMS PDU mode
+  if (!sendATCommand("AT+CMGF=0", "OK", 3000)) {
+    return recordSMS(false, 0, startTime);
+  }
   
-  // Set SMS text mode
-  if (!sendATCommand("AT+CMGF=1", "OK", 3000)) {
-    return false;
+  for (int i = 0; i < partCount; i++) {
+    if (!sendPDU(parts[i])) {
+      Serial.printf("SIM800L: SMS sending failed at part %d/%d\n", i + 1, partCount);
+      return recordSMS(false, i, startTime);
+    }
   }
   
-  // Set recipient
-  String recipient = "AT+CMGS=\"" + phoneNumber + "\"";
-  sim800->println(recipient);
-  delay(1000);
+  Serial.println("SIM800L: SMS sent successfully");
+  return recordSMS(true, partCount, startTime);
+}
+
+bool SIM800L::sendPDU(const SMSPduPart& part) {
+  // Ensure minimum delay between commands
+  while (millis() - lastCommand < COMMAND_DELAY) {
+    delay(10);
+  }
+  
+  clearBuffer();
+  
+  sim800->println("AT+CMGS=" + String(part.tpduLength));
+  lastCommand = millis();
+  
+  if (!waitForPrompt(5000)) {
+    Serial.println("⚠️ SIM800L: No '>' prompt for PDU, got: " + response);
+    sim800->write(27); // ESC aborts the pending send
+    return false;
+  }
   
-  // Send message
-  sim800->print(message);
-  delay(500);
+  sim800->print(part.pdu);
   sim800->write(26); // Ctrl+Z to send
   
-  waitForResponse(10000);
+  waitForResponse(15000);
   
-  if (response.indexOf("+CMGS:") >= 0) {
-    Serial.println("SIM800L: SMS sent successfully");
-    return true;
-  } else {
-    Serial.println("SIM800L: SMS sending failed");
+  return response.indexOf("+CMGS:") >= 0;
+}
+
+bool SIM800L::waitForPrompt(unsigned long timeout) {
+  response = "";
+  unsigned long startTime = millis();
+  
+  while (millis() - startTime < timeout) {
+    if (sim800->available()) {
+      char c = sim800->read();
+      response += c;
+      
+      if (c == '>') {
+        return true;
+      }
+      if (response.indexOf("ERROR") >= 0) {
+        return false;
+      }
+    }
+    delay(10);
+  }
+  return false;
+}
+
+bool SIM800L::waitForText(const String& text, unsigned long timeout) {
+  // Appends to the current response so callers can parse what came before
+  unsigned long startTime = millis();
+  
+  while (millis() - startTime < timeout) {
+    if (sim800->available()) {
+      char c = sim800->read();
+      response += c;
+      
+      if (response.endsWith(text)) {
+        return true;
+      }
+      if (response.endsWith("ERROR")) {
+        return false;
+      }
+    } else {
+      delay(10);
+    }
+  }
+  return false;
+}
+
+void SIM800L::queueStoredSMS() {
+  // List every stored message in text mode: +CMGL: <index>,"<stat>",...
+  if (!sendATCommand("AT+CMGF=1", "OK", 3000)) {
+    return;
+  }
+  
+  while (millis() - lastCommand < COMMAND_DELAY) {
+    delay(10);
+  }
+  clearBuffer();
+  sim800->println("AT+CMGL=\"ALL\"");
+  lastCommand = millis();
+  waitForFinalResponse(10000);
+  
+  int start = 0;
+  int queued = 0;
+  while ((start = response.indexOf("+CMGL:", start)) >= 0) {
+    int comma = response.indexOf(',', start);
+    if (comma < 0) break;
+    queuePendingSMS(response.substring(start + 6, comma).toInt());
+    queued++;
+    start = comma;
+  }
+  
+  if (queued > 0) {
+    Serial.println("SIM800L: " + String(queued) + " stored SMS queued for processing");
+  }
+}
+
+bool SIM800L::readSMS(int index) {
+  lastSMSSender = "";
+  lastSMSBody = "";
+  
+  if (!sendATCommand("AT+CMGF=1", "OK", 3000)) {
+    return false;
+  }
+  
+  while (millis() - lastCommand < COMMAND_DELAY) {
+    delay(10);
+  }
+  clearBuffer();
+  sim800->println("AT+CMGR=" + String(index));
+  lastCommand = millis();
+  waitForFinalResponse(5000);
+  
+  // +CMGR: "REC UNREAD","+639171234567","","24/10/18,12:00:00+32"\r\n<body>\r\n\r\nOK
+  int header = response.indexOf("+CMGR:");
+  if (header < 0) {
+    Serial.println("SIM800L: No SMS at index " + String(index));
+    return false;
+  }
+  
+  int quote1 = response.indexOf('"', header);             // Opens status
+  int quote2 = response.indexOf('"', quote1 + 1);         // Closes status
+  int quote3 = response.indexOf('"', quote2 + 1);         // Opens sender
+  int quote4 = response.indexOf('"', quote3 + 1);         // Closes sender
+  if (quote1 < 0 || quote2 < 0 || quote3 < 0 || quote4 < 0) {
+    Serial.println("SIM800L: Malformed +CMGR header");
     return false;
   }
+  lastSMSSender = response.substring(quote3 + 1, quote4);
+  
+  int bodyStart = response.indexOf('\n', header);
+  int bodyEnd = response.lastIndexOf("\r\nOK");
+  if (bodyStart >= 0 && bodyEnd > bodyStart) {
+    lastSMSBody = response.substring(bodyStart + 1, bodyEnd);
+    lastSMSBody.trim();
+  }
+  
+  return true;
+}
+
+bool SIM800L::deleteSMS(int index) {
+  return sendATCommand("AT+CMGD=" + String(index), "OK", 5000);
+}
+
+String SIM800L::getLastSMS() {
+  return lastSMSBody;
+}
+
+String SIM800L::getLastSMSSender() {
+  return lastSMSSender;
 }
 
 bool SIM800L::makeCall(String phoneNumber) {
+  callStartedAt = millis();
+  callState = CALL_DIALING;
+  callResult = CALL_RESULT_NONE;
+  
   if (!isReady()) {
     Serial.println("SIM800L: Module not ready for call");
+    endCall(CALL_RESULT_FAILED);
     return false;
   }
   
   String dialCommand = "ATD" + phoneNumber + ";";
-  return sendATCommand(dialCommand, "OK", 5000);
+  if (!sendATCommand(dialCommand, "OK", 5000)) {
+    // A BUSY/NO CARRIER URC may already have ended the call
+    if (callState != CALL_ENDED) {
+      endCall(CALL_RESULT_FAILED);
+    }
+    return false;
+  }
+  
+  Serial.println("📞 SIM800L: Dialing " + phoneNumber);
+  return true;
 }
 
 bool SIM800L::hangupCall() {
-  return sendATCommand("ATH", "OK", 3000);
+  bool success = sendATCommand("ATH", "OK", 3000);
+  if (callState != CALL_IDLE && callState != CALL_ENDED) {
+    endCall(callState == CALL_CONNECTED ? CALL_RESULT_ANSWERED : CALL_RESULT_NO_ANSWER);
+  }
+  return success;
 }
 
 bool SIM800L::answerCall() {
   return sendATCommand("ATA", "OK", 3000);
 }
 
+void SIM800L::endCall(CallResult result) {
+  if (callStartedAt != 0) {
+    radioActiveMs += millis() - callStartedAt;
+    callStartedAt = 0;
+  }
+  callState = CALL_ENDED;
+  callResult = result;
+  Serial.println("📞 SIM800L: Call ended - " + getCallResultName(result));
+}
+
+CallState SIM800L::getCallState() {
+  return callState;
+}
+
+CallResult SIM800L::getCallResult() {
+  return callResult;
+}
+
+String SIM800L::getCallResultName(CallResult result) {
+  switch (result) {
+    case CALL_RESULT_ANSWERED: return "answered";
+    case CALL_RESULT_BUSY: return "busy";
+    case CALL_RESULT_NO_ANSWER: return "no answer";
+    case CALL_RESULT_NO_CARRIER: return "no carrier";
+    case CALL_RESULT_FAILED: return "failed";
+    default: return "none";
+  }
+}
+
 void SIM800L::printModuleInfo() {
   Serial.println("=== SIM800L Module Info ===");
   
@@ -231,6 +586,80 @@ void SIM800L::printModuleInfo() {
   Serial.println("==========================");
 }
 
+void SIM800L::recordCommand(const String& command, unsigned long startTime, bool success) {
+  unsigned long elapsed = millis() - startTime;
+  
+  statCommands++;
+  statBlockedMs += elapsed;
+  if (!success) {
+    statFailures++;
+    if (response.length() == 0) {
+      statTimeouts++; // Modem said nothing at all
+    }
+  }
+  if (elapsed > statMaxStallMs) {
+    statMaxStallMs = elapsed;
+    statMaxStallCommand = command;
+  }
+}
+
+bool SIM800L::recordSMS(bool success, int parts, unsigned long startTime) {
+  if (success) {
+    statSMSSent++;
+  } else {
+    statSMSFailed++;
+  }
+  statSMSParts += parts;
+  statSMSMs += millis() - startTime;
+  radioActiveMs += millis() - startTime;
+  return success;
+}
+
+void SIM800L::resetStats() {
+  statCommands = 0;
+  statFailures = 0;
+  statTimeouts = 0;
+  statBlockedMs = 0;
+  statMaxStallMs = 0;
+  statMaxStallCommand = "";
+  statSMSSent = 0;
+  statSMSFailed = 0;
+  statSMSParts = 0;
+  statSMSMs = 0;
+  statRegistrationLosses = 0;
+  statsSince = millis();
+}
+
+unsigned long SIM800L::getRadioActiveMs() {
+  return radioActiveMs;
+}
+
+void SIM800L::printStats() {
+  unsigned long window = millis() - statsSince;
+  unsigned long smsAttempts = statSMSSent + statSMSFailed;
+  
+  Serial.println("\n=== SIM800L Link Statistics ===");
+  Serial.printf("Window: %lu s\n", window / 1000);
+  Serial.printf("AT commands: %lu (failed: %lu, no reply: %lu)\n", statCommands, statFailures, statTimeouts);
+  Serial.printf("Time blocked in AT commands: %lu ms (%.2f%% of window)\n",
+                statBlockedMs, window > 0 ? statBlockedMs * 100.0 / window : 0.0);
+  if (statCommands > 0) {
+    Serial.printf("Average command: %lu ms\n", statBlockedMs / statCommands);
+  }
+  Serial.printf("Longest stall: %lu ms (%s)\n", statMaxStallMs,
+                statMaxStallCommand.length() > 0 ? statMaxStallCommand.c_str() : "-");
+  Serial.printf("SMS: %lu sent, %lu failed, %lu parts\n", statSMSSent, statSMSFailed, statSMSParts);
+  if (smsAttempts > 0) {
+    Serial.printf("SMS time: %lu ms avg per message", statSMSMs / smsAttempts);
+    if (statSMSMs > 0) {
+      Serial.printf(", %.1f parts/min", statSMSParts * 60000.0 / statSMSMs);
+    }
+    Serial.println();
+  }
+  Serial.printf("Registration losses: %lu\n", statRegistrationLosses);
+  Serial.println("===============================");
+}
+
 void SIM800L::testModule() {
   Serial.println("SIM800L: Starting module test");
   
@@ -290,6 +719,125 @@ void SIM800L::testCall() {
   Serial.println("SIM800L: Call test complete");
 }
 
+bool SIM800L::enableGPRS(String apn, String username, String password) {
+  if (isGPRSConnected()) {
+    return true;
+  }
+  
+  Serial.println("SIM800L: Opening GPRS bearer (APN: " + apn + ")...");
+  
+  sendATCommand("AT+SAPBR=3,1,\"Contype\",\"GPRS\"", "OK", 3000);
+  if (!sendATCommand("AT+SAPBR=3,1,\"APN\",\"" + apn + "\"", "OK", 3000)) {
+    return false;
+  }
+  if (username.length() > 0) {
+    sendATCommand("AT+SAPBR=3,1,\"USER\",\"" + username + "\"", "OK", 3000);
+  }
+  if (password.length() > 0) {
+    sendATCommand("AT+SAPBR=3,1,\"PWD\",\"" + password + "\"", "OK", 3000);
+  }
+  
+  // Opening the bearer can take a while on a weak network
+  sendATCommand("AT+SAPBR=1,1", "OK", 30000);
+  
+  if (isGPRSConnected()) {
+    Serial.println("✅ SIM800L: GPRS bearer open");
+    return true;
+  }
+  
+  Serial.println("❌ SIM800L: Failed to open GPRS bearer");
+  return false;
+}
+
+bool SIM800L::disableGPRS() {
+  sendATCommand("AT+HTTPTERM", "OK", 2000); // Harmless if no HTTP session is open
+  bool closed = sendATCommand("AT+SAPBR=0,1", "OK", 10000);
+  gprsConnected = false;
+  Serial.println("SIM800L: GPRS bearer closed");
+  return closed;
+}
+
+bool SIM800L::isGPRSConnected() {
+  // +SAPBR: 1,1,"10.x.x.x" means bearer 1 is connected
+  gprsConnected = sendATCommand("AT+SAPBR=2,1", "+SAPBR: 1,1", 3000);
+  return gprsConnected;
+}
+
+bool SIM800L::sendHTTPRequest(String url, String data, String extraHeader) {
+  lastHTTPStatus = 0;
+  
+  if (!gprsConnected) {
+    Serial.println("SIM800L: Cannot send HTTP request - GPRS not connected");
+    return false;
+  }
+  
+  // The module would answer ERROR to the whole command line
+  if (url.length() > SIM800_HTTP_URL_MAX) {
+    Serial.println("SIM800L: URL too long for AT+HTTPPARA (" + String(url.length()) + " characters)");
+    return false;
+  }
+  
+  unsigned long startTime = millis();
+  sendATCommand("AT+HTTPTERM", "OK", 2000); // Clear any stale session
+  if (!sendATCommand("AT+HTTPINIT", "OK", 5000)) {
+    return false;
+  }
+  
+  bool success = false;
+  
+  do {
+    if (!sendATCommand("AT+HTTPPARA=\"CID\",1", "OK", 3000)) break;
+    if (!sendATCommand("AT+HTTPPARA=\"URL\",\"" + url + "\"", "OK", 5000)) break;
+    if (url.startsWith("https://") && !sendATCommand("AT+HTTPSSL=1", "OK", 3000)) break;
+    if (extraHeader.length() > 0 &&
+        !sendATCommand("AT+HTTPPARA=\"USERDATA\",\"" + extraHeader + "\"", "OK", 3000)) break;
+    
+    int action = 0; // GET
+    if (data.length() > 0) {
+      action = 1; // POST
+      if (!sendATCommand("AT+HTTPPARA=\"CONTENT\",\"application/json\"", "OK", 3000)) break;
+      
+      // Upload the body: modem answers DOWNLOAD, then OK once all bytes arrived
+      clearBuffer();
+      sim800->println("AT+HTTPDATA=" + String(data.length()) + ",10000");
+      lastCommand = millis();
+      if (!waitForText("DOWNLOAD", 5000)) {
+        Serial.println("⚠️ SIM800L: HTTPDATA not accepted: " + response);
+        break;
+      }
+      sim800->print(data);
+      waitForResponse(10000);
+      if (response.indexOf("OK") < 0) break;
+    }
+    
+    // Result arrives asynchronously as +HTTPACTION: <method>,<status>,<length>
+    if (!sendATCommand("AT+HTTPACTION=" + String(action), "OK", 5000)) break;
+    if (!waitForText("+HTTPACTION:", 60000)) {
+      Serial.println("⚠️ SIM800L: HTTP request timed out");
+      break;
+    }
+    waitForText("\n", 1000); // Rest of the status line
+    
+    int marker = response.indexOf("+HTTPACTION:");
+    int comma1 = response.indexOf(',', marker);
+    int comma2 = response.indexOf(',', comma1 + 1);
+    if (comma1 > 0 && comma2 > comma1) {
+      lastHTTPStatus = response.substring(comma1 + 1, comma2).toInt();
+    }
+    
+    success = lastHTTPStatus >= 200 && lastHTTPStatus < 300;
+    Serial.println("SIM800L: HTTP status " + String(lastHTTPStatus));
+  } while (false);
+  
+  sendATCommand("AT+HTTPTERM", "OK", 2000);
+  radioActiveMs += millis() - startTime;
+  return success;
+}
+
+int SIM800L::getLastHTTPStatus() {
+  return lastHTTPStatus;
+}
+
 void SIM800L::testGPRS() {
   Serial.println("SIM800L: Testing GPRS functionality");
   Serial.println("SIM800L: Note - This requires APN configuration");
@@ -309,6 +857,9 @@ void SIM800L::testGPRS() {
 void SIM800L::update() {
   unsigned long currentMillis = millis();
   
+  // Pick up +CMTI and other URCs that arrived while idle
+  processURCs();
+  
   // Periodic network registration check
   if (currentMillis - lastNetworkCheck >= NETWORK_CHECK_INTERVAL) {
     checkNetworkRegistration();
@@ -334,6 +885,8 @@ bool SIM800L::attemptNetworkReconnect() {
     
     // Reinitialize after reset
     sendATCommand("ATE0", "OK", 3000); // Disable echo
+    isModuleReady = false;
+    gprsConnected = false;  // The bearer went with the reset
   }
   
   // Check SIM card
@@ -342,6 +895,12 @@ bool SIM800L::attemptNetworkReconnect() {
     return false;
   }
   
+  // After a reset, or if begin() never got this far, the settings are the module's defaults
+  if (!isModuleReady) {
+    isModuleReady = true;
+    configureModule();
+  }
+  
   // Force network search
   sendATCommand("AT+COPS=0", "OK", 30000); // Auto network selection (may take up to 30s)
   
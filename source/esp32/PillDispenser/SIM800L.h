@@ -4,6 +4,28 @@
 #include <Arduino.h>
 
 #include <HardwareSerial.h>
+#include "SMSEncoder.h"
+
+#define MAX_PENDING_SMS 8  // Inbound message indexes queued from +CMTI URCs
+#define SIM800_HTTP_URL_MAX 536  // AT+HTTPPARA="URL","..." must fit the 556-character command line
+
+// Outgoing voice call progress, driven by MO RING / MO CONNECTED and final call URCs
+enum CallState {
+  CALL_IDLE,
+  CALL_DIALING,
+  CALL_RINGING,
+  CALL_CONNECTED,
+  CALL_ENDED
+};
+
+enum CallResult {
+  CALL_RESULT_NONE,
+  CALL_RESULT_ANSWERED,
+  CALL_RESULT_BUSY,
+  CALL_RESULT_NO_ANSWER,
+  CALL_RESULT_NO_CARRIER,
+  CALL_RESULT_FAILED
+};
 
 
 class SIM800L {
@@ -16,9 +38,64 @@ private:
   unsigned long lastCommand;
   unsigned long lastNetworkCheck;
   unsigned long lastReconnectAttempt;
+  uint8_t smsReference; // Concatenated SMS reference, incremented per message
+  
+  // Inbound SMS tracking
+  int pendingSMS[MAX_PENDING_SMS];
+  uint8_t pendingSMSCount;
+  String urcLine;
+  String lastSMSSender;
+  String lastSMSBody;
+  
+  // Voice call state
+  CallState callState;
+  CallResult callResult;
+  
+  // GPRS/HTTP state
+  bool gprsConnected;
+  int lastHTTPStatus;
+  
+  // Link statistics - how long the modem blocks the caller and how often it fails
+  unsigned long statCommands;
+  unsigned long statFailures;
+  unsigned long statTimeouts;
+  unsigned long statBlockedMs;
+  unsigned long statMaxStallMs;
+  String statMaxStallCommand;
+  unsigned long statSMSSent;
+  unsigned long statSMSFailed;
+  unsigned long statSMSParts;
+  unsigned long statSMSMs;
+  unsigned long statRegistrationLosses;
+  unsigned long statsSince;
+  
+  // Time the radio spent transmitting (SMS, calls, HTTP) - never reset, for the battery model
+  unsigned long radioActiveMs;
+  unsigned long callStartedAt;
+  
   static const unsigned long COMMAND_DELAY = 1000;
   static const unsigned long NETWORK_CHECK_INTERVAL = 60000; // Check every 60 seconds
   static const unsigned long RECONNECT_INTERVAL = 30000; // Retry every 30 seconds
+  
+  // SMS storage, URCs and RI - lost on every module reset
+  void configureModule();
+  
+  // PDU mode helpers
+  bool sendPDU(const SMSPduPart& part);
+  bool waitForPrompt(unsigned long timeout);
+  bool waitForText(const String& text, unsigned long timeout);
+  
+  // Unsolicited result code handling
+  void processURCs();
+  void handleURC(const String& line);
+  void scanForURCs(const String& text);
+  void queuePendingSMS(int index);
+  static bool isURC(const String& line);
+  void endCall(CallResult result);
+  
+  // Statistics helpers
+  void recordCommand(const String& command, unsigned long startTime, bool success);
+  bool recordSMS(bool success, int parts, unsigned long startTime);
 
 public:
   SIM800L(uint8_t rxPin, uint8_t txPin, uint8_t rstPin, HardwareSerial& serialPort = Serial2);
@@ -44,16 +121,25 @@ public:
   bool readSMS(int index);
   bool deleteSMS(int index);
   String getLastSMS();
+  String getLastSMSSender();
+  bool hasPendingSMS();
+  int popPendingSMS();
+  void queueStoredSMS(); // Queue messages already on the SIM (e.g. received while offline)
 
   // Call operations
   bool makeCall(String phoneNumber);
   bool hangupCall();
   bool answerCall();
+  CallState getCallState();
+  CallResult getCallResult();
+  static String getCallResultName(CallResult result);
 
   // GPRS/Internet operations
   bool enableGPRS(String apn, String username = "", String password = "");
   bool disableGPRS();
-  bool sendHTTPRequest(String url, String data = "");
+  bool isGPRSConnected();
+  bool sendHTTPRequest(String url, String data = "", String extraHeader = ""); // POST if data, else GET
+  int getLastHTTPStatus();
 
   // Testing functions
   void testModule();
@@ -61,10 +147,16 @@ public:
   void testCall();
   void testGPRS();
   void printModuleInfo();
+  
+  // Link statistics
+  void printStats();
+  void resetStats();
+  unsigned long getRadioActiveMs();
 
   // Utility functions
   void waitForResponse(unsigned long timeout = 5000);
   bool waitForOK(unsigned long timeout = 5000);
+  void waitForFinalResponse(unsigned long timeout = 5000); // Ends on a bare OK/ERROR line
   void printResponse();
 };
 
@@ -0,0 +1,188 @@
+#include "SMSCommandHandler.h"
+#include <Arduino.h>
+
+SMSCommandHandler::SMSCommandHandler(SIM800L* sim800Module) {
+  sim800 = sim800Module;
+  authorizedCount = 0;
+  queueHead = 0;
+  queueCount = 0;
+  lastFetch = 0;
+}
+
+bool SMSCommandHandler::addAuthorizedSender(String number) {
+  if (number.length() == 0) {
+    return false;
+  }
+
+  if (authorizedCount >= MAX_AUTHORIZED_SENDERS) {
+    Serial.println("SMSCommandHandler: Max authorized senders reached");
+    return false;
+  }
+
+  for (int i = 0; i < authorizedCount; i++) {
+    if (numbersMatch(authorizedSenders[i], number)) {
+      return true; // Already authorized
+    }
+  }
+
+  authorizedSenders[authorizedCount++] = number;
+  Serial.println("SMSCommandHandler: Authorized sender " + number);
+  return true;
+}
+
+bool SMSCommandHandler::numbersMatch(const String& a, const String& b) {
+  // Compare the last 10 digits so +639171234567 matches 09171234567
+  const uint8_t SIGNIFICANT_DIGITS = 10;
+  int ia = a.length() - 1;
+  int ib = b.length() - 1;
+  uint8_t compared = 0;
+
+  while (compared < SIGNIFICANT_DIGITS) {
+    while (ia >= 0 && (a[ia] < '0' || a[ia] > '9')) ia--;
+    while (ib >= 0 && (b[ib] < '0' || b[ib] > '9')) ib--;
+    if (ia < 0 || ib < 0) {
+      // One number ran out of digits - match only if both did
+      return ia < 0 && ib < 0 && compared > 0;
+    }
+    if (a[ia] != b[ib]) {
+      return false;
+    }
+    ia--;
+    ib--;
+    compared++;
+  }
+  return true;
+}
+
+bool SMSCommandHandler::isAuthorized(const String& sender) {
+  for (int i = 0; i < authorizedCount; i++) {
+    if (numbersMatch(authorizedSenders[i], sender)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void SMSCommandHandler::update() {
+  if (sim800 == nullptr || !sim800->hasPendingSMS()) {
+    return;
+  }
+
+  if (millis() - lastFetch < FETCH_INTERVAL) {
+    return;
+  }
+  lastFetch = millis();
+
+  int index = sim800->popPendingSMS();
+  bool fetched = sim800->readSMS(index);
+  String sender = sim800->getLastSMSSender();
+  String body = sim800->getLastSMS();
+
+  // Always delete so SIM storage never fills up, even for rejected messages
+  if (!sim800->deleteSMS(index)) {
+    Serial.println("⚠️ SMSCommandHandler: Failed to delete SMS at index " + String(index));
+  }
+
+  if (!fetched) {
+    return;
+  }
+
+  if (!isAuthorized(sender)) {
+    Serial.println("⚠️ SMSCommandHandler: Ignoring SMS from unauthorized sender " + sender);
+    return;
+  }
+
+  SMSCommand command = parseCommand(body);
+  command.sender = sender;
+
+  Serial.println("📩 SMSCommandHandler: Command from " + sender + ": " + body);
+
+  if (!enqueue(command)) {
+    sendReply(sender, "[PILL DISPENSER] Busy - please retry in a minute.");
+  }
+}
+
+SMSCommand SMSCommandHandler::parseCommand(String body) {
+  SMSCommand command;
+  command.type = SMS_CMD_UNKNOWN;
+  command.argument = 0;
+
+  body.trim();
+  body.toUpperCase();
+
+  // Only the first word is the command, anything after the argument is ignored
+  int space = body.indexOf(' ');
+  String verb = space > 0 ? body.substring(0, space) : body;
+  String argument = space > 0 ? body.substring(space + 1) : "";
+  argument.trim();
+
+  if (verb == "STATUS") {
+    command.type = SMS_CMD_STATUS;
+  } else if (verb == "DISPENSE") {
+    command.type = SMS_CMD_DISPENSE;
+    command.argument = argument.toInt();
+  } else if (verb == "SKIP") {
+    command.type = SMS_CMD_SKIP;
+  } else if (verb == "ACK" || verb == "OK") {
+    command.type = SMS_CMD_ACK;
+  } else if (verb == "HELP") {
+    command.type = SMS_CMD_HELP;
+  }
+
+  return command;
+}
+
+bool SMSCommandHandler::enqueue(const SMSCommand& command) {
+  if (queueCount >= SMS_COMMAND_QUEUE_SIZE) {
+    Serial.println("⚠️ SMSCommandHandler: Command queue full");
+    return false;
+  }
+
+  int tail = (queueHead + queueCount) % SMS_COMMAND_QUEUE_SIZE;
+  commandQueue[tail] = command;
+  queueCount++;
+  return true;
+}
+
+bool SMSCommandHandler::hasCommand() {
+  return queueCount > 0;
+}
+
+SMSCommand SMSCommandHandler::popCommand() {
+  SMSCommand command;
+  command.type = SMS_CMD_NONE;
+  command.argument = 0;
+
+  if (queueCount == 0) {
+    return command;
+  }
+
+  command = commandQueue[queueHead];
+  commandQueue[queueHead].sender = "";
+  queueHead = (queueHead + 1) % SMS_COMMAND_QUEUE_SIZE;
+  queueCount--;
+  return command;
+}
+
+bool SMSCommandHandler::sendReply(String phoneNumber, String message) {
+  if (sim800 == nullptr) {
+    return false;
+  }
+
+  if (sim800->sendSMS(phoneNumber, message)) {
+    Serial.println("✅ SMSCommandHandler: Reply sent to " + phoneNumber);
+    return true;
+  }
+
+  Serial.println("❌ SMSCommandHandler: Failed to reply to " + phoneNumber);
+  return false;
+}
+
+String SMSCommandHandler::getHelpText() {
+  return "[PILL DISPENSER] Commands:\n"
+         "STATUS - device status\n"
+         "DISPENSE <1-5> - dispense now\n"
+         "SKIP - skip next dose\n"
+         "ACK - stop missed-dose calls\n"
+         "HELP - this list";
+}
@@ -0,0 +1,80 @@
+#ifndef SMS_COMMAND_HANDLER_H
+#define SMS_COMMAND_HANDLER_H
+
+#include <Arduino.h>
+#include "SIM800L.h"
+
+/**
+ * SMSCommandHandler
+ *
+ * Inbound SMS command channel for caregivers without WiFi access.
+ *
+ * New messages are announced by the SIM800L as +CMTI URCs. Each one is
+ * fetched with AT+CMGR, deleted from the SIM, checked against the list of
+ * authorized caregiver numbers and parsed into a command that the main
+ * sketch drains alongside the Firebase dispense commands.
+ *
+ * Supported commands (case-insensitive):
+ *   STATUS       - Reply with device status
+ *   DISPENSE <n> - Dispense from container n (1-5)
+ *   SKIP         - Skip the next scheduled dose
+ *   ACK          - Acknowledge a missed-dose alert and stop escalation calls
+ *   HELP         - Reply with the command list
+ */
+
+#define MAX_AUTHORIZED_SENDERS 3
+#define SMS_COMMAND_QUEUE_SIZE 4
+
+enum SMSCommandType {
+  SMS_CMD_NONE,
+  SMS_CMD_STATUS,
+  SMS_CMD_DISPENSE,
+  SMS_CMD_SKIP,
+  SMS_CMD_ACK,
+  SMS_CMD_HELP,
+  SMS_CMD_UNKNOWN
+};
+
+struct SMSCommand {
+  SMSCommandType type;
+  int argument;   // Container number for DISPENSE
+  String sender;  // Number to reply to
+};
+
+class SMSCommandHandler {
+private:
+  SIM800L* sim800;
+  String authorizedSenders[MAX_AUTHORIZED_SENDERS];
+  int authorizedCount;
+
+  SMSCommand commandQueue[SMS_COMMAND_QUEUE_SIZE];
+  int queueHead;
+  int queueCount;
+
+  unsigned long lastFetch;
+  static const unsigned long FETCH_INTERVAL = 2000; // One message per 2 seconds keeps loop() responsive
+
+  bool isAuthorized(const String& sender);
+  bool enqueue(const SMSCommand& command);
+
+public:
+  SMSCommandHandler(SIM800L* sim800Module);
+
+  // Sender authentication
+  bool addAuthorizedSender(String number);
+  static bool numbersMatch(const String& a, const String& b);
+
+  // Call in loop() - fetches, authenticates, parses and deletes one pending SMS
+  void update();
+
+  // Command queue
+  bool hasCommand();
+  SMSCommand popCommand();
+  static SMSCommand parseCommand(String body);
+
+  // Replies
+  bool sendReply(String phoneNumber, String message);
+  static String getHelpText();
+};
+
+#endif
@@ -0,0 +1,284 @@
+#include "SMSEncoder.h"
+#include <Arduino.h>
+
+// GSM 03.38 default alphabet, indexed by septet value
+const uint16_t SMSEncoder::GSM7_BASIC[128] = {
+  0x0040, 0x00A3, 0x0024, 0x00A5, 0x00E8, 0x00E9, 0x00F9, 0x00EC,
+  0x00F2, 0x00C7, 0x000A, 0x00D8, 0x00F8, 0x000D, 0x00C5, 0x00E5,
+  0x0394, 0x005F, 0x03A6, 0x0393, 0x039B, 0x03A9, 0x03A0, 0x03A8,
+  0x03A3, 0x0398, 0x039E, 0x001B, 0x00C6, 0x00E6, 0x00DF, 0x00C9,
+  0x0020, 0x0021, 0x0022, 0x0023, 0x00A4, 0x0025, 0x0026, 0x0027,
+  0x0028, 0x0029, 0x002A, 0x002B, 0x002C, 0x002D, 0x002E, 0x002F,
+  0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+  0x0038, 0x0039, 0x003A, 0x003B, 0x003C, 0x003D, 0x003E, 0x003F,
+  0x00A1, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047,
+  0x0048, 0x0049, 0x004A, 0x004B, 0x004C, 0x004D, 0x004E, 0x004F,
+  0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057,
+  0x0058, 0x0059, 0x005A, 0x00C4, 0x00D6, 0x00D1, 0x00DC, 0x00A7,
+  0x00BF, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067,
+  0x0068, 0x0069, 0x006A, 0x006B, 0x006C, 0x006D, 0x006E, 0x006F,
+  0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077,
+  0x0078, 0x0079, 0x007A, 0x00E4, 0x00F6, 0x00F1, 0x00FC, 0x00E0
+};
+
+uint16_t SMSEncoder::decodeUTF8(const String& text, uint16_t* units, uint16_t maxUnits) {
+  const uint8_t* bytes = (const uint8_t*)text.c_str();
+  size_t length = text.length();
+  uint16_t count = 0;
+  size_t i = 0;
+
+  while (i < length && count < maxUnits) {
+    uint32_t codePoint;
+    uint8_t b = bytes[i];
+    int extra;
+
+    if (b < 0x80)                { codePoint = b;        extra = 0; }
+    else if ((b & 0xE0) == 0xC0) { codePoint = b & 0x1F; extra = 1; }
+    else if ((b & 0xF0) == 0xE0) { codePoint = b & 0x0F; extra = 2; }
+    else if ((b & 0xF8) == 0xF0) { codePoint = b & 0x07; extra = 3; }
+    else                         { codePoint = '?';      extra = 0; }  // Stray continuation byte
+    i++;
+
+    for (int k = 0; k < extra; k++) {
+      if (i >= length || (bytes[i] & 0xC0) != 0x80) {
+        codePoint = '?';  // Truncated sequence
+        break;
+      }
+      codePoint = (codePoint << 6) | (bytes[i] & 0x3F);
+      i++;
+    }
+
+    if (codePoint >= 0x10000) {
+      // Surrogate pair - never split between two units of storage
+      if (count + 2 > maxUnits) break;
+      codePoint -= 0x10000;
+      units[count++] = 0xD800 | (codePoint >> 10);
+      units[count++] = 0xDC00 | (codePoint & 0x3FF);
+    } else {
+      units[count++] = (uint16_t)codePoint;
+    }
+  }
+
+  if (i < length) {
+    Serial.println("SMSEncoder: ⚠️ Message too long, truncated");
+  }
+  return count;
+}
+
+int32_t SMSEncoder::lookupGSM7(uint16_t unit) {
+  // Fast path for characters that map to themselves
+  if ((unit >= 'A' && unit <= 'Z') || (unit >= 'a' && unit <= 'z') ||
+      (unit >= '0' && unit <= '9') || unit == ' ') {
+    return unit;
+  }
+
+  for (uint8_t septet = 0; septet < 128; septet++) {
+    if (GSM7_BASIC[septet] == unit && septet != 0x1B) {
+      return septet;
+    }
+  }
+
+  // Extension table (sent as ESC + code)
+  switch (unit) {
+    case 0x000C: return 0x1B0A;  // Form feed
+    case '^':    return 0x1B14;
+    case '{':    return 0x1B28;
+    case '}':    return 0x1B29;
+    case '\\':   return 0x1B2F;
+    case '[':    return 0x1B3C;
+    case '~':    return 0x1B3D;
+    case ']':    return 0x1B3E;
+    case '|':    return 0x1B40;
+    case 0x20AC: return 0x1B65;  // Euro sign
+    default:     return -1;
+  }
+}
+
+SMSEncoding SMSEncoder::detectEncoding(const String& message) {
+  uint16_t units[MAX_UNITS];
+  uint16_t count = decodeUTF8(message, units, MAX_UNITS);
+
+  for (uint16_t i = 0; i < count; i++) {
+    if (lookupGSM7(units[i]) < 0) {
+      return SMS_ENCODING_UCS2;
+    }
+  }
+  return SMS_ENCODING_GSM7;
+}
+
+void SMSEncoder::appendHexByte(String& out, uint8_t value) {
+  static const char HEX_DIGITS[] = "0123456789ABCDEF";
+  out += HEX_DIGITS[value >> 4];
+  out += HEX_DIGITS[value & 0x0F];
+}
+
+void SMSEncoder::appendHeader(String& out, const String& phoneNumber, bool concatenated,
+                              SMSEncoding encoding) {
+  // Collect destination digits
+  char digits[21];
+  uint8_t digitCount = 0;
+  bool international = phoneNumber.startsWith("+");
+  for (unsigned int i = 0; i < phoneNumber.length() && digitCount < 20; i++) {
+    char c = phoneNumber[i];
+    if (c >= '0' && c <= '9') {
+      digits[digitCount++] = c;
+    }
+  }
+
+  appendHexByte(out, 0x00);                           // SMSC: use number stored on SIM
+  appendHexByte(out, concatenated ? 0x41 : 0x01);     // SMS-SUBMIT, UDHI when concatenated
+  appendHexByte(out, 0x00);                           // Message reference (set by modem)
+  appendHexByte(out, digitCount);                     // Destination length in digits
+  appendHexByte(out, international ? 0x91 : 0x81);    // Type of address
+
+  // Destination in swapped semi-octets, padded with F
+  for (uint8_t i = 0; i < digitCount; i += 2) {
+    uint8_t low = digits[i] - '0';
+    uint8_t high = (i + 1 < digitCount) ? (digits[i + 1] - '0') : 0x0F;
+    appendHexByte(out, (high << 4) | low);
+  }
+
+  appendHexByte(out, 0x00);                                       // Protocol identifier
+  appendHexByte(out, encoding == SMS_ENCODING_UCS2 ? 0x08 : 0x00); // Data coding scheme
+}
+
+void SMSEncoder::appendUDH(String& out, uint8_t reference, uint8_t total, uint8_t sequence) {
+  appendHexByte(out, 0x05);  // UDH length
+  appendHexByte(out, 0x00);  // IEI: concatenated SMS, 8-bit reference
+  appendHexByte(out, 0x03);  // IE length
+  appendHexByte(out, reference);
+  appendHexByte(out, total);
+  appendHexByte(out, sequence);
+}
+
+void SMSEncoder::packSeptets(String& out, const uint8_t* septets, uint16_t count, bool hasUDH) {
+  // A 6-octet UDH occupies 48 bits; user data starts on the next septet boundary (bit 49)
+  uint16_t startBit = hasUDH ? 49 : 0;
+  uint16_t skipOctets = hasUDH ? 6 : 0;
+  uint16_t totalBits = startBit + count * 7;
+  uint16_t totalOctets = (totalBits + 7) / 8;
+
+  uint32_t accumulator = 0;
+  uint8_t bits = 0;
+  uint16_t emitted = 0;
+
+  // Fill bits between the UDH and the first septet
+  if (hasUDH) {
+    bits = startBit - skipOctets * 8;
+  }
+
+  for (uint16_t i = 0; i < count; i++) {
+    accumulator |= (uint32_t)(septets[i] & 0x7F) << bits;
+    bits += 7;
+    while (bits >= 8) {
+      appendHexByte(out, accumulator & 0xFF);
+      accumulator >>= 8;
+      bits -= 8;
+      emitted++;
+    }
+  }
+
+  if (emitted < totalOctets - skipOctets) {
+    appendHexByte(out, accumulator & 0xFF);
+  }
+}
+
+int SMSEncoder::encode(const String& phoneNumber, const String& message, uint8_t reference,
+                       SMSPduPart* parts, int maxParts, SMSEncoding* encodingOut) {
+  if (parts == nullptr || maxParts <= 0) {
+    return 0;
+  }
+
+  uint16_t units[MAX_UNITS];
+  uint16_t unitCount = decodeUTF8(message, units, MAX_UNITS);
+
+  // Try GSM-7 first, falling back to UCS2 on the first unmappable character
+  uint8_t septets[MAX_UNITS];
+  uint16_t septetCount = 0;
+  SMSEncoding encoding = SMS_ENCODING_GSM7;
+
+  for (uint16_t i = 0; i < unitCount; i++) {
+    int32_t code = lookupGSM7(units[i]);
+    if (code < 0) {
+      encoding = SMS_ENCODING_UCS2;
+      break;
+    }
+    if (code > 0x7F) {
+      if (septetCount + 2 > MAX_UNITS) break;
+      septets[septetCount++] = 0x1B;
+      septets[septetCount++] = code & 0x7F;
+    } else {
+      if (septetCount + 1 > MAX_UNITS) break;
+      septets[septetCount++] = code;
+    }
+  }
+
+  uint16_t total = (encoding == SMS_ENCODING_GSM7) ? septetCount : unitCount;
+  uint16_t singleLimit = (encoding == SMS_ENCODING_GSM7) ? GSM7_SINGLE_SEPTETS : UCS2_SINGLE_UNITS;
+  uint16_t partLimit = (encoding == SMS_ENCODING_GSM7) ? GSM7_PART_SEPTETS : UCS2_PART_UNITS;
+
+  // Split into chunks without breaking escape sequences or surrogate pairs
+  uint16_t chunkStart[SMS_MAX_PARTS + 1];
+  int partCount = 0;
+  chunkStart[0] = 0;
+
+  if (total <= singleLimit) {
+    partCount = 1;
+    chunkStart[1] = total;
+  } else {
+    uint16_t position = 0;
+    while (position < total && partCount < maxParts && partCount < SMS_MAX_PARTS) {
+      uint16_t end = min((uint16_t)(position + partLimit), total);
+      if (end < total) {
+        if (encoding == SMS_ENCODING_GSM7 && septets[end - 1] == 0x1B) {
+          end--;
+        } else if (encoding == SMS_ENCODING_UCS2 && (units[end - 1] & 0xFC00) == 0xD800) {
+          end--;
+        }
+      }
+      chunkStart[partCount] = position;
+      chunkStart[partCount + 1] = end;
+      partCount++;
+      position = end;
+    }
+    if (position < total) {
+      Serial.printf("SMSEncoder: ⚠️ Message exceeds %d parts, truncated\n", partCount);
+    }
+  }
+
+  bool concatenated = partCount > 1;
+  if (encodingOut != nullptr) {
+    *encodingOut = encoding;
+  }
+
+  for (int p = 0; p < partCount; p++) {
+    uint16_t from = chunkStart[p];
+    uint16_t length = chunkStart[p + 1] - from;
+    String pdu;
+    pdu.reserve(40 + 2 * 140);
+
+    appendHeader(pdu, phoneNumber, concatenated, encoding);
+
+    if (encoding == SMS_ENCODING_GSM7) {
+      appendHexByte(pdu, (concatenated ? 7 : 0) + length);  // UDL in septets
+      if (concatenated) {
+        appendUDH(pdu, reference, partCount, p + 1);
+      }
+      packSeptets(pdu, septets + from, length, concatenated);
+    } else {
+      appendHexByte(pdu, (concatenated ? 6 : 0) + length * 2);  // UDL in octets
+      if (concatenated) {
+        appendUDH(pdu, reference, partCount, p + 1);
+      }
+      for (uint16_t i = 0; i < length; i++) {
+        appendHexByte(pdu, units[from + i] >> 8);
+        appendHexByte(pdu, units[from + i] & 0xFF);
+      }
+    }
+
+    parts[p].pdu = pdu;
+    parts[p].tpduLength = pdu.length() / 2 - 1;  // Exclude the SMSC octet
+  }
+
+  return partCount;
+}
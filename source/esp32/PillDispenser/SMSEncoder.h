@@ -0,0 +1,70 @@
+#ifndef SMS_ENCODER_H
+#define SMS_ENCODER_H
+
+#include <Arduino.h>
+
+/**
+ * SMSEncoder
+ *
+ * Builds SMS-SUBMIT PDUs for the SIM800L in PDU mode (AT+CMGF=0).
+ *
+ * Each message is checked against the GSM 03.38 default alphabet. If every
+ * character fits (including the escaped extension table) the message is
+ * packed as GSM-7, otherwise it is sent as UCS2. Messages longer than one
+ * SMS are split into concatenated parts with an 8-bit reference UDH.
+ *
+ * Single part:   160 GSM-7 septets or 70 UCS2 characters
+ * Concatenated:  153 GSM-7 septets or 67 UCS2 characters per part
+ */
+
+#define SMS_MAX_PARTS 4  // Longer messages are truncated to this many parts
+
+enum SMSEncoding {
+  SMS_ENCODING_GSM7,
+  SMS_ENCODING_UCS2
+};
+
+struct SMSPduPart {
+  String pdu;          // Hex PDU, starting with the "00" SMSC octet (use SIM default)
+  uint8_t tpduLength;  // Octets after the SMSC field - the value AT+CMGS expects
+};
+
+class SMSEncoder {
+private:
+  static const uint16_t GSM7_SINGLE_SEPTETS = 160;
+  static const uint16_t GSM7_PART_SEPTETS = 153;
+  static const uint16_t UCS2_SINGLE_UNITS = 70;
+  static const uint16_t UCS2_PART_UNITS = 67;
+  static const uint16_t MAX_UNITS = SMS_MAX_PARTS * GSM7_PART_SEPTETS;
+
+  static const uint16_t GSM7_BASIC[128];
+
+  // Decode UTF-8 into UTF-16 code units, returns unit count
+  static uint16_t decodeUTF8(const String& text, uint16_t* units, uint16_t maxUnits);
+
+  // Returns septet (0x1B00 | code for extension table) or -1 if not representable
+  static int32_t lookupGSM7(uint16_t unit);
+
+  static void appendHexByte(String& out, uint8_t value);
+  static void appendHeader(String& out, const String& phoneNumber, bool concatenated, SMSEncoding encoding);
+  static void appendUDH(String& out, uint8_t reference, uint8_t total, uint8_t sequence);
+  static void packSeptets(String& out, const uint8_t* septets, uint16_t count, bool hasUDH);
+
+public:
+  static SMSEncoding detectEncoding(const String& message);
+
+  /**
+   * Encode a message into one or more PDU parts
+   * @param phoneNumber Destination in international (+63...) or national format
+   * @param message UTF-8 message text
+   * @param reference Concatenation reference shared by all parts
+   * @param parts Output array
+   * @param maxParts Capacity of the output array
+   * @param encodingOut Optional - receives the encoding that was chosen
+   * @return Number of parts written (0 on error)
+   */
+  static int encode(const String& phoneNumber, const String& message, uint8_t reference,
+                    SMSPduPart* parts, int maxParts, SMSEncoding* encodingOut = nullptr);
+};
+
+#endif
@@ -1,26 +1,38 @@
 #include "ScheduleManager.h"
+#include "EventLog.h"
 #include <Arduino.h>
+#include <Preferences.h>
 
 // Static instance for callbacks
 ScheduleManager* ScheduleManager::instance = nullptr;
 
 ScheduleManager::ScheduleManager() {
   scheduleCount = 0;
-  onDispenseCallback = nullptr;
-  onReminderCallback = nullptr;
+  eventBus = nullptr;
   onNotifyCallback = nullptr;
+  onAlarmTiming = nullptr;
   timeManager = nullptr;
+  cacheChecksum = 0;
+  syncing = false;
+  memset(syncSeen, 0, sizeof(syncSeen));
   instance = this;
   
   // Initialize all schedules
   for (int i = 0; i < MAX_SCHEDULES; i++) {
-    schedules[i].id = "";
+    schedules[i].id[0] = '\0';
     schedules[i].dispenserId = -1;
     schedules[i].hour = 0;
     schedules[i].minute = 0;
     schedules[i].enabled = false;
+    schedules[i].medicationId = NAME_NONE;
+    schedules[i].patientId = NAME_NONE;
+    schedules[i].pillSizeId = NAME_NONE;
     schedules[i].alarmId = dtINVALID_ALARM_ID;
     schedules[i].reminderAlarmId = dtINVALID_ALARM_ID;
+    schedules[i].skipNext = false;
+    schedules[i].graceMinutes = DEFAULT_GRACE_MINUTES;
+    schedules[i].lastFiredSlot = 0;
+    schedules[i].lastReminderSlot = 0;
     for (int j = 0; j < 7; j++) {
       schedules[i].weekdays[j] = true; // Default: all days enabled
     }
@@ -33,20 +45,22 @@ void ScheduleManager::begin(String deviceId) {
   Serial.println("ScheduleManager: Max schedules: " + String(MAX_SCHEDULES));
 }
 
+void ScheduleManager::setTimeManager(TimeManager* tm) {
+  timeManager = tm;
+  if (timeManager != nullptr) {
+    timeManager->setClockStepCallback(clockStepCallback);
+  }
+}
+
 void ScheduleManager::update() {
   // TimeAlarms service routine is called via Alarm.delay() in main loop
   // No need to call it here
   // Debug prints removed to reduce serial spam
 }
 
-bool ScheduleManager::addSchedule(String id, int dispenserId, int hour, int minute,
-                                  String medicationName, String patientName,
-                                  String pillSize, bool enabled) {
-  if (scheduleCount >= MAX_SCHEDULES) {
-    Serial.println("ScheduleManager: Cannot add schedule - maximum reached");
-    return false;
-  }
-  
+bool ScheduleManager::addSchedule(const char* id, int dispenserId, int hour, int minute,
+                                  const char* medicationName, const char* patientName,
+                                  const char* pillSize, bool enabled) {
   if (dispenserId < 0 || dispenserId > 4) {
     Serial.println("ScheduleManager: Invalid dispenser ID (must be 0-4)");
     return false;
@@ -57,9 +71,18 @@ bool ScheduleManager::addSchedule(String id, int dispenserId, int hour, int minu
     return false;
   }
   
+  if (id == nullptr || id[0] == '\0' || strlen(id) >= SCHEDULE_ID_MAX) {
+    Serial.println("ScheduleManager: Invalid schedule ID");
+    return false;
+  }
+  
   // Check if schedule ID already exists - update it instead of rejecting
   for (int i = 0; i < scheduleCount; i++) {
-    if (schedules[i].id == id) {
+    if (strcmp(schedules[i].id, id) == 0) {
+      // Runtime state (fired slots, grace, skip) stays with the schedule
+      if (syncing) {
+        syncSeen[i] = true;
+      }
       Serial.println("ScheduleManager: Schedule ID exists - updating instead");
       // Free the old dispense alarm
       if (schedules[i].alarmId != dtINVALID_ALARM_ID) {
@@ -75,9 +98,7 @@ bool ScheduleManager::addSchedule(String id, int dispenserId, int hour, int minu
       schedules[i].hour = hour;
       schedules[i].minute = minute;
       schedules[i].enabled = enabled;
-      schedules[i].medicationName = medicationName;
-      schedules[i].patientName = patientName;
-      schedules[i].pillSize = pillSize;
+      internNames(i, medicationName, patientName, pillSize);
       
       // Create new alarms if enabled
       if (enabled) {
@@ -94,17 +115,7 @@ bool ScheduleManager::addSchedule(String id, int dispenserId, int hour, int minu
             schedules[i].reminderAlarmId = Alarm.alarmRepeat(reminderHour, reminderMinute, 0, reminderCallback);
           }
           
-          Serial.println("\n" + String('─', 60));
-          Serial.println("✅ SCHEDULE UPDATED");
-          Serial.printf("   Schedule ID: %s\n", id.c_str());
-          Serial.printf("   Dispense Time: %02d:%02d:00\n", hour, minute);
-          Serial.printf("   Reminder Time: %02d:%02d:00 (15 min before)\n", reminderHour, reminderMinute);
-          Serial.printf("   Medication: %s\n", medicationName.c_str());
-          Serial.printf("   Patient: %s\n", patientName.c_str());
-          Serial.printf("   Dispenser ID: %d\n", dispenserId);
-          Serial.printf("   Dispense AlarmID: %d\n", schedules[i].alarmId);
-          Serial.printf("   Reminder AlarmID: %d\n", schedules[i].reminderAlarmId);
-          Serial.println(String('─', 60) + "\n");
+          LOG_INFO(LOG_MOD_SCHEDULE, EV_SCHEDULE_UPDATED, i, hour * 100 + minute, dispenserId + 1);
         }
       } else {
         schedules[i].alarmId = dtINVALID_ALARM_ID;
@@ -115,15 +126,27 @@ bool ScheduleManager::addSchedule(String id, int dispenserId, int hour, int minu
     }
   }
   
+  // A full table mid-sync still holds schedules that may be gone - drop those first
+  if (scheduleCount >= MAX_SCHEDULES && syncing) {
+    removeUnseen();
+  }
+  if (scheduleCount >= MAX_SCHEDULES) {
+    Serial.println("ScheduleManager: Cannot add schedule - maximum reached");
+    return false;
+  }
+  
   int index = scheduleCount;
-  schedules[index].id = id;
+  strncpy(schedules[index].id, id, SCHEDULE_ID_MAX - 1);
+  schedules[index].id[SCHEDULE_ID_MAX - 1] = '\0';
   schedules[index].dispenserId = dispenserId;
   schedules[index].hour = hour;
   schedules[index].minute = minute;
   schedules[index].enabled = enabled;
-  schedules[index].medicationName = medicationName;
-  schedules[index].patientName = patientName;
-  schedules[index].pillSize = pillSize;
+  internNames(index, medicationName, patientName, pillSize);
+  schedules[index].skipNext = false;
+  schedules[index].graceMinutes = DEFAULT_GRACE_MINUTES;
+  schedules[index].lastFiredSlot = 0;
+  schedules[index].lastReminderSlot = 0;
   
   // Create alarm if enabled
   if (enabled) {
@@ -140,46 +163,38 @@ bool ScheduleManager::addSchedule(String id, int dispenserId, int hour, int minu
         schedules[index].reminderAlarmId = Alarm.alarmRepeat(reminderHour, reminderMinute, 0, reminderCallback);
       }
       
-      Serial.println("\n" + String('─', 60));
-      Serial.println("✅✅✅ ALARM CREATED SUCCESSFULLY ✅✅✅");
-      Serial.printf("   Schedule Index: %d\n", index);
-      Serial.printf("   Dispense Time: %02d:%02d:00\n", schedules[index].hour, schedules[index].minute);
-      Serial.printf("   Reminder Time: %02d:%02d:00 (15 min before)\n", reminderHour, reminderMinute);
-      Serial.printf("   Medication: %s\n", medicationName.c_str());
-      Serial.printf("   Patient: %s\n", patientName.c_str());
-      Serial.printf("   Dispenser ID: %d (Container %d)\n", dispenserId, dispenserId + 1);
-      Serial.printf("   Dispense AlarmID: %d %s\n", schedules[index].alarmId, 
-                    schedules[index].alarmId == dtINVALID_ALARM_ID ? "❌ INVALID!" : "✅ VALID");
-      Serial.printf("   Reminder AlarmID: %d %s\n", schedules[index].reminderAlarmId,
-                    schedules[index].reminderAlarmId == dtINVALID_ALARM_ID ? "❌ INVALID!" : "✅ VALID");
-      Serial.printf("   Current TimeLib time: %02d:%02d:%02d\n", ::hour(), ::minute(), ::second());
-      Serial.printf("   Total alarms registered: %d\n", Alarm.count());
-      
       // Calculate time until alarm
       int currentMinutes = ::hour() * 60 + ::minute();
       int alarmMinutes = schedules[index].hour * 60 + schedules[index].minute;
       int minutesUntil = alarmMinutes - currentMinutes;
       if (minutesUntil < 0) minutesUntil += 1440; // Next day
-      Serial.printf("   Minutes until alarm: %d\n", minutesUntil);
-      Serial.println(String('─', 60) + "\n");
+      
+      if (schedules[index].alarmId == dtINVALID_ALARM_ID) {
+        LOG_ERROR(LOG_MOD_SCHEDULE, EV_ALARM_ALLOC_FAILED, index);
+      } else {
+        LOG_INFO(LOG_MOD_SCHEDULE, EV_ALARM_CREATED, index, hour * 100 + minute, minutesUntil);
+      }
     } else {
-      Serial.println("ScheduleManager: ❌ Warning - No callback available for schedule " + String(index));
+      LOG_ERROR(LOG_MOD_SCHEDULE, EV_NO_DISPENSE_CALLBACK, index);
     }
   } else {
-    Serial.println("⚠️  Schedule disabled, no alarm created");
+    LOG_INFO(LOG_MOD_SCHEDULE, EV_SCHEDULE_DISABLED, index);
     schedules[index].alarmId = dtINVALID_ALARM_ID;
     schedules[index].reminderAlarmId = dtINVALID_ALARM_ID;
   }
   
+  if (syncing) {
+    syncSeen[index] = true;
+  }
   scheduleCount++;
   
-  Serial.println("ScheduleManager: Schedule added - Total: " + String(scheduleCount));
+  LOG_INFO(LOG_MOD_SCHEDULE, EV_SCHEDULE_COUNT, scheduleCount);
   return true;
 }
 
-bool ScheduleManager::removeSchedule(String id) {
+bool ScheduleManager::removeSchedule(const char* id) {
   for (int i = 0; i < scheduleCount; i++) {
-    if (schedules[i].id == id) {
+    if (strcmp(schedules[i].id, id) == 0) {
       // Free the dispense alarm
       if (schedules[i].alarmId != dtINVALID_ALARM_ID) {
         Alarm.free(schedules[i].alarmId);
@@ -195,18 +210,18 @@ bool ScheduleManager::removeSchedule(String id) {
       }
       
       scheduleCount--;
-      Serial.println("ScheduleManager: Schedule removed - " + id);
+      Serial.printf("ScheduleManager: Schedule removed - %s\n", id);
       return true;
     }
   }
   
-  Serial.println("ScheduleManager: Schedule not found - " + id);
+  Serial.printf("ScheduleManager: Schedule not found - %s\n", id);
   return false;
 }
 
-bool ScheduleManager::updateSchedule(String id, int hour, int minute, bool enabled) {
+bool ScheduleManager::updateSchedule(const char* id, int hour, int minute, bool enabled) {
   for (int i = 0; i < scheduleCount; i++) {
-    if (schedules[i].id == id) {
+    if (strcmp(schedules[i].id, id) == 0) {
       // Remove old dispense alarm
       if (schedules[i].alarmId != dtINVALID_ALARM_ID) {
         Alarm.free(schedules[i].alarmId);
@@ -242,7 +257,7 @@ bool ScheduleManager::updateSchedule(String id, int hour, int minute, bool enabl
                        schedules[i].hour, schedules[i].minute, reminderHour, reminderMinute);
         }
       } else {
-        Serial.println("ScheduleManager: Schedule disabled - " + id);
+        Serial.printf("ScheduleManager: Schedule disabled - %s\n", id);
       }
       
       return true;
@@ -265,6 +280,51 @@ void ScheduleManager::clearAllSchedules() {
   Serial.println("ScheduleManager: All schedules cleared");
 }
 
+void ScheduleManager::beginSync() {
+  syncing = true;
+  memset(syncSeen, 0, sizeof(syncSeen));
+}
+
+int ScheduleManager::endSync() {
+  if (!syncing) {
+    return 0;
+  }
+  syncing = false;
+  return removeUnseen();
+}
+
+int ScheduleManager::removeUnseen() {
+  int kept = 0;
+  for (int i = 0; i < scheduleCount; i++) {
+    if (syncSeen[i]) {
+      if (kept != i) {
+        schedules[kept] = schedules[i];
+      }
+      kept++;
+      continue;
+    }
+    if (schedules[i].alarmId != dtINVALID_ALARM_ID) {
+      Alarm.free(schedules[i].alarmId);
+    }
+    if (schedules[i].reminderAlarmId != dtINVALID_ALARM_ID) {
+      Alarm.free(schedules[i].reminderAlarmId);
+    }
+    Serial.printf("ScheduleManager: Schedule removed - %s\n", schedules[i].id);
+  }
+  
+  int removed = scheduleCount - kept;
+  scheduleCount = kept;
+  memset(syncSeen, 0, sizeof(syncSeen));
+  for (int i = 0; i < kept; i++) {
+    syncSeen[i] = true;
+  }
+  if (removed > 0) {
+    // Alarm callbacks are tied to the slot index, which moved for some schedules
+    rearmAllSchedules();
+  }
+  return removed;
+}
+
 int ScheduleManager::getScheduleCount() {
   return scheduleCount;
 }
@@ -284,9 +344,9 @@ MedicationSchedule* ScheduleManager::getSchedule(int index) {
   return nullptr;
 }
 
-MedicationSchedule* ScheduleManager::getScheduleById(String id) {
+MedicationSchedule* ScheduleManager::getScheduleById(const char* id) {
   for (int i = 0; i < scheduleCount; i++) {
-    if (schedules[i].id == id) {
+    if (strcmp(schedules[i].id, id) == 0) {
       return &schedules[i];
     }
   }
@@ -317,70 +377,239 @@ bool ScheduleManager::isTodayScheduled(int scheduleIndex) {
 }
 
 void ScheduleManager::triggerSchedule(int scheduleIndex) {
-  Serial.println("\n" + String('█', 70));
-  Serial.println("⏰⏰⏰ ALARM CALLBACK TRIGGERED ⏰⏰⏰");
-  Serial.println(String('█', 70));
-  Serial.printf("Schedule Index: %d\n", scheduleIndex);
-  Serial.printf("Current TimeLib: %02d:%02d:%02d\n", hour(), minute(), second());
-  Serial.println(String('█', 70));
+  LOG_INFO(LOG_MOD_SCHEDULE, EV_ALARM_FIRED, scheduleIndex, hour() * 100 + minute());
   
   if (scheduleIndex < 0 || scheduleIndex >= scheduleCount) {
-    Serial.println("❌ Invalid schedule index: " + String(scheduleIndex));
-    Serial.println(String('█', 70) + "\n");
+    LOG_ERROR(LOG_MOD_SCHEDULE, EV_SCHEDULE_BAD_INDEX, scheduleIndex);
     return;
   }
   
   MedicationSchedule* schedule = &schedules[scheduleIndex];
-  Serial.printf("Schedule Time: %02d:%02d\n", schedule->hour, schedule->minute);
-  Serial.printf("Dispenser: %d (Container %d)\n", schedule->dispenserId, schedule->dispenserId + 1);
-  Serial.println("Medication: " + schedule->medicationName);
-  Serial.println("Enabled: " + String(schedule->enabled ? "YES" : "NO"));
   
   if (!schedule->enabled) {
-    Serial.println("❌ Schedule disabled, skipping");
-    Serial.println(String('█', 70) + "\n");
+    LOG_INFO(LOG_MOD_SCHEDULE, EV_DOSE_DISABLED, scheduleIndex);
     return;
   }
   
-  // Check if today is a scheduled day
-  if (!isTodayScheduled(scheduleIndex)) {
-    Serial.println("❌ Not scheduled for today, skipping");
-    Serial.println(String('█', 70) + "\n");
+  // A provisional clock may be hours behind - NTP's catch-up handles this slot
+  if (timeManager != nullptr && !timeManager->isTimeValid()) {
+    Serial.println("ScheduleManager: ⚠️ Clock not confirmed - dose held until NTP");
     return;
   }
   
-  Serial.println("✅✅✅ ALL CHECKS PASSED - DISPENSING NOW ✅✅✅");
-  Serial.println("\n" + String('█', 70));
-  Serial.println("⏰ SCHEDULED DISPENSING IN PROGRESS");
-  Serial.println(String('█', 70));
-  Serial.printf("Time: %02d:%02d\n", schedule->hour, schedule->minute);
-  Serial.println("Patient: " + schedule->patientName);
-  Serial.println("Medication: " + schedule->medicationName);
-  Serial.printf("Will send DP%d command to Arduino\n", schedule->dispenserId);
-  Serial.println("Pill Size: " + schedule->pillSize);
-  Serial.println(String('█', 70));
-  
-  // Trigger dispense callback
-  if (onDispenseCallback != nullptr) {
-    Serial.println("✅ Calling dispense callback...");
-    onDispenseCallback(schedule->dispenserId, schedule->pillSize, 
-                      schedule->medicationName, schedule->patientName);
-  } else {
-    Serial.println("❌❌❌ ERROR: NO DISPENSE CALLBACK SET! ❌❌❌");
-    Serial.println("The alarm triggered but cannot dispense!");
+  // The occurrence being served - a late catch-up may belong to yesterday
+  time_t slot = occurrenceAtOrBefore(schedule->hour, schedule->minute, now());
+  
+  // Check if the occurrence falls on a scheduled day
+  if (!isScheduledOn(scheduleIndex, slot)) {
+    LOG_INFO(LOG_MOD_SCHEDULE, EV_DOSE_NOT_TODAY, scheduleIndex);
+    return;
+  }
+  
+  // A backward clock step can bring an alarm round again - never dispense twice
+  if (schedule->lastFiredSlot == slot) {
+    LOG_WARN(LOG_MOD_SCHEDULE, EV_DOSE_ALREADY_HANDLED, scheduleIndex);
+    return;
+  }
+  markDoseHandled(scheduleIndex, slot);
+  if (onAlarmTiming != nullptr) {
+    onAlarmTiming(msPastSlot(slot));
+  }
+  
+  // Check if a caregiver asked to skip this dose
+  if (schedule->skipNext) {
+    schedule->skipNext = false;
+    saveCache();  // Or a reboot would skip the following dose too
+    LOG_INFO(LOG_MOD_SCHEDULE, EV_DOSE_SKIPPED, scheduleIndex);
+    return;
+  }
+  
+  LOG_INFO(LOG_MOD_SCHEDULE, EV_DOSE_DUE, scheduleIndex, schedule->dispenserId + 1,
+           schedule->hour * 100 + schedule->minute);
+  
+  // Dispensing happens in the bus subscribers, after this alarm callback returns
+  publishDoseEvent(BUS_DOSE_DUE, scheduleIndex);
+}
+
+void ScheduleManager::setEventBus(EventBus* bus) {
+  eventBus = bus;
+}
+
+bool ScheduleManager::publishDoseEvent(BusEventType type, int scheduleIndex) {
+  if (eventBus == nullptr) {
+    LOG_ERROR(LOG_MOD_SCHEDULE, EV_NO_DISPENSE_CALLBACK, scheduleIndex);
+    return false;
   }
-  Serial.println(String('█', 70) + "\n");
+  
+  MedicationSchedule* schedule = &schedules[scheduleIndex];
+  BusEvent event = {};
+  event.type = type;
+  event.scheduleIndex = scheduleIndex;
+  event.dispenserId = schedule->dispenserId;
+  event.hour = schedule->hour;
+  event.minute = schedule->minute;
+  event.medication = schedule->medicationId;
+  event.patient = schedule->patientId;
+  event.pillSize = schedule->pillSizeId;
+  return eventBus->publish(event);
 }
 
-void ScheduleManager::setDispenseCallback(void (*callback)(int, String, String, String)) {
-  onDispenseCallback = callback;
+void ScheduleManager::internNames(int scheduleIndex, const char* medicationName,
+                                  const char* patientName, const char* pillSize) {
+  // Reclaim names no other schedule uses before the table runs out
+  if (NAME_TABLE_SIZE - nameTable.getUsedCount() < 3) {
+    bool keep[NAME_TABLE_SIZE] = {};
+    for (int i = 0; i < scheduleCount; i++) {
+      if (i == scheduleIndex) continue;
+      keep[schedules[i].medicationId] = true;
+      keep[schedules[i].patientId] = true;
+      keep[schedules[i].pillSizeId] = true;
+    }
+    nameTable.retainOnly(keep);
+  }
+  
+  MedicationSchedule* schedule = &schedules[scheduleIndex];
+  schedule->medicationId = nameTable.intern(medicationName);
+  schedule->patientId = nameTable.intern(patientName);
+  schedule->pillSizeId = nameTable.intern(pillSize);
+}
+
+void ScheduleManager::setAlarmTimingCallback(void (*callback)(long lateMs)) {
+  onAlarmTiming = callback;
 }
 
 void ScheduleManager::setNotifyCallback(void (*callback)(String, String)) {
   onNotifyCallback = callback;
 }
 
-bool ScheduleManager::syncSchedulesFromFirebase(FirebaseData* fbdo, String basePath) {
+bool ScheduleManager::setGracePeriod(const char* id, int minutes) {
+  MedicationSchedule* schedule = getScheduleById(id);
+  if (schedule == nullptr || minutes < 0 || minutes > 24 * 60) {
+    return false;
+  }
+  schedule->graceMinutes = minutes;
+  return true;
+}
+
+// One NVS record per schedule - names are stored as text, their ids are per boot
+struct CachedSchedule {
+  char id[SCHEDULE_ID_MAX];
+  int8_t dispenserId;
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t enabled;
+  uint8_t skipNext;        // A caregiver SKIP survives a reboot
+  uint16_t graceMinutes;
+  char medication[NAME_MAX_LENGTH];
+  char patient[NAME_MAX_LENGTH];
+  char pillSize[NAME_MAX_LENGTH];
+};
+
+// Too big for a task stack; only used under the schedule lock or before the tasks start
+static CachedSchedule cacheRecords[MAX_SCHEDULES];
+
+// FNV-1a over the records, seeded with the count so an empty set has a checksum too
+static uint32_t cacheHash(int count) {
+  uint32_t h = 2166136261UL ^ (uint32_t)count;
+  const uint8_t* bytes = (const uint8_t*)cacheRecords;
+  for (size_t i = 0; i < count * sizeof(CachedSchedule); i++) {
+    h ^= bytes[i];
+    h *= 16777619UL;
+  }
+  return h;
+}
+
+static void copyName(char* dest, const char* name) {
+  strncpy(dest, name, NAME_MAX_LENGTH - 1);
+  dest[NAME_MAX_LENGTH - 1] = '\0';
+}
+
+bool ScheduleManager::saveCache() {
+  int count = scheduleCount;
+  memset(cacheRecords, 0, sizeof(cacheRecords));
+  for (int i = 0; i < count; i++) {
+    CachedSchedule& record = cacheRecords[i];
+    memcpy(record.id, schedules[i].id, SCHEDULE_ID_MAX);
+    record.dispenserId = schedules[i].dispenserId;
+    record.hour = schedules[i].hour;
+    record.minute = schedules[i].minute;
+    record.enabled = schedules[i].enabled;
+    record.skipNext = schedules[i].skipNext;
+    record.graceMinutes = schedules[i].graceMinutes;
+    copyName(record.medication, nameTable.get(schedules[i].medicationId));
+    copyName(record.patient, nameTable.get(schedules[i].patientId));
+    copyName(record.pillSize, nameTable.get(schedules[i].pillSizeId));
+  }
+  
+  // Every schedule stream event resyncs the whole set - spare the flash when nothing changed
+  uint32_t checksum = cacheHash(count);
+  if (checksum == cacheChecksum) {
+    return true;
+  }
+  
+  Preferences prefs;
+  if (!prefs.begin(SCHEDULE_PREFS_NAMESPACE, false)) {
+    Serial.println("ScheduleManager: ⚠️ Cannot open the schedule cache");
+    return false;
+  }
+  size_t bytes = count * sizeof(CachedSchedule);
+  bool ok = count == 0 || prefs.putBytes("records", cacheRecords, bytes) == bytes;
+  // Count and checksum last - a torn write fails the checksum on the next boot
+  ok = ok && prefs.putUInt("count", count) == sizeof(uint32_t);
+  ok = ok && prefs.putUInt("sum", checksum) == sizeof(uint32_t);
+  prefs.end();
+  
+  if (!ok) {
+    Serial.println("ScheduleManager: ⚠️ Schedule cache write failed");
+    return false;
+  }
+  cacheChecksum = checksum;
+  Serial.printf("ScheduleManager: 💾 %d schedule(s) cached for the next boot\n", count);
+  return true;
+}
+
+int ScheduleManager::loadCache() {
+  Preferences prefs;
+  if (!prefs.begin(SCHEDULE_PREFS_NAMESPACE, true)) {
+    Serial.println("ScheduleManager: No schedule cache yet");
+    return -1;
+  }
+  uint32_t count = prefs.getUInt("count", UINT32_MAX);
+  uint32_t checksum = prefs.getUInt("sum", 0);
+  memset(cacheRecords, 0, sizeof(cacheRecords));
+  size_t bytes = 0;
+  if (count > 0 && count <= MAX_SCHEDULES) {
+    bytes = prefs.getBytes("records", cacheRecords, sizeof(cacheRecords));
+  }
+  prefs.end();
+  
+  if (count > MAX_SCHEDULES || bytes != count * sizeof(CachedSchedule) || cacheHash(count) != checksum) {
+    Serial.println("ScheduleManager: ⚠️ Schedule cache missing or corrupt - waiting for Firebase");
+    return -1;
+  }
+  
+  beginSync();
+  int loaded = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    CachedSchedule& record = cacheRecords[i];
+    record.id[SCHEDULE_ID_MAX - 1] = '\0';
+    if (addSchedule(record.id, record.dispenserId, record.hour, record.minute,
+                    record.medication, record.patient, record.pillSize, record.enabled)) {
+      if (record.skipNext) {
+        getScheduleById(record.id)->skipNext = true;
+      }
+      setGracePeriod(record.id, record.graceMinutes);
+      loaded++;
+    }
+  }
+  endSync();
+  cacheChecksum = checksum;
+  
+  Serial.printf("ScheduleManager: 📂 %d schedule(s) loaded from the local cache\n", loaded);
+  return loaded;
+}
+
+bool ScheduleManager::syncSchedulesFromFirebase(FirebaseData* /*fbdo*/, String /*basePath*/) {
   // This will be called to load schedules from Firebase
   // Format: basePath/schedules/{scheduleId}
   Serial.println("ScheduleManager: Syncing schedules from Firebase...");
@@ -390,7 +619,7 @@ bool ScheduleManager::syncSchedulesFromFirebase(FirebaseData* fbdo, String baseP
   return true;
 }
 
-bool ScheduleManager::uploadScheduleStatus(FirebaseData* fbdo, String basePath, 
+bool ScheduleManager::uploadScheduleStatus(FirebaseData* /*fbdo*/, String /*basePath*/, 
                                           String scheduleId, String status) {
   // Upload execution status to Firebase
   Serial.println("ScheduleManager: Uploading schedule status: " + scheduleId + " -> " + status);
@@ -414,8 +643,8 @@ void ScheduleManager::printSchedules() {
                    s->hour,
                    s->minute,
                    s->dispenserId,
-                   s->medicationName.c_str());
-      Serial.println("    Patient: " + s->patientName + " | Size: " + s->pillSize);
+                   nameTable.get(s->medicationId));
+      Serial.printf("    Patient: %s | Size: %s\n", nameTable.get(s->patientId), nameTable.get(s->pillSizeId));
     }
   }
   
@@ -469,12 +698,12 @@ void ScheduleManager::testTriggerSchedule(int scheduleIndex) {
   }
   
   MedicationSchedule* schedule = &schedules[scheduleIndex];
-  Serial.printf("Schedule ID: %s\n", schedule->id.c_str());
+  Serial.printf("Schedule ID: %s\n", schedule->id);
   Serial.printf("Time: %02d:%02d\n", schedule->hour, schedule->minute);
-  Serial.println("Patient: " + schedule->patientName);
-  Serial.println("Medication: " + schedule->medicationName);
+  Serial.printf("Patient: %s\n", nameTable.get(schedule->patientId));
+  Serial.printf("Medication: %s\n", nameTable.get(schedule->medicationId));
   Serial.println("Dispenser: " + String(schedule->dispenserId));
-  Serial.println("Size: " + schedule->pillSize);
+  Serial.printf("Size: %s\n", nameTable.get(schedule->pillSizeId));
   Serial.println("Enabled: " + String(schedule->enabled ? "YES" : "NO"));
   
   // Check if today is scheduled
@@ -484,13 +713,87 @@ void ScheduleManager::testTriggerSchedule(int scheduleIndex) {
   Serial.println("Triggering dispense callback...");
   Serial.println(String('=', 60) + "\n");
   
-  // Trigger the callback regardless of time/day checks for testing
-  if (onDispenseCallback != nullptr) {
-    onDispenseCallback(schedule->dispenserId, schedule->pillSize, 
-                      schedule->medicationName, schedule->patientName);
-  } else {
-    Serial.println("❌ No dispense callback set!");
+  // Publish regardless of time/day checks for testing
+  publishDoseEvent(BUS_DOSE_DUE, scheduleIndex);
+}
+
+int ScheduleManager::skipNextSchedule() {
+  time_t nowLocal = now();
+  int bestIndex = -1;
+  time_t bestSlot = 0;
+  
+  for (int i = 0; i < scheduleCount; i++) {
+    if (!schedules[i].enabled || schedules[i].skipNext) {
+      continue;
+    }
+    
+    // Next occurrence on a scheduled weekday - today's if still ahead
+    time_t slot = occurrenceAtOrBefore(schedules[i].hour, schedules[i].minute, nowLocal) + SECS_PER_DAY;
+    int days = 0;
+    while (days < 7 && !isScheduledOn(i, slot)) {
+      slot += SECS_PER_DAY;
+      days++;
+    }
+    if (days == 7) {
+      continue;  // No weekday enabled
+    }
+    
+    if (bestIndex < 0 || slot < bestSlot) {
+      bestSlot = slot;
+      bestIndex = i;
+    }
+  }
+  
+  if (bestIndex >= 0) {
+    schedules[bestIndex].skipNext = true;
+    Serial.printf("ScheduleManager: Next dose skipped - %02d:%02d %s (Container %d)\n",
+                  schedules[bestIndex].hour, schedules[bestIndex].minute,
+                  nameTable.get(schedules[bestIndex].medicationId), schedules[bestIndex].dispenserId + 1);
   }
+  
+  return bestIndex;
+}
+
+int ScheduleManager::getMinutesUntilNextDose() {
+  int currentTime = hour() * 60 + minute();
+  int best = -1;
+  
+  for (int i = 0; i < scheduleCount; i++) {
+    if (!schedules[i].enabled) {
+      continue;
+    }
+    int minutesUntil = schedules[i].hour * 60 + schedules[i].minute - currentTime;
+    if (minutesUntil < 0) minutesUntil += 24 * 60;
+    if (best < 0 || minutesUntil < best) {
+      best = minutesUntil;
+    }
+  }
+  return best;
+}
+
+long ScheduleManager::getSecondsUntilNextAlarm() {
+  time_t nowLocal = now();
+  long best = -1;
+  
+  for (int i = 0; i < scheduleCount; i++) {
+    if (!schedules[i].enabled) {
+      continue;
+    }
+    int reminderHour, reminderMinute;
+    calculateReminderTime(schedules[i].hour, schedules[i].minute, reminderHour, reminderMinute);
+    time_t slots[2] = {
+      occurrenceAtOrBefore(schedules[i].hour, schedules[i].minute, nowLocal),
+      occurrenceAtOrBefore(reminderHour, reminderMinute, nowLocal)
+    };
+    for (int k = 0; k < 2; k++) {
+      // An alarm that has only just come due may not have been serviced yet
+      long secondsUntil = nowLocal - slots[k] < 2 ? 0 : (long)(slots[k] + SECS_PER_DAY - nowLocal);
+      if (best < 0 || secondsUntil < best) {
+        best = secondsUntil;
+      }
+    }
+  }
+  return best;
 }
 
 // Static callback functions
@@ -572,19 +875,34 @@ void ScheduleManager::reminderCallback14() { if(instance) instance->triggerRemin
 // Trigger reminder notification (15 minutes before dispense)
 void ScheduleManager::triggerReminder(int scheduleIndex) {
   if (scheduleIndex < 0 || scheduleIndex >= scheduleCount) return;
+  if (timeManager != nullptr && !timeManager->isTimeValid()) return;  // Held like the dose
   
   MedicationSchedule* schedule = &schedules[scheduleIndex];
   
-  // Check if today is scheduled
-  if (!isTodayScheduled(scheduleIndex)) {
+  int reminderHour, reminderMinute;
+  calculateReminderTime(schedule->hour, schedule->minute, reminderHour, reminderMinute);
+  time_t slot = occurrenceAtOrBefore(reminderHour, reminderMinute, now());
+  
+  // Check if the dose day is scheduled
+  if (!isScheduledOn(scheduleIndex, slot + 15 * SECS_PER_MIN)) {
     return;
   }
   
-  // Call reminder callback
-  if (onReminderCallback != nullptr) {
-    onReminderCallback(schedule->dispenserId, schedule->pillSize, 
-                      schedule->medicationName, schedule->patientName);
+  // Only one reminder per dose, even if the clock stepped back
+  if (schedule->lastReminderSlot == slot) {
+    return;
   }
+  schedule->lastReminderSlot = slot;
+  if (onAlarmTiming != nullptr) {
+    onAlarmTiming(msPastSlot(slot));
+  }
+  
+  // No reminder for a dose that will be skipped
+  if (schedule->skipNext) {
+    return;
+  }
+  
+  publishDoseEvent(BUS_DOSE_REMINDER, scheduleIndex);
 }
 
 // Calculate reminder time (15 minutes before dispense time)
@@ -601,7 +919,174 @@ void ScheduleManager::calculateReminderTime(int hour, int minute, int& reminderH
   reminderMinute = totalMinutes % 60;
 }
 
-// Set reminder callback
-void ScheduleManager::setReminderCallback(void (*callback)(int, String, String, String)) {
-  onReminderCallback = callback;
+// ===== CLOCK STEP HANDLING =====
+
+void ScheduleManager::clockStepCallback(time_t oldLocal, time_t newLocal) {
+  if (instance) instance->onClockStep(oldLocal, newLocal);
+}
+
+// Most recent occurrence of hour:minute at or before t (local epoch)
+time_t ScheduleManager::occurrenceAtOrBefore(int hour, int minute, time_t t) {
+  time_t slot = previousMidnight(t) + hour * SECS_PER_HOUR + minute * SECS_PER_MIN;
+  if (slot > t) {
+    slot -= SECS_PER_DAY;
+  }
+  return slot;
+}
+
+// Milliseconds between the local slot time and now, from the microsecond timebase
+long ScheduleManager::msPastSlot(time_t slot) {
+  if (timeManager == nullptr) {
+    return (long)(now() - slot) * 1000L;
+  }
+  int64_t utcUs = timeManager->getEpochMicros();
+  // Zone offsets are whole minutes - rounding hides a second ticking over in between
+  long offset = (long)(timeManager->getLocalEpoch() - (time_t)(utcUs / 1000000LL));
+  offset = (offset + (offset >= 0 ? 30 : -30)) / 60 * 60;
+  int64_t localUs = utcUs + (int64_t)offset * 1000000LL;
+  return (long)((localUs - (int64_t)slot * 1000000LL) / 1000);
+}
+
+bool ScheduleManager::isScheduledOn(int scheduleIndex, time_t t) {
+  int dow = (weekday(t) + 5) % 7;  // 0=Monday, 6=Sunday
+  return schedules[scheduleIndex].weekdays[dow];
+}
+
+void ScheduleManager::armSchedule(int scheduleIndex) {
+  MedicationSchedule* schedule = &schedules[scheduleIndex];
+  
+  if (schedule->alarmId != dtINVALID_ALARM_ID) {
+    Alarm.free(schedule->alarmId);
+    schedule->alarmId = dtINVALID_ALARM_ID;
+  }
+  if (schedule->reminderAlarmId != dtINVALID_ALARM_ID) {
+    Alarm.free(schedule->reminderAlarmId);
+    schedule->reminderAlarmId = dtINVALID_ALARM_ID;
+  }
+  
+  if (!schedule->enabled) {
+    return;
+  }
+  
+  OnTick_t callback = getCallbackFunction(scheduleIndex);
+  if (callback != nullptr) {
+    schedule->alarmId = Alarm.alarmRepeat(schedule->hour, schedule->minute, 0, callback);
+  }
+  
+  int reminderHour, reminderMinute;
+  calculateReminderTime(schedule->hour, schedule->minute, reminderHour, reminderMinute);
+  OnTick_t reminderCallback = getReminderCallbackFunction(scheduleIndex);
+  if (reminderCallback != nullptr) {
+    schedule->reminderAlarmId = Alarm.alarmRepeat(reminderHour, reminderMinute, 0, reminderCallback);
+  }
+}
+
+void ScheduleManager::rearmAllSchedules() {
+  // TimeAlarms keeps absolute trigger times - recreate them against the new clock
+  for (int i = 0; i < scheduleCount; i++) {
+    armSchedule(i);
+  }
+}
+
+void ScheduleManager::onClockStep(time_t oldLocal, time_t newLocal) {
+  long delta = (long)(newLocal - oldLocal);
+  Serial.printf("ScheduleManager: ⏱️ Clock stepped %+ld s - re-evaluating alarms\n", oldLocal == 0 ? 0L : delta);
+  
+  rearmAllSchedules();
+  
+  // Initial set (including NTP replacing a provisional restore) - catch up
+  // from the persisted clock, which is a no-op if there was none
+  if (oldLocal < (time_t)SECS_YR_2000) {
+    catchUpMissedDoses();
+    return;
+  }
+  
+  // Backward steps and huge jumps need no replay - the
+  // lastFiredSlot/lastReminderSlot checks stop any repeat firing
+  if (newLocal <= oldLocal) {
+    return;
+  }
+  if (delta > MAX_CATCHUP_SECONDS) {
+    Serial.println("ScheduleManager: ⚠️ Step too large to replay - alarms re-armed only");
+    return;
+  }
+  
+  replayInterval(oldLocal, newLocal);
+}
+
+void ScheduleManager::catchUpMissedDoses() {
+  if (timeManager == nullptr || !timeManager->isTimeValid()) {
+    return;
+  }
+  
+  // Everything up to the saved clock or the last handled dose was already dealt with
+  time_t nowLocal = now();
+  time_t fromLocal = timeManager->getRestoredLocalEpoch();
+  if (timeManager->getDoseWatermark() > fromLocal) {
+    fromLocal = timeManager->getDoseWatermark();
+  }
+  if (fromLocal < (time_t)SECS_YR_2000 || fromLocal >= nowLocal) {
+    Serial.println("ScheduleManager: No doses to catch up since last boot");
+    return;
+  }
+  if (nowLocal - fromLocal > MAX_CATCHUP_SECONDS) {
+    fromLocal = nowLocal - MAX_CATCHUP_SECONDS;
+  }
+  
+  Serial.printf("ScheduleManager: 🔁 Checking doses due while offline (last %ld min)\n",
+                (long)(nowLocal - fromLocal) / 60);
+  replayInterval(fromLocal, nowLocal);
+}
+
+// Handles every dose and reminder that fell in (fromLocal, toLocal] without an alarm firing
+void ScheduleManager::replayInterval(time_t fromLocal, time_t toLocal) {
+  for (int i = 0; i < scheduleCount; i++) {
+    MedicationSchedule* schedule = &schedules[i];
+    if (!schedule->enabled) {
+      continue;
+    }
+    
+    // Reminder passed over while its dose is still ahead - send it now
+    int reminderHour, reminderMinute;
+    calculateReminderTime(schedule->hour, schedule->minute, reminderHour, reminderMinute);
+    time_t reminderSlot = occurrenceAtOrBefore(reminderHour, reminderMinute, toLocal);
+    if (reminderSlot > fromLocal && reminderSlot + 15 * SECS_PER_MIN > toLocal) {
+      triggerReminder(i);
+    }
+    
+    // The window is at most a day, so at most one dose fell inside it
+    time_t slot = occurrenceAtOrBefore(schedule->hour, schedule->minute, toLocal);
+    if (slot <= fromLocal || !isScheduledOn(i, slot) || schedule->lastFiredSlot == slot) {
+      continue;
+    }
+    
+    long lateSeconds = (long)(toLocal - slot);
+    if (lateSeconds <= schedule->graceMinutes * 60L) {
+      Serial.printf("ScheduleManager: ⏰ Dose %02d:%02d passed without an alarm - dispensing %ld min late\n",
+                    schedule->hour, schedule->minute, lateSeconds / 60);
+      triggerSchedule(i);
+      continue;
+    }
+    
+    // Outside the grace window - record it as missed instead of dispensing
+    markDoseHandled(i, slot);
+    if (schedule->skipNext) {
+      schedule->skipNext = false;
+      saveCache();
+      Serial.printf("ScheduleManager: ⏭️ Skipped dose %02d:%02d passed without an alarm\n",
+                    schedule->hour, schedule->minute);
+      continue;
+    }
+    
+    Serial.printf("ScheduleManager: ❌ Dose %02d:%02d missed - %ld min past it\n",
+                  schedule->hour, schedule->minute, lateSeconds / 60);
+    publishDoseEvent(BUS_DOSE_MISSED, i);
+  }
+}
+
+void ScheduleManager::markDoseHandled(int scheduleIndex, time_t slot) {
+  schedules[scheduleIndex].lastFiredSlot = slot;
+  if (timeManager != nullptr) {
+    timeManager->setDoseWatermark(slot);
+  }
 }
@@ -5,21 +5,30 @@
 #include <TimeAlarms.h>
 #include <Firebase_ESP_Client.h>
 #include "TimeManager.h"
+#include "EventBus.h"
 
 #define MAX_SCHEDULES 15  // Maximum number of schedules (3 per dispenser x 5 dispensers)
+#define DEFAULT_GRACE_MINUTES 30   // A dose passed over by a clock step is still given this late
+#define MAX_CATCHUP_SECONDS 86400  // Larger steps only re-arm alarms, nothing is replayed
+#define SCHEDULE_ID_MAX 24         // Firebase push keys are 20 characters
+#define SCHEDULE_PREFS_NAMESPACE "schedules"  // Local copy of the last cloud schedule set
 
 struct MedicationSchedule {
-  String id;
+  char id[SCHEDULE_ID_MAX];
   int dispenserId;        // 0-4 (which of the 5 dispensers)
   int hour;               // 0-23
   int minute;             // 0-59
   bool enabled;
-  String medicationName;
-  String patientName;
-  String pillSize;        // "small", "medium", "large"
+  NameId medicationId;    // Names live in nameTable - see nameTable.get()
+  NameId patientId;
+  NameId pillSizeId;      // "small", "medium", "large"
   AlarmId alarmId;        // TimeAlarms library alarm ID for dispense
   AlarmId reminderAlarmId; // TimeAlarms library alarm ID for 15-min reminder
   bool weekdays[7];       // Monday=0, Sunday=6
+  bool skipNext;          // Skip the next occurrence (e.g. SKIP command by SMS)
+  int graceMinutes;       // How late a dose may still be dispensed after a clock step
+  time_t lastFiredSlot;   // Local time of the last dose handled (dispensed, skipped or missed)
+  time_t lastReminderSlot; // Local time of the last reminder sent
 };
 
 class ScheduleManager {
@@ -28,11 +37,14 @@ private:
   int scheduleCount;
   String deviceId;
   TimeManager* timeManager;
+  uint32_t cacheChecksum;  // Of the set last written to or read from NVS
+  bool syncing;                      // Between beginSync() and endSync()
+  bool syncSeen[MAX_SCHEDULES];      // Added again during the sync in progress
   
-  // Callback function pointers
-  void (*onDispenseCallback)(int dispenserId, String pillSize, String medication, String patient);
-  void (*onReminderCallback)(int dispenserId, String pillSize, String medication, String patient);
+  // Dose events go out on the bus; notify is still a direct callback
+  EventBus* eventBus;
   void (*onNotifyCallback)(String message, String phone);
+  void (*onAlarmTiming)(long lateMs);
   
   // Alarm callbacks must be static
   static ScheduleManager* instance;
@@ -76,32 +88,58 @@ private:
   OnTick_t getReminderCallbackFunction(int index);
   bool isTodayScheduled(int scheduleIndex);
   void calculateReminderTime(int hour, int minute, int& reminderHour, int& reminderMinute);
+  void internNames(int scheduleIndex, const char* medicationName,
+                   const char* patientName, const char* pillSize);
+  bool publishDoseEvent(BusEventType type, int scheduleIndex);
+  
+  // Clock step handling
+  static void clockStepCallback(time_t oldLocal, time_t newLocal);
+  void onClockStep(time_t oldLocal, time_t newLocal);
+  void replayInterval(time_t fromLocal, time_t toLocal);
+  void markDoseHandled(int scheduleIndex, time_t slot);
+  void armSchedule(int scheduleIndex);
+  void rearmAllSchedules();
+  int removeUnseen();
+  time_t occurrenceAtOrBefore(int hour, int minute, time_t t);
+  long msPastSlot(time_t slot);
+  bool isScheduledOn(int scheduleIndex, time_t t);
   
 public:
   ScheduleManager();
   void begin(String deviceId);
-  void setTimeManager(TimeManager* tm) { timeManager = tm; }
+  void setTimeManager(TimeManager* tm);
   void update();  // Call in loop() to process alarms
+  void catchUpMissedDoses();  // Call once after schedules are loaded at boot
   
   // Schedule management
-  bool addSchedule(String id, int dispenserId, int hour, int minute, 
-                   String medicationName, String patientName, 
-                   String pillSize = "medium", bool enabled = true);
-  bool removeSchedule(String id);
-  bool updateSchedule(String id, int hour, int minute, bool enabled);
+  bool addSchedule(const char* id, int dispenserId, int hour, int minute, 
+                   const char* medicationName, const char* patientName, 
+                   const char* pillSize = "medium", bool enabled = true);
+  bool removeSchedule(const char* id);
+  bool updateSchedule(const char* id, int hour, int minute, bool enabled);
   void clearAllSchedules();
+  
+  // Replacing the whole set (cloud sync, cache load): schedules not added again
+  // before endSync() are removed, the rest keep their fired slots, grace and skip
+  void beginSync();
+  int endSync();  // Returns the number removed
   int getScheduleCount();
   MedicationSchedule* getSchedule(int index);
-  MedicationSchedule* getScheduleById(String id);
+  MedicationSchedule* getScheduleById(const char* id);
+  
+  // Local cache, so doses are armed at boot before the network is up
+  bool saveCache();   // Writes only when the set has changed; call with the schedule lock
+  int loadCache();    // Replaces the schedules with the cached set; -1 if there is none
   
   // Firebase integration
   bool syncSchedulesFromFirebase(FirebaseData* fbdo, String basePath);
   bool uploadScheduleStatus(FirebaseData* fbdo, String basePath, String scheduleId, String status);
   
-  // Callbacks
-  void setDispenseCallback(void (*callback)(int, String, String, String));
-  void setReminderCallback(void (*callback)(int, String, String, String));
+  // Dose due, reminder and missed-dose events are published here
+  void setEventBus(EventBus* bus);
   void setNotifyCallback(void (*callback)(String, String));
+  bool setGracePeriod(const char* id, int minutes);
+  void setAlarmTimingCallback(void (*callback)(long lateMs));  // How late each alarm ran
   
   // Utilities
   void printSchedules();
@@ -109,6 +147,9 @@ public:
   int getActiveScheduleCount();
   bool isScheduleTime(int hour, int minute);
   void testTriggerSchedule(int scheduleIndex); // Manual trigger for testing
+  int skipNextSchedule(); // Marks the next upcoming dose as skipped, returns its index or -1 (call saveCache() after)
+  int getMinutesUntilNextDose(); // Any enabled schedule, ignoring weekdays; -1 if none
+  long getSecondsUntilNextAlarm(); // Dose or reminder alarm, ignoring weekdays; -1 if none
 };
 
 #endif
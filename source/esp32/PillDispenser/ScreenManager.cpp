@@ -0,0 +1,273 @@
+#include "ScreenManager.h"
+
+// Layouts, one row per LCD line
+static const ScreenLine LAYOUTS[SCREEN_COUNT][SCREEN_ROWS] = {
+  // SCREEN_HOME
+  {
+    { "PILL DISPENSER V3", FIELD_NONE, true },
+    { "Status: ", FIELD_STATUS, false },
+    { "", FIELD_TIME, false },
+    { "Next: ", FIELD_NEXT_DOSE, false }
+  },
+  // SCREEN_DISPENSING
+  {
+    { "DISPENSING", FIELD_NONE, true },
+    { "Container ", FIELD_CONTAINER, true },
+    { "", FIELD_MEDICATION, true },
+    { "", FIELD_NONE, false }
+  },
+  // SCREEN_ERROR
+  {
+    { "ERROR", FIELD_NONE, true },
+    { "", FIELD_ERROR, true },
+    { "", FIELD_NONE, false },
+    { "Check connections", FIELD_NONE, false }
+  },
+  // SCREEN_NETWORK
+  {
+    { "NETWORK STATUS", FIELD_NONE, true },
+    { "WiFi: ", FIELD_WIFI, false },
+    { "IP: ", FIELD_IP, false },
+    { "", FIELD_TIME, false }
+  },
+  // SCREEN_NEXT_DOSE
+  {
+    { "NEXT DOSE", FIELD_NONE, true },
+    { "", FIELD_NEXT_DOSE, true },
+    { "", FIELD_NONE, false },
+    { "Pills: ", FIELD_PILL_COUNT, false }
+  },
+  // SCREEN_MESSAGE
+  {
+    { "", FIELD_TITLE, true },
+    { "", FIELD_MESSAGE, true },
+    { "", FIELD_NONE, false },
+    { "", FIELD_NONE, false }
+  }
+};
+
+portMUX_TYPE ScreenManager::stateMux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char* SCREEN_NAMES[SCREEN_COUNT] = {
+  "home", "dispensing", "error", "network", "next dose", "message"
+};
+
+ScreenManager::ScreenManager() {
+  lcd = nullptr;
+  taskHandle = nullptr;
+  memset(fields, 0, sizeof(fields));
+  baseScreen = SCREEN_HOME;
+  overlayScreen = SCREEN_HOME;
+  overlayActive = false;
+  overlayStart = 0;
+  overlayDuration = 0;
+  dirty = true;
+  profiler = nullptr;
+  framesRendered = 0;
+  maxRenderMicros = 0;
+}
+
+bool ScreenManager::begin(LCDDisplay* display) {
+  if (taskHandle != nullptr) {
+    return true;
+  }
+  
+  lcd = display;
+  
+  // From here on only the render task flushes to the LCD
+  lcd->setAutoFlush(false);
+  dirty = true;
+  
+  BaseType_t created = xTaskCreatePinnedToCore(renderTask, "screen", SCREEN_TASK_STACK, this,
+                                               SCREEN_TASK_PRIORITY, &taskHandle, SCREEN_TASK_CORE);
+  if (created != pdPASS) {
+    taskHandle = nullptr;
+    lcd->setAutoFlush(true);
+    Serial.println("ScreenManager: ❌ Failed to start render task");
+    return false;
+  }
+  
+  Serial.println("ScreenManager: Render task started (" + String(1000 / FRAME_INTERVAL) + " fps)");
+  return true;
+}
+
+void ScreenManager::setProfiler(LatencyProfiler* latencyProfiler) {
+  profiler = latencyProfiler;
+}
+
+void ScreenManager::renderTask(void* param) {
+  ScreenManager* self = (ScreenManager*)param;
+  TickType_t lastWake = xTaskGetTickCount();
+  
+  for (;;) {
+    self->renderFrame();
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(FRAME_INTERVAL));
+  }
+}
+
+void ScreenManager::renderFrame() {
+  char lines[SCREEN_ROWS][SCREEN_FIELD_MAX];
+  unsigned long now = millis();
+  bool redraw;
+  
+  // Compose under the lock, draw outside it
+  portENTER_CRITICAL(&stateMux);
+  if (overlayActive && overlayDuration > 0 && now - overlayStart >= overlayDuration) {
+    overlayActive = false;
+    dirty = true;
+  }
+  redraw = dirty;
+  if (redraw) {
+    const ScreenLine* layout = LAYOUTS[overlayActive ? overlayScreen : baseScreen];
+    for (int row = 0; row < SCREEN_ROWS; row++) {
+      composeLine(layout[row], lines[row]);
+    }
+    dirty = false;
+  }
+  portEXIT_CRITICAL(&stateMux);
+  
+  if (!redraw) {
+    return;
+  }
+  
+  unsigned long started = micros();
+  for (int row = 0; row < SCREEN_ROWS; row++) {
+    lcd->printLine(lines[row], row);
+  }
+  lcd->flush();
+  
+  unsigned long elapsed = micros() - started;
+  if (elapsed > maxRenderMicros) {
+    maxRenderMicros = elapsed;
+  }
+  if (profiler != nullptr) {
+    profiler->record(PROFILE_LCD, elapsed);
+  }
+  framesRendered++;
+}
+
+void ScreenManager::composeLine(const ScreenLine& line, char* out) {
+  char text[SCREEN_FIELD_MAX];
+  
+  // Literal text, then the bound value, clipped to the row
+  strncpy(text, line.text, SCREEN_COLS);
+  text[SCREEN_COLS] = '\0';
+  if (line.field != FIELD_NONE) {
+    size_t used = strlen(text);
+    strncat(text, fields[line.field], SCREEN_COLS - used);
+  }
+  
+  size_t length = strlen(text);
+  size_t indent = line.centered ? (SCREEN_COLS - length) / 2 : 0;
+  memset(out, ' ', indent);
+  memcpy(out + indent, text, length + 1);
+}
+
+void ScreenManager::setScreen(ScreenId screen) {
+  if (screen >= SCREEN_COUNT) return;
+  
+  portENTER_CRITICAL(&stateMux);
+  if (baseScreen != screen) {
+    baseScreen = screen;
+    dirty = true;
+  }
+  portEXIT_CRITICAL(&stateMux);
+}
+
+void ScreenManager::showOverlay(ScreenId screen, unsigned long durationMs) {
+  if (screen >= SCREEN_COUNT) return;
+  
+  portENTER_CRITICAL(&stateMux);
+  overlayScreen = screen;
+  overlayActive = true;
+  overlayStart = millis();
+  overlayDuration = durationMs;
+  dirty = true;
+  portEXIT_CRITICAL(&stateMux);
+}
+
+void ScreenManager::clearOverlay() {
+  portENTER_CRITICAL(&stateMux);
+  if (overlayActive) {
+    overlayActive = false;
+    dirty = true;
+  }
+  portEXIT_CRITICAL(&stateMux);
+}
+
+void ScreenManager::showMessage(const char* title, const char* message, unsigned long durationMs) {
+  setField(FIELD_TITLE, title);
+  setField(FIELD_MESSAGE, message);
+  showOverlay(SCREEN_MESSAGE, durationMs);
+}
+
+ScreenId ScreenManager::getActiveScreen() {
+  portENTER_CRITICAL(&stateMux);
+  ScreenId active = overlayActive ? overlayScreen : baseScreen;
+  portEXIT_CRITICAL(&stateMux);
+  return active;
+}
+
+void ScreenManager::setField(ScreenField field, const char* value) {
+  if (field <= FIELD_NONE || field >= FIELD_COUNT || value == nullptr) return;
+  
+  // Values longer than a row end in "..."
+  char clipped[SCREEN_FIELD_MAX];
+  strncpy(clipped, value, SCREEN_COLS);
+  clipped[SCREEN_COLS] = '\0';
+  if (strlen(value) > SCREEN_COLS) {
+    memcpy(clipped + SCREEN_COLS - 3, "...", 3);
+  }
+  
+  portENTER_CRITICAL(&stateMux);
+  if (strcmp(fields[field], clipped) != 0) {
+    memcpy(fields[field], clipped, SCREEN_FIELD_MAX);
+    dirty = true;
+  }
+  portEXIT_CRITICAL(&stateMux);
+}
+
+void ScreenManager::setField(ScreenField field, String value) {
+  setField(field, value.c_str());
+}
+
+void ScreenManager::setField(ScreenField field, int value) {
+  char buffer[12];
+  snprintf(buffer, sizeof(buffer), "%d", value);
+  setField(field, buffer);
+}
+
+bool ScreenManager::isRunning() {
+  return taskHandle != nullptr;
+}
+
+TaskHandle_t ScreenManager::getTaskHandle() {
+  return taskHandle;
+}
+
+void ScreenManager::printStatus() {
+  portENTER_CRITICAL(&stateMux);
+  ScreenId base = baseScreen;
+  ScreenId overlay = overlayScreen;
+  bool hasOverlay = overlayActive;
+  unsigned long duration = overlayDuration;
+  unsigned long elapsed = millis() - overlayStart;
+  portEXIT_CRITICAL(&stateMux);
+  unsigned long remaining = duration > elapsed ? duration - elapsed : 0;
+  
+  Serial.println("\n=== SCREEN MANAGER ===");
+  Serial.println("Render task: " + String(isRunning() ? "Running" : "Stopped"));
+  Serial.println("Base screen: " + String(SCREEN_NAMES[base]));
+  if (hasOverlay) {
+    Serial.println("Overlay: " + String(SCREEN_NAMES[overlay]) +
+                   (duration > 0 ? " (" + String(remaining / 1000) + " s left)" : String(" (until cleared)")));
+  } else {
+    Serial.println("Overlay: none");
+  }
+  Serial.println("Frames rendered: " + String(framesRendered));
+  Serial.println("Slowest frame: " + String(maxRenderMicros) + " us");
+  if (isRunning()) {
+    Serial.println("Render task stack free: " + String(uxTaskGetStackHighWaterMark(taskHandle)) + " bytes");
+  }
+  Serial.println("======================\n");
+}
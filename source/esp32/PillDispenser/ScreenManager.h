@@ -0,0 +1,114 @@
+#ifndef SCREEN_MANAGER_H
+#define SCREEN_MANAGER_H
+
+#include <Arduino.h>
+#include "LCDDisplay.h"
+#include "LatencyProfiler.h"
+
+#define SCREEN_ROWS 4
+#define SCREEN_COLS 20
+#define SCREEN_FIELD_MAX (SCREEN_COLS + 1)
+#define SCREEN_TASK_STACK 3072
+#define SCREEN_TASK_PRIORITY 1   // Just above idle
+#define SCREEN_TASK_CORE 0       // Keep I2C off the loop() core
+
+enum ScreenId {
+  SCREEN_HOME,
+  SCREEN_DISPENSING,
+  SCREEN_ERROR,
+  SCREEN_NETWORK,
+  SCREEN_NEXT_DOSE,
+  SCREEN_MESSAGE,
+  SCREEN_COUNT
+};
+
+// Data the layouts bind to; set from anywhere with setField()
+enum ScreenField {
+  FIELD_NONE,
+  FIELD_TIME,
+  FIELD_STATUS,
+  FIELD_NEXT_DOSE,
+  FIELD_PILL_COUNT,
+  FIELD_CONTAINER,
+  FIELD_MEDICATION,
+  FIELD_ERROR,
+  FIELD_WIFI,
+  FIELD_IP,
+  FIELD_TITLE,
+  FIELD_MESSAGE,
+  FIELD_COUNT
+};
+
+// One row of a layout: literal text followed by an optional bound field
+struct ScreenLine {
+  const char* text;
+  ScreenField field;
+  bool centered;
+};
+
+/**
+ * ScreenManager
+ *
+ * Declarative screens on top of LCDDisplay. Each screen is a fixed table
+ * of rows built from literal text and bound data fields; callers only
+ * select screens and update field values, they never draw.
+ *
+ * A base screen is always shown. An overlay (e.g. dispensing or an error)
+ * replaces it for a given time, or until cleared, and the base screen
+ * comes back on its own.
+ *
+ * Rendering runs in a low-priority task at a fixed frame rate and is the
+ * only code that talks to the LCD once begin() has returned. setField()
+ * and the screen calls just copy a few bytes under a spinlock, so alarm
+ * and dispense handlers never wait on I2C.
+ */
+class ScreenManager {
+private:
+  LCDDisplay* lcd;
+  TaskHandle_t taskHandle;
+  static portMUX_TYPE stateMux;
+  
+  // Shared with the render task, guarded by stateMux
+  char fields[FIELD_COUNT][SCREEN_FIELD_MAX];
+  ScreenId baseScreen;
+  ScreenId overlayScreen;
+  bool overlayActive;
+  unsigned long overlayStart;
+  unsigned long overlayDuration;  // 0 = until clearOverlay()
+  bool dirty;
+  
+  // Render statistics
+  LatencyProfiler* profiler;
+  unsigned long framesRendered;
+  unsigned long maxRenderMicros;
+  
+  static const unsigned long FRAME_INTERVAL = 200;  // 5 frames per second
+  
+  static void renderTask(void* param);
+  void renderFrame();
+  void composeLine(const ScreenLine& line, char* out);
+  
+public:
+  ScreenManager();
+  bool begin(LCDDisplay* display);
+  void setProfiler(LatencyProfiler* latencyProfiler);  // Frame times go to PROFILE_LCD
+  
+  // Screen selection
+  void setScreen(ScreenId screen);
+  void showOverlay(ScreenId screen, unsigned long durationMs = 0);
+  void clearOverlay();
+  void showMessage(const char* title, const char* message, unsigned long durationMs);
+  ScreenId getActiveScreen();
+  
+  // Data binding
+  void setField(ScreenField field, const char* value);
+  void setField(ScreenField field, String value);
+  void setField(ScreenField field, int value);
+  
+  // Status
+  bool isRunning();
+  TaskHandle_t getTaskHandle();
+  void printStatus();
+};
+
+#endif
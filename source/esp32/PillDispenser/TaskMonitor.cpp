@@ -0,0 +1,161 @@
+#include "TaskMonitor.h"
+#include "esp_timer.h"
+
+portMUX_TYPE TaskMonitor::monitorMux = portMUX_INITIALIZER_UNLOCKED;
+
+TaskMonitor::TaskMonitor() {
+  memset(tasks, 0, sizeof(tasks));
+  taskCount = 0;
+  windowStart = 0;
+}
+
+int TaskMonitor::addEntry(const char* name, uint32_t stackSize, UBaseType_t priority, BaseType_t core, bool measured) {
+  if (taskCount >= TASK_MONITOR_MAX) {
+    Serial.println("TaskMonitor: ❌ No slot left for task " + String(name));
+    return -1;
+  }
+  
+  int id = taskCount;
+  MonitoredTask& task = tasks[id];
+  task.name = name;
+  task.handle = nullptr;
+  task.stackSize = stackSize;
+  task.priority = priority;
+  task.core = core;
+  task.measured = measured;
+  taskCount++;
+  
+  if (windowStart == 0) {
+    windowStart = esp_timer_get_time();
+  }
+  return id;
+}
+
+int TaskMonitor::start(const char* name, TaskFunction_t function, uint32_t stackSize, UBaseType_t priority, BaseType_t core) {
+  int id = addEntry(name, stackSize, priority, core, true);
+  if (id < 0) {
+    return -1;
+  }
+  
+  // The slot is filled in before the task exists, since a higher-priority
+  // task runs (and calls beginCycle) before xTaskCreate returns
+  BaseType_t created = xTaskCreatePinnedToCore(function, name, stackSize, (void*)(intptr_t)id,
+                                               priority, &tasks[id].handle, core);
+  if (created != pdPASS) {
+    tasks[id].handle = nullptr;
+    Serial.println("TaskMonitor: ❌ Failed to start task " + String(name));
+    return -1;
+  }
+  
+  Serial.printf("TaskMonitor: Started %s (priority %u, core %d, %u byte stack)\n",
+                name, (unsigned)priority, (int)core, (unsigned)stackSize);
+  return id;
+}
+
+int TaskMonitor::add(const char* name, TaskHandle_t handle, uint32_t stackSize, UBaseType_t priority, BaseType_t core) {
+  int id = addEntry(name, stackSize, priority, core, false);
+  if (id >= 0) {
+    tasks[id].handle = handle;
+  }
+  return id;
+}
+
+int TaskMonitor::idFromParam(void* param) {
+  return (int)(intptr_t)param;
+}
+
+void TaskMonitor::beginCycle(int id) {
+  if (id < 0 || id >= taskCount) return;
+  tasks[id].cycleStart = esp_timer_get_time();
+  tasks[id].inCycle = true;
+}
+
+void TaskMonitor::endCycle(int id) {
+  if (id < 0 || id >= taskCount) return;
+  MonitoredTask& task = tasks[id];
+  uint32_t elapsed = (uint32_t)(esp_timer_get_time() - task.cycleStart);
+  task.inCycle = false;
+  
+  portENTER_CRITICAL(&monitorMux);
+  task.busyMicros += elapsed;
+  task.cycles++;
+  if (elapsed > task.maxCycleMicros) {
+    task.maxCycleMicros = elapsed;
+  }
+  portEXIT_CRITICAL(&monitorMux);
+}
+
+int TaskMonitor::findBusyTask() {
+  for (int i = 0; i < taskCount; i++) {
+    if (tasks[i].measured) {
+      if (tasks[i].inCycle) return i;
+      continue;
+    }
+    // Tasks without cycles are busy unless blocked - a preempted one may be mid-transfer
+    if (tasks[i].handle != nullptr && xTaskGetCurrentTaskHandle() != tasks[i].handle) {
+      eTaskState state = eTaskGetState(tasks[i].handle);
+      if (state == eRunning || state == eReady) return i;
+    }
+  }
+  return -1;
+}
+
+uint8_t TaskMonitor::getTaskCount() {
+  return taskCount;
+}
+
+const char* TaskMonitor::getTaskName(int id) {
+  if (id < 0 || id >= taskCount) return "?";
+  return tasks[id].name;
+}
+
+uint32_t TaskMonitor::getStackFree(int id) {
+  if (id < 0 || id >= taskCount || tasks[id].handle == nullptr) return 0;
+  return uxTaskGetStackHighWaterMark(tasks[id].handle);
+}
+
+void TaskMonitor::printStatus() {
+  MonitoredTask snapshot[TASK_MONITOR_MAX];
+  
+  portENTER_CRITICAL(&monitorMux);
+  uint8_t count = taskCount;
+  memcpy(snapshot, tasks, sizeof(MonitoredTask) * count);
+  int64_t window = esp_timer_get_time() - windowStart;
+  portEXIT_CRITICAL(&monitorMux);
+  
+  Serial.println("\n=== TASKS ===");
+  Serial.println("Task        Pri Core  Stack free    CPU   Cycles  Max cycle");
+  for (uint8_t i = 0; i < count; i++) {
+    const MonitoredTask& task = snapshot[i];
+  
+    uint32_t stackFree = task.handle != nullptr ? uxTaskGetStackHighWaterMark(task.handle) : 0;
+    char cpu[8] = "-";
+    char cycles[12] = "-";
+    char maxCycle[16] = "-";
+    if (task.measured && window > 0) {
+      snprintf(cpu, sizeof(cpu), "%.1f%%", task.busyMicros * 100.0 / window);
+      snprintf(cycles, sizeof(cycles), "%lu", task.cycles);
+      snprintf(maxCycle, sizeof(maxCycle), "%.1f ms", task.maxCycleMicros / 1000.0);
+    }
+  
+    Serial.printf("%-10s %4u %4d %5u/%-5u %6s %8s %10s%s\n",
+                  task.name, (unsigned)task.priority, (int)task.core,
+                  (unsigned)stackFree, (unsigned)task.stackSize, cpu, cycles, maxCycle,
+                  task.handle == nullptr ? "  (not running)" :
+                  stackFree < TASK_STACK_WARNING ? "  ⚠️ low stack" : "");
+  }
+  Serial.printf("CPU over the last %.0f s, per core; free heap %u bytes\n",
+                window / 1000000.0, (unsigned)ESP.getFreeHeap());
+  Serial.println("=============\n");
+}
+
+void TaskMonitor::resetStats() {
+  portENTER_CRITICAL(&monitorMux);
+  for (uint8_t i = 0; i < taskCount; i++) {
+    tasks[i].busyMicros = 0;
+    tasks[i].maxCycleMicros = 0;
+    tasks[i].cycles = 0;
+  }
+  windowStart = esp_timer_get_time();
+  portEXIT_CRITICAL(&monitorMux);
+}
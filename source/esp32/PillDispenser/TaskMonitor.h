@@ -0,0 +1,68 @@
+#ifndef TASK_MONITOR_H
+#define TASK_MONITOR_H
+
+#include <Arduino.h>
+
+#define TASK_MONITOR_MAX 8
+#define TASK_STACK_WARNING 512   // Flag tasks with less free stack than this (bytes)
+
+struct MonitoredTask {
+  const char* name;
+  TaskHandle_t handle;
+  uint32_t stackSize;
+  UBaseType_t priority;
+  BaseType_t core;
+  bool measured;               // Task reports its work cycles
+  int64_t cycleStart;          // Written only by the task itself
+  volatile bool inCycle;       // Between beginCycle() and endCycle()
+  int64_t busyMicros;          // Guarded by monitorMux
+  uint32_t maxCycleMicros;
+  unsigned long cycles;
+};
+
+/**
+ * TaskMonitor
+ *
+ * Starts the firmware's FreeRTOS tasks pinned to a core and keeps per-task
+ * statistics: stack high-water mark, CPU time and the longest work cycle.
+ *
+ * CPU time is measured by the tasks themselves - each wraps one pass of
+ * its work in beginCycle()/endCycle(), so the time spent blocked on a
+ * queue or delay is not counted. The core's run-time stats counter is not
+ * enabled in the Arduino build, so this is the portable way to see which
+ * task is eating the CPU.
+ */
+class TaskMonitor {
+private:
+  static portMUX_TYPE monitorMux;
+  MonitoredTask tasks[TASK_MONITOR_MAX];
+  uint8_t taskCount;
+  int64_t windowStart;
+  
+  int addEntry(const char* name, uint32_t stackSize, UBaseType_t priority, BaseType_t core, bool measured);
+  
+public:
+  TaskMonitor();
+  
+  // Create a task pinned to a core; the task receives its monitor id as its parameter
+  int start(const char* name, TaskFunction_t function, uint32_t stackSize, UBaseType_t priority, BaseType_t core);
+  // Track a task started elsewhere (stack only, no CPU time)
+  int add(const char* name, TaskHandle_t handle, uint32_t stackSize, UBaseType_t priority, BaseType_t core);
+  
+  // Called by a monitored task around each pass of its work
+  void beginCycle(int id);
+  void endCycle(int id);
+  
+  static int idFromParam(void* param);
+  int findBusyTask();  // A task mid-cycle (or ready, if unmeasured), -1 if all are blocked
+  
+  // For MemoryMonitor's stack history
+  uint8_t getTaskCount();
+  const char* getTaskName(int id);
+  uint32_t getStackFree(int id);  // Bytes, 0 if the task is not running
+  
+  void printStatus();
+  void resetStats();
+};
+
+#endif
@@ -2,264 +2,766 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <TimeLib.h>
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_arduino_version.h"
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+#include "lwip/tcpip.h"
+#endif
+
+#define PERSIST_MAGIC 0x54494D45  // "TIME"
+
+// Survives software resets and deep sleep, lost on power-off
+struct PersistedClock {
+  uint32_t magic;
+  int64_t utcUs;
+  int64_t doseWatermark;
+  uint32_t checksum;
+};
+RTC_NOINIT_ATTR static PersistedClock rtcClock;
+
+static uint32_t clockChecksum(const PersistedClock& c) {
+  uint32_t sum = c.magic;
+  sum = sum * 31 + (uint32_t)c.utcUs + (uint32_t)(c.utcUs >> 32);
+  sum = sum * 31 + (uint32_t)c.doseWatermark + (uint32_t)(c.doseWatermark >> 32);
+  return sum;
+}
+
+volatile bool TimeManager::syncPending = false;
+struct timeval TimeManager::pendingSyncTime = {0, 0};
+int64_t TimeManager::pendingSyncMonoUs = 0;
+portMUX_TYPE TimeManager::syncMux = portMUX_INITIALIZER_UNLOCKED;
+portMUX_TYPE TimeManager::timeMux = portMUX_INITIALIZER_UNLOCKED;
 
 TimeManager::TimeManager() {
   ntpServer = "pool.ntp.org";
-  gmtOffset_sec = 0;
-  daylightOffset_sec = 0;
+  currentOffset = 0;
+  offsetKnown = false;
   lastSyncTime = 0;
   isTimeSynced = false;
-  memset(&timeinfo, 0, sizeof(timeinfo));
+  memset(&snapshot, 0, sizeof(snapshot));
+  snapshotBuilds = 0;
+  snapshotReads = 0;
+  snapshotBuildMicros = 0;
   
-  // Initialize software RTC
-  memset(&softwareRTC, 0, sizeof(softwareRTC));
-  softwareRTCInitialized = false;
-  lastSecondUpdate = 0;
+  // Timebase starts invalid until the first reference sample
+  epochOffsetUs = 0;
+  slewRemainingUs = 0;
+  lastDisciplineUs = 0;
+  lastSampleMonoUs = 0;
+  lastCorrectionUs = 0;
+  driftPpm = 0.0;
+  driftAccumulatorUs = 0.0;
+  timebaseValid = false;
+  lastPushedSecond = 0;
+  onClockStepCallback = nullptr;
+  timeRestored = false;
+  timeProvisional = false;
+  restoredLocal = 0;
+  doseWatermark = 0;
+  lastRtcPersist = 0;
+  lastNvsPersist = 0;
+  
+  syncServers[0] = ntpServer;
+  syncServers[1] = "time.nist.gov";
+  syncServers[2] = "ntp.ubuntu.com";
+  serverIndex = 0;
+  sntpStarted = false;
+  bootStart = 0;
+  syncWaitStart = 0;
+  syncWaitLimit = FIRST_SYNC_TIMEOUT;
+  syncTimeout = FIRST_SYNC_TIMEOUT;
+  syncCount = 0;
+  maxCorrectionUs = 0;
+  totalCorrectionUs = 0;
 }
 
-void TimeManager::begin(const char* server, long gmtOffset, int daylightOffset) {
+void TimeManager::begin(const char* server) {
   ntpServer = server;
-  gmtOffset_sec = gmtOffset;
-  daylightOffset_sec = daylightOffset;
+  syncServers[0] = server;
+  bootStart = millis();
 
   Serial.println("TimeManager: Initializing NTP time synchronization...");
-  Serial.printf("TimeManager: NTP Server: %s, GMT Offset: %ld, Daylight Offset: %d\n", server, gmtOffset, daylightOffset);
-
-  // Set timezone with configTime
-  configTime(gmtOffset_sec, daylightOffset_sec, ntpServer, "time.nist.gov", "ntp.ubuntu.com");
-
-  Serial.print("TimeManager: Waiting for NTP time sync");
-  int retries = 0;
-  while (!getLocalTime(&timeinfo) && retries < 20) {
-    Serial.print(".");
-    delay(1000);
-    retries++;
-  }
-
-  if (retries >= 20) {
-    Serial.println("\nTimeManager: ❌ Failed to get time from NTP after 20 attempts");
-    isTimeSynced = false;
-
-    // Try to set a fallback time based on compile time
-    Serial.println("TimeManager: Setting fallback time based on compilation time");
-    struct tm compileTime = {0};
-    compileTime.tm_year = 2025 - 1900; // Year since 1900
-    compileTime.tm_mon = 11;  // December (0-based)
-    compileTime.tm_mday = 11; // Day
-    compileTime.tm_hour = 12; // Hour
-    compileTime.tm_min = 0;   // Minute
-    compileTime.tm_sec = 0;   // Second
-    time_t fallbackTime = mktime(&compileTime);
-    struct timeval tv = {fallbackTime, 0};
-    settimeofday(&tv, nullptr);
-    Serial.println("TimeManager: Fallback time set");
+  Serial.printf("TimeManager: NTP Server: %s, Time zone: %s\n", server, getTimezone().c_str());
+
+  // Sync completes in the background - update() picks up the result
+  startSNTP();
+}
+
+bool TimeManager::restoreTime() {
+  if (timebaseValid) {
+    return false;
+  }
+  
+  int64_t savedUs = 0;
+  String source;
+  
+  if (rtcClock.magic == PERSIST_MAGIC && rtcClock.checksum == clockChecksum(rtcClock)) {
+    savedUs = rtcClock.utcUs;
+    doseWatermark = rtcClock.doseWatermark;
+    source = "RTC memory";
   } else {
-    Serial.println("\nTimeManager: ✅ Time synced from NTP successfully!");
-    isTimeSynced = true;
-    lastSyncTime = millis();
+    Preferences prefs;
+    if (prefs.begin(TIME_PREFS_NAMESPACE, true)) {
+      savedUs = prefs.getLong64("utc", 0);
+      doseWatermark = (time_t)prefs.getLong64("mark", 0);
+      prefs.end();
+    }
+    source = "NVS";
+  }
+  
+  if (savedUs / 1000000 < 1577836800) {
+    Serial.println("TimeManager: No persisted time - waiting for NTP");
+    return false;
+  }
+  
+  // The record predates this boot - add the uptime since (the reset itself is not counted)
+  time_t savedUtc = (time_t)(savedUs / 1000000);
+  restoredLocal = savedUtc + offsetAt(savedUtc);
+  applyReferenceTime(savedUs + esp_timer_get_time(), source.c_str());
+  lastSampleMonoUs = 0; // Not a trustworthy drift baseline
+  timeRestored = true;
+  
+  // After a power loss the clock is behind by however long the power was off
+  if (source == "NVS") {
+    timeProvisional = true;
+    Serial.println("TimeManager: ⚠️ Time restored from NVS is provisional until NTP (powered-off time unknown): " + getDateTimeString());
+    return true;
+  }
+  
+  Serial.println("TimeManager: ✅ Time restored from " + source + ": " + getDateTimeString());
+  return true;
+}
 
-    // Print current time for verification
-    char timeStringBuff[50];
-    strftime(timeStringBuff, sizeof(timeStringBuff), "%Y-%m-%d %H:%M:%S", &timeinfo);
-    Serial.print("TimeManager: Current time: ");
-    Serial.println(timeStringBuff);
-
-    // CRITICAL: Sync Arduino Time library for TimeAlarms compatibility
-    // TimeAlarms library uses hour(), minute(), second() from TimeLib.h
-    // We must call setTime() to sync the Time library with NTP time
-    setTime(timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec, 
-            timeinfo.tm_mday, timeinfo.tm_mon + 1, timeinfo.tm_year + 1900);
-    Serial.println("TimeManager: ✅ Arduino Time library synced for TimeAlarms");
-    Serial.printf("TimeManager: TimeLib shows: %02d:%02d:%02d\n", hour(), minute(), second());
-    
-    // Initialize software RTC with NTP time
-    initializeSoftwareRTC();
+void TimeManager::persistClock(bool toNVS) {
+  // Never persist the fallback or a provisional time - it would look real after a reboot
+  if (!timebaseValid || timeProvisional || (!isTimeSynced && !timeRestored)) {
+    return;
+  }
+  
+  int64_t utcUs = getEpochMicros();
+  rtcClock.magic = PERSIST_MAGIC;
+  rtcClock.utcUs = utcUs;
+  rtcClock.doseWatermark = doseWatermark;
+  rtcClock.checksum = clockChecksum(rtcClock);
+  lastRtcPersist = millis();
+  
+  if (toNVS) {
+    Preferences prefs;
+    if (prefs.begin(TIME_PREFS_NAMESPACE, false)) {
+      prefs.putLong64("utc", utcUs);
+      prefs.putLong64("mark", (int64_t)doseWatermark);
+      prefs.end();
+    }
+    lastNvsPersist = lastRtcPersist;
   }
 }
 
-bool TimeManager::syncTime() {
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("TimeManager: ❌ Cannot sync - WiFi not connected");
-    return false;
+void TimeManager::setDoseWatermark(time_t local) {
+  if (local <= doseWatermark || timeProvisional || (!isTimeSynced && !timeRestored)) {
+    return;
   }
+  doseWatermark = local;
+  persistClock(true); // Rare - write through to NVS straight away
+}
 
-  Serial.println("TimeManager: 🔄 Re-syncing time with NTP server...");
+time_t TimeManager::getDoseWatermark() {
+  return doseWatermark;
+}
 
-  // Force reconfigure NTP
-  configTime(gmtOffset_sec, daylightOffset_sec, ntpServer, "time.nist.gov", "ntp.ubuntu.com");
+time_t TimeManager::getRestoredLocalEpoch() {
+  return timeRestored ? restoredLocal : 0;
+}
 
-  // Wait a bit for NTP to update
-  delay(2000);
+bool TimeManager::isTimeRestored() {
+  return timeRestored;
+}
 
-  // Get current time
-  if (!getLocalTime(&timeinfo)) {
-    Serial.println("TimeManager: ❌ Failed to obtain time from NTP");
-    isTimeSynced = false;
-    return false;
-  }
+bool TimeManager::isTimeProvisional() {
+  return timeProvisional;
+}
 
-  char timeStringBuff[50];
-  strftime(timeStringBuff, sizeof(timeStringBuff), "%Y-%m-%d %H:%M:%S", &timeinfo);
-  Serial.print("TimeManager: ✅ Current DateTime: ");
-  Serial.println(timeStringBuff);
+void TimeManager::startSNTP() {
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  // lwIP on core 3.x asserts unless the SNTP client is driven under the
+  // TCPIP core lock, as configTime() does - this runs in an app task
+  LOCK_TCPIP_CORE();
+  if (esp_sntp_enabled()) {
+    esp_sntp_stop();
+  }
+  esp_sntp_setoperatingmode(ESP_SNTP_OPMODE_POLL);
+  esp_sntp_setservername(0, syncServers[serverIndex]);
+#else
+  if (sntp_enabled()) {
+    sntp_stop();
+  }
+  sntp_setoperatingmode(SNTP_OPMODE_POLL);
+  sntp_setservername(0, syncServers[serverIndex]);
+#endif
+  
+  // Smooth mode adjusts the system clock gradually for small corrections
+  sntp_set_sync_mode(SNTP_SYNC_MODE_SMOOTH);
+  sntp_set_sync_interval(SYNC_INTERVAL);
+  sntp_set_time_sync_notification_cb(onSNTPSync);
+  
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  esp_sntp_init();
+  UNLOCK_TCPIP_CORE();
+#else
+  sntp_init();
+#endif
+  
+  sntpStarted = true;
+  syncWaitStart = millis();
+  syncWaitLimit = syncTimeout;
+  Serial.printf("TimeManager: SNTP started with %s (waiting up to %lu s)\n", 
+                syncServers[serverIndex], syncTimeout / 1000);
+}
 
-  // CRITICAL: Sync Arduino Time library for TimeAlarms compatibility
-  setTime(timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec, 
-          timeinfo.tm_mday, timeinfo.tm_mon + 1, timeinfo.tm_year + 1900);
-  Serial.println("TimeManager: ✅ Arduino Time library synced for TimeAlarms");
-  Serial.printf("TimeManager: TimeLib shows: %02d:%02d:%02d\n", hour(), minute(), second());
+void TimeManager::onSNTPSync(struct timeval* tv) {
+  // Runs in the lwIP task - just record the sample and when it arrived
+  portENTER_CRITICAL(&syncMux);
+  pendingSyncTime = *tv;
+  pendingSyncMonoUs = esp_timer_get_time();
+  syncPending = true;
+  portEXIT_CRITICAL(&syncMux);
+}
 
+void TimeManager::consumeSyncSample() {
+  if (!syncPending) {
+    return;
+  }
+  
+  portENTER_CRITICAL(&syncMux);
+  struct timeval tv = pendingSyncTime;
+  int64_t capturedMonoUs = pendingSyncMonoUs;
+  syncPending = false;
+  portEXIT_CRITICAL(&syncMux);
+  
+  // Account for the time between the callback and now
+  int64_t referenceUs = (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec + (esp_timer_get_time() - capturedMonoUs);
+  applyReferenceTime(referenceUs, syncServers[serverIndex]);
+  
+  // The first sync is the initial set, not a correction
+  int64_t magnitude = llabs(lastCorrectionUs);
+  if (syncCount > 0) {
+    totalCorrectionUs += magnitude;
+    if (magnitude > maxCorrectionUs) {
+      maxCorrectionUs = magnitude;
+    }
+  }
+  syncCount++;
+  
+  if (!isTimeSynced) {
+    Serial.println("TimeManager: ✅ Time synced from NTP successfully!");
+    Serial.println("TimeManager: Current time: " + getDateTimeString());
+  }
   isTimeSynced = true;
   lastSyncTime = millis();
   
-  // Sync software RTC from NTP
-  syncSoftwareRTCFromNTP();
+  // Next sync is expected one poll interval from now
+  syncTimeout = FIRST_SYNC_TIMEOUT;
+  syncWaitStart = millis();
+  syncWaitLimit = SYNC_INTERVAL + FIRST_SYNC_TIMEOUT;
+}
+
+void TimeManager::applyFallbackTime() {
+  Serial.println("TimeManager: ❌ No NTP time after " + String(BOOT_FALLBACK_DELAY / 1000) + " s");
+  Serial.println("TimeManager: Setting fallback time based on compilation time");
+  
+  // 2025-12-11 12:00 local time
+  struct tm compileTime = {};
+  compileTime.tm_year = 2025 - 1900; // Year since 1900
+  compileTime.tm_mon = 11;  // December (0-based)
+  compileTime.tm_mday = 11; // Day
+  compileTime.tm_hour = 12; // Hour
+  compileTime.tm_min = 0;   // Minute
+  compileTime.tm_sec = 0;   // Second
+  time_t fallbackLocal = mktime(&compileTime);
+  time_t fallbackTime = fallbackLocal - offsetAt(fallbackLocal);
   
+  if (time(nullptr) < 1577836800) {
+    struct timeval tv = {fallbackTime, 0};
+    settimeofday(&tv, nullptr);
+  }
+  applyReferenceTime((int64_t)fallbackTime * 1000000LL, "fallback");
+  Serial.println("TimeManager: Fallback time set");
+}
+
+bool TimeManager::syncTime() {
+  if (WiFi.status() != WL_CONNECTED) {
+    Serial.println("TimeManager: ❌ Cannot sync - WiFi not connected");
+    return false;
+  }
+
+  Serial.println("TimeManager: 🔄 Requesting NTP sync from " + String(syncServers[serverIndex]) + "...");
+
+  if (!sntpStarted) {
+    startSNTP();
+  } else {
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    LOCK_TCPIP_CORE();
+    sntp_restart();
+    UNLOCK_TCPIP_CORE();
+#else
+    sntp_restart();
+#endif
+    syncWaitStart = millis();
+    syncWaitLimit = syncTimeout;
+  }
   return true;
 }
 
 void TimeManager::forceSync() {
   Serial.println("TimeManager: 🔄 Force syncing time...");
-  if (syncTime()) {
-    syncSoftwareRTCFromNTP();
-  }
+  syncTime();
 }
 
-void TimeManager::initializeSoftwareRTC() {
-  Serial.println("TimeManager: Initializing software RTC...");
+void TimeManager::applyReferenceTime(int64_t referenceUs, const char* source) {
+  // Bring the offset up to date before measuring the error
+  discipline();
   
-  // Try to get time from NTP first
-  if (getLocalTime(&timeinfo)) {
-    // Copy NTP time to software RTC
-    softwareRTC = timeinfo;
-    softwareRTCInitialized = true;
-    lastSecondUpdate = millis();
-    Serial.println("TimeManager: Software RTC initialized from NTP");
-    
-    char timeStringBuff[50];
-    strftime(timeStringBuff, sizeof(timeStringBuff), "%Y-%m-%d %H:%M:%S", &softwareRTC);
-    Serial.print("TimeManager: Software RTC time: ");
-    Serial.println(timeStringBuff);
+  int64_t mono = esp_timer_get_time();
+  portENTER_CRITICAL(&timeMux);
+  int64_t errorUs = referenceUs - (mono + epochOffsetUs);
+  portEXIT_CRITICAL(&timeMux);
+  lastCorrectionUs = errorUs;
+  bool stepped = false;
+  
+  // A provisional clock is replaced outright and reported as an initial set
+  time_t oldLocal = timebaseValid && !timeProvisional ? getLocalEpoch() : 0;
+  
+  if (!timebaseValid || timeProvisional || llabs(errorUs) >= STEP_THRESHOLD_US) {
+    // First sample or large error - step and restart the drift baseline
+    portENTER_CRITICAL(&timeMux);
+    epochOffsetUs += errorUs;
+    portEXIT_CRITICAL(&timeMux);
+    slewRemainingUs = 0;
+    lastSampleMonoUs = mono;
+    timebaseValid = true;
+    timeProvisional = false;
+    stepped = true;
+    Serial.printf("TimeManager: Timebase stepped by %lld ms (%s)\n", (long long)(errorUs / 1000), source);
   } else {
-    // Fallback: set to current date/time
-    Serial.println("TimeManager: NTP failed, setting software RTC to fallback time");
-    softwareRTC.tm_year = 2025 - 1900; // Year since 1900
-    softwareRTC.tm_mon = 11;  // December (0-based)
-    softwareRTC.tm_mday = 11; // Day
-    softwareRTC.tm_hour = 12; // Hour
-    softwareRTC.tm_min = 0;   // Minute
-    softwareRTC.tm_sec = 0;   // Second
-    softwareRTCInitialized = true;
-    lastSecondUpdate = millis();
-  }
-}
-
-void TimeManager::updateSoftwareRTC() {
-  if (!softwareRTCInitialized) {
-    initializeSoftwareRTC();
+    // Whatever error remains beyond the still-pending slew is oscillator drift
+    int64_t interval = mono - lastSampleMonoUs;
+    if (lastSampleMonoUs != 0 && interval >= MIN_DRIFT_INTERVAL_US) {
+      double residualPpm = (double)(errorUs - slewRemainingUs) * 1e6 / (double)interval;
+      driftPpm += residualPpm * 0.5;
+      if (driftPpm > MAX_DRIFT_PPM) driftPpm = MAX_DRIFT_PPM;
+      if (driftPpm < -MAX_DRIFT_PPM) driftPpm = -MAX_DRIFT_PPM;
+    }
+    lastSampleMonoUs = mono;
+    slewRemainingUs = errorUs;
+    Serial.printf("TimeManager: Slewing %lld ms (%s), drift estimate %.2f ppm\n",
+                  (long long)(errorUs / 1000), source, driftPpm);
+  }
+  
+  lastPushedSecond = 0; // Force TimeLib refresh
+  pushToTimeLib();
+  
+  // Alarms are serviced after this returns - let the scheduler re-evaluate first
+  if (stepped && onClockStepCallback != nullptr) {
+    onClockStepCallback(oldLocal, getLocalEpoch());
+  }
+}
+
+void TimeManager::setClockStepCallback(void (*callback)(time_t, time_t)) {
+  onClockStepCallback = callback;
+}
+
+void TimeManager::discipline() {
+  int64_t mono = esp_timer_get_time();
+  int64_t elapsed = mono - lastDisciplineUs;
+  if (elapsed < DISCIPLINE_INTERVAL_US) {
     return;
   }
+  lastDisciplineUs = mono;
   
-  // Update every second
-  if (millis() - lastSecondUpdate >= 1000) {
-    lastSecondUpdate = millis();
-    
-    // Increment seconds
-    softwareRTC.tm_sec++;
-    
-    // Handle minute rollover
-    if (softwareRTC.tm_sec >= 60) {
-      softwareRTC.tm_sec = 0;
-      softwareRTC.tm_min++;
-      
-      // Handle hour rollover
-      if (softwareRTC.tm_min >= 60) {
-        softwareRTC.tm_min = 0;
-        softwareRTC.tm_hour++;
-        
-        // Handle day rollover (simplified - doesn't handle months with different days)
-        if (softwareRTC.tm_hour >= 24) {
-          softwareRTC.tm_hour = 0;
-          softwareRTC.tm_mday++;
-          
-          // Handle month rollover (simplified)
-          if (softwareRTC.tm_mday > 31) {
-            softwareRTC.tm_mday = 1;
-            softwareRTC.tm_mon++;
-            
-            // Handle year rollover
-            if (softwareRTC.tm_mon >= 12) {
-              softwareRTC.tm_mon = 0;
-              softwareRTC.tm_year++;
-            }
-          }
-        }
-      }
+  if (!timebaseValid) {
+    return;
+  }
+  
+  // Continuous drift compensation, keeping the sub-microsecond remainder
+  driftAccumulatorUs += (double)elapsed * driftPpm / 1e6;
+  int64_t wholeUs = (int64_t)driftAccumulatorUs;
+  driftAccumulatorUs -= wholeUs;
+  
+  // Slew the pending correction at a bounded rate so time stays monotonic
+  int64_t step = 0;
+  if (slewRemainingUs != 0) {
+    int64_t maxStep = elapsed * MAX_SLEW_PPM / 1000000;
+    step = slewRemainingUs;
+    if (step > maxStep) step = maxStep;
+    if (step < -maxStep) step = -maxStep;
+    slewRemainingUs -= step;
+  }
+  
+  portENTER_CRITICAL(&timeMux);
+  epochOffsetUs += wholeUs + step;
+  portEXIT_CRITICAL(&timeMux);
+}
+
+void TimeManager::pushToTimeLib() {
+  if (!timebaseValid) {
+    return;
+  }
+  
+  // TimeAlarms reads TimeLib - write it once per local second boundary
+  time_t utc = (time_t)(getEpochMicros() / 1000000LL);
+  int32_t offset = offsetAt(utc);
+  time_t local = utc + offset;
+  if (local != lastPushedSecond) {
+    setTime(local);
+    lastPushedSecond = local;
+    refreshSnapshot();
+  }
+  
+  // DST transition or zone change - local time jumped by the offset difference
+  if (offsetKnown && offset != currentOffset) {
+    int32_t previousOffset = currentOffset;
+    currentOffset = offset;
+    Serial.printf("TimeManager: UTC offset changed %+ld -> %+ld s (%s)\n",
+                  (long)previousOffset, (long)offset, getZoneName().c_str());
+    if (onClockStepCallback != nullptr) {
+      onClockStepCallback(utc + previousOffset, local);
     }
   }
+  currentOffset = offset;
+  offsetKnown = true;
 }
 
-void TimeManager::syncSoftwareRTCFromNTP() {
-  if (getLocalTime(&timeinfo)) {
-    softwareRTC = timeinfo;
-    softwareRTCInitialized = true;
-    lastSecondUpdate = millis();
-    Serial.println("TimeManager: Software RTC synced from NTP");
+void TimeManager::loadTimezone(const char* defaultTZ) {
+  String saved;
+  Preferences prefs;
+  if (prefs.begin(TIME_PREFS_NAMESPACE, true)) {
+    saved = prefs.getString("tz", "");
+    prefs.end();
+  }
+  
+  if (saved.length() > 0 && applyTimezone(saved.c_str())) {
+    Serial.println("TimeManager: Time zone " + saved + " (saved)");
+  } else if (applyTimezone(defaultTZ)) {
+    Serial.println("TimeManager: Time zone " + String(defaultTZ) + " (default)");
+  } else {
+    Serial.println("TimeManager: ❌ Invalid time zone " + String(defaultTZ) + " - using UTC");
   }
 }
 
-String TimeManager::getSoftwareRTCTimeString() {
-  if (!softwareRTCInitialized) {
-    return "12/11/2025 12:00:00 PM";
+bool TimeManager::applyTimezone(const char* tz) {
+  // Parse outside the lock, then swap the whole rule set in at once
+  TimeZoneRules parsed;
+  if (!parsed.set(tz)) {
+    return false;
+  }
+  portENTER_CRITICAL(&timeMux);
+  tzRules = parsed;
+  portEXIT_CRITICAL(&timeMux);
+  return true;
+}
+
+int32_t TimeManager::offsetAt(time_t utc) {
+  // The lookup updates the rules' segment cache
+  portENTER_CRITICAL(&timeMux);
+  int32_t offset = tzRules.offsetAt(utc);
+  portEXIT_CRITICAL(&timeMux);
+  return offset;
+}
+
+bool TimeManager::setTimezone(const char* tz) {
+  if (getTimezone() == tz) {
+    return true;
+  }
+  if (!applyTimezone(tz)) {
+    Serial.println("TimeManager: ❌ Invalid POSIX TZ string: " + String(tz));
+    return false;
   }
   
-  char buffer[25];
-  strftime(buffer, sizeof(buffer), "%m/%d/%Y %I:%M:%S %p", &softwareRTC);
+  Preferences prefs;
+  if (prefs.begin(TIME_PREFS_NAMESPACE, false)) {
+    prefs.putString("tz", tz);
+    prefs.end();
+  }
+  Serial.println("TimeManager: ✅ Time zone set to " + String(tz));
+  
+  // Re-push so TimeLib and the schedule see the new local time now
+  portENTER_CRITICAL(&timeMux);
+  snapshot.utc = 0;
+  portEXIT_CRITICAL(&timeMux);
+  lastPushedSecond = 0;
+  pushToTimeLib();
+  return true;
+}
+
+String TimeManager::getTimezone() {
+  char tz[TZ_STRING_MAX];
+  portENTER_CRITICAL(&timeMux);
+  strcpy(tz, tzRules.getString());
+  portEXIT_CRITICAL(&timeMux);
+  return String(tz);
+}
+
+String TimeManager::getZoneName() {
+  time_t utc = (time_t)(getEpochMicros() / 1000000LL);
+  char name[TZ_NAME_MAX];
+  portENTER_CRITICAL(&timeMux);
+  strcpy(name, tzRules.nameAt(utc));
+  portEXIT_CRITICAL(&timeMux);
+  return String(name);
+}
+
+bool TimeManager::isDST() {
+  time_t utc = (time_t)(getEpochMicros() / 1000000LL);
+  portENTER_CRITICAL(&timeMux);
+  bool dst = tzRules.isDstAt(utc);
+  portEXIT_CRITICAL(&timeMux);
+  return dst;
+}
+
+int64_t TimeManager::getEpochMicros() {
+  // 64-bit reads are two loads on this core - the lock keeps them whole
+  portENTER_CRITICAL(&timeMux);
+  int64_t offset = epochOffsetUs;
+  portEXIT_CRITICAL(&timeMux);
+  return esp_timer_get_time() + offset;
+}
+
+time_t TimeManager::getLocalEpoch() {
+  time_t utc = (time_t)(getEpochMicros() / 1000000LL);
+  return utc + offsetAt(utc);
+}
+
+double TimeManager::getDriftPpm() {
+  return driftPpm;
+}
+
+long TimeManager::getPendingSlewMs() {
+  return (long)(slewRemainingUs / 1000);
+}
+
+long TimeManager::getLastCorrectionMs() {
+  return (long)(lastCorrectionUs / 1000);
+}
+
+bool TimeManager::getLocalTm(struct tm* out) {
+  TimeSnapshot now = getSnapshot();
+  if (!now.valid) {
+    return false;
+  }
+  *out = now.fields;
+  return true;
+}
+
+String TimeManager::formatLocal(const char* format) {
+  TimeSnapshot now = getSnapshot();
+  if (!now.valid) {
+    return "N/A";
+  }
+  char buffer[64];
+  strftime(buffer, sizeof(buffer), format, &now.fields);
   return String(buffer);
 }
 
-String TimeManager::getSoftwareRTCDateTimeString() {
-  if (!softwareRTCInitialized) {
-    return "2025-12-11 12:00:00";
+static inline void put2(char* p, int value) {
+  p[0] = '0' + value / 10;
+  p[1] = '0' + value % 10;
+}
+
+static inline void put4(char* p, int value) {
+  put2(p, value / 100);
+  put2(p + 2, value % 100);
+}
+
+void TimeManager::buildSnapshot(TimeSnapshot* out) {
+  if (!timebaseValid) {
+    // Same placeholders the string accessors have always returned
+    memset(out, 0, sizeof(*out));
+    strcpy(out->time, "12:00:00");
+    strcpy(out->display, "12/11/2025 12:00:00 PM");
+    strcpy(out->date, "0000-00-00");
+    strcpy(out->dateTime, "2025-12-11 12:00:00");
+    strcpy(out->iso8601, "2025-12-11T12:00:00");
+    strcpy(out->logPrefix, "[2025-12-11 12:00:00] ");
+    return;
   }
   
-  char buffer[20];
-  strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &softwareRTC);
-  return String(buffer);
+  time_t utc = (time_t)(getEpochMicros() / 1000000LL);
+  out->valid = true;
+  out->utc = utc;
+  out->offset = offsetAt(utc);
+  out->local = utc + out->offset;
+  gmtime_r(&out->local, &out->fields);
+  
+  const struct tm& t = out->fields;
+  int year = t.tm_year + 1900;
+  int hour12 = t.tm_hour % 12 == 0 ? 12 : t.tm_hour % 12;
+  
+  // "HH:MM:SS"
+  put2(out->time, t.tm_hour);
+  out->time[2] = ':';
+  put2(out->time + 3, t.tm_min);
+  out->time[5] = ':';
+  put2(out->time + 6, t.tm_sec);
+  out->time[8] = '\0';
+  
+  // "YYYY-MM-DD"
+  put4(out->date, year);
+  out->date[4] = '-';
+  put2(out->date + 5, t.tm_mon + 1);
+  out->date[7] = '-';
+  put2(out->date + 8, t.tm_mday);
+  out->date[10] = '\0';
+  
+  // "YYYY-MM-DD HH:MM:SS"
+  memcpy(out->dateTime, out->date, 10);
+  out->dateTime[10] = ' ';
+  memcpy(out->dateTime + 11, out->time, 9);
+  
+  // "YYYY-MM-DDTHH:MM:SS+hh:mm"
+  memcpy(out->iso8601, out->dateTime, 20);
+  out->iso8601[10] = 'T';
+  int32_t offsetMinutes = out->offset / 60;
+  out->iso8601[19] = offsetMinutes < 0 ? '-' : '+';
+  if (offsetMinutes < 0) offsetMinutes = -offsetMinutes;
+  put2(out->iso8601 + 20, offsetMinutes / 60);
+  out->iso8601[22] = ':';
+  put2(out->iso8601 + 23, offsetMinutes % 60);
+  out->iso8601[25] = '\0';
+  
+  // "MM/DD/YYYY hh:MM:SS AM"
+  put2(out->display, t.tm_mon + 1);
+  out->display[2] = '/';
+  put2(out->display + 3, t.tm_mday);
+  out->display[5] = '/';
+  put4(out->display + 6, year);
+  out->display[10] = ' ';
+  put2(out->display + 11, hour12);
+  memcpy(out->display + 13, out->time + 2, 6);
+  out->display[19] = ' ';
+  out->display[20] = t.tm_hour < 12 ? 'A' : 'P';
+  out->display[21] = 'M';
+  out->display[22] = '\0';
+  
+  // "[YYYY-MM-DD HH:MM:SS] "
+  out->logPrefix[0] = '[';
+  memcpy(out->logPrefix + 1, out->dateTime, 19);
+  out->logPrefix[20] = ']';
+  out->logPrefix[21] = ' ';
+  out->logPrefix[22] = '\0';
+}
+
+void TimeManager::refreshSnapshot() {
+  unsigned long started = micros();
+  TimeSnapshot built;
+  buildSnapshot(&built);
+  unsigned long elapsed = micros() - started;
+  
+  portENTER_CRITICAL(&timeMux);
+  snapshot = built;
+  snapshotBuilds++;
+  snapshotBuildMicros += elapsed;
+  portEXIT_CRITICAL(&timeMux);
+}
+
+TimeSnapshot TimeManager::getSnapshot() {
+  // Cheap staleness check; the rebuild itself happens once per second
+  time_t utc = timebaseValid ? (time_t)(getEpochMicros() / 1000000LL) : 0;
+  TimeSnapshot copy;
+  portENTER_CRITICAL(&timeMux);
+  snapshotReads++;
+  bool stale = snapshotBuilds == 0 || snapshot.valid != timebaseValid || (timebaseValid && utc != snapshot.utc);
+  if (!stale) {
+    copy = snapshot;
+  }
+  portEXIT_CRITICAL(&timeMux);
+
+  if (stale) {
+    refreshSnapshot();
+    portENTER_CRITICAL(&timeMux);
+    copy = snapshot;
+    portEXIT_CRITICAL(&timeMux);
+  }
+  return copy;
+}
+
+void TimeManager::benchmarkFormatting() {
+  const int iterations = 200;
+  
+  // Old path: broken-down time + strftime + String per call
+  unsigned long started = micros();
+  size_t sink = 0;
+  for (int i = 0; i < iterations; i++) {
+    time_t local = getLocalEpoch();
+    struct tm fields;
+    gmtime_r(&local, &fields);
+    char buffer[64];
+    strftime(buffer, sizeof(buffer), "%m/%d/%Y %I:%M:%S %p", &fields);
+    String formatted(buffer);
+    sink += formatted.length();
+  }
+  unsigned long legacyMicros = micros() - started;
+  
+  // Snapshot view
+  started = micros();
+  for (int i = 0; i < iterations; i++) {
+    sink += getSnapshot().display[0];
+  }
+  unsigned long snapshotMicros = micros() - started;
+  
+  Serial.println("TimeManager: Time formatting benchmark (" + String(iterations) + " calls)");
+  Serial.printf("  strftime + String:  %.2f us/call\n", (float)legacyMicros / iterations);
+  Serial.printf("  Snapshot view:      %.2f us/call\n", (float)snapshotMicros / iterations);
+  Serial.printf("  Snapshot rebuilds:  %lu (avg %.1f us), reads: %lu\n", snapshotBuilds,
+                snapshotBuilds > 0 ? (float)snapshotBuildMicros / snapshotBuilds : 0.0f, snapshotReads);
+  if (sink == 0) {
+    Serial.println();
+  }
 }
 
 void TimeManager::update() {
-  // Update software RTC every call (it handles its own timing internally)
-  updateSoftwareRTC();
-  
-  // CRITICAL: Keep TimeLib synchronized with software RTC for TimeAlarms
-  // This ensures hour(), minute(), second() functions return current time
-  static unsigned long lastTimeSyncUpdate = 0;
-  if (millis() - lastTimeSyncUpdate >= 1000) { // Sync every second
-    if (softwareRTCInitialized) {
-      setTime(softwareRTC.tm_hour, softwareRTC.tm_min, softwareRTC.tm_sec,
-              softwareRTC.tm_mday, softwareRTC.tm_mon + 1, softwareRTC.tm_year + 1900);
-    }
-    lastTimeSyncUpdate = millis();
+  discipline();
+  consumeSyncSample();
+  pushToTimeLib();
+  
+  unsigned long currentMillis = millis();
+  
+  // Nothing from NTP yet - give TimeLib a sensible time instead of 1970
+  if (!timebaseValid && currentMillis - bootStart >= BOOT_FALLBACK_DELAY) {
+    applyFallbackTime();
   }
   
-  // Check if time is valid, if not, try to sync immediately
-  time_t currentTime = time(nullptr);
-  if (currentTime < 1000000000) { // Invalid time (before year 2001)
-    Serial.println("TimeManager: System time is invalid, attempting immediate NTP sync...");
-    syncTime();
+  if (currentMillis - lastRtcPersist >= PERSIST_RTC_INTERVAL) {
+    persistClock(currentMillis - lastNvsPersist >= PERSIST_NVS_INTERVAL);
+  }
+  
+  if (!sntpStarted) {
     return;
   }
-
-  // Re-sync every 6 hours to keep software RTC accurate
-  if (isTimeSynced && (millis() - lastSyncTime > SYNC_INTERVAL)) {
-    Serial.println("TimeManager: Auto-sync triggered (6 hour interval)");
-    syncTime();
-    // Sync software RTC from NTP after successful sync
-    if (isTimeSynced) {
-      syncSoftwareRTCFromNTP();
-    }
+  
+  // Server rotation only makes sense while the network is up
+  if (WiFi.status() != WL_CONNECTED) {
+    syncWaitStart = currentMillis;
+    return;
   }
+  
+  if (currentMillis - syncWaitStart >= syncWaitLimit) {
+    serverIndex = (serverIndex + 1) % NTP_SERVER_COUNT;
+    syncTimeout = syncTimeout * 2 > MAX_SYNC_BACKOFF ? MAX_SYNC_BACKOFF : syncTimeout * 2;
+    Serial.println("⚠️ TimeManager: NTP sync overdue - switching to " + String(syncServers[serverIndex]));
+    startSNTP();
+  }
+}
+
+long TimeManager::getMaxCorrectionMs() {
+  return (long)(maxCorrectionUs / 1000);
+}
+
+unsigned long TimeManager::getSyncCount() {
+  return syncCount;
+}
+
+String TimeManager::getCurrentServer() {
+  return String(syncServers[serverIndex]);
 }
 
 time_t TimeManager::getTimestampWithFallback() {
@@ -283,12 +785,11 @@ time_t TimeManager::getTimestampWithFallback() {
 }
 
 bool TimeManager::isNTPSynced() {
-  time_t now = time(nullptr);
-  return (now > 1000000000); // Valid timestamp (after year 2001)
+  return isTimeValid();
 }
 
 String TimeManager::getFormattedDateTime() {
-  if (!getLocalTime(&timeinfo)) {
+  if (!timebaseValid) {
     // Return fallback formatted time if NTP fails
     unsigned long fallbackTimestamp = millis() / 1000 + 1692620000;
     time_t fallbackTime = (time_t)fallbackTimestamp;
@@ -299,9 +800,7 @@ String TimeManager::getFormattedDateTime() {
     return String(timeStringBuff) + " (EST)"; // Estimated time
   }
   
-  char timeStringBuff[50];
-  strftime(timeStringBuff, sizeof(timeStringBuff), "%Y-%m-%d %H:%M:%S", &timeinfo);
-  return String(timeStringBuff);
+  return String(getSnapshot().dateTime);
 }
 
 String TimeManager::getFormattedDateTimeWithFallback() {
@@ -320,60 +819,65 @@ String TimeManager::getFormattedDateTimeWithFallback() {
 }
 
 String TimeManager::getCurrentLogPrefix() {
-  String datetime = getFormattedDateTimeWithFallback();
-  return "[" + datetime + "] ";
+  if (!isNTPSynced()) {
+    return "[" + getFormattedDateTimeWithFallback() + "] ";
+  }
+  return String(getSnapshot().logPrefix);
 }
 
 String TimeManager::getTimeString() {
-  return getSoftwareRTCTimeString();
+  return String(getSnapshot().display);
 }
 
 String TimeManager::getDateString() {
-  if (!getLocalTime(&timeinfo)) {
-    return "0000-00-00";
-  }
-  
-  char buffer[11];
-  strftime(buffer, sizeof(buffer), "%Y-%m-%d", &timeinfo);
-  return String(buffer);
+  return String(getSnapshot().date);
 }
 
 String TimeManager::getDateTimeString() {
-  return getSoftwareRTCDateTimeString();
+  return String(getSnapshot().dateTime);
 }
 
 time_t TimeManager::getTimestamp() {
-  return time(nullptr);
+  if (!timebaseValid) {
+    return 0;
+  }
+  return (time_t)(getEpochMicros() / 1000000LL);
 }
 
 int TimeManager::getHour() {
-  if (!getLocalTime(&timeinfo)) return 0;
-  return timeinfo.tm_hour;
+  TimeSnapshot now = getSnapshot();
+  if (!now.valid) return 0;
+  return now.fields.tm_hour;
 }
 
 int TimeManager::getMinute() {
-  if (!getLocalTime(&timeinfo)) return 0;
-  return timeinfo.tm_min;
+  TimeSnapshot now = getSnapshot();
+  if (!now.valid) return 0;
+  return now.fields.tm_min;
 }
 
 int TimeManager::getSecond() {
-  if (!getLocalTime(&timeinfo)) return 0;
-  return timeinfo.tm_sec;
+  TimeSnapshot now = getSnapshot();
+  if (!now.valid) return 0;
+  return now.fields.tm_sec;
 }
 
 int TimeManager::getDay() {
-  if (!getLocalTime(&timeinfo)) return 0;
-  return timeinfo.tm_mday;
+  TimeSnapshot now = getSnapshot();
+  if (!now.valid) return 0;
+  return now.fields.tm_mday;
 }
 
 int TimeManager::getMonth() {
-  if (!getLocalTime(&timeinfo)) return 0;
-  return timeinfo.tm_mon + 1; // tm_mon is 0-11
+  TimeSnapshot now = getSnapshot();
+  if (!now.valid) return 0;
+  return now.fields.tm_mon + 1; // tm_mon is 0-11
 }
 
 int TimeManager::getYear() {
-  if (!getLocalTime(&timeinfo)) return 0;
-  return timeinfo.tm_year + 1900; // tm_year is years since 1900
+  TimeSnapshot now = getSnapshot();
+  if (!now.valid) return 0;
+  return now.fields.tm_year + 1900; // tm_year is years since 1900
 }
 
 bool TimeManager::isSynced() {
@@ -385,19 +889,13 @@ unsigned long TimeManager::getLastSyncTime() {
 }
 
 bool TimeManager::isTimeValid() {
-  time_t now = time(nullptr);
   // Consider time valid if it's after 2020-01-01 (timestamp > 1577836800)
-  return (now > 1577836800);
+  // and not a provisional restore
+  return timebaseValid && !timeProvisional && getTimestamp() > 1577836800;
 }
 
 String TimeManager::getFormattedTime(const char* format) {
-  if (!getLocalTime(&timeinfo)) {
-    return "N/A";
-  }
-  
-  char buffer[64];
-  strftime(buffer, sizeof(buffer), format, &timeinfo);
-  return String(buffer);
+  return formatLocal(format);
 }
 
 void TimeManager::printDebug() {
@@ -413,6 +911,15 @@ void TimeManager::printDebug() {
   Serial.println(isTimeSynced ? "✅ SYNCED" : "❌ NOT SYNCED");
   Serial.print("Time Valid:      ");
   Serial.println(isTimeValid() ? "✅ YES" : "❌ NO");
+  Serial.printf("Time Zone:       %s (%s%s)\n", getTimezone().c_str(), getZoneName().c_str(), isDST() ? ", DST" : "");
+  Serial.print("Restored:        ");
+  Serial.println(timeRestored ? (timeProvisional ? "YES (NVS only - provisional until NTP)" : "YES (persisted clock)") : "NO");
+  Serial.printf("Dose Watermark:  %ld\n", (long)doseWatermark);
+  Serial.printf("Drift Estimate:  %.2f ppm\n", driftPpm);
+  Serial.printf("Last Correction: %ld ms (pending slew %ld ms)\n", getLastCorrectionMs(), getPendingSlewMs());
+  Serial.printf("NTP Syncs:       %lu via %s, max correction %ld ms, avg %ld ms\n",
+                syncCount, syncServers[serverIndex], getMaxCorrectionMs(),
+                syncCount > 1 ? (long)(totalCorrectionUs / (syncCount - 1) / 1000) : 0L);
   
   if (lastSyncTime > 0) {
     unsigned long timeSinceSync = (millis() - lastSyncTime) / 1000;
@@ -434,6 +941,7 @@ void TimeManager::testTime() {
   
   unsigned long lastUpdate = 0;
   bool testRunning = true;
+  struct tm timeinfo;
   
   while (testRunning) {
     // Check for exit command
@@ -455,7 +963,7 @@ void TimeManager::testTime() {
       lastUpdate = millis();
       
       // Get current time
-      if (!getLocalTime(&timeinfo)) {
+      if (!getLocalTm(&timeinfo)) {
         Serial.println("❌ Failed to get local time");
         continue;
       }
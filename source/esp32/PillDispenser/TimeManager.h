@@ -5,37 +5,190 @@
 #include <WiFi.h>
 #include <time.h>
 #include <TimeLib.h>
+#include <Preferences.h>
+#include "esp_sntp.h"
+#include "TimeZoneRules.h"
+
+#define NTP_SERVER_COUNT 3
+#define TIME_PREFS_NAMESPACE "timebase"
+
+// Everything callers format from the clock, rebuilt once per local second
+struct TimeSnapshot {
+  bool valid;
+  time_t utc;
+  time_t local;
+  int32_t offset;           // Seconds east of UTC
+  struct tm fields;         // Broken-down local time
+  char time[9];             // "14:05:09"
+  char display[23];         // "12/11/2025 02:05:09 PM" (getTimeString format)
+  char date[11];            // "2025-12-11"
+  char dateTime[20];        // "2025-12-11 14:05:09"
+  char iso8601[26];         // "2025-12-11T14:05:09+08:00"
+  char logPrefix[23];       // "[2025-12-11 14:05:09] "
+};
+
+/**
+ * TimeManager
+ *
+ * Wall-clock time is derived from the monotonic esp_timer plus an epoch
+ * offset:  UTC (us) = esp_timer_get_time() + epochOffsetUs
+ *
+ * NTP results are fed in as reference samples. Small errors are slewed
+ * into the offset at a bounded rate so time never jumps or runs backwards;
+ * only the first sample or a large error steps the clock. The residual
+ * error between samples is used to estimate the crystal drift (ppm), which
+ * is then compensated continuously. TimeLib (and therefore TimeAlarms) is
+ * updated from this timebase at each local second boundary.
+ *
+ * NTP runs asynchronously through the ESP-IDF SNTP client in smooth mode.
+ * The sync-notification callback only records the sample; update() feeds
+ * it to the timebase. If a sync does not arrive in time the next server is
+ * tried with exponential backoff - nothing here ever waits for the network.
+ *
+ * Once the time is trusted (NTP or restored) it is saved every second to
+ * RTC memory, which survives a software reset, and every 10 minutes to
+ * NVS, which survives power loss. The last handled dose (watermark) is
+ * saved with it so doses due across a reboot can be caught up.
+ *
+ * Only the RTC record is trusted on restore. The NVS record can be up to
+ * 10 minutes old and says nothing about how long the power was off, so a
+ * clock restored from it alone is provisional: it runs for display and
+ * logs, but isTimeValid() stays false until NTP replaces it. That first
+ * NTP step is reported as an initial set, and the scheduler catches up
+ * from the persisted watermark.
+ *
+ * Local time comes from a POSIX TZ string (TimeZoneRules), configurable at
+ * runtime and kept in NVS. A DST transition or zone change shifts local
+ * time; it is reported through the clock-step callback like any other step.
+ */
 
 class TimeManager {
 private:
   const char* ntpServer;
-  long gmtOffset_sec;
-  int daylightOffset_sec;
+  TimeZoneRules tzRules;
+  int32_t currentOffset;        // UTC offset last written to TimeLib
+  bool offsetKnown;
   unsigned long lastSyncTime;
   bool isTimeSynced;
   
   static const unsigned long SYNC_INTERVAL = 21600000; // 6 hours in milliseconds
+  static const unsigned long FIRST_SYNC_TIMEOUT = 30000;   // Try another server if no reply in 30 s
+  static const unsigned long MAX_SYNC_BACKOFF = 1800000;   // Back off to at most 30 minutes
+  static const unsigned long BOOT_FALLBACK_DELAY = 20000;  // Use fallback time if nothing after 20 s
+  
+  // Async SNTP client
+  const char* syncServers[NTP_SERVER_COUNT];
+  uint8_t serverIndex;
+  bool sntpStarted;
+  unsigned long bootStart;
+  unsigned long syncWaitStart;   // Watchdog start for the expected sync
+  unsigned long syncWaitLimit;   // How long to wait before rotating servers
+  unsigned long syncTimeout;     // Current backoff step
+  
+  // Applied-correction metric
+  unsigned long syncCount;
+  int64_t maxCorrectionUs;
+  int64_t totalCorrectionUs;
+  
+  // Written by the SNTP callback (lwIP task), consumed in update()
+  static volatile bool syncPending;
+  static struct timeval pendingSyncTime;
+  static int64_t pendingSyncMonoUs;
+  static portMUX_TYPE syncMux;
+  static void onSNTPSync(struct timeval* tv);
+  
+  // Guards the epoch offset, the zone rules (their lookup cache too) and the
+  // snapshot - every task reads the clock, update() rewrites it
+  static portMUX_TYPE timeMux;
   
-  struct tm timeinfo;
+  // Per-second formatted snapshot
+  TimeSnapshot snapshot;
+  unsigned long snapshotBuilds;
+  unsigned long snapshotReads;
+  unsigned long snapshotBuildMicros;
   
-  // Software RTC variables
-  unsigned long lastSecondUpdate;
-  struct tm softwareRTC;
-  bool softwareRTCInitialized;
+  // Monotonic timebase
+  int64_t epochOffsetUs;        // UTC microseconds minus esp_timer_get_time()
+  int64_t slewRemainingUs;      // Correction not yet applied to the offset
+  int64_t lastDisciplineUs;     // Monotonic time of the last discipline() pass
+  int64_t lastSampleMonoUs;     // Monotonic time of the previous reference sample
+  int64_t lastCorrectionUs;     // Error measured at the last reference sample
+  double driftPpm;              // Estimated oscillator error, positive = local clock slow
+  double driftAccumulatorUs;    // Sub-microsecond remainder of drift compensation
+  bool timebaseValid;
+  time_t lastPushedSecond;      // Last local second written to TimeLib
+  
+  // Notified after every step so alarms can be re-evaluated (old, new local epoch)
+  void (*onClockStepCallback)(time_t oldLocal, time_t newLocal);
+  
+  // Persisted clock (RTC memory + NVS)
+  bool timeRestored;            // Time came from a persisted record, not NTP
+  bool timeProvisional;         // That record was NVS only - the time spent powered off is unknown
+  time_t restoredLocal;         // Local time stored in that record
+  time_t doseWatermark;         // Local time of the last dose handled
+  unsigned long lastRtcPersist;
+  unsigned long lastNvsPersist;
+  
+  static const unsigned long PERSIST_RTC_INTERVAL = 1000;    // RTC memory every second
+  static const unsigned long PERSIST_NVS_INTERVAL = 600000;  // NVS every 10 minutes (flash wear)
+  
+  static const int64_t STEP_THRESHOLD_US = 1000000;         // Errors of 1 s or more are stepped
+  static const int64_t MAX_SLEW_PPM = 500;                  // Slew at most 0.5 ms per second
+  static const int64_t MAX_DRIFT_PPM = 200;                 // Clamp for the drift estimate
+  static const int64_t MIN_DRIFT_INTERVAL_US = 600000000LL; // Need 10 min between samples to estimate drift
+  static const int64_t DISCIPLINE_INTERVAL_US = 100000;     // Apply slew/drift every 100 ms
+  
+  void startSNTP();
+  void consumeSyncSample();
+  void applyFallbackTime();
+  void discipline();
+  void pushToTimeLib();
+  void persistClock(bool toNVS);
+  void refreshSnapshot();
+  void buildSnapshot(TimeSnapshot* out);
+  int32_t offsetAt(time_t utc);
+  bool applyTimezone(const char* tz);
+  bool getLocalTm(struct tm* out);
+  String formatLocal(const char* format);
   
 public:
   TimeManager();
-  void begin(const char* server = "pool.ntp.org", long gmtOffset = 0, int daylightOffset = 0);
+  void begin(const char* server = "pool.ntp.org");
+  bool restoreTime();  // Call early in setup(), before the network is up
   void update();
-  bool syncTime();
+  bool syncTime();   // Requests a sync, returns immediately
   void forceSync(); // Force immediate time sync
   
-  // Software RTC methods
-  void initializeSoftwareRTC();
-  void updateSoftwareRTC();
-  void syncSoftwareRTCFromNTP();
-  String getSoftwareRTCTimeString();
-  String getSoftwareRTCDateTimeString();
+  // Timebase
+  void applyReferenceTime(int64_t referenceUs, const char* source);
+  void setClockStepCallback(void (*callback)(time_t, time_t));
+  int64_t getEpochMicros();   // UTC, microseconds
+  time_t getLocalEpoch();     // Local wall-clock seconds (what TimeLib holds)
+  double getDriftPpm();
+  long getPendingSlewMs();
+  long getLastCorrectionMs();
+  long getMaxCorrectionMs();
+  unsigned long getSyncCount();
+  String getCurrentServer();
+  
+  // Dose watermark (persisted with the clock)
+  void setDoseWatermark(time_t local);
+  time_t getDoseWatermark();
+  time_t getRestoredLocalEpoch();
+  bool isTimeRestored();
+  bool isTimeProvisional();   // Restored from NVS only - not valid for doses until NTP
+  
+  // Time zone (POSIX TZ string, e.g. "PHT-8" or "CET-1CEST,M3.5.0,M10.5.0/3")
+  void loadTimezone(const char* defaultTZ);  // NVS value, or defaultTZ if none saved
+  bool setTimezone(const char* tz);          // Validates, applies and saves to NVS
+  String getTimezone();
+  String getZoneName();
+  bool isDST();
+  
+  // Per-second snapshot, copied out so no other task can rewrite it mid-read.
+  // Use the fields in place, e.g. getSnapshot().display - no allocation.
+  TimeSnapshot getSnapshot();
+  void benchmarkFormatting();       // Snapshot vs. per-call strftime cost
   
   // Time retrieval functions
   String getTimeString();
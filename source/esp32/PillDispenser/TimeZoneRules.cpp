@@ -0,0 +1,320 @@
+#include "TimeZoneRules.h"
+
+#define SECONDS_PER_DAY 86400LL
+
+TimeZoneRules::TimeZoneRules() {
+  transitionCount = 0;
+  tableFirstYear = 0;
+  cacheFrom = 0;
+  cacheUntil = 0;
+  parse("UTC0");
+}
+
+bool TimeZoneRules::set(const char* tz) {
+  if (tz == nullptr || strlen(tz) >= TZ_STRING_MAX) {
+    return false;
+  }
+  
+  TimeZoneRules parsed;
+  if (!parsed.parse(tz)) {
+    return false;
+  }
+  *this = parsed;
+  return true;
+}
+
+const char* TimeZoneRules::getString() {
+  return posix;
+}
+
+bool TimeZoneRules::parse(const char* tz) {
+  const char* p = parseName(tz, stdName);
+  if (p == nullptr) return false;
+  
+  int32_t posixOffset;
+  p = parseOffset(p, &posixOffset);
+  if (p == nullptr) return false;
+  stdOffset = -posixOffset;  // POSIX offsets count westwards
+  
+  hasDst = false;
+  dstName[0] = '\0';
+  dstOffset = stdOffset;
+  
+  if (*p != '\0') {
+    p = parseName(p, dstName);
+    if (p == nullptr) return false;
+    hasDst = true;
+    dstOffset = stdOffset + 3600;
+  
+    if (*p != '\0' && *p != ',') {
+      p = parseOffset(p, &posixOffset);
+      if (p == nullptr) return false;
+      dstOffset = -posixOffset;
+    }
+  
+    // No rules given - POSIX leaves this open, use the US rules like glibc
+    const char* rules;
+    if (*p == ',') {
+      rules = p + 1;
+    } else if (*p == '\0') {
+      rules = "M3.2.0,M11.1.0";
+    } else {
+      return false;
+    }
+  
+    rules = parseRule(rules, &startRule);
+    if (rules == nullptr || *rules != ',') return false;
+    rules = parseRule(rules + 1, &endRule);
+    if (rules == nullptr || *rules != '\0') return false;
+  }
+  
+  strncpy(posix, tz, TZ_STRING_MAX - 1);
+  posix[TZ_STRING_MAX - 1] = '\0';
+  
+  // Force a rebuild on the next lookup
+  transitionCount = 0;
+  tableFirstYear = 0;
+  cacheFrom = 0;
+  cacheUntil = 0;
+  return true;
+}
+
+const char* TimeZoneRules::parseName(const char* p, char* out) {
+  int length = 0;
+  
+  if (*p == '<') {
+    // Quoted form, e.g. <+08>
+    p++;
+    while (*p != '\0' && *p != '>') {
+      if (length < TZ_NAME_MAX - 1) out[length] = *p;
+      length++;
+      p++;
+    }
+    if (*p != '>') return nullptr;
+    p++;
+  } else {
+    while (isalpha((unsigned char)*p)) {
+      if (length < TZ_NAME_MAX - 1) out[length] = *p;
+      length++;
+      p++;
+    }
+  }
+  
+  if (length < 3) return nullptr;
+  out[length < TZ_NAME_MAX - 1 ? length : TZ_NAME_MAX - 1] = '\0';
+  return p;
+}
+
+const char* TimeZoneRules::parseOffset(const char* p, int32_t* seconds) {
+  int sign = 1;
+  if (*p == '+' || *p == '-') {
+    if (*p == '-') sign = -1;
+    p++;
+  }
+  if (!isdigit((unsigned char)*p)) return nullptr;
+  
+  // [+|-]hh[:mm[:ss]]
+  int32_t parts[3] = {0, 0, 0};
+  for (int i = 0; i < 3; i++) {
+    if (i > 0) {
+      if (*p != ':') break;
+      p++;
+      if (!isdigit((unsigned char)*p)) return nullptr;
+    }
+    while (isdigit((unsigned char)*p)) {
+      parts[i] = parts[i] * 10 + (*p - '0');
+      p++;
+    }
+  }
+  if (parts[0] > 167 || parts[1] > 59 || parts[2] > 59) return nullptr;
+  
+  *seconds = sign * (parts[0] * 3600 + parts[1] * 60 + parts[2]);
+  return p;
+}
+
+const char* TimeZoneRules::parseRule(const char* p, TZRule* rule) {
+  char* end;
+  
+  if (*p == 'M') {
+    rule->type = 'M';
+    rule->month = strtol(p + 1, &end, 10);
+    if (*end != '.') return nullptr;
+    rule->week = strtol(end + 1, &end, 10);
+    if (*end != '.') return nullptr;
+    rule->day = strtol(end + 1, &end, 10);
+    if (rule->month < 1 || rule->month > 12 || rule->week < 1 || rule->week > 5 ||
+        rule->day < 0 || rule->day > 6) {
+      return nullptr;
+    }
+  } else if (*p == 'J') {
+    rule->type = 'J';
+    rule->day = strtol(p + 1, &end, 10);
+    if (rule->day < 1 || rule->day > 365) return nullptr;
+  } else if (isdigit((unsigned char)*p)) {
+    rule->type = 'D';
+    rule->day = strtol(p, &end, 10);
+    if (rule->day > 365) return nullptr;
+  } else {
+    return nullptr;
+  }
+  p = end;
+  
+  rule->time = 7200; // 02:00 local unless given
+  if (*p == '/') {
+    p = parseOffset(p + 1, &rule->time);
+  }
+  return p;
+}
+
+// Days since 1970-01-01 for a proleptic Gregorian date
+int64_t TimeZoneRules::daysFromCivil(int year, int month, int day) {
+  year -= month <= 2;
+  int64_t era = (year >= 0 ? year : year - 399) / 400;
+  int64_t yoe = year - era * 400;
+  int64_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+int TimeZoneRules::yearOfDays(int64_t days) {
+  days += 719468;
+  int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  int64_t doe = days - era * 146097;
+  int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  int64_t mp = (5 * doy + 2) / 153;
+  return (int)(yoe + era * 400 + (mp >= 10 ? 1 : 0));
+}
+
+int64_t TimeZoneRules::ruleDay(const TZRule& rule, int year) {
+  int64_t jan1 = daysFromCivil(year, 1, 1);
+  
+  if (rule.type == 'J') {
+    // Julian day 1-365, February 29 is never counted
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return jan1 + rule.day - 1 + (leap && rule.day >= 60 ? 1 : 0);
+  }
+  if (rule.type == 'D') {
+    return jan1 + rule.day;
+  }
+  
+  // Day d of week w of month m, week 5 meaning the last one
+  int64_t first = daysFromCivil(year, rule.month, 1);
+  int64_t next = rule.month == 12 ? daysFromCivil(year + 1, 1, 1) : daysFromCivil(year, rule.month + 1, 1);
+  int firstDow = (int)(((first + 4) % 7 + 7) % 7);  // 1970-01-01 was a Thursday
+  int64_t offset = (rule.day - firstDow + 7) % 7 + (rule.week - 1) * 7;
+  while (first + offset >= next) {
+    offset -= 7;
+  }
+  return first + offset;
+}
+
+void TimeZoneRules::buildTable(int firstYear) {
+  transitionCount = 0;
+  tableFirstYear = firstYear;
+  
+  for (int year = firstYear; year < firstYear + TZ_TABLE_YEARS; year++) {
+    // Start is given in standard time, end in daylight time
+    TZTransition start = { ruleDay(startRule, year) * SECONDS_PER_DAY + startRule.time - stdOffset, dstOffset, true };
+    TZTransition end = { ruleDay(endRule, year) * SECONDS_PER_DAY + endRule.time - dstOffset, stdOffset, false };
+  
+    // Southern hemisphere zones leave DST before they enter it
+    if (start.utc < end.utc) {
+      transitions[transitionCount++] = start;
+      transitions[transitionCount++] = end;
+    } else {
+      transitions[transitionCount++] = end;
+      transitions[transitionCount++] = start;
+    }
+  }
+  
+  // Whatever the year ends in is also what it starts in
+  initialOffset = transitions[1].offset;
+  initialDst = transitions[1].dst;
+}
+
+void TimeZoneRules::lookup(int64_t utc) {
+  if (!hasDst) {
+    cacheFrom = INT64_MIN;
+    cacheUntil = INT64_MAX;
+    cacheOffset = stdOffset;
+    cacheDst = false;
+    return;
+  }
+  
+  int64_t tableStart = daysFromCivil(tableFirstYear, 1, 1) * SECONDS_PER_DAY;
+  int64_t tableEnd = daysFromCivil(tableFirstYear + TZ_TABLE_YEARS, 1, 1) * SECONDS_PER_DAY;
+  if (transitionCount == 0 || utc < tableStart || utc >= tableEnd) {
+    int64_t days = utc / SECONDS_PER_DAY - (utc % SECONDS_PER_DAY < 0 ? 1 : 0);
+    buildTable(yearOfDays(days) - 1);
+    tableStart = daysFromCivil(tableFirstYear, 1, 1) * SECONDS_PER_DAY;
+    tableEnd = daysFromCivil(tableFirstYear + TZ_TABLE_YEARS, 1, 1) * SECONDS_PER_DAY;
+  }
+  
+  // Last transition at or before utc
+  int low = 0;
+  int high = transitionCount - 1;
+  int found = -1;
+  while (low <= high) {
+    int mid = (low + high) / 2;
+    if (transitions[mid].utc <= utc) {
+      found = mid;
+      low = mid + 1;
+    } else {
+      high = mid - 1;
+    }
+  }
+  
+  if (found < 0) {
+    cacheFrom = tableStart;
+    cacheUntil = transitions[0].utc;
+    cacheOffset = initialOffset;
+    cacheDst = initialDst;
+  } else {
+    cacheFrom = transitions[found].utc;
+    cacheUntil = found + 1 < transitionCount ? transitions[found + 1].utc : tableEnd;
+    cacheOffset = transitions[found].offset;
+    cacheDst = transitions[found].dst;
+  }
+}
+
+int32_t TimeZoneRules::offsetAt(int64_t utc) {
+  if (utc < cacheFrom || utc >= cacheUntil) {
+    lookup(utc);
+  }
+  return cacheOffset;
+}
+
+bool TimeZoneRules::isDstAt(int64_t utc) {
+  offsetAt(utc);
+  return cacheDst;
+}
+
+const char* TimeZoneRules::nameAt(int64_t utc) {
+  return isDstAt(utc) ? dstName : stdName;
+}
+
+int64_t TimeZoneRules::nextTransition(int64_t utc) {
+  if (!hasDst) {
+    return 0;
+  }
+  
+  offsetAt(utc);
+  for (int i = 0; i < transitionCount; i++) {
+    if (transitions[i].utc > utc) {
+      return transitions[i].utc;
+    }
+  }
+  
+  // Past the end of the table - the first one next year
+  int64_t days = utc / SECONDS_PER_DAY;
+  buildTable(yearOfDays(days));
+  cacheFrom = 0;
+  cacheUntil = 0;
+  for (int i = 0; i < transitionCount; i++) {
+    if (transitions[i].utc > utc) {
+      return transitions[i].utc;
+    }
+  }
+  return 0;
+}
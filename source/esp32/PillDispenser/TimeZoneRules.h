@@ -0,0 +1,83 @@
+#ifndef TIME_ZONE_RULES_H
+#define TIME_ZONE_RULES_H
+
+#include <Arduino.h>
+
+/**
+ * TimeZoneRules
+ *
+ * POSIX TZ string support, e.g. "PHT-8", "CET-1CEST,M3.5.0,M10.5.0/3" or
+ * "AEST-10AEDT,M10.1.0,M4.1.0/3". Offsets follow POSIX: "-8" means 8 hours
+ * east of UTC.
+ *
+ * The DST rules are expanded once into a table of UTC transition times
+ * covering TZ_TABLE_YEARS years. The segment the last lookup fell in is
+ * cached, so converting UTC to local time is a compare or two per call;
+ * the table is rebuilt only when a lookup falls outside it.
+ */
+
+#define TZ_TABLE_YEARS 10
+#define TZ_MAX_TRANSITIONS (TZ_TABLE_YEARS * 2)
+#define TZ_STRING_MAX 48
+#define TZ_NAME_MAX 8
+
+struct TZRule {
+  char type;        // 'M' = month.week.day, 'J' = Julian day 1-365, 'D' = zero-based day 0-365
+  int month;        // 1-12 ('M' rules)
+  int week;         // 1-5, 5 = last ('M' rules)
+  int day;          // Day of week 0=Sunday ('M'), or day number ('J'/'D')
+  int32_t time;     // Seconds after local midnight the change happens
+};
+
+struct TZTransition {
+  int64_t utc;      // First UTC second the new offset applies
+  int32_t offset;   // Seconds east of UTC from here on
+  bool dst;
+};
+
+class TimeZoneRules {
+private:
+  char posix[TZ_STRING_MAX];
+  char stdName[TZ_NAME_MAX];
+  char dstName[TZ_NAME_MAX];
+  int32_t stdOffset;  // Seconds east of UTC
+  int32_t dstOffset;
+  bool hasDst;
+  TZRule startRule;   // Into DST, given in standard local time
+  TZRule endRule;     // Out of DST, given in daylight local time
+  
+  // Precompiled transitions
+  TZTransition transitions[TZ_MAX_TRANSITIONS];
+  int transitionCount;
+  int tableFirstYear;
+  int32_t initialOffset;  // In effect before the first transition
+  bool initialDst;
+  
+  // Cached segment [cacheFrom, cacheUntil)
+  int64_t cacheFrom;
+  int64_t cacheUntil;
+  int32_t cacheOffset;
+  bool cacheDst;
+  
+  bool parse(const char* tz);
+  static const char* parseName(const char* p, char* out);
+  static const char* parseOffset(const char* p, int32_t* seconds);
+  static const char* parseRule(const char* p, TZRule* rule);
+  static int64_t daysFromCivil(int year, int month, int day);
+  static int yearOfDays(int64_t days);
+  static int64_t ruleDay(const TZRule& rule, int year);
+  void buildTable(int firstYear);
+  void lookup(int64_t utc);
+  
+public:
+  TimeZoneRules();
+  bool set(const char* tz);   // Keeps the current zone if tz does not parse
+  const char* getString();
+  
+  int32_t offsetAt(int64_t utc);      // Seconds east of UTC
+  bool isDstAt(int64_t utc);
+  const char* nameAt(int64_t utc);    // Abbreviation, e.g. "CEST"
+  int64_t nextTransition(int64_t utc); // 0 if the zone has no DST
+};
+
+#endif
@@ -20,7 +20,39 @@ const String USER_ID = "MmRwYAQXJiZcA7jgvkjCOw0m5Uz2";  // Firebase auth user ID
 // Device Configuration
 const String DEVICE_NAME = "PillDispenser_V3";
 
+// Default time zone as a POSIX TZ string (overridden by /system_config/timezone)
+// e.g. "PHT-8" (Philippines), "CET-1CEST,M3.5.0,M10.5.0/3" (Central Europe), "EST5EDT,M3.2.0,M11.1.0" (US Eastern)
+const String DEVICE_TIMEZONE = "PHT-8";
+
 // Emergency Contact (used for system error notifications)
 const String EMERGENCY_PHONE = CAREGIVER_1_PHONE;
 
+// Missed-dose escalation (SMS first, then voice calls down the contact list)
+const unsigned long ESCALATION_ACK_MINUTES = 10;   // Minutes to reply ACK before calls start
+const unsigned long ESCALATION_RING_SECONDS = 45;  // Ring time per call before trying the next contact
+
+// Battery pack (used for state of charge and runtime estimates)
+const String BATTERY_CHEMISTRY = "liion";           // "liion" (18650 NMC) or "lifepo4"
+const uint8_t BATTERY_CELLS = 2;                    // Cells in series (2S)
+const unsigned int BATTERY_CAPACITY_MAH = 2600;     // Capacity of one cell string
+
+// Heap fragmentation guard: when the largest free block stays below the floor,
+// caregivers get a system error SMS and the dispenser restarts at a quiet moment
+const uint32_t MEMORY_BLOCK_FLOOR_BYTES = 24576;  // Room for a TLS session plus margin
+const int MEMORY_RESTART_QUIET_MINUTES = 60;      // No restart this close to a scheduled dose
+
+// Light sleep between doses: the ESP32 sleeps while idle and wakes for alarms,
+// console input, the Arduino Uno and the SIM800L ring indicator ("power off" disables at runtime)
+const bool POWER_LIGHT_SLEEP = true;
+
+// GPRS fallback (used for cloud reporting when WiFi is down)
+const String GPRS_APN = "internet";   // Carrier APN, e.g. "internet" (Smart) or "internet.globe.com.ph" (Globe)
+const String GPRS_USER = "";          // Leave empty if the carrier does not require it
+const String GPRS_PASSWORD = "";
+// Realtime Database secret (Project settings > Service accounts > Database secrets).
+// Without it GPRS uploads use the access token cached while WiFi was up, which
+// expires within an hour of the outage starting and may be too long for the
+// SIM800's URL limit - after that, writes wait for WiFi.
+const String GPRS_DATABASE_SECRET = "";
+
 #endif // USER_CONFIG_H
\ No newline at end of file
@@ -2,7 +2,6 @@
 #include <Arduino.h>
 
 // Initialize static constants
-const float VoltageSensor::ADC_VOLTAGE_STEP = 0.00080566;   // 3.3V / 4095 ≈ 0.00080566V (ESP32 12-bit ADC with 11dB attenuation)
 const float VoltageSensor::VOLTAGE_DIVIDER_RATIO = 5.0;    // 25V / 5V = 5.0
 
 VoltageSensor::VoltageSensor(uint8_t pin) {
@@ -12,22 +11,54 @@ VoltageSensor::VoltageSensor(uint8_t pin) {
   lastBatteryPercentage = 0.0;
   lastAdcValue = 0;
   lastBatteryUpdate = 0;
+  
+  sampleTimer = nullptr;
+  memset(medianWindow, 0, sizeof(medianWindow));
+  medianIndex = 0;
+  filterQ8 = 0;
+  publishedQ8 = 0;
+  sampleCount = 0;
+  rawSum = 0;
+  rawSumSquares = 0;
+  filteredSum = 0;
+  filteredSumSquares = 0;
+  windowCount = 0;
+  rawNoiseMicroVolts = 0;
+  filteredNoiseMicroVolts = 0;
 }
 
 void VoltageSensor::begin() {
   pinMode(analogPin, INPUT);
   
   // Configure ADC attenuation for full 0-3.3V range
+  analogReadResolution(12);
   analogSetAttenuation(ADC_11db);  // 0-3.3V range
   
+  // Prime the median and the filter so the first reads don't ramp up from 0
+  uint16_t first = analogReadMilliVolts(analogPin);
+  for (uint8_t i = 0; i < MEDIAN_TAPS; i++) {
+    medianWindow[i] = first;
+  }
+  filterQ8 = (int32_t)first << 8;
+  publishedQ8 = filterQ8;
+  
+  if (sampleTimer == nullptr) {
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = onSampleTimer;
+    timerArgs.arg = this;
+    timerArgs.name = "vsense";
+    if (esp_timer_create(&timerArgs, &sampleTimer) != ESP_OK ||
+        esp_timer_start_periodic(sampleTimer, SAMPLE_INTERVAL_US) != ESP_OK) {
+      Serial.println("VoltageSensor: ❌ Failed to start sampling timer");
+    }
+  }
+  
   Serial.println("VoltageSensor: Module initialized");
   Serial.print("VoltageSensor: Pin: GPIO ");
   Serial.println(analogPin);
-  Serial.print("VoltageSensor: ADC Resolution: ");
-  Serial.println(ADC_RESOLUTION);
-  Serial.print("VoltageSensor: Voltage Step: ");
-  Serial.print(ADC_VOLTAGE_STEP, 8);
-  Serial.println(" V");
+  Serial.print("VoltageSensor: Sampling: ");
+  Serial.print(1000000 / SAMPLE_INTERVAL_US);
+  Serial.println(" Hz, calibrated, median-5 + IIR");
   Serial.print("VoltageSensor: Input Range: 0-25V (via voltage divider)");
   Serial.println();
   
@@ -38,14 +69,71 @@ void VoltageSensor::begin() {
   Serial.println(" V");
 }
 
+void VoltageSensor::onSampleTimer(void* arg) {
+  VoltageSensor* self = (VoltageSensor*)arg;
+  self->processSample(analogReadMilliVolts(self->analogPin));
+}
+
+uint16_t VoltageSensor::median(const uint16_t* values) {
+  uint16_t sorted[MEDIAN_TAPS];
+  memcpy(sorted, values, sizeof(sorted));
+  
+  // Insertion sort, 5 elements
+  for (uint8_t i = 1; i < MEDIAN_TAPS; i++) {
+    uint16_t value = sorted[i];
+    int8_t j = i - 1;
+    while (j >= 0 && sorted[j] > value) {
+      sorted[j + 1] = sorted[j];
+      j--;
+    }
+    sorted[j + 1] = value;
+  }
+  return sorted[MEDIAN_TAPS / 2];
+}
+
+// Runs in the esp_timer task
+void VoltageSensor::processSample(uint16_t milliVolts) {
+  medianWindow[medianIndex] = milliVolts;
+  medianIndex = (medianIndex + 1) % MEDIAN_TAPS;
+  
+  int32_t input = (int32_t)median(medianWindow) << 8;
+  filterQ8 += (input - filterQ8) >> IIR_SHIFT;
+  
+  // Single aligned 32-bit store - readers always see a whole value
+  publishedQ8 = filterQ8;
+  sampleCount++;
+  
+  // Noise of the unfiltered samples vs the filter output
+  rawSum += milliVolts;
+  rawSumSquares += (int64_t)milliVolts * milliVolts;
+  filteredSum += filterQ8;
+  filteredSumSquares += (int64_t)filterQ8 * filterQ8;
+  windowCount++;
+  
+  if (windowCount >= NOISE_WINDOW) {
+    // n^2 * variance in integers - a float mean^2 would cancel out the signal
+    int64_t rawSpread = windowCount * rawSumSquares - rawSum * rawSum;
+    int64_t filteredSpread = windowCount * filteredSumSquares - filteredSum * filteredSum;
+  
+    rawNoiseMicroVolts = rawSpread > 0 ? (uint32_t)(sqrt((double)rawSpread) * 1000.0 / windowCount) : 0;
+    filteredNoiseMicroVolts = filteredSpread > 0 ? (uint32_t)(sqrt((double)filteredSpread) * 1000.0 / 256.0 / windowCount) : 0;
+  
+    rawSum = 0;
+    rawSumSquares = 0;
+    filteredSum = 0;
+    filteredSumSquares = 0;
+    windowCount = 0;
+  }
+}
+
+// Direct single-shot conversion, for diagnostics only
 uint16_t VoltageSensor::readADC() {
   lastAdcValue = analogRead(analogPin);
   return lastAdcValue;
 }
 
 float VoltageSensor::readRawVoltage() {
-  lastAdcValue = analogRead(analogPin);
-  lastRawVoltage = lastAdcValue * ADC_VOLTAGE_STEP;
+  lastRawVoltage = publishedQ8 / 256000.0f;
   return lastRawVoltage;
 }
 
@@ -68,18 +156,9 @@ uint16_t VoltageSensor::getLastADC() {
 }
 
 float VoltageSensor::readAveragedVoltage(uint8_t samples) {
-  if (samples == 0) samples = 1;
-  
-  float sum = 0.0;
-  for (uint8_t i = 0; i < samples; i++) {
-    sum += readActualVoltage();
-    delay(10);
-  }
-  
-  float averaged = sum / samples;
-  lastActualVoltage = averaged;
-  
-  return averaged;
+  // The background filter already averages; this no longer samples or waits
+  (void)samples;
+  return readActualVoltage();
 }
 
 bool VoltageSensor::isVoltageLow(float threshold) {
@@ -91,10 +170,8 @@ bool VoltageSensor::isVoltageHigh(float threshold) {
 }
 
 bool VoltageSensor::isConnected() {
-  // Sensor is always "connected" if pin is readable
-  // Check if we get a valid ADC reading
-  uint16_t testValue = analogRead(analogPin);
-  return (testValue <= ADC_RESOLUTION);
+  // Connected once the background sampler is producing readings
+  return sampleTimer != nullptr && sampleCount > 0;
 }
 
 float VoltageSensor::calculateBatteryPercentage(float voltage) {
@@ -117,7 +194,7 @@ float VoltageSensor::calculateBatteryPercentage(float voltage) {
 }
 
 float VoltageSensor::readBatteryPercentage() {
-  float voltage = readAveragedVoltage(5); // Average of 5 samples
+  float voltage = readActualVoltage();
   lastBatteryPercentage = calculateBatteryPercentage(voltage);
   lastBatteryUpdate = millis();
   return lastBatteryPercentage;
@@ -147,7 +224,20 @@ bool VoltageSensor::isBatteryLow(float threshold) {
   return lastBatteryPercentage < threshold;
 }
 
+float VoltageSensor::getRawNoiseMilliVolts() {
+  return rawNoiseMicroVolts / 1000.0f * VOLTAGE_DIVIDER_RATIO;
+}
+
+float VoltageSensor::getFilteredNoiseMilliVolts() {
+  return filteredNoiseMicroVolts / 1000.0f * VOLTAGE_DIVIDER_RATIO;
+}
+
+uint32_t VoltageSensor::getSampleCount() {
+  return sampleCount;
+}
+
 void VoltageSensor::printDebug() {
+  readADC();
   readActualVoltage();
   readBatteryPercentage();
   
@@ -166,6 +256,13 @@ void VoltageSensor::printDebug() {
   Serial.println(" %");
   Serial.print("Battery Status:  ");
   Serial.println(getBatteryStatus());
+  Serial.print("Noise (1 s):     ");
+  Serial.print(getRawNoiseMilliVolts(), 1);
+  Serial.print(" mV raw -> ");
+  Serial.print(getFilteredNoiseMilliVolts(), 2);
+  Serial.println(" mV filtered");
+  Serial.print("Samples:         ");
+  Serial.println(sampleCount);
   Serial.println("─────────────────────────────────────");
 }
 
@@ -2,15 +2,53 @@
 #define VOLTAGE_SENSOR_H
 
 #include <Arduino.h>
+#include "esp_timer.h"
 
+/**
+ * VoltageSensor
+ *
+ * The ADC is sampled in the background from an esp_timer at a fixed rate.
+ * Each sample is converted with the eFuse calibration (analogReadMilliVolts
+ * uses the ADC characterisation, which corrects the ESP32's nonlinear
+ * response), passed through a 5-tap median to drop spikes from the servo
+ * and GSM current bursts, then through a fixed-point first-order IIR.
+ *
+ * The filtered value is published as a single 32-bit word, so reads never
+ * block, never touch the ADC and need no lock.
+ */
 class VoltageSensor {
 private:
   uint8_t analogPin;
   static const uint16_t ADC_RESOLUTION = 4095;  // 12-bit ADC
-  static const float ADC_VOLTAGE_STEP;          // 0.00489V per increment
   static const float VOLTAGE_DIVIDER_RATIO;     // 25.0 / 5.0 = 5.0
   static const uint8_t SAMPLE_COUNT = 10;       // Number of samples for averaging
   
+  // Background sampling
+  static const uint32_t SAMPLE_INTERVAL_US = 10000;  // 100 Hz
+  static const uint8_t MEDIAN_TAPS = 5;
+  static const uint8_t IIR_SHIFT = 5;                // alpha = 1/32, ~0.3 s time constant
+  static const uint16_t NOISE_WINDOW = 100;          // Samples per noise estimate (1 s)
+  
+  esp_timer_handle_t sampleTimer;
+  uint16_t medianWindow[MEDIAN_TAPS];
+  uint8_t medianIndex;
+  int32_t filterQ8;                          // Pin millivolts << 8
+  volatile uint32_t publishedQ8;             // Latest filterQ8, written only by the sampler
+  volatile uint32_t sampleCount;
+  
+  // Noise (standard deviation) over the last window, raw vs filtered
+  int64_t rawSum;
+  int64_t rawSumSquares;
+  int64_t filteredSum;
+  int64_t filteredSumSquares;
+  uint16_t windowCount;
+  volatile uint32_t rawNoiseMicroVolts;
+  volatile uint32_t filteredNoiseMicroVolts;
+  
+  static void onSampleTimer(void* arg);
+  void processSample(uint16_t milliVolts);
+  static uint16_t median(const uint16_t* values);
+  
   // Battery calibration (18650 Li-ion 2S configuration: 6.0V - 8.4V)
   static constexpr float BATTERY_MIN_VOLTAGE = 6.0;   // 3.0V per cell x 2 = 6.0V (empty)
   static constexpr float BATTERY_MAX_VOLTAGE = 8.4;  // 4.2V per cell x 2 = 8.4V (full)
@@ -43,10 +81,15 @@ public:
   String getBatteryStatus();  // Returns: "Full", "Good", "Low", "Critical"
   
   // Advanced features
-  float readAveragedVoltage(uint8_t samples = SAMPLE_COUNT);
+  float readAveragedVoltage(uint8_t samples = SAMPLE_COUNT);  // Filtered value; samples kept for compatibility
   bool isVoltageLow(float threshold = 6.5);  // Updated for 2S battery
   bool isVoltageHigh(float threshold = 8.4); // Updated for 2S battery
   bool isBatteryLow(float threshold = 20.0); // Battery % threshold
+  
+  // Filter statistics (at the battery, i.e. after the divider ratio)
+  float getRawNoiseMilliVolts();
+  float getFilteredNoiseMilliVolts();
+  uint32_t getSampleCount();
 };
 
 #endif
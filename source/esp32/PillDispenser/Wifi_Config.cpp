@@ -53,7 +53,7 @@ bool setupWiFiWithManager(TimeManager* timeManager, const char* apName) {
         // Initialize NTP after successful WiFi connection
         if (timeManager != nullptr) {
             Serial.println("Initializing NTP time sync...");
-            timeManager->begin("pool.ntp.org", 28800, 0); // GMT+8 Philippine Time
+            timeManager->begin("pool.ntp.org"); // Time zone comes from loadTimezone()/system_config
         }
         
         return true;